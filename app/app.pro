@@ -0,0 +1,24 @@
+TEMPLATE = app
+TARGET = myMusicPlayer
+
+include(../common.pri)
+include(../core/core.pri)
+
+SOURCES += \
+    main.cpp \
+    mainwindow.cpp
+
+HEADERS += \
+    mainwindow.h
+
+FORMS += \
+    mainwindow.ui
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+RESOURCES += \
+    ../icons.qrc \
+    ../styles.qrc
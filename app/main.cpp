@@ -0,0 +1,83 @@
+#include "mainwindow.h"
+#include "startuptrace.h"
+#include "refreshscheduler.h"
+#include "iconregistry.h"
+#include "framemeter.h"
+#include "spectrumanalyzer.h"
+#include "playerengine.h"
+#include "controlserver.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <memory>
+
+int main(int argc, char *argv[])
+{
+    StartupTrace::start();
+    QApplication::setApplicationName("myMusicPlayer");
+    QApplication::setOrganizationName("CrystallisR");
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+
+    // without a window there is no need for a gui application, or a display
+    bool headless = false;
+    for (int arg = 1; arg < argc; arg++)
+        if (qstrcmp(argv[arg], "--headless") == 0) headless = true;
+    std::unique_ptr<QCoreApplication> app(headless ? new QCoreApplication(argc, argv)
+                                                   : new QApplication(argc, argv));
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption trace_option("trace-startup",
+        "Print time to first paint, time to interactive and time to full library.");
+    parser.addOption(trace_option);
+    QCommandLineOption wakeup_option("trace-wakeups",
+        "Print ui refreshes per second, to check what playback costs while idle or hidden.");
+    parser.addOption(wakeup_option);
+    QCommandLineOption fps_option("trace-fps",
+        "Print frames per second and the longest frame of the music list while it repaints.");
+    parser.addOption(fps_option);
+    QCommandLineOption spectrum_option("trace-spectrum",
+        "Print how much of one core the spectrum analysis takes while it runs.");
+    parser.addOption(spectrum_option);
+    QCommandLineOption headless_option("headless",
+        "Play without a window, driven only through the control socket.");
+    parser.addOption(headless_option);
+    QCommandLineOption socket_option("control-socket",
+        "Name of the local control socket (default " + ControlServer::defaultName() + ").",
+        "name", ControlServer::defaultName());
+    parser.addOption(socket_option);
+    parser.process(*app);
+    StartupTrace::setEnabled(parser.isSet(trace_option));
+    RefreshScheduler::setTracing(parser.isSet(wakeup_option));
+    FrameMeter::setTracing(parser.isSet(fps_option));
+    SpectrumAnalyzer::setTracing(parser.isSet(spectrum_option));
+
+    if (headless)
+    { // the engine alone, settings and session are kept as the window would keep them
+        PlayerEngine engine;
+        ControlServer control_server(&engine);
+        if (!control_server.listen(parser.value(socket_option)))
+        {
+            qWarning() << "cannot listen on" << parser.value(socket_option) << control_server.errorString();
+            return 1;
+        }
+        QObject::connect(app.get(), &QCoreApplication::aboutToQuit, &engine, &PlayerEngine::writeSettings);
+        engine.start();
+        return app->exec();
+    }
+
+    QFile themeFile( ":css/styles/normalTheme.css" );
+    themeFile.open( QFile::ReadOnly );
+    QString appStyleSheet( themeFile.readAll() );
+    static_cast<QApplication*>(app.get())->setStyleSheet(appStyleSheet);
+
+    // decoded once here, every widget and list row shares them afterwards
+    IconRegistry::preload();
+    MainWindow w;
+    w.show();
+    // the window's engine answers the control socket as well
+    ControlServer control_server(w.getEngine());
+    if (!control_server.listen(parser.value(socket_option)))
+        qWarning() << "cannot listen on" << parser.value(socket_option) << control_server.errorString();
+    return app->exec();
+}
@@ -0,0 +1,745 @@
+#include "mainwindow.h"
+#include "ui_mainwindow.h"
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent)
+    , ui(new Ui::MainWindow)
+    , spectrum_analyzer(new SpectrumAnalyzer)
+    , ui_refresh(new RefreshScheduler)
+    , waveform_cache(new WaveformCache)
+    , stall_detector(new StallDetector)
+    , shown_seconds(-1)
+    , shown_cover(0)
+{
+    ui->setupUi(this);
+    // the engine reads its own settings, the library itself is loaded in the background, see initDeferred()
+    engine = std::unique_ptr<PlayerEngine>(new PlayerEngine(ui->musicList));
+    music_list = engine->getMusic_list();
+    // load settings
+    // you should read settings after ui is set up
+    // since you may want to initialize some components in ui
+    readSettings();
+
+    // player initialization
+    engine->setAudioTap(spectrum_analyzer->getTap());
+    engine->setVolume(volumeConvert(last_position));
+    ui->actionGapless_Playback->setChecked(engine->getGapless());
+    ui->actionAnalyze_Loudness->setChecked(engine->getAnalyze_loudness());
+    ui->actionWatch_Library->setChecked(engine->getWatch_library());
+
+    // set key shortcuts
+    setShortCutsForAll();
+
+    // set Menu & actions
+    initActions();
+    // initMenus();
+
+    // ui setting
+    ui->volumeSlider->setValue(last_position);
+    ui->volumeDisplay->setText(QString::number(ui->volumeSlider->value()) + "%");
+
+    setWindowIcon(IconRegistry::icon(IR::AppIcon));
+    default_music_image = IconRegistry::pixmap(IR::MusicNote);
+    this->setProperty("windowOpacity", 1.0);
+
+    // other ui componet settings
+    ui->playButton->setEnabled(true);
+    ui->stopButton->setEnabled(false);
+    // set stylesheet
+    // ...
+
+    // signal&slot connecttion
+    initConnect();
+    connect(ui_refresh.get(), &RefreshScheduler::refresh, this, &MainWindow::refreshPosition);
+    if (PerfProbe::isCompiledIn()) stall_detector->start();
+    // whatever ends the app, window, tray or control socket, the settings go out with it
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &MainWindow::writeSettings);
+
+    // the play mode is back right away, the queue once the library has loaded
+    showPlayMode(engine->getPlay_mode());
+
+    // the first paint is traced on the central widget
+    ui->centralwidget->installEventFilter(this);
+    QTimer::singleShot(0, this, &MainWindow::initDeferred);
+}
+
+MainWindow::~MainWindow()
+{
+    delete ui;
+}
+
+PlayerEngine *MainWindow::getEngine() const
+{
+    return engine.get();
+}
+
+void MainWindow::initConnect()
+{
+    // the window follows the engine, whoever drives it
+    connect(engine.get(), &PlayerEngine::stateChanged, this, &MainWindow::stateChanged);
+    connect(engine.get(), &PlayerEngine::positionChanged, this, &MainWindow::positionChanged);
+    connect(engine.get(), &PlayerEngine::trackLoaded, this, &MainWindow::showMusicInfo);
+    connect(engine.get(), &PlayerEngine::playModeChanged, this, &MainWindow::showPlayMode);
+    connect(engine.get(), &PlayerEngine::volumeChanged, this, &MainWindow::showVolume);
+    connect(engine.get(), &PlayerEngine::underrunDetected, this, &MainWindow::showUnderrun);
+    connect(engine.get(), &PlayerEngine::libraryLoaded, this, &MainWindow::libraryLoaded);
+    // library import runs in the background, report how it goes
+    connect(music_list->getScanner(), &LibraryScanner::progress, this, &MainWindow::showImportProgress);
+    connect(music_list->getScanner(), &LibraryScanner::finished, this, &MainWindow::showImportFinished);
+    connect(music_list->getAnalyzer(), &LoudnessAnalyzer::progress, this, &MainWindow::showAnalysisProgress);
+    connect(music_list->getAnalyzer(), &LoudnessAnalyzer::finished, this, &MainWindow::showAnalysisFinished);
+    // covers are read from the cache in the background, show them once they are in
+    connect(music_list->getCover_cache(), &CoverCache::coverLoaded, this, &MainWindow::showCover);
+    connect(music_list, &ManageList::searchFinished, this, &MainWindow::showSearchFinished);
+    connect(music_list, &ManageList::listSorted, this, &MainWindow::showListSorted);
+    connect(music_list, &ManageList::librarySynced, this, &MainWindow::showLibrarySynced);
+    // the seek bar draws the waveform as it is decoded
+    connect(waveform_cache.get(), &WaveformCache::peaksChanged, ui->progressSlider, &WaveformSlider::setPeaks);
+    connect(spectrum_analyzer.get(), &SpectrumAnalyzer::spectrumReady, ui->spectrumView, &SpectrumView::setSpectrum);
+    // sorting reorders the library itself, the file keeps the order
+    const QList<QPair<QAction*, TM::SortField>> sort_actions {
+        {ui->actionSort_By_Title, TM::SortByTitle}, {ui->actionSort_By_Artist, TM::SortByArtist},
+        {ui->actionSort_By_Album, TM::SortByAlbum}, {ui->actionSort_By_Path, TM::SortByPath},
+        {ui->actionSort_By_Duration, TM::SortByDuration}, {ui->actionSort_By_Date_Added, TM::SortByDateAdded}};
+    for (const auto& sort_action : sort_actions)
+    {
+        TM::SortField field = sort_action.second;
+        connect(sort_action.first, &QAction::triggered, this, [this, field]() { sortLibrary(field); });
+    }
+
+    // if not using auto connection by ui designer, use below connection
+    // connect(ui->playButton, &QPushButton::clicked, this, &MainWindow::on_playButton_clicked); //...
+}
+
+void MainWindow::initDeferred()
+{ // runs on the first event loop pass, the window is already up by now
+    setTrayIcon(windowIcon());
+    setMusicListMenu();
+    connectMusicListMenu();
+    setModeButton();
+
+    ui->actionImport_Music_Resources->setEnabled(false);
+    engine->start();
+    StartupTrace::mark(ST::Interactive);
+}
+
+void MainWindow::libraryLoaded(bool)
+{ // the engine has brought the last session back by now
+    ui->actionImport_Music_Resources->setEnabled(true);
+    StartupTrace::mark(ST::LibraryLoaded);
+}
+
+void MainWindow::setShortCutsForAll()
+{
+    ui->playButton->setShortcut(QKeySequence("Space"));
+    ui->stopButton->setShortcut(QKeySequence("Ctrl+C"));
+    ui->forwardButton->setShortcut(QKeySequence("Ctrl+Right"));
+    ui->backwardButton->setShortcut(QKeySequence("Ctrl+Left"));
+    ui->volumeButton->setShortcut(QKeySequence("Ctrl+O"));
+    // diagnostics are not in any menu
+    diagnostics_shortcut = std::unique_ptr<QShortcut>(new QShortcut(QKeySequence("Ctrl+Shift+D"), this));
+    connect(diagnostics_shortcut.get(), &QShortcut::activated, this, &MainWindow::showDiagnostics);
+}
+
+void MainWindow::positionChanged(qint64)
+{ // drawn by refreshPosition() on the next frame
+    ui_refresh->request();
+}
+
+void MainWindow::refreshPosition()
+{ // only what actually changed is touched
+    qint64 duration = engine->duration();
+    qint64 position = engine->position();
+    if (duration != ui->progressSlider->maximum())
+        ui->progressSlider->setMaximum(duration);
+    ui->progressSlider->setValue(position);
+
+    const int base {1000};
+    qint64 total_seconds = position / base;
+    if (total_seconds == shown_seconds) return;
+    shown_seconds = total_seconds;
+    auto seconds = total_seconds % 60;
+    auto minutes = (total_seconds / 60) % 60;
+    auto hours = (total_seconds / 3600) % 24;
+    QTime time(hours, minutes, seconds);
+    ui->durationDisplay->setText(time.toString());
+}
+
+void MainWindow::updateRefreshPaused()
+{
+    ui_refresh->setPaused(!isVisible() || isMinimized());
+    updateSpectrum();
+}
+
+void MainWindow::showDiagnostics()
+{
+    if (!perf_dialog) perf_dialog = std::unique_ptr<PerfDialog>(new PerfDialog(this));
+    perf_dialog->show();
+    perf_dialog->raise();
+    perf_dialog->activateWindow();
+}
+
+void MainWindow::updateSpectrum()
+{ // no analysis while nothing is heard or nothing is shown
+    bool active = engine && engine->playbackState() == QMediaPlayer::PlayingState
+            && !ui_refresh->isPaused();
+    spectrum_analyzer->setActive(active);
+    if (!active) ui->spectrumView->clear();
+}
+
+void MainWindow::stateChanged(QMediaPlayer::PlaybackState state)
+{ // the next track after one that ended is the engine's business
+    updateSpectrum();
+    bool playing = state == QMediaPlayer::PlayingState;
+    ui->playButton->setEnabled(true);
+    ui->stopButton->setEnabled(state != QMediaPlayer::StoppedState);
+    ui->playButton->setIcon(IconRegistry::icon(playing ? IR::PauseButton : IR::PlayButton));
+    play_action->setIcon(IconRegistry::icon(playing ? IR::Pause : IR::Play));
+    play_action->setText(playing ? "&Pause" : "&Play");
+}
+
+// protected
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    auto ret = setYesOrNoMessageBox("Are You Sure to Exit?", "Exit");
+
+    if (ret == QMessageBox::Yes)
+    { // settings and session are written on aboutToQuit
+        event->accept();
+    }
+    else
+    {
+        event->ignore();
+    }
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == ui->centralwidget && event->type() == QEvent::Paint)
+    {
+        StartupTrace::mark(ST::FirstPaint);
+        ui->centralwidget->removeEventFilter(this);
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+    if (screen()) ui_refresh->setRefresh_rate(screen()->refreshRate());
+    updateRefreshPaused();
+}
+
+void MainWindow::hideEvent(QHideEvent *event)
+{
+    QMainWindow::hideEvent(event);
+    updateRefreshPaused();
+}
+
+void MainWindow::changeEvent(QEvent *event)
+{
+    QMainWindow::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange) updateRefreshPaused();
+}
+
+// private slot
+
+void MainWindow::on_actionOpen_File_triggered()
+{
+    QString prompt = "Please Select Your Audio File";
+    QString file_format {"ALL (*.mp3 *.wav *.flac);;"
+                         "MP3 (*.mp3);;WAV (*.wav);;FLAC (*.flac)"};
+    QString file_dir = default_file_dir == "" ? qApp->applicationDirPath() : default_file_dir;
+    QString file_path = QFileDialog::getOpenFileName(this, prompt, file_dir, file_format);
+
+    QFileInfo file_info(file_path);
+    if (file_info.absolutePath() != "") default_file_dir = file_info.absolutePath();
+    if (file_info.fileName() != "") engine->playFile(file_info.absoluteFilePath());
+
+}
+
+void MainWindow::on_actionImport_Music_Resources_triggered()
+{
+    QString prompt = "Please Select Your Audio File Directory";
+    QString import_dir = QFileDialog::getExistingDirectory(this, prompt,\
+               default_import_dir, QFileDialog::DontUseNativeDialog);
+    if (import_dir.isEmpty()) return;
+    QDir dir(import_dir);
+
+    if (!music_list->importToList(dir, engine->getImport_extensions()))
+    {
+        statusBar()->showMessage("An Import Is Already Running", 3000);
+        return;
+    }
+    default_import_dir = import_dir;
+}
+
+void MainWindow::on_actionCancel_Import_triggered()
+{
+    music_list->cancelImport();
+}
+
+void MainWindow::on_actionReset_Music_List_triggered()
+{
+    auto ret = setYesOrNoMessageBox("Are You Sure To Clear All Imported Files?", "Reset");
+    if (ret == QMessageBox::Yes)
+    {
+        engine->getPlay_queue()->clear();
+        music_list->clear();
+    }
+}
+
+void MainWindow::on_actionGapless_Playback_toggled(bool checked)
+{
+    engine->setGapless(checked);
+}
+
+void MainWindow::on_actionAnalyze_Loudness_toggled(bool checked)
+{
+    engine->setAnalyzeLoudness(checked);
+}
+
+void MainWindow::on_actionWatch_Library_toggled(bool checked)
+{
+    engine->setWatchLibrary(checked);
+}
+
+void MainWindow::on_actionCrossfade_triggered()
+{
+    bool ok = false;
+    DK::FadeCurve crossfade_curve = engine->getCrossfade_curve();
+    double seconds = QInputDialog::getDouble(this, "Crossfade", "Crossfade Between Tracks In Seconds (0 = Off):",
+                                             engine->getCrossfade_ms() / 1000.0, 0.0, PIPELINE_MAX_CROSSFADE / 1000.0, 1, &ok);
+    if (!ok) return;
+    if (seconds > 0.0)
+    {
+        QStringList curves {"Equal Power", "Linear"};
+        QString curve = QInputDialog::getItem(this, "Crossfade", "Fade Curve:", curves,
+                                              crossfade_curve == DK::Linear ? 1 : 0, false, &ok);
+        if (!ok) return;
+        crossfade_curve = curve == curves[1] ? DK::Linear : DK::EqualPower;
+    }
+    engine->setCrossfade(qRound(seconds * 1000.0), crossfade_curve);
+}
+
+void MainWindow::on_actionAudio_Engine_triggered()
+{
+    QString label = "Playback Engine:";
+    if (engine->getAudio_engine() == PB::Pipeline)
+    {
+        auto* pipeline = static_cast<AudioPipeline*>(engine->getAudio_player());
+        label = QString("Output Latency %1 ms, %2 Underruns So Far<br>Playback Engine:")
+                .arg(pipeline->latencyMs()).arg(pipeline->getUnderruns());
+    }
+    bool ok = false;
+    QStringList engines {"Qt Multimedia", "Audio Pipeline"};
+    QString chosen = QInputDialog::getItem(this, "Audio Engine", label, engines,
+                                           engine->getAudio_engine() == PB::Pipeline ? 1 : 0, false, &ok);
+    if (!ok) return;
+
+    if (chosen == engines[1])
+    {
+        int buffer_ms = QInputDialog::getInt(this, "Audio Engine", "Output Buffer (ms):",
+                                             engine->getOutput_buffer_ms(), 10, 1000, 10, &ok);
+        if (!ok) return;
+        int period_ms = QInputDialog::getInt(this, "Audio Engine", "Period (ms):",
+                                             engine->getOutput_period_ms(), 1, qMax(1, buffer_ms / 2), 1, &ok);
+        if (!ok) return;
+        engine->setAudioEngine(PB::Pipeline, buffer_ms, period_ms);
+    }
+    else
+        engine->setAudioEngine(PB::Multimedia, engine->getOutput_buffer_ms(), engine->getOutput_period_ms());
+}
+
+void MainWindow::on_actionReplay_Gain_triggered()
+{
+    bool ok = false;
+    QStringList modes {"Off", "Track", "Album"};
+    QString mode = QInputDialog::getItem(this, "Replay Gain", "Normalize Loudness By Tags<br>(Audio Pipeline Only):",
+                                         modes, static_cast<int>(engine->getReplay_gain()), false, &ok);
+    if (!ok) return;
+    engine->setReplayGain(static_cast<TR::GainMode>(modes.indexOf(mode)));
+}
+
+void MainWindow::on_actionSet_Appearance_triggered()
+{
+    this->setProperty("windowOpacity", 1.0);
+}
+
+void MainWindow::on_progressSlider_sliderMoved(int position)
+{
+    engine->seek(position);
+}
+
+void MainWindow::on_volumeSlider_sliderMoved(int position)
+{
+    last_position = position;
+    engine->setVolume(volumeConvert(position));
+}
+
+void MainWindow::on_playButton_clicked()
+{ // icons follow the player, see stateChanged()
+    engine->togglePlay();
+}
+
+void MainWindow::on_stopButton_clicked()
+{
+    engine->stop();
+}
+
+void MainWindow::on_volumeButton_clicked()
+{
+    engine->setMuted(!engine->isMuted());
+}
+
+void MainWindow::on_musicList_doubleClicked(const QModelIndex& index)
+{
+    engine->playRow(music_list->getRow(index));
+}
+
+void MainWindow::on_searchEdit_textChanged(const QString& text)
+{ // matched on the index thread, the list is narrowed once the results are back
+    music_list->search(text);
+}
+
+void MainWindow::on_forwardButton_clicked()
+{
+    engine->next();
+}
+
+void MainWindow::on_backwardButton_clicked()
+{
+    engine->previous();
+}
+
+void MainWindow::on_modeButton_clicked()
+{
+    ui->modeButton->showMenu();
+}
+
+// play control
+void MainWindow::addToPlayQueue()
+{
+    engine->enqueue(music_list->selectedTracks());
+}
+
+void MainWindow::removeFromPlayList()
+{
+    auto ret = setYesOrNoMessageBox("Are You Sure To Remove The Selected File(s) From Play List?"
+                                    "<br>(Local Files Won't Be Affected)"
+                                    ,"Remove Music");
+    // the play queue drops the removed tracks by itself
+    if (ret == QMessageBox::Yes)
+        music_list->removeSelectedFromList();
+}
+
+void MainWindow::setOrderLoopMode()
+{
+    engine->setPlayMode(PQ::PlayMode::Order);
+}
+
+void MainWindow::setSingleLoopMode()
+{
+    engine->setPlayMode(PQ::PlayMode::Single);
+}
+
+void MainWindow::setRandomLoopMode()
+{
+    engine->setPlayMode(PQ::PlayMode::Shuffle);
+}
+
+// ui update
+void MainWindow::showMusicInfo(const QFileInfo& file_info)
+{
+    PERF_SCOPE("showMusicInfo");
+    waveform_cache->request(file_info.absoluteFilePath());
+    // tracks in the library had their tags and cover read in the background,
+    // only files opened from outside it ask the player
+    auto* track_model = music_list->getTrack_model();
+    // the library keeps canonical paths, a file opened through a symlink is found by its target
+    QString file_path = file_info.canonicalFilePath();
+    if (file_path.isEmpty()) file_path = file_info.absoluteFilePath();
+    TM::TrackInfo info = track_model->trackInfo(track_model->rowOf(track_model->idOfPath(file_path)));
+    QString title;
+    QString author;
+    if (info.isValid())
+    {
+        title = info.title;
+        author = info.artist;
+        shown_cover = info.cover_key;
+        showCover(shown_cover);
+    }
+    else
+    {
+        QMediaMetaData file_meta_data = engine->metaData();
+        QImage cover_image = file_meta_data.value(QMediaMetaData::ThumbnailImage).value<QImage>();
+        shown_cover = 0;
+        if (!cover_image.isNull())
+            ui->musicGraphics->setPixmap(QPixmap::fromImage(cover_image));
+        else
+            ui->musicGraphics->setPixmap(default_music_image);
+        title = file_meta_data.value(QMediaMetaData::Title).toString();
+        author = file_meta_data.value(QMediaMetaData::Author).toString();
+    }
+
+    if (!title.isEmpty() && !author.isEmpty())
+        ui->musicNameDisplay->setText(\
+         "Playing " + title + "...<br>Musician ("+ author\
+         + ")<br>File (" + file_info.fileName() + ")");
+    else
+        ui->musicNameDisplay->setText("Playing <"+ file_info.fileName() + ">...");
+
+    // also show music info in tray icon tooltips
+    tray_icon->setToolTip("Playing <"+ file_info.fileName() + ">...");
+}
+
+void MainWindow::showPlayMode(PQ::PlayMode mode)
+{
+    switch (mode) {
+    case PQ::PlayMode::Single:
+        ui->modeButton->setIcon(IconRegistry::icon(IR::SingleLoop));
+        break;
+    case PQ::PlayMode::Shuffle:
+        ui->modeButton->setIcon(IconRegistry::icon(IR::ShuffleLoop));
+        break;
+    default:
+        ui->modeButton->setIcon(IconRegistry::icon(IR::OrderLoop));
+        break;
+    }
+}
+
+void MainWindow::showVolume(float volume, bool muted)
+{ // the slider only moves for changes that did not come from it
+    int position = volumePosition(volume);
+    if (position != last_position)
+    {
+        last_position = position;
+        ui->volumeSlider->setValue(position);
+    }
+    ui->volumeButton->setIcon(IconRegistry::icon(muted ? IR::MuteButton : IR::VolumeButton));
+    ui->volumeDisplay->setText(QString::number(muted ? 0 : position) + "%");
+}
+
+
+void MainWindow::showCover(quint64 cover_key)
+{ // a cover still being read from disk shows up through coverLoaded()
+    if (cover_key != shown_cover) return;
+    QPixmap cover = music_list->getCover_cache()->thumbnail(cover_key);
+    ui->musicGraphics->setPixmap(cover.isNull() ? default_music_image : cover);
+}
+
+void MainWindow::showUnderrun(int underruns, qint64 latency_ms)
+{
+    statusBar()->showMessage(QString("Audio Underrun (%1 So Far), Output Latency %2 ms")
+                             .arg(underruns).arg(latency_ms), 3000);
+}
+
+void MainWindow::showImportProgress(int files_found, double files_per_sec)
+{
+    statusBar()->showMessage(QString("Importing... %1 Files Found (%2 Files/s)")
+                             .arg(files_found).arg(files_per_sec, 0, 'f', 0));
+}
+
+void MainWindow::showImportFinished(bool cancelled, int files_found, qint64 elapsed_ms)
+{
+    QString state = cancelled ? "Import Cancelled" : "Import Finished";
+    statusBar()->showMessage(QString("%1, %2 Files Scanned In %3 s")
+                             .arg(state).arg(files_found).arg(elapsed_ms / 1000.0, 0, 'f', 1), 5000);
+}
+
+void MainWindow::showAnalysisProgress(int done, int total, double tracks_per_sec, double cpu_seconds)
+{
+    statusBar()->showMessage(QString("Analyzing Loudness... %1/%2 Tracks (%3 Tracks/s, %4 s CPU)")
+                             .arg(done).arg(total).arg(tracks_per_sec, 0, 'f', 1).arg(cpu_seconds, 0, 'f', 1), 1000);
+}
+
+void MainWindow::showAnalysisFinished(bool cancelled, int analyzed, qint64 elapsed_ms, double cpu_seconds)
+{ // nothing to say when every track was already measured
+    if (analyzed == 0) return;
+    QString state = cancelled ? "Loudness Analysis Cancelled" : "Loudness Analysis Finished";
+    statusBar()->showMessage(QString("%1, %2 Tracks In %3 s (%4 s CPU)")
+                             .arg(state).arg(analyzed).arg(elapsed_ms / 1000.0, 0, 'f', 1)
+                             .arg(cpu_seconds, 0, 'f', 1), 5000);
+}
+
+void MainWindow::showSearchFinished(int matches, qint64 elapsed_us)
+{
+    statusBar()->showMessage(QString("%1 Matches In %2 ms").arg(matches).arg(elapsed_us / 1000.0, 0, 'f', 2), 3000);
+}
+
+void MainWindow::showListSorted(int tracks, qint64 elapsed_ms)
+{
+    statusBar()->showMessage(QString("%1 Tracks Sorted In %2 s").arg(tracks).arg(elapsed_ms / 1000.0, 0, 'f', 2), 3000);
+}
+
+void MainWindow::showLibrarySynced(int added, int removed, int moved)
+{
+    statusBar()->showMessage(QString("Library Folders Changed, %1 Added, %2 Removed, %3 Moved")
+                             .arg(added).arg(removed).arg(moved), 5000);
+}
+
+void MainWindow::sortLibrary(TM::SortField field)
+{
+    if (music_list->sortList(field, ui->actionSort_Descending->isChecked()))
+        statusBar()->showMessage("Sorting...");
+    else
+        statusBar()->showMessage("Nothing To Sort Until The Library Has Loaded", 3000);
+}
+
+// save/load settings
+void MainWindow::writeSettings()
+{
+    QSettings settings;
+    settings.setValue("file/default_dir", default_file_dir);
+    settings.setValue("file/default_import_dir", default_import_dir);
+    settings.setValue("file/last_volume_pos", last_position);
+    // playback and library settings are the engine's
+    engine->writeSettings();
+}
+
+void MainWindow::readSettings()
+{
+    QSettings settings;
+    default_file_dir = settings.value("file/default_dir", "").toString();
+    default_import_dir = settings.value("file/default_import_dir", default_file_dir).toString();
+    last_position = settings.value("file/last_volume_pos", 25).toInt();
+}
+
+void MainWindow::initActions()
+{
+    quit_action = std::unique_ptr<QAction>(new QAction("&Quit", this));
+    quit_action->setIcon(IconRegistry::icon(IR::Quit));
+    connect(quit_action.get(), &QAction::triggered, qApp, &QCoreApplication::quit);
+
+    add_to_queue_action = std::unique_ptr<QAction>(new QAction("&Add To Play Queue", this));
+    add_to_queue_action->setIcon(IconRegistry::icon(IR::AddToQueue));
+    connect(add_to_queue_action.get(), &QAction::triggered, this, &MainWindow::addToPlayQueue);
+
+    remove_from_list_action = std::unique_ptr<QAction>(new QAction("&Remove From List", this));
+    remove_from_list_action->setIcon(IconRegistry::icon(IR::RemoveFromList));
+    connect(remove_from_list_action.get(), &QAction::triggered, this, &MainWindow::removeFromPlayList);
+
+    play_next_action = std::unique_ptr<QAction>(new QAction("&Play Next", this));
+    play_next_action->setIcon(IconRegistry::icon(IR::Next));
+    connect(play_next_action.get(), &QAction::triggered, this, &MainWindow::on_forwardButton_clicked);
+
+    play_prev_action = std::unique_ptr<QAction>(new QAction("&Play Last", this));
+    play_prev_action->setIcon(IconRegistry::icon(IR::Back));
+    connect(play_prev_action.get(), &QAction::triggered, this, &MainWindow::on_backwardButton_clicked);
+
+    play_action = std::unique_ptr<QAction>(new QAction(("&Play"), this));
+    play_action->setIcon(IconRegistry::icon(IR::Play));
+    connect(play_action.get(), &QAction::triggered, this, &MainWindow::on_playButton_clicked);
+
+    order_loop_action = std::unique_ptr<QAction>(new QAction(("&Order Loop"), this));
+    order_loop_action->setIcon(IconRegistry::icon(IR::OrderLoop));
+    connect(order_loop_action.get(), &QAction::triggered, this, &MainWindow::setOrderLoopMode);
+
+    single_loop_action= std::unique_ptr<QAction>(new QAction(("&Repeat Once"), this));
+    single_loop_action->setIcon(IconRegistry::icon(IR::SingleLoop));
+    connect(single_loop_action.get(), &QAction::triggered, this, &MainWindow::setSingleLoopMode);
+
+    random_loop_action = std::unique_ptr<QAction>(new QAction(("&Shuffle"), this));
+    random_loop_action->setIcon(IconRegistry::icon(IR::ShuffleLoop));
+    connect(random_loop_action.get(), &QAction::triggered, this, &MainWindow::setRandomLoopMode);
+}
+
+void MainWindow::setModeButton()
+{
+    mode_menu = std::unique_ptr<QMenu>(new QMenu(this));
+    mode_menu->setWindowFlag(Qt::FramelessWindowHint);
+    mode_menu->setAttribute(Qt::WA_TranslucentBackground);
+    mode_menu->addAction(order_loop_action.get());
+    mode_menu->addAction(single_loop_action.get());
+    mode_menu->addAction(random_loop_action.get());
+    ui->modeButton->setMenu(mode_menu.get());
+}
+
+void MainWindow::setMusicListMenu()
+{
+    music_list_menu = std::unique_ptr<QMenu>(new QMenu(this));
+    music_list_menu->setWindowFlag(Qt::FramelessWindowHint);
+    music_list_menu->setAttribute(Qt::WA_TranslucentBackground);
+    music_list_menu->addAction(add_to_queue_action.get());
+    music_list_menu->addAction(remove_from_list_action.get());
+}
+
+void MainWindow::connectMusicListMenu()
+{
+    music_list->getItem_list()->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(music_list->getItem_list(), &QWidget::customContextMenuRequested,\
+            this, &MainWindow::showMusicListMenu);
+}
+
+void MainWindow::showMusicListMenu(const QPoint &pos)
+{
+    // get global position
+    QPoint global_pos = music_list->getItem_list()->mapToGlobal(pos);
+    music_list_menu->exec(global_pos);
+}
+
+void MainWindow::setTrayIcon(const QIcon& appIcon)
+{
+    tray_icon = std::unique_ptr<QSystemTrayIcon>(new QSystemTrayIcon(this));
+    tray_icon->setIcon(appIcon);
+    tray_icon->setToolTip("Not Playing Now");
+    setTrayIconMenu();
+    tray_icon->show();
+    // set System Tray Icon Interaction
+    connect(tray_icon.get(), &QSystemTrayIcon::activated, this, &MainWindow::trayIconActivated);
+}
+
+void MainWindow::setTrayIconMenu()
+{
+    // init & set tray menu
+    tray_menu = std::unique_ptr<QMenu>(new QMenu(this));
+    tray_menu->setWindowFlag(Qt::FramelessWindowHint);
+    tray_menu->setAttribute(Qt::WA_TranslucentBackground);
+    tray_menu->addAction(play_next_action.get());
+    tray_menu->addAction(play_action.get());
+    tray_menu->addAction(play_prev_action.get());
+    tray_menu->addAction(quit_action.get());
+    tray_icon->setContextMenu(tray_menu.get());
+}
+
+void MainWindow::trayIconActivated(QSystemTrayIcon::ActivationReason reason)
+{
+    switch (reason)
+    {
+        case QSystemTrayIcon::Trigger:
+          this->tray_icon->showMessage("Playing Now", "To Be Done", IconRegistry::icon(IR::Star));
+          break;
+        default: ;
+    }
+}
+
+// helper functions
+float MainWindow::volumeConvert(int value)
+{// using exponential on volume percent to produce linear changes in perceived loudness
+    if (value < 0) return 0.0f;
+    if (value > 100) return 1.0f;
+    float percent = static_cast<float>(value) / 100.0f;
+    float converted_volume = (qExp<float>(percent) - 1.0f) / (qExp<float>(1.0f) - 1.0f);
+    return converted_volume;
+}
+
+int MainWindow::volumePosition(float volume)
+{ // volumeConvert() backwards, for volume set from outside the window
+    if (volume <= 0.0f) return 0;
+    if (volume >= 1.0f) return 100;
+    return qRound(qLn(volume * (qExp<float>(1.0f) - 1.0f) + 1.0f) * 100.0f);
+}
+
+int MainWindow::setYesOrNoMessageBox(QString message, QString window_title)
+{
+    QMessageBox exit_box;
+
+    exit_box.setWindowTitle(window_title);
+    exit_box.setWindowIcon(IconRegistry::icon(IR::AppIcon));
+    exit_box.setIconPixmap(IconRegistry::pixmap(IR::QuestionMark));
+
+    exit_box.setText(message);
+    exit_box.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+    exit_box.setDefaultButton(QMessageBox::Yes);
+    return exit_box.exec();
+}
@@ -18,13 +18,22 @@
 #include <QtMath>
 #include <QSettings>
 #include <QCloseEvent>
-#include <QListWidgetItem>
+#include <QListView>
 #include <QMessageBox>
 #include <QShortcut>
 #include <memory>
 #include <QSystemTrayIcon>
-#include "playqueue.h"
-#include "managelist.h"
+#include <QStatusBar>
+#include <QTimer>
+#include <QScreen>
+#include "playerengine.h"
+#include "startuptrace.h"
+#include "refreshscheduler.h"
+#include "iconregistry.h"
+#include "waveformcache.h"
+#include "spectrumanalyzer.h"
+#include "perfprobe.h"
+#include "perfdialog.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -37,11 +46,17 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
+    // the window is one client of the engine, the control socket can be another
+    PlayerEngine* getEngine() const;
     void stateChanged(QMediaPlayer::PlaybackState state);
     void positionChanged(qint64 position);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    void changeEvent(QEvent *event) override;
 
 private slots:
 
@@ -61,7 +76,7 @@ private slots:
 
     void on_actionSet_Appearance_triggered();
 
-    void on_musicList_itemDoubleClicked(QListWidgetItem* item);
+    void on_musicList_doubleClicked(const QModelIndex& index);
 
     void on_forwardButton_clicked();
 
@@ -69,14 +84,32 @@ private slots:
 
     void on_actionReset_Music_List_triggered();
 
+    void on_actionCancel_Import_triggered();
+
+    void on_actionGapless_Playback_toggled(bool checked);
+
+    void on_actionAnalyze_Loudness_toggled(bool checked);
+
+    void on_actionWatch_Library_toggled(bool checked);
+
+    void on_actionCrossfade_triggered();
+
+    void on_actionAudio_Engine_triggered();
+
+    void on_actionReplay_Gain_triggered();
+
     void on_modeButton_clicked();
 
+    void on_searchEdit_textChanged(const QString& text);
+
 private:
     Ui::MainWindow *ui;
-    std::unique_ptr<QMediaPlayer> audio_player;
-    std::unique_ptr<QAudioOutput> audio_output;
-    std::unique_ptr<PlayQueue> play_queue;
-    std::unique_ptr<ManageList> music_list;
+    // the audible player copies its output into the analyzer's tap, so it has to outlive the engine
+    std::unique_ptr<SpectrumAnalyzer> spectrum_analyzer;
+    // players, play queue and library
+    std::unique_ptr<PlayerEngine> engine;
+    // the engine's library, kept at hand
+    ManageList* music_list;
     // maybe add a favorite list
     std::unique_ptr<QSystemTrayIcon> tray_icon;
 
@@ -98,27 +131,33 @@ private:
     // file settings
     QString default_file_dir;
     QString default_import_dir;
-    QFileInfo cur_file_info;
     int last_position;
 
     // ui settings
     QPixmap default_music_image;
-
-    // temporary state/ control variable
-    bool volume_button_clicked;
-    bool play_button_clicked;
-    bool music_manually_stopped;
-    float cached_volume;
+    // position updates are drawn once a frame, and not at all while hidden
+    std::unique_ptr<RefreshScheduler> ui_refresh;
+    // peaks of the playing track for the seek bar, decoded once and kept on disk
+    std::unique_ptr<WaveformCache> waveform_cache;
+    // hot path timings, only there when the probes are compiled in
+    std::unique_ptr<StallDetector> stall_detector;
+    std::unique_ptr<PerfDialog> perf_dialog;
+    std::unique_ptr<QShortcut> diagnostics_shortcut;
+    qint64 shown_seconds;
+
+    // cover the music graphics label should show, 0 for none
+    quint64 shown_cover;
 
     // usesr interaction settings
     void setShortCutsForAll();
 
     // signal and slot connection control
     void initConnect();
+    // setup that can wait until the window is on screen
+    void initDeferred();
+    void libraryLoaded(bool ok);
 
     // play control
-    void startPlayingNew(QFileInfo file_info);
-    inline void playListItem(QListWidgetItem* item);
     void addToPlayQueue();
     void removeFromPlayList();
     void setOrderLoopMode();
@@ -126,13 +165,30 @@ private:
     void setRandomLoopMode();
 
     // ui update
-    void showMusicInfo(QMediaPlayer::MediaStatus);
-    inline void updateItemSelectedUI(QListWidgetItem* cur_item, QListWidgetItem* new_item);
+    void showMusicInfo(const QFileInfo& file_info);
+    void showPlayMode(PQ::PlayMode mode);
+    void showVolume(float volume, bool muted);
+    void showCover(quint64 cover_key);
+    void showUnderrun(int underruns, qint64 latency_ms);
+    void showImportProgress(int files_found, double files_per_sec);
+    void showImportFinished(bool cancelled, int files_found, qint64 elapsed_ms);
+    void showAnalysisProgress(int done, int total, double tracks_per_sec, double cpu_seconds);
+    void showAnalysisFinished(bool cancelled, int analyzed, qint64 elapsed_ms, double cpu_seconds);
+    void showSearchFinished(int matches, qint64 elapsed_us);
+    void showListSorted(int tracks, qint64 elapsed_ms);
+    void showLibrarySynced(int added, int removed, int moved);
+    void sortLibrary(TM::SortField field);
 
     // save/load settings
     void writeSettings();
     void readSettings();
 
+    // ui refresh
+    void refreshPosition();
+    void updateRefreshPaused();
+    void updateSpectrum();
+    void showDiagnostics();
+
     // manage menu actions
     void initActions();
 
@@ -150,6 +206,7 @@ private:
 
     // helper functions
     float volumeConvert(int value);
+    int volumePosition(float volume);
     int setYesOrNoMessageBox(QString message, QString window_title);
 };
 
@@ -0,0 +1,581 @@
+#include "audiopipeline.h"
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const qint64 UnknownFrames = std::numeric_limits<qint64>::max();
+}
+
+// PipelineDevice
+
+PipelineDevice::PipelineDevice(AudioPipeline *init_pipeline)
+    : pipeline(init_pipeline)
+{
+
+}
+
+qint64 PipelineDevice::bytesAvailable() const
+{ // the pipeline renders silence when it runs dry, so there is always data
+    return pipeline->getPeriod_frames() * pipeline->getBytes_per_frame() + QIODevice::bytesAvailable();
+}
+
+bool PipelineDevice::isSequential() const
+{
+    return true;
+}
+
+qint64 PipelineDevice::readData(char *data, qint64 maxlen)
+{
+    int bytes_per_frame = pipeline->getBytes_per_frame();
+    int frames = static_cast<int>(qMin<qint64>(maxlen / bytes_per_frame, pipeline->getPeriod_frames()));
+    if (frames <= 0) return 0;
+    if (pipeline->getUse_int16())
+        pipeline->renderInt16(reinterpret_cast<qint16*>(data), frames);
+    else
+        pipeline->render(reinterpret_cast<float*>(data), frames);
+    return static_cast<qint64>(frames) * bytes_per_frame;
+}
+
+qint64 PipelineDevice::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(len)
+    return -1;
+}
+
+// AudioPipeline
+
+AudioPipeline::Deck::Deck()
+    : ring(PIPELINE_SAMPLE_RATE / 1000 * PIPELINE_RING_MS, PIPELINE_CHANNELS)
+    , epoch(0)
+    , requested_start(0)
+    , loaded(false)
+{
+
+}
+
+AudioPipeline::AudioPipeline(QObject *parent)
+    : PlayerBackend{parent}
+    , active_deck(0)
+    , use_int16(false)
+    , buffer_ms(PIPELINE_DEFAULT_BUFFER)
+    , period_ms(PIPELINE_DEFAULT_PERIOD)
+    , playback_state(QMediaPlayer::StoppedState)
+    , media_status(QMediaPlayer::NoMedia)
+    , restart_on_play(false)
+    , next_requested(false)
+    , reported_underruns(0)
+    , current_volume(1.0f)
+    , fade_frames(0)
+    , fade_curve(DK::EqualPower)
+    , abort_fade(false)
+    , period_frames(PIPELINE_SAMPLE_RATE / 1000 * PIPELINE_DEFAULT_PERIOD)
+    , gain_mode(TR::Off)
+    , audio_tap(nullptr)
+    , advanced(false)
+    , ended(false)
+    , underruns(0)
+    , rendered_frames(0)
+    , fade_pos(0)
+    , fade_len(0)
+{
+    limiter.release = DspKernels::releasePerBlock(PIPELINE_SAMPLE_RATE, PIPELINE_LIMIT_RELEASE);
+
+    // the decoders convert to the mixing format, the sink gets the same
+    // unless the device can't take float
+    decode_format.setSampleRate(PIPELINE_SAMPLE_RATE);
+    decode_format.setChannelCount(PIPELINE_CHANNELS);
+    decode_format.setSampleFormat(QAudioFormat::Float);
+
+    QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    QAudioFormat sink_format = decode_format;
+    use_int16 = !device.isFormatSupported(sink_format);
+    if (use_int16) sink_format.setSampleFormat(QAudioFormat::Int16);
+    audio_sink = std::unique_ptr<QAudioSink>(new QAudioSink(device, sink_format));
+    audio_sink->setBufferSize(sink_format.bytesForDuration(buffer_ms * 1000));
+
+    decode_thread.setObjectName("AudioPipeline decode");
+    for (int index = 0; index < 2; index++)
+    {
+        Deck& deck = decks[index];
+        deck.worker = std::unique_ptr<DecodeWorker>(new DecodeWorker(&deck.ring, &deck.state, decode_format));
+        deck.worker->moveToThread(&decode_thread);
+        connectDeck(index);
+    }
+    decode_thread.start();
+
+    // everything the audio thread touches is allocated up front
+    scratch_from.resize(PIPELINE_MAX_RENDER * PIPELINE_CHANNELS);
+    scratch_to.resize(PIPELINE_MAX_RENDER * PIPELINE_CHANNELS);
+    scratch_mix.resize(PIPELINE_MAX_RENDER * PIPELINE_CHANNELS);
+
+    render_device = std::unique_ptr<PipelineDevice>(new PipelineDevice(this));
+    render_device->open(QIODevice::ReadOnly);
+
+    tick_timer.setInterval(PIPELINE_TICK);
+    connect(&tick_timer, &QTimer::timeout, this, &AudioPipeline::tick);
+}
+
+AudioPipeline::~AudioPipeline()
+{
+    audio_sink->stop();
+    for (auto& deck: decks)
+    {
+        DecodeWorker* worker = deck.worker.get();
+        QMetaObject::invokeMethod(worker, [worker]{ worker->shutdown(); }, Qt::BlockingQueuedConnection);
+    }
+    decode_thread.quit();
+    decode_thread.wait();
+}
+
+void AudioPipeline::setSource(const QUrl &source)
+{
+    abort_fade = true;
+    next_requested = false;
+    restart_on_play = false;
+    loadDeck(1 - active_deck, QUrl());
+    loadDeck(active_deck, source);
+    setMediaStatus(source.isEmpty() ? QMediaPlayer::NoMedia : QMediaPlayer::LoadingMedia);
+    emit durationChanged(0);
+    emit positionChanged(0);
+}
+
+QUrl AudioPipeline::source() const
+{
+    return decks[active_deck].source;
+}
+
+void AudioPipeline::play()
+{
+    if (source().isEmpty()) return;
+    if (restart_on_play)
+    {
+        restart_on_play = false;
+        loadDeck(active_deck, source());
+    }
+    ended = false;
+    if (audio_sink->state() == QAudio::SuspendedState)
+        audio_sink->resume();
+    else if (audio_sink->state() != QAudio::ActiveState)
+        startSink();
+    tick_timer.start();
+    setPlaybackState(QMediaPlayer::PlayingState);
+}
+
+void AudioPipeline::pause()
+{
+    if (playback_state != QMediaPlayer::PlayingState) return;
+    audio_sink->suspend();
+    tick_timer.stop();
+    setPlaybackState(QMediaPlayer::PausedState);
+}
+
+void AudioPipeline::stop()
+{
+    if (playback_state == QMediaPlayer::StoppedState) return;
+    audio_sink->stop();
+    tick_timer.stop();
+    abort_fade = true;
+    next_requested = false;
+    // keep the source, play() decodes it again from the start
+    QUrl source = decks[active_deck].source;
+    loadDeck(1 - active_deck, QUrl());
+    loadDeck(active_deck, QUrl());
+    decks[active_deck].source = source;
+    restart_on_play = true;
+    setPlaybackState(QMediaPlayer::StoppedState);
+    emit positionChanged(0);
+}
+
+void AudioPipeline::setPosition(qint64 position)
+{ // QAudioDecoder can't seek, decode again and drop everything before position
+    if (source().isEmpty()) return;
+    restart_on_play = false;
+    abort_fade = true;
+    restartDeck(active_deck, qMax<qint64>(0, position) * PIPELINE_SAMPLE_RATE / 1000);
+    emit positionChanged(position);
+}
+
+qint64 AudioPipeline::position() const
+{
+    const Deck& deck = decks[active_deck];
+    // the audio thread hasn't picked the last seek up yet
+    if (deck.state.seen_epoch != deck.epoch) return frameToMs(deck.requested_start);
+    qint64 played = frameToMs(deck.state.played);
+    return qMax<qint64>(frameToMs(deck.requested_start), played - latencyMs());
+}
+
+qint64 AudioPipeline::duration() const
+{
+    return frameToMs(decks[active_deck].state.total_frames);
+}
+
+QMediaPlayer::PlaybackState AudioPipeline::playbackState() const
+{
+    return playback_state;
+}
+
+QMediaPlayer::MediaStatus AudioPipeline::mediaStatus() const
+{
+    return media_status;
+}
+
+QMediaMetaData AudioPipeline::metaData() const
+{ // the decoder doesn't read tags
+    return QMediaMetaData();
+}
+
+void AudioPipeline::setVolume(float volume)
+{
+    current_volume = volume;
+}
+
+float AudioPipeline::volume() const
+{
+    return current_volume;
+}
+
+bool AudioPipeline::handlesTransitions() const
+{
+    return true;
+}
+
+void AudioPipeline::setNextSource(const QUrl &source)
+{
+    loadDeck(1 - active_deck, source);
+}
+
+void AudioPipeline::setAudioTap(AudioRingBuffer *tap)
+{ // the render output is already 48 kHz stereo float, it is copied as it leaves
+    audio_tap.store(tap, std::memory_order_release);
+}
+
+void AudioPipeline::setCrossfade(int fade_ms, DK::FadeCurve curve)
+{
+    fade_ms = qBound(0, fade_ms, PIPELINE_MAX_CROSSFADE);
+    fade_frames = static_cast<qint64>(fade_ms) * PIPELINE_SAMPLE_RATE / 1000;
+    fade_curve = curve;
+}
+
+int AudioPipeline::getCrossfade_ms() const
+{
+    return static_cast<int>(frameToMs(fade_frames));
+}
+
+void AudioPipeline::setGainMode(TR::GainMode mode)
+{
+    gain_mode = mode;
+}
+
+void AudioPipeline::setOutputTiming(int new_buffer_ms, int new_period_ms)
+{
+    // a period has to fit the scratch buffers and at least twice into the sink buffer
+    new_buffer_ms = qBound(10, new_buffer_ms, 1000);
+    new_period_ms = qBound(1, new_period_ms, qMin(new_buffer_ms / 2, PIPELINE_MAX_RENDER * 1000 / PIPELINE_SAMPLE_RATE));
+    if (new_buffer_ms == buffer_ms && new_period_ms == period_ms) return;
+    buffer_ms = new_buffer_ms;
+    period_ms = new_period_ms;
+    period_frames = PIPELINE_SAMPLE_RATE / 1000 * period_ms;
+
+    // the sink only takes a new buffer size on start
+    QAudio::State sink_state = audio_sink->state();
+    audio_sink->stop();
+    audio_sink->setBufferSize(audio_sink->format().bytesForDuration(buffer_ms * 1000));
+    if (sink_state == QAudio::ActiveState || sink_state == QAudio::IdleState)
+        startSink();
+    else if (sink_state == QAudio::SuspendedState)
+    {
+        startSink();
+        audio_sink->suspend();
+    }
+}
+
+int AudioPipeline::getBuffer_ms() const
+{
+    return buffer_ms;
+}
+
+int AudioPipeline::getPeriod_ms() const
+{
+    return period_ms;
+}
+
+int AudioPipeline::getUnderruns() const
+{
+    return underruns;
+}
+
+qint64 AudioPipeline::latencyMs() const
+{ // what went into the sink minus what the device reports as played
+    if (audio_sink->state() == QAudio::StoppedState) return 0;
+    qint64 latency = frameToMs(rendered_frames) - audio_sink->processedUSecs() / 1000;
+    return qMax<qint64>(0, latency);
+}
+
+void AudioPipeline::render(float *out, int frames)
+{ // runs on the audio thread: no allocation, no locks, no signals, only atomics
+    if (abort_fade.exchange(false))
+    {
+        fade_pos = 0;
+        fade_len = 0;
+    }
+
+    int done = 0;
+    while (done < frames)
+    {
+        int active = active_deck;
+        Deck& cur = decks[active];
+        Deck& next = decks[1 - active];
+        syncDeck(cur);
+        syncDeck(next);
+        float* dst = out + done * PIPELINE_CHANNELS;
+        int want = frames - done;
+
+        if (!cur.state.armed) break;
+
+        if (fade_len > 0)
+        { // mix the tail of the current track into the head of the next one
+            if (!next.state.armed)
+            {
+                fade_pos = 0;
+                fade_len = 0;
+                continue;
+            }
+            int count = static_cast<int>(qMin<qint64>(want, fade_len - fade_pos));
+            int got_from = cur.ring.read(scratch_from.data(), count);
+            int got_to = next.ring.read(scratch_to.data(), count);
+            cur.state.played.fetch_add(got_from, std::memory_order_relaxed);
+            next.state.played.fetch_add(got_to, std::memory_order_relaxed);
+            std::fill(scratch_from.begin() + got_from * PIPELINE_CHANNELS,
+                      scratch_from.begin() + count * PIPELINE_CHANNELS, 0.0f);
+            std::fill(scratch_to.begin() + got_to * PIPELINE_CHANNELS,
+                      scratch_to.begin() + count * PIPELINE_CHANNELS, 0.0f);
+            // the track gains ride on the fade curve, the volume on the limiter pass
+            DspKernels::crossfade(dst, scratch_from.constData(), scratch_to.constData(), count,
+                                  PIPELINE_CHANNELS, fade_pos, fade_len,
+                                  static_cast<DK::FadeCurve>(fade_curve.load()),
+                                  deckGain(cur), deckGain(next));
+            DspKernels::gainLimit(dst, count, PIPELINE_CHANNELS, current_volume,
+                                  PIPELINE_LIMIT_CEILING, limiter);
+            fade_pos += count;
+            done += count;
+            if (fade_pos >= fade_len) switchDecks();
+            continue;
+        }
+
+        bool next_ready = next.state.armed && (next.state.input_done || next.ring.available() > 0);
+        qint64 remaining = remainingFrames(cur);
+        qint64 fade = fade_frames;
+        if (next_ready && fade > 0 && remaining != UnknownFrames)
+        {
+            if (remaining > 0 && remaining <= fade)
+            {
+                fade_pos = 0;
+                fade_len = remaining;
+                continue;
+            }
+            // stop right where the fade has to begin
+            if (remaining > fade) want = static_cast<int>(qMin<qint64>(want, remaining - fade));
+        }
+
+        int got = cur.ring.read(dst, want);
+        cur.state.played.fetch_add(got, std::memory_order_relaxed);
+        DspKernels::gainLimit(dst, got, PIPELINE_CHANNELS, deckGain(cur) * current_volume,
+                              PIPELINE_LIMIT_CEILING, limiter);
+        done += got;
+        if (got == want) continue;
+
+        if (cur.state.input_done && cur.ring.available() == 0)
+        { // end of track, join the next one without a gap
+            if (next_ready)
+            {
+                switchDecks();
+                continue;
+            }
+            ended = true;
+        }
+        else if (cur.state.played > cur.state.start_frame)
+        { // the decoder fell behind in the middle of a track
+            underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+    }
+
+    std::fill(out + done * PIPELINE_CHANNELS, out + frames * PIPELINE_CHANNELS, 0.0f);
+    rendered_frames.fetch_add(frames, std::memory_order_relaxed);
+    // a full tap loses this block, playback never waits on the analyzer
+    if (AudioRingBuffer* tap = audio_tap.load(std::memory_order_acquire)) tap->write(out, frames);
+}
+
+void AudioPipeline::renderInt16(qint16 *out, int frames)
+{
+    render(scratch_mix.data(), frames);
+    DspKernels::floatToInt16(out, scratch_mix.constData(), frames * PIPELINE_CHANNELS);
+}
+
+int AudioPipeline::getBytes_per_frame() const
+{
+    return PIPELINE_CHANNELS * (use_int16 ? sizeof(qint16) : sizeof(float));
+}
+
+bool AudioPipeline::getUse_int16() const
+{
+    return use_int16;
+}
+
+int AudioPipeline::getPeriod_frames() const
+{
+    return period_frames;
+}
+
+// private
+
+void AudioPipeline::connectDeck(int index)
+{
+    DecodeWorker* worker = decks[index].worker.get();
+    connect(worker, &DecodeWorker::loaded, this, [this, index](int epoch, qint64 duration){
+        Deck& deck = decks[index];
+        if (epoch != deck.epoch) return;
+        bool first = !deck.loaded;
+        deck.loaded = true;
+        if (index != active_deck) return;
+        if (duration > 0) emit durationChanged(duration);
+        if (first) setMediaStatus(QMediaPlayer::LoadedMedia);
+    });
+    connect(worker, &DecodeWorker::failed, this, [this, index](int epoch, const QString& message){
+        Deck& deck = decks[index];
+        if (epoch != deck.epoch) return;
+        qWarning() << "AudioPipeline:" << deck.source.toLocalFile() << message;
+        if (index == active_deck) setMediaStatus(QMediaPlayer::InvalidMedia);
+    });
+}
+
+void AudioPipeline::loadDeck(int index, const QUrl &source)
+{
+    Deck& deck = decks[index];
+    deck.source = source;
+    deck.loaded = false;
+    restartDeck(index, 0);
+}
+
+void AudioPipeline::restartDeck(int index, qint64 from_frame)
+{
+    Deck& deck = decks[index];
+    // keep the audio thread off a deck that is about to hold another track
+    if (index != active_deck) deck.state.armed = false;
+    int epoch = ++deck.epoch;
+    deck.requested_start = from_frame;
+    DecodeWorker* worker = deck.worker.get();
+    QUrl source = deck.source;
+    QMetaObject::invokeMethod(worker, [worker, epoch, source, from_frame]{
+        worker->load(epoch, source, from_frame);
+    }, Qt::QueuedConnection);
+}
+
+void AudioPipeline::startSink()
+{
+    rendered_frames = 0;
+    audio_sink->start(render_device.get());
+}
+
+void AudioPipeline::tick()
+{
+    if (advanced.exchange(false))
+    { // the audio thread moved on to the other deck, free the old one
+        loadDeck(1 - active_deck, QUrl());
+        next_requested = false;
+        emit durationChanged(duration());
+        emit sourceAdvanced(source());
+    }
+
+    if (ended.exchange(false))
+    {
+        audio_sink->stop();
+        tick_timer.stop();
+        restart_on_play = true;
+        setMediaStatus(QMediaPlayer::EndOfMedia);
+        setPlaybackState(QMediaPlayer::StoppedState);
+        return;
+    }
+
+    int count = underruns;
+    if (count != reported_underruns)
+    {
+        reported_underruns = count;
+        emit underrunDetected(count, latencyMs());
+    }
+
+    // ask for the next track early enough to decode the start of it before the fade
+    Deck& cur = decks[active_deck];
+    if (!next_requested && cur.loaded && cur.state.seen_epoch == cur.epoch)
+    {
+        qint64 remaining = remainingFrames(cur);
+        if (remaining != UnknownFrames && frameToMs(remaining) < getCrossfade_ms() + PIPELINE_LEAD)
+        {
+            next_requested = true;
+            emit nextSourceNeeded();
+        }
+    }
+
+    emit positionChanged(position());
+}
+
+void AudioPipeline::setPlaybackState(QMediaPlayer::PlaybackState state)
+{
+    if (playback_state == state) return;
+    playback_state = state;
+    emit playbackStateChanged(state);
+}
+
+void AudioPipeline::setMediaStatus(QMediaPlayer::MediaStatus status)
+{
+    if (media_status == status) return;
+    media_status = status;
+    emit mediaStatusChanged(status);
+}
+
+void AudioPipeline::syncDeck(Deck &deck)
+{ // audio thread, drop what an earlier load left in the ring
+    int epoch = deck.state.epoch.load(std::memory_order_acquire);
+    if (epoch == deck.state.seen_epoch.load(std::memory_order_relaxed)) return;
+    deck.ring.discardUntil(deck.state.discard_mark);
+    deck.state.played = deck.state.start_frame.load();
+    deck.state.seen_epoch = epoch;
+}
+
+void AudioPipeline::switchDecks()
+{ // audio thread
+    int old = active_deck;
+    decks[old].state.armed = false;
+    active_deck = 1 - old;
+    fade_pos = 0;
+    fade_len = 0;
+    advanced = true;
+}
+
+float AudioPipeline::deckGain(const Deck &deck) const
+{
+    switch (gain_mode) {
+    case TR::Track:
+        return deck.state.track_gain;
+    case TR::Album:
+        return deck.state.album_gain;
+    default:
+        return 1.0f;
+    }
+}
+
+qint64 AudioPipeline::remainingFrames(const Deck &deck) const
+{
+    if (deck.state.input_done) return deck.ring.available();
+    qint64 total = deck.state.total_frames;
+    if (total <= 0) return UnknownFrames;
+    return qMax<qint64>(0, total - deck.state.played);
+}
+
+qint64 AudioPipeline::frameToMs(qint64 frames) const
+{
+    return frames * 1000 / PIPELINE_SAMPLE_RATE;
+}
@@ -0,0 +1,177 @@
+#ifndef AUDIOPIPELINE_H
+#define AUDIOPIPELINE_H
+
+#include <QObject>
+#include <QIODevice>
+#include <QThread>
+#include <QTimer>
+#include <QAudioSink>
+#include <QAudioFormat>
+#include <QMediaDevices>
+#include <QAudioDevice>
+#include <atomic>
+#include <memory>
+#include "playerbackend.h"
+#include "dspkernels.h"
+#include "audioringbuffer.h"
+#include "decodeworker.h"
+
+QT_BEGIN_NAMESPACE
+namespace AP { class AudioPipeline;}
+QT_END_NAMESPACE
+
+class AudioPipeline;
+
+// pull device for the audio sink, every read renders straight out of the pipeline
+class PipelineDevice : public QIODevice
+{
+public:
+    explicit PipelineDevice(AudioPipeline* init_pipeline);
+
+    qint64 bytesAvailable() const override;
+    bool isSequential() const override;
+
+protected:
+    qint64 readData(char* data, qint64 maxlen) override;
+    qint64 writeData(const char* data, qint64 len) override;
+
+private:
+    AudioPipeline* pipeline;
+};
+
+// plays tracks through QAudioDecoder -> ring buffer -> QAudioSink
+// decoding runs on its own thread, one worker per deck; with two decks the
+// next track can be mixed in (crossfade) or joined sample accurately (gapless)
+class AudioPipeline : public PlayerBackend
+{
+    Q_OBJECT
+    #define PIPELINE_SAMPLE_RATE 48000
+    #define PIPELINE_CHANNELS 2
+    #define PIPELINE_RING_MS 2000
+    #define PIPELINE_MAX_RENDER 8192
+    #define PIPELINE_TICK 20
+    #define PIPELINE_LEAD 10000
+    #define PIPELINE_MAX_CROSSFADE 12000
+    #define PIPELINE_DEFAULT_BUFFER 200
+    #define PIPELINE_DEFAULT_PERIOD 20
+    #define PIPELINE_LIMIT_CEILING 1.0f
+    #define PIPELINE_LIMIT_RELEASE 100
+
+public:
+    explicit AudioPipeline(QObject *parent = nullptr);
+    ~AudioPipeline();
+
+    void setSource(const QUrl& source) override;
+    QUrl source() const override;
+    void play() override;
+    void pause() override;
+    void stop() override;
+    void setPosition(qint64 position) override;
+    qint64 position() const override;
+    qint64 duration() const override;
+    QMediaPlayer::PlaybackState playbackState() const override;
+    QMediaPlayer::MediaStatus mediaStatus() const override;
+    QMediaMetaData metaData() const override;
+
+    void setVolume(float volume) override;
+    float volume() const override;
+
+    bool handlesTransitions() const override;
+    void setNextSource(const QUrl& source) override;
+    void setAudioTap(AudioRingBuffer* tap) override;
+
+    // 0 joins the tracks without a gap, up to PIPELINE_MAX_CROSSFADE ms
+    void setCrossfade(int fade_ms, DK::FadeCurve curve);
+    int getCrossfade_ms() const;
+
+    // replay gain is applied together with the volume, with a true-peak limiter after it
+    void setGainMode(TR::GainMode mode);
+
+    // sink buffer and the most the audio thread renders per callback
+    void setOutputTiming(int buffer_ms, int period_ms);
+    int getBuffer_ms() const;
+    int getPeriod_ms() const;
+
+    // diagnostics
+    int getUnderruns() const;
+    // audio rendered but not yet played by the device
+    qint64 latencyMs() const;
+
+    // audio thread, fills frames of interleaved output
+    void render(float* out, int frames);
+    void renderInt16(qint16* out, int frames);
+    int getBytes_per_frame() const;
+    bool getUse_int16() const;
+    int getPeriod_frames() const;
+
+signals:
+    void underrunDetected(int underruns, qint64 latency_ms);
+
+private:
+    struct Deck
+    {
+        Deck();
+        AudioRingBuffer ring;
+        DW::DeckState state;
+        std::unique_ptr<DecodeWorker> worker;
+        QUrl source;
+        // the last load asked of the worker
+        int epoch;
+        qint64 requested_start;
+        bool loaded;
+    };
+
+    Deck decks[2];
+    std::atomic<int> active_deck;
+    QThread decode_thread;
+    QAudioFormat decode_format;
+    std::unique_ptr<QAudioSink> audio_sink;
+    std::unique_ptr<PipelineDevice> render_device;
+    QTimer tick_timer;
+    bool use_int16;
+    int buffer_ms;
+    int period_ms;
+
+    QMediaPlayer::PlaybackState playback_state;
+    QMediaPlayer::MediaStatus media_status;
+    bool restart_on_play;
+    bool next_requested;
+    int reported_underruns;
+
+    // set by the gui, read by the audio thread
+    std::atomic<float> current_volume;
+    std::atomic<qint64> fade_frames;
+    std::atomic<int> fade_curve;
+    std::atomic<bool> abort_fade;
+    std::atomic<int> period_frames;
+    std::atomic<int> gain_mode;
+    std::atomic<AudioRingBuffer*> audio_tap;
+    // set by the audio thread, picked up on the next tick
+    std::atomic<bool> advanced;
+    std::atomic<bool> ended;
+    std::atomic<int> underruns;
+    std::atomic<qint64> rendered_frames;
+
+    // audio thread only
+    qint64 fade_pos;
+    qint64 fade_len;
+    DK::LimiterState limiter;
+    QVector<float> scratch_from;
+    QVector<float> scratch_to;
+    QVector<float> scratch_mix;
+
+    void connectDeck(int index);
+    void loadDeck(int index, const QUrl& source);
+    void restartDeck(int index, qint64 from_frame);
+    void startSink();
+    void tick();
+    void setPlaybackState(QMediaPlayer::PlaybackState state);
+    void setMediaStatus(QMediaPlayer::MediaStatus status);
+    void syncDeck(Deck& deck);
+    void switchDecks();
+    float deckGain(const Deck& deck) const;
+    qint64 remainingFrames(const Deck& deck) const;
+    qint64 frameToMs(qint64 frames) const;
+};
+
+#endif // AUDIOPIPELINE_H
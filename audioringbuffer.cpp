@@ -0,0 +1,75 @@
+#include "audioringbuffer.h"
+#include <cstring>
+
+AudioRingBuffer::AudioRingBuffer(int min_capacity, int init_channels)
+    : capacity(1)
+    , channels(init_channels)
+    , write_index(0)
+    , read_index(0)
+{
+    while (capacity < min_capacity) capacity <<= 1;
+    mask = static_cast<quint64>(capacity) - 1;
+    samples.resize(capacity * channels);
+}
+
+int AudioRingBuffer::write(const float *in, int frames)
+{
+    quint64 write_pos = write_index.load(std::memory_order_relaxed);
+    quint64 read_pos = read_index.load(std::memory_order_acquire);
+    frames = qMin(frames, capacity - static_cast<int>(write_pos - read_pos));
+    if (frames <= 0) return 0;
+
+    int slot = static_cast<int>(write_pos & mask);
+    int first = qMin(frames, capacity - slot);
+    std::memcpy(samples.data() + slot * channels, in, sizeof(float) * first * channels);
+    std::memcpy(samples.data(), in + first * channels, sizeof(float) * (frames - first) * channels);
+    // publish the frames only once they are in place
+    write_index.store(write_pos + frames, std::memory_order_release);
+    return frames;
+}
+
+int AudioRingBuffer::space() const
+{
+    quint64 write_pos = write_index.load(std::memory_order_relaxed);
+    quint64 read_pos = read_index.load(std::memory_order_acquire);
+    return capacity - static_cast<int>(write_pos - read_pos);
+}
+
+quint64 AudioRingBuffer::writeIndex() const
+{
+    return write_index.load(std::memory_order_relaxed);
+}
+
+int AudioRingBuffer::read(float *out, int frames)
+{
+    quint64 read_pos = read_index.load(std::memory_order_relaxed);
+    quint64 write_pos = write_index.load(std::memory_order_acquire);
+    frames = qMin(frames, static_cast<int>(write_pos - read_pos));
+    if (frames <= 0) return 0;
+
+    int slot = static_cast<int>(read_pos & mask);
+    int first = qMin(frames, capacity - slot);
+    std::memcpy(out, samples.constData() + slot * channels, sizeof(float) * first * channels);
+    std::memcpy(out + first * channels, samples.constData(), sizeof(float) * (frames - first) * channels);
+    // hand the slots back to the producer
+    read_index.store(read_pos + frames, std::memory_order_release);
+    return frames;
+}
+
+int AudioRingBuffer::available() const
+{
+    quint64 read_pos = read_index.load(std::memory_order_relaxed);
+    quint64 write_pos = write_index.load(std::memory_order_acquire);
+    return static_cast<int>(write_pos - read_pos);
+}
+
+void AudioRingBuffer::discardUntil(quint64 index)
+{
+    quint64 read_pos = read_index.load(std::memory_order_relaxed);
+    if (index > read_pos) read_index.store(index, std::memory_order_release);
+}
+
+int AudioRingBuffer::getCapacity() const
+{
+    return capacity;
+}
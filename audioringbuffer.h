@@ -0,0 +1,43 @@
+#ifndef AUDIORINGBUFFER_H
+#define AUDIORINGBUFFER_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <atomic>
+
+QT_BEGIN_NAMESPACE
+namespace AR { class AudioRingBuffer;}
+QT_END_NAMESPACE
+
+// single producer / single consumer ring of interleaved float frames
+// the decoder thread writes, the audio thread reads, neither side ever blocks
+// indices only grow, the slot is index & mask
+class AudioRingBuffer
+{
+public:
+    AudioRingBuffer(int min_capacity, int init_channels);
+
+    // producer side
+    int write(const float* in, int frames);
+    int space() const;
+    quint64 writeIndex() const;
+
+    // consumer side
+    int read(float* out, int frames);
+    int available() const;
+    // drop everything written before index
+    void discardUntil(quint64 index);
+
+    int getCapacity() const;
+
+private:
+    QVector<float> samples;
+    int capacity;
+    quint64 mask;
+    int channels;
+    // kept on separate cache lines so the two threads don't share one
+    alignas(64) std::atomic<quint64> write_index;
+    alignas(64) std::atomic<quint64> read_index;
+};
+
+#endif // AUDIORINGBUFFER_H
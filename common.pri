@@ -0,0 +1,16 @@
+# settings shared by the core library, the app and the tests
+QT += core gui multimedia network
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++17
+CONFIG -= debug_and_release debug_and_release_target
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+# hot path timers (PERF_SCOPE), in debug builds or with CONFIG+=perf_probes
+CONFIG(debug, debug|release)|perf_probes: DEFINES += PERF_PROBES
+
+INCLUDEPATH += $$PWD
@@ -0,0 +1,251 @@
+#include "controlserver.h"
+#include "perfprobe.h"
+#include <QCoreApplication>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+namespace
+{
+    const char* stateName(QMediaPlayer::PlaybackState state)
+    {
+        switch (state) {
+        case QMediaPlayer::PlayingState:
+            return "playing";
+        case QMediaPlayer::PausedState:
+            return "paused";
+        default:
+            return "stopped";
+        }
+    }
+
+    const char* modeName(PQ::PlayMode mode)
+    {
+        switch (mode) {
+        case PQ::Single:
+            return "single";
+        case PQ::Shuffle:
+            return "shuffle";
+        default:
+            return "order";
+        }
+    }
+}
+
+ControlServer::ControlServer(PlayerEngine *init_engine, QObject *parent)
+    : QObject{parent}
+    , engine(init_engine)
+    , server(new QLocalServer)
+{
+    // only the user running the player may drive it
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(server.get(), &QLocalServer::newConnection, this, &ControlServer::acceptClients);
+}
+
+ControlServer::~ControlServer()
+{ // clients are children of the server and go with it
+    server->close();
+}
+
+bool ControlServer::listen(const QString &name)
+{ // only a refused connection means nobody is behind the socket any more
+    listen_error.clear();
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(CS::ProbeTimeout))
+    {
+        probe.disconnectFromServer();
+        listen_error = "another instance is listening on " + name;
+        return false;
+    }
+    if (probe.error() == QLocalSocket::ConnectionRefusedError)
+        QLocalServer::removeServer(name);
+    return server->listen(name);
+}
+
+QString ControlServer::errorString() const
+{
+    return listen_error.isEmpty() ? server->errorString() : listen_error;
+}
+
+QString ControlServer::fullServerName() const
+{
+    return server->fullServerName();
+}
+
+QString ControlServer::defaultName()
+{
+    return QCoreApplication::applicationName() + "-control";
+}
+
+// private
+
+void ControlServer::acceptClients()
+{
+    while (QLocalSocket* client = server->nextPendingConnection())
+    {
+        pending.insert(client, QByteArray());
+        connect(client, &QLocalSocket::readyRead, this, [this, client]() { readClient(client); });
+        connect(client, &QLocalSocket::disconnected, this, [this, client]() { dropClient(client); });
+    }
+}
+
+void ControlServer::readClient(QLocalSocket *client)
+{ // every complete line is run, the rest waits for the next read
+    auto found = pending.find(client);
+    if (found == pending.end()) return;
+    QByteArray& buffer = found.value();
+    buffer += client->readAll();
+
+    QByteArray replies;
+    int commands = 0;
+    qsizetype start = 0;
+    qsizetype end = 0;
+    while ((end = buffer.indexOf('\n', start)) >= 0)
+    {
+        QByteArray line = buffer.mid(start, end - start).trimmed();
+        start = end + 1;
+        if (line.isEmpty()) continue;
+        execute(line, replies);
+        commands++;
+    }
+    buffer.remove(0, start);
+    PERF_COUNT("control_commands", commands);
+
+    if (buffer.size() > CS::MaxLineLength)
+    {
+        replies += "error line too long\n";
+        buffer.clear();
+        client->write(replies);
+        client->disconnectFromServer();
+        return;
+    }
+    if (replies.isEmpty()) return;
+    // sent right away, a quit may end the event loop before it comes back to the socket
+    client->write(replies);
+    client->flush();
+}
+
+void ControlServer::dropClient(QLocalSocket *client)
+{
+    pending.remove(client);
+    client->deleteLater();
+}
+
+void ControlServer::execute(const QByteArray &line, QByteArray &replies)
+{
+    PERF_SCOPE("control_command");
+    qsizetype space = line.indexOf(' ');
+    QByteArray command = space < 0 ? line : line.left(space);
+    QByteArray argument = space < 0 ? QByteArray() : line.mid(space + 1).trimmed();
+    bool ok = true;
+
+    if (command == "status")
+    {
+        replies += "ok " + statusJson() + '\n';
+        return;
+    }
+    else if (command == "play")
+        engine->play();
+    else if (command == "pause")
+        engine->pause();
+    else if (command == "toggle")
+        engine->togglePlay();
+    else if (command == "stop")
+        engine->stop();
+    else if (command == "next")
+        engine->next();
+    else if (command == "previous")
+        engine->previous();
+    else if (command == "seek")
+    {
+        qint64 position = argument.toLongLong(&ok);
+        if (!ok || position < 0)
+        {
+            replies += "error seek takes a position in ms\n";
+            return;
+        }
+        engine->seek(position);
+    }
+    else if (command == "volume")
+    {
+        int percent = argument.toInt(&ok);
+        if (!ok || percent < 0 || percent > 100)
+        {
+            replies += "error volume takes 0-100\n";
+            return;
+        }
+        engine->setVolume(percent / 100.0f);
+    }
+    else if (command == "mode")
+    {
+        if (argument == "order")
+            engine->setPlayMode(PQ::Order);
+        else if (argument == "single")
+            engine->setPlayMode(PQ::Single);
+        else if (argument == "shuffle")
+            engine->setPlayMode(PQ::Shuffle);
+        else
+        {
+            replies += "error mode takes order, single or shuffle\n";
+            return;
+        }
+    }
+    else if (command == "enqueue")
+    { // track ids, or a single path that may contain spaces
+        auto* track_model = engine->getMusic_list()->getTrack_model();
+        QList<TM::TrackId> ids;
+        for (const QByteArray& token : argument.split(' '))
+        {
+            if (token.isEmpty()) continue;
+            TM::TrackId id = token.toUInt(&ok);
+            if (!ok) break;
+            if (track_model->rowOf(id) < 0)
+            {
+                replies += "error no track " + token + '\n';
+                return;
+            }
+            ids.append(id);
+        }
+        if (!ok)
+        {
+            ids.clear();
+            TM::TrackId id = track_model->idOfPath(QString::fromUtf8(argument));
+            if (id == TM::InvalidId)
+            {
+                replies += "error not in the library\n";
+                return;
+            }
+            ids.append(id);
+        }
+        if (ids.isEmpty())
+        {
+            replies += "error enqueue takes track ids or a path\n";
+            return;
+        }
+        engine->enqueue(ids);
+    }
+    else if (command == "quit")
+        QMetaObject::invokeMethod(QCoreApplication::instance(), &QCoreApplication::quit, Qt::QueuedConnection);
+    else
+    {
+        replies += "error unknown command " + command + '\n';
+        return;
+    }
+    replies += "ok\n";
+}
+
+QByteArray ControlServer::statusJson() const
+{
+    PE::Status status = engine->status();
+    QJsonObject json;
+    json["state"] = stateName(status.state);
+    json["track"] = qint64(status.track);
+    json["file"] = status.file_path;
+    json["position"] = status.position;
+    json["duration"] = status.duration;
+    json["volume"] = qRound(status.volume * 100.0f);
+    json["muted"] = status.muted;
+    json["mode"] = modeName(status.play_mode);
+    json["tracks"] = status.tracks;
+    return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,60 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QByteArray>
+#include <QHash>
+#include <memory>
+#include "playerengine.h"
+
+QT_BEGIN_NAMESPACE
+namespace CS { class ControlServer;}
+QT_END_NAMESPACE
+
+namespace CS
+{
+    // a client sending a longer line than this is dropped
+    const int MaxLineLength = 4096;
+    // how long a running instance gets to answer before its socket counts as stale
+    const int ProbeTimeout = 500;
+}
+
+// local control socket for a PlayerEngine, one command per line, one reply line per command:
+//   play | pause | toggle | stop | next | previous | seek <ms> | volume <0-100>
+//   mode order|single|shuffle | enqueue <id|path>... | status | quit
+// replies are "ok", "ok {json}" for status, or "error <message>"
+// everything a read brought in is handled in one go and answered with a single write,
+// so a client pipelining commands costs one wakeup per batch and not one per command
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ControlServer(PlayerEngine* init_engine, QObject *parent = nullptr);
+    ~ControlServer();
+
+    // fails while another instance answers on the name,
+    // a socket left behind by a crashed instance is removed first
+    bool listen(const QString& name = defaultName());
+    QString errorString() const;
+    QString fullServerName() const;
+    static QString defaultName();
+
+private:
+    PlayerEngine* engine;
+    std::unique_ptr<QLocalServer> server;
+    QString listen_error;
+    // bytes after the last complete line, per client
+    QHash<QLocalSocket*, QByteArray> pending;
+
+    void acceptClients();
+    void readClient(QLocalSocket* client);
+    void dropClient(QLocalSocket* client);
+    // runs one command line and appends its reply
+    void execute(const QByteArray& line, QByteArray& replies);
+    QByteArray statusJson() const;
+};
+
+#endif // CONTROLSERVER_H
@@ -0,0 +1,6 @@
+# links the core library, include after common.pri
+CORE_OUT = $$shadowed($$PWD)
+
+LIBS += -L$$CORE_OUT -lmyMusicPlayerCore
+win32-msvc*: PRE_TARGETDEPS += $$CORE_OUT/myMusicPlayerCore.lib
+else: PRE_TARGETDEPS += $$CORE_OUT/libmyMusicPlayerCore.a
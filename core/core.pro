@@ -0,0 +1,82 @@
+# everything but the window, linked into the app and every test through core.pri
+TEMPLATE = lib
+CONFIG += staticlib
+TARGET = myMusicPlayerCore
+
+include(../common.pri)
+
+SOURCES += \
+    ../audiopipeline.cpp \
+    ../audioringbuffer.cpp \
+    ../controlserver.cpp \
+    ../covercache.cpp \
+    ../decodeworker.cpp \
+    ../dspkernels.cpp \
+    ../fftplan.cpp \
+    ../framemeter.cpp \
+    ../iconregistry.cpp \
+    ../librarydatabase.cpp \
+    ../libraryscanner.cpp \
+    ../librarysorter.cpp \
+    ../librarywatcher.cpp \
+    ../loudnessanalyzer.cpp \
+    ../loudnessmeter.cpp \
+    ../managelist.cpp \
+    ../perfdialog.cpp \
+    ../perfprobe.cpp \
+    ../playerbackend.cpp \
+    ../playerengine.cpp \
+    ../playqueue.cpp \
+    ../refreshscheduler.cpp \
+    ../searchindex.cpp \
+    ../searchproxymodel.cpp \
+    ../sessionstore.cpp \
+    ../shuffleorder.cpp \
+    ../spectrumanalyzer.cpp \
+    ../spectrumview.cpp \
+    ../startuptrace.cpp \
+    ../tagreader.cpp \
+    ../tagscanner.cpp \
+    ../trackdelegate.cpp \
+    ../trackmodel.cpp \
+    ../trackring.cpp \
+    ../waveformcache.cpp \
+    ../waveformslider.cpp
+
+HEADERS += \
+    ../audiopipeline.h \
+    ../audioringbuffer.h \
+    ../controlserver.h \
+    ../covercache.h \
+    ../decodeworker.h \
+    ../dspkernels.h \
+    ../fftplan.h \
+    ../framemeter.h \
+    ../iconregistry.h \
+    ../librarydatabase.h \
+    ../libraryscanner.h \
+    ../librarysorter.h \
+    ../librarywatcher.h \
+    ../loudnessanalyzer.h \
+    ../loudnessmeter.h \
+    ../managelist.h \
+    ../perfdialog.h \
+    ../perfprobe.h \
+    ../playerbackend.h \
+    ../playerengine.h \
+    ../playqueue.h \
+    ../refreshscheduler.h \
+    ../searchindex.h \
+    ../searchproxymodel.h \
+    ../sessionstore.h \
+    ../shuffleorder.h \
+    ../spectrumanalyzer.h \
+    ../spectrumview.h \
+    ../startuptrace.h \
+    ../tagreader.h \
+    ../tagscanner.h \
+    ../trackdelegate.h \
+    ../trackmodel.h \
+    ../trackring.h \
+    ../waveformcache.h \
+    ../waveformslider.h
@@ -0,0 +1,106 @@
+#include "covercache.h"
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <cstring>
+
+CoverCache::CoverCache(const QString& init_dir, QObject *parent)
+    : QObject{parent}
+    , dir(init_dir)
+    , thumbnails(COVER_THUMB_MEMORY)
+    , icons(COVER_ICON_MEMORY)
+{
+    QDir().mkpath(dir);
+    load_pool.setMaxThreadCount(2);
+}
+
+CoverCache::~CoverCache()
+{
+    load_pool.waitForDone();
+}
+
+quint64 CoverCache::store(const QByteArray &image_data) const
+{ // the file name is the key, so an image is only ever scaled and written once
+    if (image_data.isEmpty()) return 0;
+    quint64 key {0};
+    memcpy(&key, QCryptographicHash::hash(image_data, QCryptographicHash::Sha1).constData(), sizeof(key));
+    if (!key) key = 1;
+
+    QString file_path = pathOf(key);
+    if (QFile::exists(file_path)) return key;
+
+    QImage image = QImage::fromData(image_data);
+    if (image.isNull()) return 0;
+    if (image.width() > COVER_THUMB_SIZE || image.height() > COVER_THUMB_SIZE)
+        image = image.scaled(COVER_THUMB_SIZE, COVER_THUMB_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    // two threads may write the same cover, QSaveFile keeps that harmless
+    QSaveFile cover_file(file_path);
+    if (!cover_file.open(QIODevice::WriteOnly) || !image.save(&cover_file, "JPG", 90) || !cover_file.commit())
+        return 0;
+    return key;
+}
+
+QPixmap CoverCache::thumbnail(quint64 key)
+{
+    if (!key) return QPixmap();
+    if (QPixmap* pixmap = thumbnails.object(key)) return *pixmap;
+    request(key);
+    return QPixmap();
+}
+
+QPixmap CoverCache::icon(quint64 key)
+{
+    if (!key) return QPixmap();
+    if (QPixmap* pixmap = icons.object(key)) return *pixmap;
+    request(key);
+    return QPixmap();
+}
+
+QString CoverCache::defaultDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/covers";
+}
+
+QString CoverCache::getDir() const
+{
+    return dir;
+}
+
+// private
+
+QString CoverCache::pathOf(quint64 key) const
+{
+    return dir + '/' + QString::number(key, 16).rightJustified(16, '0') + ".jpg";
+}
+
+void CoverCache::request(quint64 key)
+{ // decoding and scaling happen on load_pool, pixmaps are made on the gui thread
+    if (loading.contains(key) || missing.contains(key)) return;
+    loading.insert(key);
+    QString file_path = pathOf(key);
+    load_pool.start([this, key, file_path]() {
+        QImage thumbnail(file_path);
+        QImage small_icon;
+        if (!thumbnail.isNull())
+            small_icon = thumbnail.scaled(COVER_ICON_SIZE, COVER_ICON_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        QMetaObject::invokeMethod(this, [this, key, thumbnail, small_icon]() { loaded(key, thumbnail, small_icon); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+void CoverCache::loaded(quint64 key, const QImage &thumbnail, const QImage &small_icon)
+{
+    loading.remove(key);
+    if (thumbnail.isNull())
+    { // deleted from the cache directory, don't keep asking the disk
+        missing.insert(key);
+        return;
+    }
+    // costs are in KB
+    thumbnails.insert(key, new QPixmap(QPixmap::fromImage(thumbnail)), thumbnail.sizeInBytes() / 1024);
+    icons.insert(key, new QPixmap(QPixmap::fromImage(small_icon)), qMax<qsizetype>(1, small_icon.sizeInBytes() / 1024));
+    emit coverLoaded(key);
+}
@@ -0,0 +1,58 @@
+#ifndef COVERCACHE_H
+#define COVERCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QSet>
+#include <QImage>
+#include <QPixmap>
+#include <QThreadPool>
+
+QT_BEGIN_NAMESPACE
+namespace CC { class CoverCache;}
+QT_END_NAMESPACE
+
+// downscaled cover art, one file per distinct image named after a hash of
+// the embedded picture, so an album's tracks share one entry
+// recently shown pixmaps stay in memory, anything else is read back off the gui thread
+class CoverCache : public QObject
+{
+    Q_OBJECT
+    #define COVER_THUMB_SIZE 256
+    #define COVER_ICON_SIZE 32
+    #define COVER_THUMB_MEMORY (16 * 1024) // KB
+    #define COVER_ICON_MEMORY (8 * 1024) // KB
+
+public:
+    explicit CoverCache(const QString& init_dir = defaultDir(), QObject *parent = nullptr);
+    ~CoverCache();
+
+    // any thread: makes sure a thumbnail of image_data is on disk, 0 if it is no image
+    quint64 store(const QByteArray& image_data) const;
+
+    // gui thread: a null pixmap means it is being read, coverLoaded() follows
+    QPixmap thumbnail(quint64 key);
+    QPixmap icon(quint64 key);
+
+    static QString defaultDir();
+
+    // getters & setters
+    QString getDir() const;
+
+signals:
+    void coverLoaded(quint64 key);
+
+private:
+    QString dir;
+    QCache<quint64, QPixmap> thumbnails;
+    QCache<quint64, QPixmap> icons;
+    QSet<quint64> loading;
+    QSet<quint64> missing;
+    QThreadPool load_pool;
+
+    QString pathOf(quint64 key) const;
+    void request(quint64 key);
+    void loaded(quint64 key, const QImage& thumbnail, const QImage& small_icon);
+};
+
+#endif // COVERCACHE_H
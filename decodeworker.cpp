@@ -0,0 +1,184 @@
+#include "decodeworker.h"
+#include "dspkernels.h"
+#include <QDebug>
+#include <cstring>
+
+DecodeWorker::DecodeWorker(AudioRingBuffer *init_ring, DW::DeckState *init_state,
+                           const QAudioFormat &init_format, QObject *parent)
+    : QObject{parent}
+    , ring(init_ring)
+    , state(init_state)
+    , format(init_format)
+    , epoch(0)
+    , decoding_finished(false)
+    , rate_warned(false)
+    , load_reported(false)
+    , skip_frames(0)
+    , backlog_pos(0)
+{
+
+}
+
+DecodeWorker::~DecodeWorker()
+{
+
+}
+
+void DecodeWorker::load(int new_epoch, const QUrl &new_source, qint64 start_frame)
+{
+    if (!decoder) createDecoder();
+
+    state->armed = false;
+    decoder->stop();
+    drain_timer->stop();
+    backlog.clear();
+    backlog_pos = 0;
+    skip_frames = start_frame;
+    decoding_finished = false;
+    rate_warned = false;
+    load_reported = false;
+    if (new_source != source)
+    { // a seek keeps the track's duration and gains
+        state->total_frames = 0;
+        TR::Tags tags = TagReader::read(new_source.toLocalFile());
+        state->track_gain = TagReader::gainFor(tags, TR::Track);
+        state->album_gain = TagReader::gainFor(tags, TR::Album);
+    }
+    source = new_source;
+    epoch = new_epoch;
+
+    // whatever is in the ring now belongs to the previous load, the audio
+    // thread drops it once it sees the new epoch
+    state->input_done = false;
+    state->start_frame = start_frame;
+    state->discard_mark = ring->writeIndex();
+    state->epoch.store(epoch, std::memory_order_release);
+
+    if (source.isEmpty()) return;
+    decoder->setSource(source);
+    decoder->start();
+    state->armed = true;
+}
+
+void DecodeWorker::shutdown()
+{ // the decoder has to go away on the thread it was made on
+    state->armed = false;
+    drain_timer.reset();
+    decoder.reset();
+}
+
+// private
+
+void DecodeWorker::createDecoder()
+{
+    decoder = std::unique_ptr<QAudioDecoder>(new QAudioDecoder);
+    decoder->setAudioFormat(format);
+    connect(decoder.get(), &QAudioDecoder::bufferReady, this, &DecodeWorker::drain);
+    connect(decoder.get(), &QAudioDecoder::finished, this, [this]{
+        decoding_finished = true;
+        drain();
+    });
+    connect(decoder.get(), &QAudioDecoder::durationChanged, this, [this](qint64 duration){
+        state->total_frames = duration * format.sampleRate() / 1000;
+        load_reported = true;
+        emit loaded(epoch, duration);
+    });
+    connect(decoder.get(), qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), this, [this](QAudioDecoder::Error){
+        state->armed = false;
+        emit failed(epoch, decoder->errorString());
+    });
+
+    drain_timer = std::unique_ptr<QTimer>(new QTimer);
+    drain_timer->setInterval(DECODE_DRAIN_INTERVAL);
+    connect(drain_timer.get(), &QTimer::timeout, this, &DecodeWorker::drain);
+}
+
+void DecodeWorker::appendBuffer(const QAudioBuffer &buffer)
+{
+    if (!buffer.isValid()) return;
+
+    if (!load_reported)
+    { // some backends never report a duration, the first buffer has to do
+        load_reported = true;
+        emit loaded(epoch, decoder->duration());
+    }
+
+    QAudioFormat buffer_format = buffer.format();
+    if (buffer_format.sampleRate() != format.sampleRate() && !rate_warned)
+    {
+        qWarning() << "DecodeWorker: decoder gave" << buffer_format.sampleRate() << "Hz, expected" << format.sampleRate();
+        rate_warned = true;
+    }
+
+    int out_channels = format.channelCount();
+    int channels = buffer_format.channelCount();
+    int skip = static_cast<int>(qMin<qint64>(skip_frames, buffer.frameCount()));
+    int frames = buffer.frameCount() - skip;
+    skip_frames -= skip;
+    if (frames <= 0 || channels <= 0) return;
+
+    if (backlog_pos > 0 && backlog_pos * 2 >= backlog.size())
+    {
+        backlog.remove(0, backlog_pos);
+        backlog_pos = 0;
+    }
+    int base = backlog.size();
+    backlog.resize(base + frames * out_channels);
+    float* out = backlog.data() + base;
+    const char* in = buffer.constData<char>() + buffer_format.bytesForFrames(skip);
+
+    if (channels <= out_channels && buffer_format.sampleFormat() == QAudioFormat::Float)
+        std::memcpy(out, in, sizeof(float) * frames * channels);
+    else if (channels <= out_channels && buffer_format.sampleFormat() == QAudioFormat::Int16)
+        DspKernels::int16ToFloat(out, reinterpret_cast<const qint16*>(in), frames * channels);
+    else if (channels <= out_channels && buffer_format.sampleFormat() == QAudioFormat::Int32)
+        DspKernels::int32ToFloat(out, reinterpret_cast<const qint32*>(in), frames * channels);
+    else
+    { // anything else, keep the first channels
+        int bytes_per_sample = buffer_format.bytesPerSample();
+        int used = qMin(channels, out_channels);
+        for (int frame = 0; frame < frames; frame++)
+            for (int ch = 0; ch < used; ch++)
+                out[frame * used + ch] = buffer_format.normalizedSampleValue(
+                            in + (frame * channels + ch) * bytes_per_sample);
+        channels = used;
+    }
+    if (channels == 1 && out_channels == 2) DspKernels::monoToStereo(out, out, frames);
+}
+
+int DecodeWorker::backlogFrames() const
+{
+    return (backlog.size() - backlog_pos) / format.channelCount();
+}
+
+void DecodeWorker::drain()
+{ // the decoder only goes on once its buffers are read, so a full backlog stops reading
+  // and decoding waits until the ring has taken enough to make room again
+    int out_channels = format.channelCount();
+    int pending = 0;
+    bool progress = true;
+    while (progress)
+    {
+        while (backlogFrames() < ring->getCapacity() && decoder->bufferAvailable())
+            appendBuffer(decoder->read());
+        pending = backlogFrames();
+        int written = pending > 0 ? ring->write(backlog.constData() + backlog_pos, pending) : 0;
+        backlog_pos += written * out_channels;
+        pending -= written;
+        progress = written > 0 && decoder->bufferAvailable();
+    }
+    if (pending == 0)
+    {
+        backlog.clear();
+        backlog_pos = 0;
+    }
+
+    // keep polling while the ring is full or the decoder is held back, rest otherwise
+    if (pending > 0 || decoder->bufferAvailable())
+    {
+        if (!drain_timer->isActive()) drain_timer->start();
+        return;
+    }
+    drain_timer->stop();
+    if (decoding_finished) state->input_done = true;
+}
@@ -0,0 +1,84 @@
+#ifndef DECODEWORKER_H
+#define DECODEWORKER_H
+
+#include <QObject>
+#include <QUrl>
+#include <QTimer>
+#include <QAudioDecoder>
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <atomic>
+#include <memory>
+#include "audioringbuffer.h"
+#include "tagreader.h"
+
+QT_BEGIN_NAMESPACE
+namespace DW { class DecodeWorker;}
+QT_END_NAMESPACE
+
+namespace DW
+{
+    // what the decoder thread, the audio thread and the gui share about one deck
+    struct DeckState
+    {
+        // bumped by the worker each time it starts a new load, after discard_mark and start_frame
+        std::atomic<int> epoch {0};
+        // the load the audio thread has caught up with
+        std::atomic<int> seen_epoch {0};
+        std::atomic<quint64> discard_mark {0};
+        std::atomic<qint64> start_frame {0};
+        // frames the audio thread has taken out of the ring, counted from start_frame
+        std::atomic<qint64> played {0};
+        std::atomic<qint64> total_frames {0};
+        // armed decks may be read by the audio thread
+        std::atomic<bool> armed {false};
+        // nothing more will reach the ring
+        std::atomic<bool> input_done {false};
+        // linear replay gains read from the tags, 1 when there are none
+        std::atomic<float> track_gain {1.0f};
+        std::atomic<float> album_gain {1.0f};
+    };
+}
+
+// runs a QAudioDecoder on the decode thread and writes its pcm into a ring
+class DecodeWorker : public QObject
+{
+    Q_OBJECT
+    #define DECODE_DRAIN_INTERVAL 5
+
+public:
+    DecodeWorker(AudioRingBuffer* init_ring, DW::DeckState* init_state,
+                 const QAudioFormat& init_format, QObject *parent = nullptr);
+    ~DecodeWorker();
+
+    // decode thread only, call through QMetaObject::invokeMethod
+    void load(int epoch, const QUrl& source, qint64 start_frame);
+    void shutdown();
+
+signals:
+    void loaded(int epoch, qint64 duration);
+    void failed(int epoch, const QString& message);
+
+private:
+    AudioRingBuffer* ring;
+    DW::DeckState* state;
+    QAudioFormat format;
+    std::unique_ptr<QAudioDecoder> decoder;
+    std::unique_ptr<QTimer> drain_timer;
+    QUrl source;
+    int epoch;
+    bool decoding_finished;
+    bool rate_warned;
+    bool load_reported;
+    qint64 skip_frames;
+    // decoded frames the ring has no room for yet, about a ring's worth at most
+    QVector<float> backlog;
+    int backlog_pos;
+
+    void createDecoder();
+    void appendBuffer(const QAudioBuffer& buffer);
+    int backlogFrames() const;
+    void drain();
+};
+
+#endif // DECODEWORKER_H
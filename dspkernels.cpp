@@ -0,0 +1,293 @@
+#include "dspkernels.h"
+#include <QtMath>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DK_USE_SSE2
+#endif
+
+namespace
+{
+    // curves are evaluated once per segment and interpolated linearly in between
+    const int FadeSegment = 64;
+    // the limiter decides one gain per block
+    const int LimitBlock = 64;
+
+    inline void curveGains(double t, DK::FadeCurve curve, float& gain_from, float& gain_to)
+    {
+        t = qBound(0.0, t, 1.0);
+        if (curve == DK::EqualPower)
+        {
+            gain_from = static_cast<float>(qCos(t * M_PI_2));
+            gain_to = static_cast<float>(qSin(t * M_PI_2));
+        }
+        else
+        {
+            gain_from = static_cast<float>(1.0 - t);
+            gain_to = static_cast<float>(t);
+        }
+    }
+}
+
+void DspKernels::mixRamp(float *out, const float *from, const float *to, int frames, int channels,
+                         float gain_from, float step_from, float gain_to, float step_to)
+{
+    int frame = 0;
+#ifdef DK_USE_SSE2
+    if (channels == 2)
+    { // two stereo frames per register, both channels share a gain
+        __m128 g_from = _mm_setr_ps(gain_from, gain_from, gain_from + step_from, gain_from + step_from);
+        __m128 g_to = _mm_setr_ps(gain_to, gain_to, gain_to + step_to, gain_to + step_to);
+        const __m128 d_from = _mm_set1_ps(2.0f * step_from);
+        const __m128 d_to = _mm_set1_ps(2.0f * step_to);
+        for (; frame + 2 <= frames; frame += 2)
+        {
+            __m128 a = _mm_loadu_ps(from + frame * 2);
+            __m128 b = _mm_loadu_ps(to + frame * 2);
+            _mm_storeu_ps(out + frame * 2, _mm_add_ps(_mm_mul_ps(a, g_from), _mm_mul_ps(b, g_to)));
+            g_from = _mm_add_ps(g_from, d_from);
+            g_to = _mm_add_ps(g_to, d_to);
+        }
+    }
+    else if (channels == 1)
+    {
+        __m128 g_from = _mm_setr_ps(gain_from, gain_from + step_from,
+                                    gain_from + 2.0f * step_from, gain_from + 3.0f * step_from);
+        __m128 g_to = _mm_setr_ps(gain_to, gain_to + step_to,
+                                  gain_to + 2.0f * step_to, gain_to + 3.0f * step_to);
+        const __m128 d_from = _mm_set1_ps(4.0f * step_from);
+        const __m128 d_to = _mm_set1_ps(4.0f * step_to);
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            __m128 a = _mm_loadu_ps(from + frame);
+            __m128 b = _mm_loadu_ps(to + frame);
+            _mm_storeu_ps(out + frame, _mm_add_ps(_mm_mul_ps(a, g_from), _mm_mul_ps(b, g_to)));
+            g_from = _mm_add_ps(g_from, d_from);
+            g_to = _mm_add_ps(g_to, d_to);
+        }
+    }
+#endif
+    // scalar tail, and any channel layout the vector paths do not cover
+    for (; frame < frames; frame++)
+    {
+        float g_from = gain_from + step_from * frame;
+        float g_to = gain_to + step_to * frame;
+        for (int ch = 0; ch < channels; ch++)
+        {
+            int idx = frame * channels + ch;
+            out[idx] = from[idx] * g_from + to[idx] * g_to;
+        }
+    }
+}
+
+void DspKernels::crossfade(float *out, const float *from, const float *to, int frames, int channels,
+                           qint64 fade_pos, qint64 fade_len, DK::FadeCurve curve,
+                           float scale_from, float scale_to)
+{
+    if (fade_len <= 0) fade_len = 1;
+    int done = 0;
+    while (done < frames)
+    {
+        int segment = qMin(FadeSegment, frames - done);
+        float from_start, to_start, from_end, to_end;
+        curveGains(double(fade_pos + done) / fade_len, curve, from_start, to_start);
+        curveGains(double(fade_pos + done + segment) / fade_len, curve, from_end, to_end);
+        from_start *= scale_from;
+        from_end *= scale_from;
+        to_start *= scale_to;
+        to_end *= scale_to;
+
+        int offset = done * channels;
+        mixRamp(out + offset, from + offset, to + offset, segment, channels,
+                from_start, (from_end - from_start) / segment,
+                to_start, (to_end - to_start) / segment);
+        done += segment;
+    }
+}
+
+void DspKernels::gainLimit(float *buf, int frames, int channels, float gain, float ceiling,
+                           DK::LimiterState &state)
+{
+    if (channels <= 0 || channels > DK::MaxChannels) return;
+    const int history = 3 * channels;
+    // history frames, then the block scaled by gain
+    float window[(3 + LimitBlock) * DK::MaxChannels];
+#ifdef DK_USE_SSE2
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 nine = _mm_set1_ps(9.0f / 16.0f);
+    const __m128 one = _mm_set1_ps(1.0f / 16.0f);
+    const __m128 vgain = _mm_set1_ps(gain);
+#endif
+
+    int done = 0;
+    while (done < frames)
+    {
+        int block = qMin(LimitBlock, frames - done);
+        int samples = block * channels;
+        float* data = buf + done * channels;
+        float* scaled = window + history;
+        std::memcpy(window, state.history, sizeof(float) * history);
+
+        // scale and take the sample peak in one go
+        float peak = 0.0f;
+        int idx = 0;
+#ifdef DK_USE_SSE2
+        __m128 vpeak = _mm_setzero_ps();
+        for (; idx + 4 <= samples; idx += 4)
+        {
+            __m128 x = _mm_mul_ps(_mm_loadu_ps(data + idx), vgain);
+            _mm_storeu_ps(scaled + idx, x);
+            vpeak = _mm_max_ps(vpeak, _mm_and_ps(x, abs_mask));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, vpeak);
+        peak = qMax(qMax(lanes[0], lanes[1]), qMax(lanes[2], lanes[3]));
+#endif
+        for (; idx < samples; idx++)
+        {
+            scaled[idx] = data[idx] * gain;
+            peak = qMax(peak, qAbs(scaled[idx]));
+        }
+
+        // midpoints between neighbouring frames, x(n + 1/2) = (9(x1 + x2) - (x0 + x3)) / 16
+        // every sample of a vector has its neighbours one channel stride away
+        int first = channels;
+        int last = (3 + block - 2) * channels;
+        idx = first;
+#ifdef DK_USE_SSE2
+        vpeak = _mm_setzero_ps();
+        for (; idx + 4 <= last; idx += 4)
+        {
+            __m128 x0 = _mm_loadu_ps(window + idx - channels);
+            __m128 x1 = _mm_loadu_ps(window + idx);
+            __m128 x2 = _mm_loadu_ps(window + idx + channels);
+            __m128 x3 = _mm_loadu_ps(window + idx + 2 * channels);
+            __m128 mid = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(x1, x2), nine), _mm_mul_ps(_mm_add_ps(x0, x3), one));
+            vpeak = _mm_max_ps(vpeak, _mm_and_ps(mid, abs_mask));
+        }
+        _mm_storeu_ps(lanes, vpeak);
+        peak = qMax(peak, qMax(qMax(lanes[0], lanes[1]), qMax(lanes[2], lanes[3])));
+#endif
+        for (; idx < last; idx++)
+        {
+            float mid = (9.0f * (window[idx] + window[idx + channels])
+                         - (window[idx - channels] + window[idx + 2 * channels])) / 16.0f;
+            peak = qMax(peak, qAbs(mid));
+        }
+
+        // instant attack, release towards no reduction
+        float reduction = state.reduction + (1.0f - state.reduction) * state.release;
+        if (reduction > 0.9999f) reduction = 1.0f;
+        if (peak * reduction > ceiling) reduction = ceiling / peak;
+        state.reduction = reduction;
+
+        if (reduction == 1.0f)
+            std::memcpy(data, scaled, sizeof(float) * samples);
+        else
+        {
+            idx = 0;
+#ifdef DK_USE_SSE2
+            const __m128 vreduction = _mm_set1_ps(reduction);
+            for (; idx + 4 <= samples; idx += 4)
+                _mm_storeu_ps(data + idx, _mm_mul_ps(_mm_loadu_ps(scaled + idx), vreduction));
+#endif
+            for (; idx < samples; idx++)
+                data[idx] = scaled[idx] * reduction;
+        }
+
+        std::memcpy(state.history, window + samples, sizeof(float) * history);
+        done += block;
+    }
+}
+
+float DspKernels::releasePerBlock(int sample_rate, int release_ms)
+{
+    if (sample_rate <= 0 || release_ms <= 0) return 1.0f;
+    return static_cast<float>(1.0 - qExp(-double(LimitBlock) * 1000.0 / (double(release_ms) * sample_rate)));
+}
+
+void DspKernels::floatToInt16(qint16 *out, const float *in, int samples)
+{ // both paths round in the current mode, nearest-even unless someone changed it
+    int idx = 0;
+#ifdef DK_USE_SSE2
+    const __m128 scale = _mm_set1_ps(DK::Int16Scale);
+    const __m128 upper = _mm_set1_ps(32767.0f);
+    const __m128 lower = _mm_set1_ps(-32768.0f);
+    for (; idx + 8 <= samples; idx += 8)
+    {
+        __m128 a = _mm_max_ps(lower, _mm_min_ps(upper, _mm_mul_ps(_mm_loadu_ps(in + idx), scale)));
+        __m128 b = _mm_max_ps(lower, _mm_min_ps(upper, _mm_mul_ps(_mm_loadu_ps(in + idx + 4), scale)));
+        __m128i lo = _mm_cvtps_epi32(a);
+        __m128i hi = _mm_cvtps_epi32(b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + idx), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (; idx < samples; idx++)
+        out[idx] = static_cast<qint16>(std::lrintf(qBound(-32768.0f, in[idx] * DK::Int16Scale, 32767.0f)));
+}
+
+void DspKernels::int16ToFloat(float *out, const qint16 *in, int samples)
+{
+    const float scale = 1.0f / DK::Int16Scale;
+    for (int idx = 0; idx < samples; idx++)
+        out[idx] = in[idx] * scale;
+}
+
+void DspKernels::int32ToFloat(float *out, const qint32 *in, int samples)
+{
+    const float scale = 1.0f / 2147483648.0f;
+    for (int idx = 0; idx < samples; idx++)
+        out[idx] = in[idx] * scale;
+}
+
+void DspKernels::monoToStereo(float *out, const float *in, int frames)
+{ // walk backwards so out may alias in
+    for (int frame = frames - 1; frame >= 0; frame--)
+    {
+        out[frame * 2] = in[frame];
+        out[frame * 2 + 1] = in[frame];
+    }
+}
+
+void DspKernels::minMax(const float *in, int samples, float &lo, float &hi)
+{
+    int idx = 0;
+#ifdef DK_USE_SSE2
+    if (samples >= 16)
+    { // four accumulators each way keep the min/max latency off the loop
+        __m128 lo_a = _mm_set1_ps(lo), lo_b = lo_a, lo_c = lo_a, lo_d = lo_a;
+        __m128 hi_a = _mm_set1_ps(hi), hi_b = hi_a, hi_c = hi_a, hi_d = hi_a;
+        for (; idx + 16 <= samples; idx += 16)
+        {
+            __m128 a = _mm_loadu_ps(in + idx);
+            __m128 b = _mm_loadu_ps(in + idx + 4);
+            __m128 c = _mm_loadu_ps(in + idx + 8);
+            __m128 d = _mm_loadu_ps(in + idx + 12);
+            lo_a = _mm_min_ps(lo_a, a);
+            lo_b = _mm_min_ps(lo_b, b);
+            lo_c = _mm_min_ps(lo_c, c);
+            lo_d = _mm_min_ps(lo_d, d);
+            hi_a = _mm_max_ps(hi_a, a);
+            hi_b = _mm_max_ps(hi_b, b);
+            hi_c = _mm_max_ps(hi_c, c);
+            hi_d = _mm_max_ps(hi_d, d);
+        }
+        // fold the four lanes of the combined accumulators
+        __m128 lo_v = _mm_min_ps(_mm_min_ps(lo_a, lo_b), _mm_min_ps(lo_c, lo_d));
+        __m128 hi_v = _mm_max_ps(_mm_max_ps(hi_a, hi_b), _mm_max_ps(hi_c, hi_d));
+        lo_v = _mm_min_ps(lo_v, _mm_shuffle_ps(lo_v, lo_v, _MM_SHUFFLE(1, 0, 3, 2)));
+        hi_v = _mm_max_ps(hi_v, _mm_shuffle_ps(hi_v, hi_v, _MM_SHUFFLE(1, 0, 3, 2)));
+        lo_v = _mm_min_ss(lo_v, _mm_shuffle_ps(lo_v, lo_v, _MM_SHUFFLE(2, 3, 0, 1)));
+        hi_v = _mm_max_ss(hi_v, _mm_shuffle_ps(hi_v, hi_v, _MM_SHUFFLE(2, 3, 0, 1)));
+        lo = _mm_cvtss_f32(lo_v);
+        hi = _mm_cvtss_f32(hi_v);
+    }
+#endif
+    for (; idx < samples; idx++)
+    {
+        lo = qMin(lo, in[idx]);
+        hi = qMax(hi, in[idx]);
+    }
+}
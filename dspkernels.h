@@ -0,0 +1,62 @@
+#ifndef DSPKERNELS_H
+#define DSPKERNELS_H
+
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+namespace DK { class DspKernels;}
+QT_END_NAMESPACE
+
+namespace DK
+{
+    enum FadeCurve {Linear, EqualPower};
+
+    const int MaxChannels = 8;
+    // full scale of 16 bit samples, the same both ways so int16 -> float -> int16 is lossless
+    const float Int16Scale = 32768.0f;
+
+    // carried from one gainLimit() call to the next
+    struct LimiterState
+    {
+        // gain reduction currently applied, 1 = none
+        float reduction = 1.0f;
+        // how far reduction moves back towards 1 per block
+        float release = 0.0133f;
+        // the last frames of the previous call, already scaled by its gain
+        float history[3 * MaxChannels] = {};
+    };
+}
+
+// sample kernels for the audio pipeline, interleaved float PCM
+// none of them allocate, they are meant to run on the audio thread
+class DspKernels
+{
+public:
+    // out = from * gain_from + to * gain_to, both gains ramping linearly per frame
+    static void mixRamp(float* out, const float* from, const float* to, int frames, int channels,
+                        float gain_from, float step_from, float gain_to, float step_to);
+
+    // crossfade frames [fade_pos, fade_pos + frames) of a fade fade_len frames long
+    // scale_from/scale_to are constant gains folded into the curve, e.g. replay gain
+    static void crossfade(float* out, const float* from, const float* to, int frames, int channels,
+                          qint64 fade_pos, qint64 fade_len, DK::FadeCurve curve,
+                          float scale_from = 1.0f, float scale_to = 1.0f);
+
+    // buf *= gain in place, then pulled under ceiling by a true-peak limiter
+    // peaks between samples are estimated by 2x interpolation, attack is instant,
+    // release follows state.release; a gain of 1 below the ceiling leaves buf untouched
+    static void gainLimit(float* buf, int frames, int channels, float gain, float ceiling,
+                          DK::LimiterState& state);
+    static float releasePerBlock(int sample_rate, int release_ms);
+
+    // format conversion, floatToInt16 clamps to [-32768, 32767] and rounds to nearest
+    static void floatToInt16(qint16* out, const float* in, int samples);
+    static void int16ToFloat(float* out, const qint16* in, int samples);
+    static void int32ToFloat(float* out, const qint32* in, int samples);
+    static void monoToStereo(float* out, const float* in, int frames);
+
+    // lo and hi are widened to the smallest and largest of in, channels don't matter
+    static void minMax(const float* in, int samples, float& lo, float& hi);
+};
+
+#endif // DSPKERNELS_H
@@ -0,0 +1,114 @@
+#include "fftplan.h"
+#include <QtMath>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FP_USE_SSE2
+#endif
+
+FftPlan::FftPlan(int init_size)
+    : size(1)
+{
+    while (size < init_size) size <<= 1;
+
+    int bits = 0;
+    while ((1 << bits) < size) bits++;
+    for (int index = 0; index < size; index++)
+    {
+        int reversed = 0;
+        for (int bit = 0; bit < bits; bit++)
+            if (index & (1 << bit)) reversed |= 1 << (bits - 1 - bit);
+        if (index < reversed)
+        {
+            swaps.append(index);
+            swaps.append(reversed);
+        }
+    }
+
+    twiddle_re.resize(qMax(1, size - 1));
+    twiddle_im.resize(qMax(1, size - 1));
+    for (int half = 1; half < size; half <<= 1)
+    {
+        for (int step = 0; step < half; step++)
+        {
+            double angle = -M_PI * step / half;
+            twiddle_re[half - 1 + step] = static_cast<float>(qCos(angle));
+            twiddle_im[half - 1 + step] = static_cast<float>(qSin(angle));
+        }
+    }
+}
+
+FftPlan::~FftPlan()
+{
+
+}
+
+void FftPlan::forward(float *re, float *im) const
+{
+    for (int idx = 0; idx < swaps.size(); idx += 2)
+    {
+        std::swap(re[swaps[idx]], re[swaps[idx + 1]]);
+        std::swap(im[swaps[idx]], im[swaps[idx + 1]]);
+    }
+
+    for (int half = 1; half < size; half <<= 1)
+    {
+        const float* w_re = twiddle_re.constData() + half - 1;
+        const float* w_im = twiddle_im.constData() + half - 1;
+        for (int start = 0; start < size; start += 2 * half)
+        {
+            float* a_re = re + start;
+            float* a_im = im + start;
+            float* b_re = a_re + half;
+            float* b_im = a_im + half;
+            int step = 0;
+#ifdef FP_USE_SSE2
+            for (; step + 4 <= half; step += 4)
+            { // t = w * b, b = a - t, a = a + t, four at a time
+                __m128 wr = _mm_loadu_ps(w_re + step);
+                __m128 wi = _mm_loadu_ps(w_im + step);
+                __m128 br = _mm_loadu_ps(b_re + step);
+                __m128 bi = _mm_loadu_ps(b_im + step);
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+                __m128 ar = _mm_loadu_ps(a_re + step);
+                __m128 ai = _mm_loadu_ps(a_im + step);
+                _mm_storeu_ps(b_re + step, _mm_sub_ps(ar, tr));
+                _mm_storeu_ps(b_im + step, _mm_sub_ps(ai, ti));
+                _mm_storeu_ps(a_re + step, _mm_add_ps(ar, tr));
+                _mm_storeu_ps(a_im + step, _mm_add_ps(ai, ti));
+            }
+#endif
+            for (; step < half; step++)
+            {
+                float tr = b_re[step] * w_re[step] - b_im[step] * w_im[step];
+                float ti = b_re[step] * w_im[step] + b_im[step] * w_re[step];
+                b_re[step] = a_re[step] - tr;
+                b_im[step] = a_im[step] - ti;
+                a_re[step] += tr;
+                a_im[step] += ti;
+            }
+        }
+    }
+}
+
+void FftPlan::power(float *out, const float *re, const float *im, int bins)
+{
+    int bin = 0;
+#ifdef FP_USE_SSE2
+    for (; bin + 4 <= bins; bin += 4)
+    {
+        __m128 r = _mm_loadu_ps(re + bin);
+        __m128 i = _mm_loadu_ps(im + bin);
+        _mm_storeu_ps(out + bin, _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(i, i)));
+    }
+#endif
+    for (; bin < bins; bin++)
+        out[bin] = re[bin] * re[bin] + im[bin] * im[bin];
+}
+
+int FftPlan::getSize() const
+{
+    return size;
+}
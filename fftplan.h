@@ -0,0 +1,35 @@
+#ifndef FFTPLAN_H
+#define FFTPLAN_H
+
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+namespace FP { class FftPlan;}
+QT_END_NAMESPACE
+
+// in-place radix-2 FFT over split real and imaginary arrays, size a power of two
+// twiddles are stored stage after stage, so every butterfly loop reads them in order
+// and four butterflies go through one SSE2 register where the stage is wide enough
+class FftPlan
+{
+public:
+    explicit FftPlan(int init_size);
+    ~FftPlan();
+
+    // forward transform in place, no allocation
+    void forward(float* re, float* im) const;
+    // squared magnitude of bins [0, bins)
+    static void power(float* out, const float* re, const float* im, int bins);
+
+    int getSize() const;
+
+private:
+    int size;
+    // index pairs swapped by the bit reversal, each pair once
+    QVector<int> swaps;
+    // stage with half width h keeps its h twiddles at [h - 1, 2h - 1)
+    QVector<float> twiddle_re;
+    QVector<float> twiddle_im;
+};
+
+#endif // FFTPLAN_H
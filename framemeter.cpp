@@ -0,0 +1,57 @@
+#include "framemeter.h"
+#include <QWidget>
+#include <QEvent>
+#include <QDebug>
+
+bool FrameMeter::tracing = false;
+
+FrameMeter::FrameMeter(QWidget *init_widget, const QString &init_name, QObject *parent)
+    : QObject{parent}
+    , widget(init_widget)
+    , name(init_name)
+    , frames(0)
+    , longest_gap_ms(0)
+{
+    if (!tracing || !widget) return;
+    widget->installEventFilter(this);
+    stats_timer.setInterval(FRAME_STATS_INTERVAL);
+    connect(&stats_timer, &QTimer::timeout, this, &FrameMeter::reportStats);
+    stats_timer.start();
+}
+
+FrameMeter::~FrameMeter()
+{
+
+}
+
+void FrameMeter::setTracing(bool enable)
+{
+    tracing = enable;
+}
+
+bool FrameMeter::isTracing()
+{
+    return tracing;
+}
+
+bool FrameMeter::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == widget && event->type() == QEvent::Paint)
+    { // the gap since the last paint is the frame time while scrolling
+        if (frame_clock.isValid()) longest_gap_ms = qMax(longest_gap_ms, frame_clock.elapsed());
+        frame_clock.start();
+        frames++;
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+// private
+
+void FrameMeter::reportStats()
+{ // an idle widget has nothing to report
+    if (frames == 0) return;
+    qInfo().noquote() << QString("%1: %2 fps, longest frame %3 ms").arg(name).arg(frames).arg(longest_gap_ms);
+    frames = 0;
+    longest_gap_ms = 0;
+    frame_clock.invalidate();
+}
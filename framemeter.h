@@ -0,0 +1,42 @@
+#ifndef FRAMEMETER_H
+#define FRAMEMETER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE
+namespace FM { class FrameMeter;}
+QT_END_NAMESPACE
+
+// counts the paints of one widget and prints frames per second and the longest
+// gap between two frames once a second, while anything is painted at all
+// does nothing unless tracing was switched on before it was made
+class FrameMeter : public QObject
+{
+    Q_OBJECT
+    #define FRAME_STATS_INTERVAL 1000
+
+public:
+    FrameMeter(QWidget* init_widget, const QString& init_name, QObject *parent = nullptr);
+    ~FrameMeter();
+
+    static void setTracing(bool enable);
+    static bool isTracing();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    static bool tracing;
+    QWidget* widget;
+    QString name;
+    QTimer stats_timer;
+    QElapsedTimer frame_clock;
+    int frames;
+    qint64 longest_gap_ms;
+
+    void reportStats();
+};
+
+#endif // FRAMEMETER_H
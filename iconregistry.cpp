@@ -0,0 +1,57 @@
+#include "iconregistry.h"
+
+// allocated by preload(), pixmaps can't be made before the application object
+QIcon* IconRegistry::icons = nullptr;
+QPixmap* IconRegistry::pixmaps = nullptr;
+
+void IconRegistry::preload()
+{
+    if (icons) return;
+    icons = new QIcon[IR::IconCount];
+    // a pixmap decodes the file now, a QIcon from a path would wait for the first paint
+    for (int id = 0; id < IR::IconCount; id++)
+        icons[id] = QIcon(QPixmap(iconPath(static_cast<IR::Icon>(id))));
+
+    pixmaps = new QPixmap[IR::PixmapCount];
+    pixmaps[IR::MusicNote] = QPixmap(":icons/res/musical_notec.png");
+    pixmaps[IR::QuestionMark] = QPixmap(":icons/res/question_markr1.png").scaledToHeight(DIALOG_ICON_HEIGHT);
+}
+
+const QIcon &IconRegistry::icon(IR::Icon id)
+{
+    preload();
+    return icons[id];
+}
+
+const QPixmap &IconRegistry::pixmap(IR::Pixmap id)
+{
+    preload();
+    return pixmaps[id];
+}
+
+// private
+
+const char *IconRegistry::iconPath(IR::Icon id)
+{
+    switch (id)
+    {
+    case IR::AppIcon: return ":icons/res/musical_notec.png";
+    case IR::TrackIcon: return ":/icons/res/music_notec2.png";
+    case IR::PlayButton: return ":/icons/res/play_w.png";
+    case IR::PauseButton: return ":/icons/res/pause_w.png";
+    case IR::VolumeButton: return ":/icons/res/volume_w.png";
+    case IR::MuteButton: return ":/icons/res/volume_mute_w.png";
+    case IR::Play: return ":icons/res/play.png";
+    case IR::Pause: return ":icons/res/pause.png";
+    case IR::Next: return ":icons/res/next.png";
+    case IR::Back: return ":icons/res/back.png";
+    case IR::OrderLoop: return ":icons/res/loopmodec.png";
+    case IR::SingleLoop: return ":icons/res/loopb.png";
+    case IR::ShuffleLoop: return ":icons/res/shuffle.png";
+    case IR::AddToQueue: return ":icons/res/add_p1.png";
+    case IR::RemoveFromList: return ":icons/res/remove_cyan1.png";
+    case IR::Quit: return ":icons/res/quit.png";
+    case IR::Star: return ":icons/res/star_shining.png";
+    default: return "";
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef ICONREGISTRY_H
+#define ICONREGISTRY_H
+
+#include <QIcon>
+#include <QPixmap>
+
+QT_BEGIN_NAMESPACE
+namespace IR { class IconRegistry;}
+QT_END_NAMESPACE
+
+namespace IR
+{
+    enum Icon {AppIcon, TrackIcon, PlayButton, PauseButton, VolumeButton, MuteButton,
+               Play, Pause, Next, Back, OrderLoop, SingleLoop, ShuffleLoop,
+               AddToQueue, RemoveFromList, Quit, Star, IconCount};
+    enum Pixmap {MusicNote, QuestionMark, PixmapCount};
+}
+
+// every icon and pixmap the ui uses, decoded once and shared from then on
+// QIcon and QPixmap are implicitly shared, handing out copies costs a refcount
+class IconRegistry
+{
+    #define DIALOG_ICON_HEIGHT 40
+
+public:
+    // decodes everything up front, later calls do nothing
+    // needs the application object, call it after QApplication is up
+    static void preload();
+    static const QIcon& icon(IR::Icon id);
+    static const QPixmap& pixmap(IR::Pixmap id);
+
+private:
+    static QIcon* icons;
+    static QPixmap* pixmaps;
+
+    static const char* iconPath(IR::Icon id);
+};
+
+#endif // ICONREGISTRY_H
@@ -0,0 +1,176 @@
+#include "librarydatabase.h"
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+LibraryDatabase::LibraryDatabase(const QString& init_file_path)
+    : file_path(init_file_path)
+{
+
+}
+
+bool LibraryDatabase::exists() const
+{
+    return QFile::exists(file_path);
+}
+
+bool LibraryDatabase::read(TM::TrackTable &table) const
+{ // map the file and copy the arrays out in one pass, no per-record parsing
+    QFile db_file(file_path);
+    if (!db_file.open(QIODevice::ReadOnly)) return false;
+    qint64 file_size = db_file.size();
+    if (file_size < static_cast<qint64>(sizeof(LD::Header))) return false;
+
+    const uchar* data = db_file.map(0, file_size);
+    if (!data) return false;
+
+    const auto* header = reinterpret_cast<const LD::Header*>(data);
+    if (header->magic != LD::Magic) return false;
+    quint32 version = header->version;
+    if (!(version == 1 && header->record_size == LD::RecordSizeV1)
+        && !(version == 2 && header->record_size == LD::RecordSizeV2)
+        && !(version == LD::Version && header->record_size == sizeof(LD::Record)))
+        return false;
+
+    qint64 records_end = sizeof(LD::Header) + qint64(header->record_count) * header->record_size;
+    qint64 dirs_end = records_end + qint64(header->dir_count) * sizeof(LD::DirEntry);
+    qint64 pool_end = dirs_end + qint64(header->pool_length) * sizeof(QChar);
+    if (pool_end > file_size) return false;
+
+    const uchar* records = data + sizeof(LD::Header);
+    const auto* dirs = reinterpret_cast<const LD::DirEntry*>(data + records_end);
+    const auto* pool = reinterpret_cast<const QChar*>(data + dirs_end);
+
+    TM::TrackTable loaded;
+    loaded.next_id = header->next_id;
+    loaded.name_pool = QString(pool, header->pool_length);
+
+    loaded.dir_table.reserve(header->dir_count);
+    for (quint32 index = 0; index < header->dir_count; index++)
+    {
+        if (qint64(dirs[index].offset) + dirs[index].length > header->pool_length) return false;
+        loaded.dir_table.append(QString(pool + dirs[index].offset, dirs[index].length));
+    }
+
+    int count = header->record_count;
+    loaded.ids.resize(count);
+    loaded.dir_index.resize(count);
+    loaded.name_offset.resize(count);
+    loaded.name_length.resize(count);
+    loaded.fingerprints.resize(count);
+    loaded.loudness.resize(count);
+    loaded.info.resize(count);
+    for (int row = 0; row < count; row++)
+    {
+        const LD::Record& record = *reinterpret_cast<const LD::Record*>(records + qint64(row) * header->record_size);
+        if (record.id == TM::InvalidId || record.id >= header->next_id
+            || record.dir_index >= header->dir_count
+            || qint64(record.name_offset) + record.name_length > header->pool_length)
+            return false;
+        loaded.ids[row] = record.id;
+        loaded.dir_index[row] = record.dir_index;
+        loaded.name_offset[row] = record.name_offset;
+        loaded.name_length[row] = record.name_length;
+        loaded.fingerprints[row] = record.fingerprint;
+        if (version < 2) continue;
+        TM::Loudness& loudness = loaded.loudness[row];
+        loudness.file_size = record.file_size;
+        loudness.mtime = record.mtime;
+        loudness.integrated = record.loudness;
+        loudness.true_peak = record.true_peak;
+
+        if (version < 3) continue;
+        qint64 info_end = qint64(record.info_offset) + record.title_length + record.artist_length + record.album_length;
+        if (info_end > header->pool_length) return false;
+        TM::TrackInfo& info = loaded.info[row];
+        info.file_size = record.info_size;
+        info.mtime = record.info_mtime;
+        const QChar* text = pool + record.info_offset;
+        info.title = QString(text, record.title_length);
+        info.artist = QString(text + record.title_length, record.artist_length);
+        info.album = QString(text + record.title_length + record.artist_length, record.album_length);
+        info.duration_ms = record.duration_ms;
+        info.cover_key = record.cover_key;
+    }
+
+    table = loaded;
+    return true;
+}
+
+bool LibraryDatabase::write(const TM::TrackTable &table) const
+{ // QSaveFile only replaces the old file once everything is written
+    QDir().mkpath(QFileInfo(file_path).absolutePath());
+    QSaveFile db_file(file_path);
+    if (!db_file.open(QIODevice::WriteOnly)) return false;
+
+    // rebuild the string pool so garbage left by removals is not written
+    QString pool;
+    pool.reserve(table.name_pool.size());
+    QByteArray records(table.size() * sizeof(LD::Record), Qt::Uninitialized);
+    auto* record = reinterpret_cast<LD::Record*>(records.data());
+    for (int row = 0; row < table.size(); row++, record++)
+    {
+        record->id = table.ids[row];
+        record->dir_index = table.dir_index[row];
+        record->name_offset = pool.size();
+        record->name_length = table.name_length[row];
+        record->flags = 0;
+        record->fingerprint = table.fingerprints[row];
+        const TM::Loudness& loudness = table.loudness[row];
+        record->file_size = loudness.file_size;
+        record->mtime = loudness.mtime;
+        record->loudness = loudness.integrated;
+        record->true_peak = loudness.true_peak;
+        const TM::TrackInfo& info = table.info[row];
+        record->info_size = info.file_size;
+        record->info_mtime = info.mtime;
+        record->title_length = qMin(info.title.size(), 0xFFFF);
+        record->artist_length = qMin(info.artist.size(), 0xFFFF);
+        record->album_length = qMin(info.album.size(), 0xFFFF);
+        record->reserved = 0;
+        record->duration_ms = static_cast<quint32>(qBound<qint64>(0, info.duration_ms, 0xFFFFFFFF));
+        record->cover_key = info.cover_key;
+        pool.append(table.name_pool.constData() + table.name_offset[row], table.name_length[row]);
+        record->info_offset = pool.size();
+        pool.append(info.title.constData(), record->title_length);
+        pool.append(info.artist.constData(), record->artist_length);
+        pool.append(info.album.constData(), record->album_length);
+    }
+
+    QByteArray dirs(table.dir_table.size() * sizeof(LD::DirEntry), Qt::Uninitialized);
+    auto* dir = reinterpret_cast<LD::DirEntry*>(dirs.data());
+    for (const QString& dir_path : table.dir_table)
+    {
+        dir->offset = pool.size();
+        dir->length = dir_path.size();
+        pool.append(dir_path);
+        dir++;
+    }
+
+    LD::Header header;
+    header.magic = LD::Magic;
+    header.version = LD::Version;
+    header.record_count = table.size();
+    header.record_size = sizeof(LD::Record);
+    header.dir_count = table.dir_table.size();
+    header.next_id = table.next_id;
+    header.pool_length = pool.size();
+    header.reserved = 0;
+
+    db_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    db_file.write(records);
+    db_file.write(dirs);
+    db_file.write(reinterpret_cast<const char*>(pool.constData()), pool.size() * sizeof(QChar));
+    return db_file.commit();
+}
+
+QString LibraryDatabase::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/library.db";
+}
+
+QString LibraryDatabase::getFile_path() const
+{
+    return file_path;
+}
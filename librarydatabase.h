@@ -0,0 +1,86 @@
+#ifndef LIBRARYDATABASE_H
+#define LIBRARYDATABASE_H
+
+#include <QString>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace LD { class LibraryDatabase;}
+QT_END_NAMESPACE
+
+namespace LD
+{
+    const quint32 Magic = 0x4C504D4D; // "MMPL"
+    const quint32 Version = 3;
+    // older records stop after the fingerprint (1) or the loudness (2),
+    // what they lack reads as not analyzed
+    const quint32 RecordSizeV1 = 24;
+    const quint32 RecordSizeV2 = 48;
+
+    // on-disk layout, native byte order:
+    // [Header][Record * record_count][DirEntry * dir_count][QChar * pool_length]
+    struct Header
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 record_count;
+        quint32 record_size;
+        quint32 dir_count;
+        quint32 next_id;
+        quint32 pool_length;
+        quint32 reserved;
+    };
+
+    struct Record
+    {
+        quint32 id;
+        quint32 dir_index;
+        quint32 name_offset;
+        quint16 name_length;
+        quint16 flags;
+        quint64 fingerprint;
+        // loudness analysis, valid while the file matches size and mtime
+        qint64 file_size;
+        qint64 mtime;
+        float loudness;
+        float true_peak;
+        // tags, title, artist and album follow each other in the pool
+        qint64 info_size;
+        qint64 info_mtime;
+        quint32 info_offset;
+        quint16 title_length;
+        quint16 artist_length;
+        quint16 album_length;
+        quint16 reserved;
+        quint32 duration_ms;
+        quint64 cover_key;
+    };
+
+    struct DirEntry
+    {
+        quint32 offset;
+        quint32 length;
+    };
+}
+
+// read copies the whole file into a TrackTable, write replaces it whole through QSaveFile
+class LibraryDatabase
+{
+public:
+    explicit LibraryDatabase(const QString& init_file_path = defaultPath());
+
+    // read/write, both are safe to call from a worker thread
+    bool exists() const;
+    bool read(TM::TrackTable& table) const;
+    bool write(const TM::TrackTable& table) const;
+
+    static QString defaultPath();
+
+    // getters & setters
+    QString getFile_path() const;
+
+private:
+    QString file_path;
+};
+
+#endif // LIBRARYDATABASE_H
@@ -0,0 +1,142 @@
+#include "libraryscanner.h"
+#include <QCryptographicHash>
+#include <cstring>
+
+LibraryScanner::LibraryScanner(QObject *parent)
+    : QObject{parent}
+    , use_fingerprint(false)
+    , running(false)
+    , cancelled(false)
+    , pending_dirs(0)
+    , files_found(0)
+{
+    scan_pool.setMaxThreadCount(QThread::idealThreadCount());
+    progress_timer.setInterval(SCAN_PROGRESS_INTERVAL);
+    connect(&progress_timer, &QTimer::timeout, this, &LibraryScanner::reportProgress);
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    cancel();
+    scan_pool.waitForDone();
+}
+
+// scan control
+
+bool LibraryScanner::scan(const QDir &root_dir, const QStringList &extensions)
+{
+    if (running || !root_dir.exists()) return false;
+
+    // match on a precompiled suffix set instead of a regex per file
+    extension_set.clear();
+    for (const QString& extension : extensions)
+        extension_set.insert(extension.toLower());
+
+    running = true;
+    cancelled = false;
+    files_found = 0;
+    pending_dirs = 1;
+    scan_clock.start();
+    progress_timer.start();
+
+    QString root_path = root_dir.absolutePath();
+    scan_pool.start([this, root_path]() { scanDir(root_path); });
+    return true;
+}
+
+void LibraryScanner::cancel()
+{
+    cancelled = true;
+}
+
+bool LibraryScanner::isRunning() const
+{
+    return running;
+}
+
+quint64 LibraryScanner::fileFingerprint(const QFileInfo &file)
+{ // size plus a hash of the head of the file, cheap enough to run on import
+    const qint64 head_size {64 * 1024};
+    QFile audio_file(file.absoluteFilePath());
+    if (!audio_file.open(QIODevice::ReadOnly)) return 0;
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    qint64 size = audio_file.size();
+    hash.addData(QByteArrayView(reinterpret_cast<const char*>(&size), sizeof(size)));
+    hash.addData(audio_file.read(head_size));
+
+    quint64 fingerprint {0};
+    memcpy(&fingerprint, hash.result().constData(), sizeof(fingerprint));
+    return fingerprint ? fingerprint : 1;
+}
+
+void LibraryScanner::setUse_fingerprint(bool newUse_fingerprint)
+{
+    use_fingerprint = newUse_fingerprint;
+}
+
+bool LibraryScanner::getUse_fingerprint() const
+{
+    return use_fingerprint;
+}
+
+// private
+
+void LibraryScanner::scanDir(const QString &dir_path)
+{ // runs on a pool thread, every subdirectory becomes a task of its own
+    QStringList file_paths;
+    QVector<quint64> fingerprints;
+
+    if (!cancelled)
+    {
+        QDir dir(dir_path);
+        const auto entries = dir.entryInfoList(QDir::Files | QDir::Dirs
+                                               | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+        for (const QFileInfo& entry : entries)
+        {
+            if (cancelled) break;
+            if (entry.isDir())
+            {
+                QString sub_path = entry.absoluteFilePath();
+                pending_dirs++;
+                scan_pool.start([this, sub_path]() { scanDir(sub_path); });
+                continue;
+            }
+            if (!extension_set.contains(entry.suffix().toLower())) continue;
+
+            QString file_path = entry.canonicalFilePath();
+            if (file_path.isEmpty()) continue;
+            file_paths.append(file_path);
+            fingerprints.append(use_fingerprint ? fileFingerprint(entry) : 0);
+            if (file_paths.size() >= SCAN_BATCH_SIZE) flushBatch(file_paths, fingerprints);
+        }
+        flushBatch(file_paths, fingerprints);
+    }
+
+    // the last task to finish reports back to the owner thread
+    if (pending_dirs.fetch_sub(1) == 1)
+        QMetaObject::invokeMethod(this, &LibraryScanner::onScanDone, Qt::QueuedConnection);
+}
+
+void LibraryScanner::flushBatch(QStringList &file_paths, QVector<quint64> &fingerprints)
+{
+    if (file_paths.isEmpty() || cancelled) return;
+    files_found += file_paths.size();
+    emit batchFound(file_paths, fingerprints);
+    file_paths.clear();
+    fingerprints.clear();
+}
+
+void LibraryScanner::reportProgress()
+{
+    qint64 elapsed = qMax<qint64>(scan_clock.elapsed(), 1);
+    emit progress(files_found, files_found * 1000.0 / elapsed);
+}
+
+void LibraryScanner::onScanDone()
+{
+    progress_timer.stop();
+    running = false;
+    reportProgress();
+    emit finished(cancelled, files_found, scan_clock.elapsed());
+}
@@ -0,0 +1,64 @@
+#ifndef LIBRARYSCANNER_H
+#define LIBRARYSCANNER_H
+
+#include <QObject>
+#include <QDir>
+#include <QSet>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <atomic>
+
+QT_BEGIN_NAMESPACE
+namespace LS { class LibraryScanner;}
+QT_END_NAMESPACE
+
+class LibraryScanner : public QObject
+{
+    Q_OBJECT
+    #define SCAN_BATCH_SIZE 256
+    #define SCAN_PROGRESS_INTERVAL 250
+
+public:
+    explicit LibraryScanner(QObject *parent = nullptr);
+    ~LibraryScanner();
+
+    // scan control
+    bool scan(const QDir& root_dir, const QStringList& extensions);
+    void cancel();
+    bool isRunning() const;
+
+    // file helpers, safe to call from any thread
+    static quint64 fileFingerprint(const QFileInfo& file);
+
+    // getters & setters
+    void setUse_fingerprint(bool newUse_fingerprint);
+    bool getUse_fingerprint() const;
+
+signals:
+    // canonical paths of matching files, fingerprints are 0 when disabled
+    void batchFound(const QStringList& file_paths, const QVector<quint64>& fingerprints);
+    void progress(int files_found, double files_per_sec);
+    void finished(bool cancelled, int files_found, qint64 elapsed_ms);
+
+private:
+    QThreadPool scan_pool;
+    QTimer progress_timer;
+    QElapsedTimer scan_clock;
+
+    QSet<QString> extension_set;
+    bool use_fingerprint;
+    bool running;
+
+    std::atomic<bool> cancelled;
+    std::atomic<int> pending_dirs;
+    std::atomic<int> files_found;
+
+    void scanDir(const QString& dir_path);
+    void flushBatch(QStringList& file_paths, QVector<quint64>& fingerprints);
+    void reportProgress();
+    void onScanDone();
+};
+
+#endif // LIBRARYSCANNER_H
@@ -0,0 +1,186 @@
+#include "librarysorter.h"
+#include <QCollator>
+#include <QThread>
+#include <algorithm>
+#include <numeric>
+
+LibrarySorter::LibrarySorter(QObject *parent)
+    : QObject{parent}
+    , latest_serial(0)
+    , running(0)
+{
+    driver_pool.setMaxThreadCount(1);
+    work_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+LibrarySorter::~LibrarySorter()
+{
+    latest_serial++;
+    driver_pool.waitForDone();
+}
+
+void LibrarySorter::sort(const TM::TrackTable &table, TM::SortField field, bool descending)
+{
+    int serial = ++latest_serial;
+    running++;
+    driver_pool.start([this, serial, table, field, descending]() {
+        runSort(serial, table, field, descending);
+        running--;
+    });
+}
+
+bool LibrarySorter::isRunning() const
+{
+    return running > 0;
+}
+
+// private
+
+void LibrarySorter::runSort(int serial, const TM::TrackTable &table, TM::SortField field, bool descending)
+{ // runs on the driver thread
+    if (serial != latest_serial) return;
+    QElapsedTimer clock;
+    clock.start();
+
+    // the text fields the order depends on, ties fall through to the next one
+    QVector<LS::KeyField> chain;
+    switch (field) {
+    case TM::SortByTitle:
+        chain = {LS::TitleKey, LS::ArtistKey};
+        break;
+    case TM::SortByArtist:
+        chain = {LS::ArtistKey, LS::AlbumKey, LS::TitleKey};
+        break;
+    case TM::SortByAlbum:
+        chain = {LS::AlbumKey, LS::ArtistKey, LS::TitleKey};
+        break;
+    case TM::SortByPath:
+        chain = {LS::PathKey};
+        break;
+    case TM::SortByDuration:
+        chain = {LS::TitleKey};
+        break;
+    default:
+        break;
+    }
+    makeKeys(table, chain);
+    if (serial != latest_serial) return;
+
+    const QVector<TM::TrackId>& ids = table.ids;
+    auto compareText = [this, &ids](LS::KeyField key_field, int a, int b) {
+        const LS::CachedKey& key_a = key_cache[key_field][ids[a]];
+        const LS::CachedKey& key_b = key_cache[key_field][ids[b]];
+        // tracks without the tag go last
+        if (key_a.text.isEmpty() != key_b.text.isEmpty()) return key_a.text.isEmpty() ? 1 : -1;
+        return key_a.key->compare(*key_b.key);
+    };
+    auto less = [&](int a, int b) {
+        if (field == TM::SortByDuration && table.info[a].duration_ms != table.info[b].duration_ms)
+            return table.info[a].duration_ms < table.info[b].duration_ms;
+        for (LS::KeyField key_field : chain)
+        {
+            int result = compareText(key_field, a, b);
+            if (result) return result < 0;
+        }
+        // ids are handed out in import order, this is the date added
+        return ids[a] < ids[b];
+    };
+
+    QVector<int> rows(table.size());
+    std::iota(rows.begin(), rows.end(), 0);
+    parallelSort(rows, less);
+    if (serial != latest_serial) return;
+    if (descending) std::reverse(rows.begin(), rows.end());
+
+    QVector<TM::TrackId> sorted_ids;
+    sorted_ids.reserve(rows.size());
+    for (int row : rows) sorted_ids.append(ids[row]);
+    emit sorted(sorted_ids, field, descending, clock.elapsed());
+}
+
+void LibrarySorter::makeKeys(const TM::TrackTable &table, const QVector<LS::KeyField> &fields)
+{ // only tracks whose text changed since the last sort get a new key
+    if (fields.isEmpty() || table.size() == 0) return;
+    for (LS::KeyField key_field : fields)
+        if (key_cache[key_field].size() < table.next_id) key_cache[key_field].resize(table.next_id);
+
+    int chunks = qBound(1, table.size() / SORT_MIN_CHUNK, work_pool.maxThreadCount());
+    int chunk_size = (table.size() + chunks - 1) / chunks;
+    runParallel(chunks, [this, &table, &fields, chunk_size](int chunk) {
+        // QCollator is reentrant, not thread-safe, one per task
+        QCollator collator;
+        collator.setNumericMode(true);
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+        int last = qMin(table.size(), (chunk + 1) * chunk_size);
+        for (int row = chunk * chunk_size; row < last; row++)
+        {
+            for (LS::KeyField key_field : fields)
+            {
+                LS::CachedKey& cached = key_cache[key_field][table.ids[row]];
+                QString text = keyText(table, row, key_field);
+                if (cached.key && cached.text == text) continue;
+                cached.key.emplace(collator.sortKey(text));
+                cached.text = text;
+            }
+        }
+    });
+}
+
+template <class Less>
+void LibrarySorter::parallelSort(QVector<int> &rows, Less less)
+{
+    int size = rows.size();
+    int chunks = qBound(1, size / SORT_MIN_CHUNK, work_pool.maxThreadCount());
+    int chunk_size = (size + chunks - 1) / chunks;
+    // rows [start, start + width) are sorted runs after each pass
+    runParallel(chunks, [&rows, &less, chunk_size, size](int chunk) {
+        int first = chunk * chunk_size;
+        int last = qMin(size, first + chunk_size);
+        if (first < last) std::sort(rows.begin() + first, rows.begin() + last, less);
+    });
+
+    // merge neighbouring runs, every pair in parallel, between two buffers
+    QVector<int> scratch(size);
+    QVector<int>* from = &rows;
+    QVector<int>* to = &scratch;
+    for (int width = chunk_size; width < size; width *= 2)
+    {
+        int pairs = (size + 2 * width - 1) / (2 * width);
+        runParallel(pairs, [from, to, &less, width, size](int pair) {
+            int first = pair * 2 * width;
+            int middle = qMin(size, first + width);
+            int last = qMin(size, first + 2 * width);
+            std::merge(from->cbegin() + first, from->cbegin() + middle, from->cbegin() + middle,
+                       from->cbegin() + last, to->begin() + first, less);
+        });
+        std::swap(from, to);
+    }
+    if (from != &rows) rows.swap(scratch);
+}
+
+template <class Task>
+void LibrarySorter::runParallel(int count, Task task)
+{ // the last task runs here, the driver would only wait otherwise
+    for (int index = 0; index + 1 < count; index++)
+        work_pool.start([&task, index]() { task(index); });
+    if (count > 0) task(count - 1);
+    work_pool.waitForDone();
+}
+
+QString LibrarySorter::keyText(const TM::TrackTable &table, int row, LS::KeyField field)
+{
+    const TM::TrackInfo& info = table.info[row];
+    switch (field) {
+    case LS::ArtistKey:
+        return info.artist;
+    case LS::AlbumKey:
+        return info.album;
+    case LS::TitleKey:
+        // untagged tracks go by their file name, the way the list shows them
+        if (!info.title.isEmpty()) return info.title;
+        return QString(table.name_pool.constData() + table.name_offset[row], table.name_length[row]);
+    default:
+        return table.dir_table[table.dir_index[row]] + '/'
+               + QString(table.name_pool.constData() + table.name_offset[row], table.name_length[row]);
+    }
+}
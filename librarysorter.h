@@ -0,0 +1,70 @@
+#ifndef LIBRARYSORTER_H
+#define LIBRARYSORTER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QCollatorSortKey>
+#include <QElapsedTimer>
+#include <atomic>
+#include <optional>
+#include <vector>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace LS { class LibrarySorter;}
+QT_END_NAMESPACE
+
+namespace LS
+{
+    // text fields with cached collation keys
+    enum KeyField {TitleKey, ArtistKey, AlbumKey, PathKey, KeyFieldCount};
+
+    struct CachedKey
+    {
+        QString text; // what the key was made from, a different text means a new key
+        std::optional<QCollatorSortKey> key;
+    };
+}
+
+// sorts a snapshot of the library off the GUI thread
+// text is compared through QCollator sort keys, made in parallel and kept per track
+// id so later sorts only make keys for new or retagged tracks
+// chunks are sorted in parallel, then merged pairwise in parallel rounds
+class LibrarySorter : public QObject
+{
+    Q_OBJECT
+    #define SORT_MIN_CHUNK 16384
+
+public:
+    explicit LibrarySorter(QObject *parent = nullptr);
+    ~LibrarySorter();
+
+    // a newer sort makes an older one still running give up
+    void sort(const TM::TrackTable& table, TM::SortField field, bool descending);
+    bool isRunning() const;
+
+signals:
+    // every id of the snapshot, in the new order
+    void sorted(const QVector<TM::TrackId>& ids, int field, bool descending, qint64 elapsed_ms);
+
+private:
+    // the driver runs one sort at a time and waits on the workers
+    QThreadPool driver_pool;
+    QThreadPool work_pool;
+    std::atomic<int> latest_serial;
+    std::atomic<int> running;
+    // driver thread only, workers write disjoint slots of a pre-sized cache
+    std::vector<LS::CachedKey> key_cache[LS::KeyFieldCount];
+
+    void runSort(int serial, const TM::TrackTable& table, TM::SortField field, bool descending);
+    void makeKeys(const TM::TrackTable& table, const QVector<LS::KeyField>& fields);
+    template <class Less>
+    void parallelSort(QVector<int>& rows, Less less);
+    // runs count tasks on the work pool and waits for all of them
+    template <class Task>
+    void runParallel(int count, Task task);
+
+    static QString keyText(const TM::TrackTable& table, int row, LS::KeyField field);
+};
+
+#endif // LIBRARYSORTER_H
@@ -0,0 +1,315 @@
+#include "librarywatcher.h"
+#include "libraryscanner.h"
+#include <QDir>
+#include <QDebug>
+#include <utility>
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+LibraryWatcher::LibraryWatcher(TrackModel *init_track_model, QObject *parent)
+    : QObject{parent}
+    , track_model(init_track_model)
+    , use_fingerprint(false)
+    , watching(false)
+    , running(false)
+    , serial(0)
+{ // batches run one after the other, each sees the library the last one left
+    sync_pool.setMaxThreadCount(1);
+    debounce_timer.setSingleShot(true);
+    debounce_timer.setInterval(WATCH_DEBOUNCE);
+    connect(&debounce_timer, &QTimer::timeout, this, &LibraryWatcher::startBatch);
+    connect(&fs_watcher, &QFileSystemWatcher::directoryChanged, this, &LibraryWatcher::directoryChanged);
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    serial++;
+    sync_pool.waitForDone();
+}
+
+// watch control
+
+void LibraryWatcher::watch(const QStringList &new_roots, const QStringList &new_extensions)
+{ // the first batch lists every root in full, which also catches what changed while not watching
+    stop();
+    watching = true;
+    for (const QString& extension : new_extensions)
+        extensions.insert(extension.toLower());
+    for (const QString& root : new_roots) addRoot(root);
+}
+
+void LibraryWatcher::addRoot(const QString &root)
+{ // a root that is not there (an unmounted drive) is left alone
+    if (!watching) return;
+    QString root_path = QFileInfo(root).canonicalFilePath();
+    if (root_path.isEmpty() || roots.contains(root_path)) return;
+    roots.append(root_path);
+    dirty_dirs.insert(root_path);
+    startBatch();
+}
+
+void LibraryWatcher::stop()
+{
+    serial++;
+    watching = false;
+    debounce_timer.stop();
+    dirty_clock.invalidate();
+    dirty_dirs.clear();
+    roots.clear();
+    extensions.clear();
+    const QStringList watched = fs_watcher.directories();
+    if (!watched.isEmpty()) fs_watcher.removePaths(watched);
+}
+
+bool LibraryWatcher::isWatching() const
+{
+    return watching;
+}
+
+void LibraryWatcher::recordInode(TM::TrackId id, quint64 inode)
+{
+    if (id == TM::InvalidId) return;
+    if (id >= TM::TrackId(inode_of_id.size())) inode_of_id.resize(id + 1);
+    inode_of_id[id] = inode;
+}
+
+quint64 LibraryWatcher::fileInode(const QString &file_path)
+{ // a rename keeps the inode, so it tells a move from a delete and a new file
+#ifdef Q_OS_UNIX
+    struct stat file_stat;
+    if (::stat(QFile::encodeName(file_path).constData(), &file_stat) != 0) return 0;
+    quint64 inode = quint64(file_stat.st_ino) ^ (quint64(file_stat.st_dev) << 48);
+    return inode ? inode : 1;
+#else
+    Q_UNUSED(file_path);
+    return 0;
+#endif
+}
+
+void LibraryWatcher::setUse_fingerprint(bool newUse_fingerprint)
+{
+    use_fingerprint = newUse_fingerprint;
+}
+
+// private
+
+void LibraryWatcher::directoryChanged(const QString &path)
+{ // a burst of changes is one batch, but a steady stream still gets through
+    if (!watching) return;
+    dirty_dirs.insert(path);
+    if (!dirty_clock.isValid()) dirty_clock.start();
+    if (dirty_clock.elapsed() < WATCH_MAX_DELAY || !debounce_timer.isActive()) debounce_timer.start();
+}
+
+void LibraryWatcher::startBatch()
+{ // one batch at a time, changes coming in meanwhile make the next one
+    if (running || dirty_dirs.isEmpty()) return;
+    running = true;
+    dirty_clock.invalidate();
+
+    LW::Job job;
+    job.table = track_model->snapshot();
+    job.inode_of_id = inode_of_id;
+    job.dirs = dirty_dirs.values();
+    dirty_dirs.clear();
+    const QStringList watched = fs_watcher.directories();
+    job.watched = QSet<QString>(watched.cbegin(), watched.cend());
+    job.roots = roots;
+    job.extensions = extensions;
+    job.use_fingerprint = use_fingerprint;
+
+    int batch_serial = serial;
+    sync_pool.start([this, job, batch_serial]() {
+        LW::Delta delta = sync(job);
+        QMetaObject::invokeMethod(this, [this, batch_serial, delta]() { batchDone(batch_serial, delta); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+void LibraryWatcher::batchDone(int batch_serial, const LW::Delta &delta)
+{
+    running = false;
+    if (batch_serial == serial)
+    {
+        for (int idx = 0; idx < delta.seen_ids.size(); idx++) recordInode(delta.seen_ids[idx], delta.seen_inodes[idx]);
+
+        if (!delta.new_dirs.isEmpty())
+        {
+            const QStringList failed = fs_watcher.addPaths(delta.new_dirs);
+            if (!failed.isEmpty()) qWarning() << "cannot watch" << failed.size() << "directories, first" << failed.first();
+        }
+        if (!delta.gone_dirs.isEmpty())
+        { // subdirectories of a directory that is gone are gone too
+            QSet<QString> gone(delta.gone_dirs.cbegin(), delta.gone_dirs.cend());
+            QStringList stale;
+            for (const QString& dir : fs_watcher.directories())
+                if (isUnder(dir, gone)) stale.append(dir);
+            if (!stale.isEmpty()) fs_watcher.removePaths(stale);
+        }
+        if (!delta.isEmpty()) emit changed(delta);
+    }
+    if (!dirty_dirs.isEmpty()) debounce_timer.start();
+}
+
+LW::Delta LibraryWatcher::sync(const LW::Job &job)
+{ // runs on sync_pool, reads the disk and the snapshot it was given, nothing else
+    const TM::TrackTable& table = job.table;
+    LW::Delta delta;
+
+    // rows grouped by directory in one counting pass over the table
+    int dir_count = table.dir_table.size();
+    QHash<QString, int> dir_of_path;
+    dir_of_path.reserve(dir_count);
+    for (int dir = 0; dir < dir_count; dir++) dir_of_path.insert(table.dir_table[dir], dir);
+    QVector<int> dir_start(dir_count + 1, 0);
+    for (int row = 0; row < table.size(); row++) dir_start[table.dir_index[row] + 1]++;
+    for (int dir = 0; dir < dir_count; dir++) dir_start[dir + 1] += dir_start[dir];
+    QVector<int> dir_rows(table.size());
+    QVector<int> fill = dir_start;
+    for (int row = 0; row < table.size(); row++) dir_rows[fill[table.dir_index[row]]++] = row;
+
+    struct Found
+    {
+        QString path;
+        quint64 inode;
+        qint64 size;
+    };
+    QVector<Found> found;
+    QVector<int> removed_rows;
+
+    // changed directories are listed, new subdirectories walked in full,
+    // subdirectories watched already have batches of their own
+    QSet<QString> visited;
+    QStringList pending = job.dirs;
+    while (!pending.isEmpty())
+    {
+        QString dir_path = pending.takeLast();
+        if (visited.contains(dir_path)) continue;
+        QDir dir(dir_path);
+        if (!dir.exists())
+        {
+            if (job.watched.contains(dir_path)) delta.gone_dirs.append(dir_path);
+            continue;
+        }
+        visited.insert(dir_path);
+        if (!job.watched.contains(dir_path)) delta.new_dirs.append(dir_path);
+
+        QHash<QString, int> known;
+        auto dir_iter = dir_of_path.constFind(dir_path);
+        if (dir_iter != dir_of_path.constEnd())
+        {
+            int dir_index = dir_iter.value();
+            known.reserve(dir_start[dir_index + 1] - dir_start[dir_index]);
+            for (int idx = dir_start[dir_index]; idx < dir_start[dir_index + 1]; idx++)
+            {
+                int row = dir_rows[idx];
+                known.insert(table.name_pool.mid(table.name_offset[row], table.name_length[row]), row);
+            }
+        }
+
+        const auto entries = dir.entryInfoList(QDir::Files | QDir::Dirs
+                                               | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+        for (const QFileInfo& entry : entries)
+        {
+            if (entry.isDir())
+            {
+                QString sub_path = entry.absoluteFilePath();
+                if (!job.watched.contains(sub_path)) pending.append(sub_path);
+                continue;
+            }
+            if (!job.extensions.contains(entry.suffix().toLower())) continue;
+
+            QString file_path = entry.absoluteFilePath();
+            quint64 inode = fileInode(file_path);
+            auto known_iter = known.find(entry.fileName());
+            if (known_iter != known.end())
+            {
+                delta.seen_ids.append(table.ids[known_iter.value()]);
+                delta.seen_inodes.append(inode);
+                known.erase(known_iter);
+                continue;
+            }
+            found.append({file_path, inode, entry.size()});
+        }
+        // in the library but not in the directory any more
+        for (int row : std::as_const(known)) removed_rows.append(row);
+    }
+
+    // directories the library has tracks in that disappeared below a changed one,
+    // except below a root that is gone as a whole, that is a drive not mounted
+    QSet<QString> dirty(job.dirs.cbegin(), job.dirs.cend());
+    QSet<QString> online_roots;
+    for (const QString& root : job.roots)
+        if (QFileInfo::exists(root)) online_roots.insert(root);
+    for (int dir = 0; dir < dir_count; dir++)
+    {
+        const QString& dir_path = table.dir_table[dir];
+        if (dir_start[dir] == dir_start[dir + 1] || visited.contains(dir_path)) continue;
+        if (!isUnder(dir_path, dirty) || !isUnder(dir_path, online_roots) || QFileInfo::exists(dir_path)) continue;
+        delta.gone_dirs.append(dir_path);
+        for (int idx = dir_start[dir]; idx < dir_start[dir + 1]; idx++) removed_rows.append(dir_rows[idx]);
+    }
+
+    // a file that left one place and turned up in another is the same track,
+    // matched by inode first, by content fingerprint when the inode changed (a copy between drives)
+    QHash<quint64, int> removed_by_inode;
+    QHash<quint64, int> removed_by_fingerprint;
+    for (int idx = 0; idx < removed_rows.size(); idx++)
+    {
+        int row = removed_rows[idx];
+        TM::TrackId id = table.ids[row];
+        quint64 inode = id < TM::TrackId(job.inode_of_id.size()) ? job.inode_of_id[id] : 0;
+        if (inode) removed_by_inode.insert(inode, idx);
+        if (table.fingerprints[row]) removed_by_fingerprint.insert(table.fingerprints[row], idx);
+    }
+    QVector<bool> matched(removed_rows.size(), false);
+    for (const Found& file : std::as_const(found))
+    {
+        int match = -1;
+        auto inode_iter = file.inode ? removed_by_inode.constFind(file.inode) : removed_by_inode.constEnd();
+        if (inode_iter != removed_by_inode.constEnd() && !matched[inode_iter.value()])
+        { // inodes are reused, a different size means a new file that got an old number
+            const TM::TrackInfo& info = table.info[removed_rows[inode_iter.value()]];
+            if (!info.isValid() || info.file_size == file.size) match = inode_iter.value();
+        }
+        quint64 fingerprint = 0;
+        if (match < 0 && (job.use_fingerprint || !removed_by_fingerprint.isEmpty()))
+        {
+            fingerprint = LibraryScanner::fileFingerprint(QFileInfo(file.path));
+            auto fingerprint_iter = removed_by_fingerprint.constFind(fingerprint);
+            if (fingerprint_iter != removed_by_fingerprint.constEnd() && !matched[fingerprint_iter.value()])
+                match = fingerprint_iter.value();
+        }
+
+        if (match >= 0)
+        {
+            matched[match] = true;
+            TM::TrackId id = table.ids[removed_rows[match]];
+            delta.moved_ids.append(id);
+            delta.moved_paths.append(file.path);
+            delta.seen_ids.append(id);
+            delta.seen_inodes.append(file.inode);
+            continue;
+        }
+        delta.added_paths.append(file.path);
+        delta.added_fingerprints.append(job.use_fingerprint ? fingerprint : 0);
+        delta.added_inodes.append(file.inode);
+    }
+    for (int idx = 0; idx < removed_rows.size(); idx++)
+        if (!matched[idx]) delta.removed_ids.append(table.ids[removed_rows[idx]]);
+    return delta;
+}
+
+bool LibraryWatcher::isUnder(const QString &path, const QSet<QString> &dirs)
+{ // the path itself or any directory above it
+    QString parent = path;
+    while (!parent.isEmpty())
+    {
+        if (dirs.contains(parent)) return true;
+        int split = parent.lastIndexOf('/');
+        if (split <= 0) break;
+        parent.truncate(split);
+    }
+    return false;
+}
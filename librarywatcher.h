@@ -0,0 +1,110 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QSet>
+#include <QTimer>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace LW { class LibraryWatcher;}
+QT_END_NAMESPACE
+
+namespace LW
+{
+    // what one batch of changed directories does to the library
+    struct Delta
+    {
+        // new files, fingerprints are 0 unless fingerprinting is on
+        QStringList added_paths;
+        QVector<quint64> added_fingerprints;
+        QVector<quint64> added_inodes;
+        // files that are gone
+        QVector<TM::TrackId> removed_ids;
+        // files that were renamed or moved, the track keeps its id
+        QVector<TM::TrackId> moved_ids;
+        QStringList moved_paths;
+        // file identity of tracks found on disk, see LibraryWatcher::fileInode
+        QVector<TM::TrackId> seen_ids;
+        QVector<quint64> seen_inodes;
+        // directories to start and stop watching
+        QStringList new_dirs;
+        QStringList gone_dirs;
+
+        bool isEmpty() const { return added_paths.isEmpty() && removed_ids.isEmpty() && moved_ids.isEmpty(); }
+    };
+
+    // everything a batch needs, handed to the pool thread as a copy
+    struct Job
+    {
+        TM::TrackTable table;
+        QVector<quint64> inode_of_id;
+        QStringList dirs;
+        QSet<QString> watched;
+        QStringList roots;
+        QSet<QString> extensions;
+        bool use_fingerprint = false;
+    };
+}
+
+// keeps the library in step with the imported folders while the program runs
+// changed directories are collected for WATCH_DEBOUNCE ms and listed as one batch
+// in the background, only those directories are read, never the whole tree
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+    #define WATCH_DEBOUNCE 300
+    #define WATCH_MAX_DELAY 2000
+
+public:
+    explicit LibraryWatcher(TrackModel* init_track_model, QObject *parent = nullptr);
+    ~LibraryWatcher();
+
+    // watch control, the roots are walked once and then followed by their changes
+    void watch(const QStringList& new_roots, const QStringList& new_extensions);
+    void addRoot(const QString& root);
+    void stop();
+    bool isWatching() const;
+    // identity of a file added to the library outside a batch
+    void recordInode(TM::TrackId id, quint64 inode);
+
+    // device and inode packed into one key, 0 where the platform has none
+    static quint64 fileInode(const QString& file_path);
+
+    // getters & setters
+    void setUse_fingerprint(bool newUse_fingerprint);
+
+signals:
+    void changed(const LW::Delta& delta);
+
+private:
+    TrackModel* track_model;
+    QFileSystemWatcher fs_watcher;
+    QThreadPool sync_pool;
+    QTimer debounce_timer;
+    // time since the oldest change still waiting, a steady stream of
+    // changes still gets a batch out every WATCH_MAX_DELAY ms
+    QElapsedTimer dirty_clock;
+
+    QStringList roots;
+    QSet<QString> extensions;
+    QSet<QString> dirty_dirs;
+    // last known inode of every track, indexed by id
+    QVector<quint64> inode_of_id;
+    bool use_fingerprint;
+    bool watching;
+    bool running;
+    // batches started before the last watch() or stop() are dropped
+    int serial;
+
+    void directoryChanged(const QString& path);
+    void startBatch();
+    void batchDone(int batch_serial, const LW::Delta& delta);
+    static LW::Delta sync(const LW::Job& job);
+    static bool isUnder(const QString& path, const QSet<QString>& dirs);
+};
+
+#endif // LIBRARYWATCHER_H
@@ -0,0 +1,217 @@
+#include "loudnessanalyzer.h"
+#include "loudnessmeter.h"
+#include "dspkernels.h"
+#include <QAudioDecoder>
+#include <QAudioBuffer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QUrl>
+#include <QtNumeric>
+#include <cstring>
+#include <memory>
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <time.h>
+#endif
+
+LoudnessAnalyzer::LoudnessAnalyzer(QObject *parent)
+    : QObject{parent}
+    , thread_limit(qMax(1, QThread::idealThreadCount() / 2))
+    , running(false)
+    , cancelled(false)
+    , throttled(false)
+    , pending_jobs(0)
+    , done_jobs(0)
+    , analyzed_jobs(0)
+    , cpu_nsecs(0)
+{ // decoding is heavy, leave half the cores to the gui and the audio thread
+    analyze_pool.setMaxThreadCount(thread_limit);
+    progress_timer.setInterval(ANALYZE_PROGRESS_INTERVAL);
+    connect(&progress_timer, &QTimer::timeout, this, &LoudnessAnalyzer::reportProgress);
+}
+
+LoudnessAnalyzer::~LoudnessAnalyzer()
+{
+    cancel();
+    analyze_pool.waitForDone();
+}
+
+// analysis control
+
+bool LoudnessAnalyzer::analyze(const QVector<LA::Job> &new_jobs)
+{
+    if (running || new_jobs.isEmpty()) return false;
+
+    running = true;
+    jobs = new_jobs;
+    cancelled = false;
+    pending_jobs = jobs.size();
+    done_jobs = 0;
+    analyzed_jobs = 0;
+    cpu_nsecs = 0;
+    analyze_clock.start();
+    progress_timer.start();
+
+    // jobs is left alone until the last task is done, the tasks only read it
+    for (int index = 0; index < jobs.size(); index++)
+        analyze_pool.start([this, index]() { analyzeJob(index); });
+    return true;
+}
+
+void LoudnessAnalyzer::cancel()
+{
+    cancelled = true;
+}
+
+bool LoudnessAnalyzer::isRunning() const
+{
+    return running;
+}
+
+void LoudnessAnalyzer::setThrottled(bool newThrottled)
+{ // running tasks finish their track, then only one thread picks up new ones
+    throttled = newThrottled;
+    analyze_pool.setMaxThreadCount(throttled ? 1 : thread_limit);
+}
+
+bool LoudnessAnalyzer::getThrottled() const
+{
+    return throttled;
+}
+
+bool LoudnessAnalyzer::measure(const QString &file_path, TM::Loudness &result,
+                               const std::atomic<bool> &cancelled, const std::atomic<bool> &throttled)
+{ // pool threads have no event loop of their own, the decoder runs in a local one
+    QAudioDecoder decoder;
+    QEventLoop loop;
+    std::unique_ptr<LoudnessMeter> meter;
+    QVector<float> samples;
+    bool done = false;
+    bool ok = true;
+    auto stop = [&](bool success) {
+        ok = ok && success;
+        done = true;
+        loop.quit();
+    };
+
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&]() {
+        QAudioBuffer buffer = decoder.read();
+        if (!buffer.isValid() || done) return;
+        if (cancelled)
+        {
+            stop(false);
+            return;
+        }
+
+        // measured at the file's own rate and layout, no resampling or downmix
+        QAudioFormat format = buffer.format();
+        int channels = format.channelCount();
+        int frames = buffer.frameCount();
+        if (channels <= 0 || frames <= 0) return;
+        if (!meter) meter = std::unique_ptr<LoudnessMeter>(new LoudnessMeter(format.sampleRate(), channels));
+
+        samples.resize(frames * channels);
+        const char* in = buffer.constData<char>();
+        switch (format.sampleFormat()) {
+        case QAudioFormat::Float:
+            std::memcpy(samples.data(), in, sizeof(float) * frames * channels);
+            break;
+        case QAudioFormat::Int16:
+            DspKernels::int16ToFloat(samples.data(), reinterpret_cast<const qint16*>(in), frames * channels);
+            break;
+        case QAudioFormat::Int32:
+            DspKernels::int32ToFloat(samples.data(), reinterpret_cast<const qint32*>(in), frames * channels);
+            break;
+        default:
+            for (int sample = 0; sample < frames * channels; sample++)
+                samples[sample] = format.normalizedSampleValue(in + sample * format.bytesPerSample());
+            break;
+        }
+        meter->process(samples.constData(), frames);
+
+        if (throttled) QThread::msleep(ANALYZE_THROTTLE_SLEEP);
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, [&]() { stop(true); });
+    QObject::connect(&decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), &loop,
+                     [&](QAudioDecoder::Error) { stop(false); });
+
+    decoder.setSource(QUrl::fromLocalFile(file_path));
+    decoder.start();
+    // an error may already have come in from start()
+    if (!done) loop.exec();
+    decoder.stop();
+
+    if (!ok || !meter || meter->getFrames() == 0) return false;
+    result.integrated = meter->integrated();
+    result.true_peak = meter->truePeak();
+    return true;
+}
+
+qint64 LoudnessAnalyzer::threadCpuNsecs()
+{ // cpu time of the calling thread, 0 where the platform has no way to tell
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0;
+    quint64 ticks = (quint64(kernel.dwHighDateTime) << 32 | kernel.dwLowDateTime)
+            + (quint64(user.dwHighDateTime) << 32 | user.dwLowDateTime);
+    return qint64(ticks * 100);
+#elif defined(Q_OS_UNIX)
+    timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0;
+    return qint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+// private
+
+void LoudnessAnalyzer::analyzeJob(int index)
+{ // runs on a pool thread
+    const LA::Job& job = jobs.at(index);
+    if (!cancelled)
+    {
+        QThread::currentThread()->setPriority(throttled ? QThread::LowestPriority : QThread::LowPriority);
+        QFileInfo file(job.file_path);
+        qint64 size = file.size();
+        qint64 mtime = file.lastModified().toMSecsSinceEpoch();
+        // a file that has not changed since its last analysis is done already
+        if (file.exists() && !job.cached.matches(size, mtime))
+        {
+            qint64 cpu_start = threadCpuNsecs();
+            TM::Loudness result;
+            bool measured = measure(job.file_path, result, cancelled, throttled);
+            cpu_nsecs += threadCpuNsecs() - cpu_start;
+            if (measured || !cancelled)
+            { // files that fail to decode are remembered too, so they are not retried every time
+                if (!measured) result.integrated = result.true_peak = qQNaN();
+                result.file_size = size;
+                result.mtime = mtime;
+                analyzed_jobs++;
+                emit analyzed(job.id, result);
+            }
+        }
+    }
+    done_jobs++;
+
+    // the last task to finish reports back to the owner thread
+    if (pending_jobs.fetch_sub(1) == 1)
+        QMetaObject::invokeMethod(this, &LoudnessAnalyzer::onAnalyzeDone, Qt::QueuedConnection);
+}
+
+void LoudnessAnalyzer::reportProgress()
+{ // tracks per second only counts tracks that were actually decoded
+    qint64 elapsed = qMax<qint64>(analyze_clock.elapsed(), 1);
+    emit progress(done_jobs, jobs.size(), analyzed_jobs * 1000.0 / elapsed, cpu_nsecs / 1e9);
+}
+
+void LoudnessAnalyzer::onAnalyzeDone()
+{
+    progress_timer.stop();
+    reportProgress();
+    running = false;
+    jobs.clear();
+    emit finished(cancelled, analyzed_jobs, analyze_clock.elapsed(), cpu_nsecs / 1e9);
+}
@@ -0,0 +1,81 @@
+#ifndef LOUDNESSANALYZER_H
+#define LOUDNESSANALYZER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QVector>
+#include <atomic>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace LA { class LoudnessAnalyzer;}
+QT_END_NAMESPACE
+
+namespace LA
+{
+    struct Job
+    {
+        TM::TrackId id;
+        QString file_path;
+        // what the library already knows, the file is skipped if it still matches
+        TM::Loudness cached;
+    };
+}
+
+// measures integrated loudness and true peak of many tracks on a bounded pool,
+// decoding with QAudioDecoder; results come back through analyzed()
+class LoudnessAnalyzer : public QObject
+{
+    Q_OBJECT
+    #define ANALYZE_PROGRESS_INTERVAL 500
+    #define ANALYZE_THROTTLE_SLEEP 5 // ms per decoded buffer while throttled
+
+public:
+    explicit LoudnessAnalyzer(QObject *parent = nullptr);
+    ~LoudnessAnalyzer();
+
+    // analysis control
+    bool analyze(const QVector<LA::Job>& new_jobs);
+    void cancel();
+    bool isRunning() const;
+
+    // while throttled one low priority thread is left, pausing between buffers
+    void setThrottled(bool newThrottled);
+    bool getThrottled() const;
+
+    // decodes and measures one file, blocks the calling thread
+    static bool measure(const QString& file_path, TM::Loudness& result,
+                        const std::atomic<bool>& cancelled, const std::atomic<bool>& throttled);
+    // cpu time of the calling thread, 0 where the platform has no way to tell
+    static qint64 threadCpuNsecs();
+
+signals:
+    void analyzed(TM::TrackId id, const TM::Loudness& loudness);
+    // skipped tracks count as done, cpu time is summed over the pool threads
+    void progress(int done, int total, double tracks_per_sec, double cpu_seconds);
+    void finished(bool cancelled, int analyzed, qint64 elapsed_ms, double cpu_seconds);
+
+private:
+    QThreadPool analyze_pool;
+    QTimer progress_timer;
+    QElapsedTimer analyze_clock;
+    QVector<LA::Job> jobs;
+    int thread_limit;
+    bool running;
+
+    std::atomic<bool> cancelled;
+    std::atomic<bool> throttled;
+    std::atomic<int> pending_jobs;
+    std::atomic<int> done_jobs;
+    std::atomic<int> analyzed_jobs;
+    std::atomic<qint64> cpu_nsecs;
+
+    void analyzeJob(int index);
+    void reportProgress();
+    void onAnalyzeDone();
+};
+
+#endif // LOUDNESSANALYZER_H
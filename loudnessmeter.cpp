@@ -0,0 +1,159 @@
+#include "loudnessmeter.h"
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+
+LoudnessMeter::LoudnessMeter(int init_sample_rate, int init_channels)
+    : sample_rate(qMax(init_sample_rate, 1))
+    , channels(qMax(init_channels, 1))
+    , measured_channels(qMin(channels, DK::MaxChannels))
+    , frames_seen(0)
+    , step_energy(0.0)
+    , step_pos(0)
+    , recent_steps{}
+    , steps_seen(0)
+    , peak_pos(0)
+    , peak(0.0f)
+{
+    // BS.1770 filters, worked out for this sample rate instead of the 48 kHz table
+    double gain_db = 3.999843853973347;
+    double k = qTan(M_PI * 1681.974450955533 / sample_rate);
+    double q = 0.7071752369554196;
+    double vh = qPow(10.0, gain_db / 20.0);
+    double vb = qPow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+             2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+
+    k = qTan(M_PI * 38.13547087602444 / sample_rate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    highpass = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+
+    std::memset(filter_state, 0, sizeof(filter_state));
+    std::memset(peak_history, 0, sizeof(peak_history));
+
+    // surround channels count 1.41x, the lfe of a 5.1 layout not at all
+    for (int ch = 0; ch < DK::MaxChannels; ch++) weights[ch] = 1.0;
+    if (measured_channels == 5)
+        weights[3] = weights[4] = 1.41;
+    else if (measured_channels >= 6)
+    {
+        weights[3] = 0.0;
+        weights[4] = weights[5] = 1.41;
+    }
+
+    step_frames = qMax(1, sample_rate * LOUDNESS_STEP_MS / 1000);
+
+    // windowed sinc, each phase normalised to unity gain so phase 0 is the sample itself
+    oversample = sample_rate < 96000 ? 4 : sample_rate < 192000 ? 2 : 1;
+    int length = oversample * LOUDNESS_PEAK_TAPS;
+    int center = length / 2;
+    peak_filter.resize(length);
+    for (int phase = 0; phase < oversample; phase++)
+    {
+        double sum = 0.0;
+        for (int tap = 0; tap < LOUDNESS_PEAK_TAPS; tap++)
+        {
+            int n = phase + tap * oversample;
+            double x = double(n - center) / oversample;
+            double sinc = n == center ? 1.0 : qSin(M_PI * x) / (M_PI * x);
+            double window = 0.5 - 0.5 * qCos(2.0 * M_PI * n / length);
+            // stored newest sample first, see process()
+            peak_filter[phase * LOUDNESS_PEAK_TAPS + LOUDNESS_PEAK_TAPS - 1 - tap] = sinc * window;
+            sum += sinc * window;
+        }
+        for (int tap = 0; tap < LOUDNESS_PEAK_TAPS; tap++)
+            peak_filter[phase * LOUDNESS_PEAK_TAPS + tap] /= sum;
+    }
+}
+
+void LoudnessMeter::process(const float *in, int frames)
+{
+    for (int frame = 0; frame < frames; frame++)
+    {
+        const float* samples = in + frame * channels;
+        double energy = 0.0;
+        for (int ch = 0; ch < measured_channels; ch++)
+        {
+            double x = samples[ch];
+            double* state = filter_state[ch];
+            double y = shelf.b0 * x + state[0];
+            state[0] = shelf.b1 * x - shelf.a1 * y + state[1];
+            state[1] = shelf.b2 * x - shelf.a2 * y;
+            double z = highpass.b0 * y + state[2];
+            state[2] = highpass.b1 * y - highpass.a1 * z + state[3];
+            state[3] = highpass.b2 * y - highpass.a2 * z;
+            energy += weights[ch] * z * z;
+
+            float* history = peak_history[ch];
+            history[peak_pos] = history[peak_pos + LOUDNESS_PEAK_TAPS] = samples[ch];
+            const float* window = history + peak_pos + 1;
+            for (int phase = 0; phase < oversample; phase++)
+            {
+                const float* coef = peak_filter.constData() + phase * LOUDNESS_PEAK_TAPS;
+                float sum = 0.0f;
+                for (int tap = 0; tap < LOUDNESS_PEAK_TAPS; tap++)
+                    sum += coef[tap] * window[tap];
+                peak = qMax(peak, std::fabs(sum));
+            }
+        }
+        peak_pos = (peak_pos + 1) % LOUDNESS_PEAK_TAPS;
+
+        step_energy += energy;
+        if (++step_pos == step_frames) endStep();
+    }
+    frames_seen += frames;
+}
+
+double LoudnessMeter::integrated() const
+{ // mean of the blocks above the absolute gate, then again above the relative gate
+    double absolute = qPow(10.0, (LOUDNESS_ABSOLUTE_GATE + 0.691) / 10.0);
+    double sum = 0.0;
+    int count = 0;
+    for (double block : blocks)
+    {
+        if (block <= absolute) continue;
+        sum += block;
+        count++;
+    }
+    if (count == 0) return LOUDNESS_ABSOLUTE_GATE;
+
+    double relative = sum / count * qPow(10.0, LOUDNESS_RELATIVE_GATE / 10.0);
+    double gate = qMax(absolute, relative);
+    sum = 0.0;
+    count = 0;
+    for (double block : blocks)
+    {
+        if (block <= gate) continue;
+        sum += block;
+        count++;
+    }
+    if (count == 0) return LOUDNESS_ABSOLUTE_GATE;
+    return qMax(LOUDNESS_ABSOLUTE_GATE, -0.691 + 10.0 * std::log10(sum / count));
+}
+
+double LoudnessMeter::truePeak() const
+{
+    return 20.0 * std::log10(qMax(double(peak), 1e-10));
+}
+
+qint64 LoudnessMeter::getFrames() const
+{
+    return frames_seen;
+}
+
+// private
+
+void LoudnessMeter::endStep()
+{ // a gating block is the last LOUDNESS_BLOCK_STEPS steps, so one closes every step
+    recent_steps[steps_seen % LOUDNESS_BLOCK_STEPS] = step_energy / step_frames;
+    steps_seen++;
+    step_energy = 0.0;
+    step_pos = 0;
+    if (steps_seen < LOUDNESS_BLOCK_STEPS) return;
+
+    double block = 0.0;
+    for (double step : recent_steps) block += step;
+    blocks.append(block / LOUDNESS_BLOCK_STEPS);
+}
@@ -0,0 +1,70 @@
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <QVector>
+#include "dspkernels.h"
+
+QT_BEGIN_NAMESPACE
+namespace LM { class LoudnessMeter;}
+QT_END_NAMESPACE
+
+// EBU R128 / ITU-R BS.1770 integrated loudness and true peak of one track
+// feed it the whole track with process(), then read the results
+class LoudnessMeter
+{
+    #define LOUDNESS_BLOCK_STEPS 4 // 400 ms gating blocks, 75% overlap
+    #define LOUDNESS_STEP_MS 100
+    #define LOUDNESS_ABSOLUTE_GATE -70.0
+    #define LOUDNESS_RELATIVE_GATE -10.0
+    #define LOUDNESS_PEAK_TAPS 12 // per phase of the oversampling filter
+
+public:
+    LoudnessMeter(int init_sample_rate, int init_channels);
+
+    // interleaved float samples, channels beyond DK::MaxChannels are ignored
+    void process(const float* in, int frames);
+
+    // LUFS, LOUDNESS_ABSOLUTE_GATE when nothing is loud enough to count
+    double integrated() const;
+    // dBTP, from 4x oversampling below 96 kHz
+    double truePeak() const;
+    qint64 getFrames() const;
+
+private:
+    struct Biquad
+    {
+        double b0, b1, b2, a1, a2;
+    };
+
+    int sample_rate;
+    int channels;
+    int measured_channels;
+    qint64 frames_seen;
+
+    // k-weighting, a high shelf followed by a high pass, two state values per stage
+    Biquad shelf;
+    Biquad highpass;
+    double filter_state[DK::MaxChannels][4];
+    double weights[DK::MaxChannels];
+
+    // weighted energy of the current step, and the mean square of the last steps
+    double step_energy;
+    int step_frames;
+    int step_pos;
+    double recent_steps[LOUDNESS_BLOCK_STEPS];
+    int steps_seen;
+    // mean square of every gating block
+    QVector<double> blocks;
+
+    // true peak, polyphase interpolation over the last LOUDNESS_PEAK_TAPS samples
+    int oversample;
+    QVector<float> peak_filter;
+    // each sample is written twice so the newest LOUDNESS_PEAK_TAPS are always contiguous
+    float peak_history[DK::MaxChannels][2 * LOUDNESS_PEAK_TAPS];
+    int peak_pos;
+    float peak;
+
+    void endStep();
+};
+
+#endif // LOUDNESSMETER_H
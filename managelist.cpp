@@ -1,103 +1,549 @@
 #include "managelist.h"
+#include "perfprobe.h"
+#include <QFileInfo>
+#include <QDebug>
+#include <utility>
 
-ManageList::ManageList(QListWidget* init_list, QObject *parent)
+ManageList::ManageList(QListView* init_list, QObject *parent)
     : QObject{parent}
     , item_list(init_list)
+    , cover_cache(new CoverCache)
+    , track_model(new TrackModel)
+    , search_model(new SearchProxyModel(track_model.get()))
+    , track_delegate(new TrackDelegate)
+    , scanner(new LibraryScanner)
+    , analyzer(new LoudnessAnalyzer)
+    , tag_scanner(new TagScanner(cover_cache.get()))
+    , sorter(new LibrarySorter)
+    , watcher(new LibraryWatcher(track_model.get()))
+    , watch_library(false)
+    , analyze_again(false)
+    , read_tags_again(false)
+    , search_index(new SearchIndex)
+    , search_serial(0)
+    , list_dirty(false)
+    , pending_row(0)
+    , list_loading(false)
+    , list_loaded(false)
 {
+    track_model->setCover_cache(cover_cache.get());
+    setupView();
+    connect(scanner.get(), &LibraryScanner::batchFound, this, &ManageList::appendScanned);
+    connect(scanner.get(), &LibraryScanner::finished, this, &ManageList::importFinished);
+    connect(watcher.get(), &LibraryWatcher::changed, this, &ManageList::applyDelta);
 
+    // any change to the list schedules a write of the library file
+    save_pool.setMaxThreadCount(1);
+    save_timer.setSingleShot(true);
+    save_timer.setInterval(SAVE_DELAY);
+    connect(&save_timer, &QTimer::timeout, this, &ManageList::saveInBackground);
+    connect(track_model.get(), &QAbstractItemModel::rowsInserted, this, &ManageList::markDirty);
+    connect(track_model.get(), &QAbstractItemModel::rowsRemoved, this, &ManageList::markDirty);
+    connect(track_model.get(), &QAbstractItemModel::modelReset, this, &ManageList::markDirty);
+    // the library file keeps the sorted order
+    connect(track_model.get(), &QAbstractItemModel::layoutChanged, this, &ManageList::markDirty);
+    connect(sorter.get(), &LibrarySorter::sorted, this,
+            [this](const QVector<TM::TrackId>& ids, int field, bool, qint64 elapsed_ms) { applySort(ids, field, elapsed_ms); });
+
+    // measured loudness and tags go into the library file with the rest of the track
+    connect(analyzer.get(), &LoudnessAnalyzer::analyzed, track_model.get(), &TrackModel::setLoudness);
+    connect(analyzer.get(), &LoudnessAnalyzer::analyzed, this, &ManageList::markDirty);
+    connect(analyzer.get(), &LoudnessAnalyzer::finished, this, &ManageList::analysisFinished);
+    connect(tag_scanner.get(), &TagScanner::tagsRead, track_model.get(), &TrackModel::setTrackInfo);
+    connect(tag_scanner.get(), &TagScanner::tagsRead, this, &ManageList::markDirty);
+    connect(tag_scanner.get(), &TagScanner::finished, this, &ManageList::tagScanFinished);
+
+    fill_timer.setInterval(0);
+    connect(&fill_timer, &QTimer::timeout, this, &ManageList::fillNextBatch);
+
+    // every change to the model is queued to the index in the order it happened
+    search_index->moveToThread(&search_thread);
+    search_thread.start();
+    connect(search_index.get(), &SearchIndex::resultsReady, this, &ManageList::showResults);
+    refilter_timer.setSingleShot(true);
+    refilter_timer.setInterval(0);
+    connect(&refilter_timer, &QTimer::timeout, this, [this]() {
+        if (!search_text.isEmpty()) search(search_text);
+    });
+    connect(track_model.get(), &QAbstractItemModel::rowsInserted, this,
+            [this](const QModelIndex&, int first, int last) { indexRows(first, last, false); });
+    connect(track_model.get(), &QAbstractItemModel::rowsAboutToBeRemoved, this,
+            [this](const QModelIndex&, int first, int last) { unindexRows(first, last); });
+    connect(track_model.get(), &QAbstractItemModel::modelReset, this,
+            [this]() { indexRows(0, track_model->count() - 1, true); });
+    connect(track_model.get(), &QAbstractItemModel::dataChanged, this,
+            [this](const QModelIndex& top_left, const QModelIndex& bottom_right, const QList<int>& roles) {
+        // only tags change the text, covers and loudness don't
+        if (roles.isEmpty() || roles.contains(Qt::DisplayRole)) indexRows(top_left.row(), bottom_right.row(), false);
+    });
 }
 
 ManageList::~ManageList()
 {
+    analyzer.reset();
+    tag_scanner.reset();
+    watcher.reset();
+    // changes still waiting for the save timer go out now
+    flushList();
+    save_pool.waitForDone();
+    // the index is deleted here, after its thread is gone
+    search_index->setLatest_serial(-1);
+    search_thread.quit();
+    search_thread.wait();
+}
 
+bool ManageList::importToList(const QDir &dir, const QStringList& extensions)
+{ // scan runs in the background, found files arrive through appendScanned
+    PERF_SCOPE("importToList");
+    if (list_loading) return false;
+    if (!scanner->scan(dir, extensions)) return false;
+    // the folder is watched once its files are in
+    import_root = dir.canonicalPath();
+    watch_extensions = extensions;
+    return true;
 }
 
-void ManageList::importToList(const QDir &dir, QString format)
+void ManageList::cancelImport()
 {
-    // Match designated format
-    static QRegularExpression re(format, QRegularExpression::CaseInsensitiveOption);
-
-    // register imported files
-    for (const QFileInfo &file : dir.entryInfoList(QDir::Files))
-    {
-        if (!re.match(file.fileName()).hasMatch()) continue;
-        auto items = item_list->findItems(file.fileName(), Qt::MatchExactly);
-        if (!items.isEmpty()) continue;
-
-        QListWidgetItem* item = new QListWidgetItem;
-        item->setIcon(QIcon(":/icons/res/music_notec2.png"));
-        item->setText(file.fileName());
-        item->setData(Qt::UserRole, file.absoluteFilePath());
-        item_list->addItem(item);
-    }
+    scanner->cancel();
 }
 
 void ManageList::removeSelectedFromList()
+{ // rows still being loaded point into the name pool, do not compact it now
+    if (list_loading) return;
+    track_model->removeTracks(selectedTracks());
+}
+
+void ManageList::clear()
 {
-    QList<QListWidgetItem*> removed_items = item_list->selectedItems();
-    for (QListWidgetItem* item: removed_items)
+    cancelAnalysis();
+    read_tags_again = false;
+    tag_scanner->cancel();
+    if (list_loading)
     {
-        item_list->takeItem(item_list->row(item));
-        delete item;
+        fill_timer.stop();
+        pending_table = TM::TrackTable();
+        list_loading = false;
+        list_loaded = true;
+        emit listLoaded(true);
     }
+    track_model->clear();
+    // nothing imported, nothing to watch
+    watch_roots.clear();
+    updateWatch();
 }
 
-void ManageList::clear()
+int ManageList::getRow(const QModelIndex &index)
 {
-    item_list->clear();
+    return search_model->mapToSource(index).row();
 }
 
-int ManageList::getRow(QListWidgetItem *item)
+QList<TM::TrackId> ManageList::selectedTracks() const
 {
-    return item_list->row(item);
+    QList<TM::TrackId> selected;
+    if (!item_list) return selected;
+    for (const QModelIndex& index : item_list->selectionModel()->selectedIndexes())
+        selected.append(track_model->idAt(search_model->mapToSource(index).row()));
+    return selected;
+}
+
+void ManageList::updateUIonItemChange(TM::TrackId cur_id, TM::TrackId new_id)
+{ // tracks filtered out by a search are not shown, nothing to select then
+    if (!item_list) return;
+    track_delegate->setNow_playing(new_id);
+    item_list->viewport()->update();
+    QModelIndex cur_index = search_model->mapFromSource(track_model->index(track_model->rowOf(cur_id)));
+    QModelIndex new_index = search_model->mapFromSource(track_model->index(track_model->rowOf(new_id)));
+    auto* selection = item_list->selectionModel();
+    if (cur_index.isValid()) selection->select(cur_index, QItemSelectionModel::Deselect);
+    if (!new_index.isValid()) return;
+    selection->select(new_index, QItemSelectionModel::Select);
+    item_list->scrollTo(new_index);
+}
+
+bool ManageList::saveList()
+{ // blocking write, used when the list must be on disk right now
+    PERF_SCOPE("saveList");
+    save_timer.stop();
+    save_pool.waitForDone();
+    // a half loaded list must never overwrite the full one
+    if (!list_dirty || list_loading) return true;
+    if (!library_db.write(track_model->snapshot())) return false;
+    list_dirty = false;
+    return true;
 }
 
-void ManageList::updateUIonItemChange(QListWidgetItem *cur_item, QListWidgetItem *new_item)
+void ManageList::flushList()
 {
-    cur_item->setSelected(false);
-    new_item->setSelected(true);
-    item_list->scrollToItem(new_item);
+    save_timer.stop();
+    saveInBackground();
 }
 
-void ManageList::saveList(QSettings &settings, QString list_name)
+bool ManageList::loadList()
 {
-    settings.beginWriteArray(list_name);
-    for (int row = 0; row < item_list->count(); row++)
-    {
-        settings.setArrayIndex(row);
-        QListWidgetItem* cur_item = item_list->item(row);
-        settings.setValue("fileName", cur_item->text());
-        settings.setValue("filePath", cur_item->data(Qt::UserRole));
-    }
-    settings.endArray();
+    PERF_SCOPE("loadList");
+    TM::TrackTable table;
+    if (!library_db.read(table)) return false;
+    track_model->setTable(table);
+    save_timer.stop();
+    list_dirty = false;
+    list_loaded = true;
+    updateWatch();
+    return true;
+}
+
+void ManageList::loadListAsync()
+{ // reading and validating the file happens off the GUI thread
+    if (list_loading) return;
+    list_loading = true;
+    LibraryDatabase database = library_db;
+    save_pool.start([this, database]() {
+        PERF_SCOPE("loadList_read");
+        TM::TrackTable table;
+        bool ok = database.read(table);
+        QMetaObject::invokeMethod(this, [this, ok, table]() { startFill(ok, table); },
+                                  Qt::QueuedConnection);
+    });
 }
 
-void ManageList::loadList(QSettings &settings, QString list_name)
+bool ManageList::isLoading() const
 {
+    return list_loading;
+}
+
+bool ManageList::migrateList(QSettings &settings, QString list_name)
+{ // one-time import of the list kept in the settings file by older versions
     int size = settings.beginReadArray(list_name);
+    QStringList file_paths;
+    file_paths.reserve(size);
     for (int row = 0; row < size; row++)
     {
         settings.setArrayIndex(row);
-        QString file_name = settings.value("fileName").toString();
+        // file name is the last segment of the path, no need to keep both
+        // stored the way imports store it, files gone since keep their old path
         QString file_path = settings.value("filePath").toString();
-
-        QListWidgetItem* cur_item = new QListWidgetItem;
-        cur_item->setIcon(QIcon(":/icons/res/music_notec2.png"));
-        cur_item->setText(file_name);
-        cur_item->setData(Qt::UserRole, file_path);
-        item_list->addItem(cur_item);
+        QString canonical_path = QFileInfo(file_path).canonicalFilePath();
+        file_paths.append(canonical_path.isEmpty() ? file_path : canonical_path);
     }
     settings.endArray();
+    if (size == 0) return false;
+
+    track_model->appendNewTracks(file_paths);
+    if (!saveList()) return false;
+    settings.remove(list_name);
+    return true;
 }
 
-void ManageList::setItem_list(QListWidget *newMusic_list)
+void ManageList::analyzeLoudness()
+{ // jobs start from the paths the list shows, the analyzer skips files it has seen unchanged
+    if (list_loading) return;
+    if (analyzer->isRunning())
+    {
+        analyze_again = true;
+        return;
+    }
+    analyze_again = false;
+
+    QVector<LA::Job> jobs;
+    jobs.reserve(track_model->count());
+    for (int row = 0; row < track_model->count(); row++)
+    {
+        QModelIndex index = track_model->index(row);
+        jobs.append({index.data(TM::IdRole).toUInt(), index.data(Qt::UserRole).toString(),
+                     track_model->loudness(row)});
+    }
+    analyzer->analyze(jobs);
+}
+
+bool ManageList::sortList(TM::SortField field, bool descending)
+{ // a half loaded list would come back out of order
+    if (list_loading || track_model->count() == 0) return false;
+    sorter->sort(track_model->snapshot(), field, descending);
+    return true;
+}
+
+void ManageList::setWatching(bool enabled)
+{
+    if (watch_library == enabled) return;
+    watch_library = enabled;
+    updateWatch();
+}
+
+bool ManageList::isWatching() const
+{
+    return watcher->isWatching();
+}
+
+void ManageList::search(const QString &text)
+{ // only the newest query is answered, older ones still queued are dropped
+    refilter_timer.stop();
+    search_serial++;
+    search_index->setLatest_serial(search_serial);
+    search_text = text.trimmed();
+    if (search_text.isEmpty())
+    {
+        search_model->clearFilter();
+        return;
+    }
+    int serial = search_serial;
+    QString query = search_text;
+    SearchIndex* index = search_index.get();
+    QMetaObject::invokeMethod(index, [index, serial, query]() { index->search(serial, query); },
+                              Qt::QueuedConnection);
+}
+
+void ManageList::readTags()
+{
+    if (list_loading) return;
+    if (tag_scanner->isRunning())
+    {
+        read_tags_again = true;
+        return;
+    }
+    read_tags_again = false;
+
+    QVector<TS::Job> jobs;
+    jobs.reserve(track_model->count());
+    for (int row = 0; row < track_model->count(); row++)
+        jobs.append({track_model->idAt(row), track_model->filePath(row), track_model->trackInfo(row)});
+    tag_scanner->scan(jobs);
+}
+
+void ManageList::cancelAnalysis()
+{
+    analyze_again = false;
+    analyzer->cancel();
+}
+
+void ManageList::setItem_list(QListView *newMusic_list)
 {
     item_list = newMusic_list;
+    setupView();
 }
 
-QListWidget *ManageList::getItem_list() const
+QListView *ManageList::getItem_list() const
 {
     return item_list;
 }
 
+TrackModel *ManageList::getTrack_model() const
+{
+    return track_model.get();
+}
+
+void ManageList::setUse_fingerprint(bool newUse_fingerprint)
+{
+    scanner->setUse_fingerprint(newUse_fingerprint);
+    watcher->setUse_fingerprint(newUse_fingerprint);
+}
+
+bool ManageList::getUse_fingerprint() const
+{
+    return scanner->getUse_fingerprint();
+}
+
+LibraryScanner *ManageList::getScanner() const
+{
+    return scanner.get();
+}
+
+LoudnessAnalyzer *ManageList::getAnalyzer() const
+{
+    return analyzer.get();
+}
+
+TagScanner *ManageList::getTag_scanner() const
+{
+    return tag_scanner.get();
+}
+
+CoverCache *ManageList::getCover_cache() const
+{
+    return cover_cache.get();
+}
+
+void ManageList::setWatch_roots(const QStringList &newWatch_roots, const QStringList &newWatch_extensions)
+{
+    watch_roots = newWatch_roots;
+    watch_extensions = newWatch_extensions;
+    updateWatch();
+}
 
+QStringList ManageList::getWatch_roots() const
+{
+    return watch_roots;
+}
+
+// private
+
+void ManageList::markDirty()
+{
+    list_dirty = true;
+    save_timer.start();
+}
+
+void ManageList::saveInBackground()
+{ // the snapshot shares the model's arrays until either side changes
+    if (!list_dirty || list_loading) return;
+    list_dirty = false;
+    LibraryDatabase database = library_db;
+    TM::TrackTable table = track_model->snapshot();
+    save_pool.start([database, table]() {
+        PERF_SCOPE("saveList_write");
+        if (!database.write(table))
+            qWarning() << "failed to write library file" << database.getFile_path();
+    });
+}
+
+void ManageList::startFill(bool ok, const TM::TrackTable &table)
+{
+    if (!list_loading) return; // cleared while reading
+    if (!ok)
+    {
+        list_loading = false;
+        list_loaded = true;
+        updateWatch();
+        emit listLoaded(false);
+        return;
+    }
+    pending_table = table;
+    pending_row = qMin(LOAD_BATCH, table.size());
+    track_model->setTable(table.mid(0, pending_row));
+    fill_timer.start();
+}
+
+void ManageList::fillNextBatch()
+{ // one batch per event loop pass keeps the window responsive while filling
+    if (pending_row < pending_table.size())
+    {
+        PERF_SCOPE("loadList_fill");
+        int count = qMin(LOAD_BATCH, pending_table.size() - pending_row);
+        track_model->appendSlice(pending_table.mid(pending_row, count));
+        pending_row += count;
+        return;
+    }
+    fill_timer.stop();
+    pending_table = TM::TrackTable();
+    list_loading = false;
+    // filling the model is not a change to the library
+    save_timer.stop();
+    list_dirty = false;
+    list_loaded = true;
+    updateWatch();
+    emit listLoaded(true);
+}
+
+void ManageList::appendScanned(const QStringList &file_paths, const QVector<quint64> &fingerprints)
+{ // register scanned files, skipping files already in the list
+    track_model->appendNewTracks(file_paths, fingerprints);
+}
+
+void ManageList::analysisFinished(bool cancelled)
+{
+    if (analyze_again && !cancelled) analyzeLoudness();
+}
+
+void ManageList::tagScanFinished(bool cancelled)
+{
+    if (read_tags_again && !cancelled) readTags();
+}
+
+void ManageList::importFinished(bool cancelled)
+{ // a folder inside one watched already is covered by it
+    QString root = import_root;
+    import_root.clear();
+    if (cancelled || root.isEmpty()) return;
+    for (const QString& watch_root : std::as_const(watch_roots))
+        if (root == watch_root || root.startsWith(watch_root + '/')) return;
+    watch_roots.append(root);
+    watcher->addRoot(root);
+}
+
+void ManageList::updateWatch()
+{ // every root is listed again on start, whatever changed while not watching comes in then
+    if (watch_library && list_loaded && !watch_roots.isEmpty())
+        watcher->watch(watch_roots, watch_extensions);
+    else
+        watcher->stop();
+}
+
+void ManageList::applyDelta(const LW::Delta &delta)
+{ // moves keep their track, playing, queued or selected
+    if (list_loading) return;
+    int tracks = track_model->count();
+    track_model->removeTracks(delta.removed_ids);
+    int removed = tracks - track_model->count();
+    track_model->moveTracks(delta.moved_ids, delta.moved_paths);
+    tracks = track_model->count();
+    appendScanned(delta.added_paths, delta.added_fingerprints);
+    int added = track_model->count() - tracks;
+    // the next move of a new file is told from a delete by its inode
+    for (int idx = 0; idx < delta.added_paths.size(); idx++)
+        if (delta.added_inodes[idx]) watcher->recordInode(track_model->idOfPath(delta.added_paths[idx]), delta.added_inodes[idx]);
+    if (added || removed || !delta.moved_ids.isEmpty()) emit librarySynced(added, removed, delta.moved_ids.size());
+}
+
+void ManageList::setupView()
+{ // one delegate paints every row, all rows the same height
+    frame_meter.reset();
+    if (!item_list) return;
+    item_list->setModel(search_model.get());
+    item_list->setItemDelegate(track_delegate.get());
+    item_list->setUniformItemSizes(true);
+    item_list->viewport()->setAttribute(Qt::WA_Hover);
+    frame_meter.reset(new FrameMeter(item_list->viewport(), "music list"));
+}
+
+void ManageList::applySort(const QVector<TM::TrackId> &ids, int field, qint64 elapsed_ms)
+{
+    if (list_loading) return;
+    track_model->reorder(ids);
+    track_model->setGroup_field(static_cast<TM::SortField>(field));
+    emit listSorted(ids.size(), elapsed_ms);
+}
+
+void ManageList::indexRows(int first, int last, bool reset)
+{ // the text is only put together here, normalizing it is the index thread's job
+    SearchIndex* index = search_index.get();
+    for (int batch = first; batch <= last || (reset && batch == first); batch += SEARCH_INDEX_BATCH)
+    {
+        int batch_last = qMin(last, batch + SEARCH_INDEX_BATCH - 1);
+        QVector<TM::TrackId> ids;
+        QStringList texts;
+        ids.reserve(batch_last - batch + 1);
+        texts.reserve(batch_last - batch + 1);
+        for (int row = batch; row <= batch_last; row++)
+        {
+            const TM::TrackInfo info = track_model->trackInfo(row);
+            ids.append(track_model->idAt(row));
+            texts.append(track_model->fileName(row) + ' ' + info.title + ' ' + info.artist + ' ' + info.album);
+        }
+        bool first_batch = reset && batch == first;
+        QMetaObject::invokeMethod(index, [index, ids, texts, first_batch]() {
+            if (first_batch)
+                index->reset(ids, texts);
+            else
+                index->update(ids, texts);
+        }, Qt::QueuedConnection);
+    }
+    // the results may have changed with the index
+    if (!search_text.isEmpty()) refilter_timer.start();
+}
+
+void ManageList::unindexRows(int first, int last)
+{
+    QVector<TM::TrackId> ids;
+    ids.reserve(last - first + 1);
+    for (int row = first; row <= last; row++) ids.append(track_model->idAt(row));
+    SearchIndex* index = search_index.get();
+    QMetaObject::invokeMethod(index, [index, ids]() { index->remove(ids); }, Qt::QueuedConnection);
+    if (!search_text.isEmpty()) refilter_timer.start();
+}
+
+void ManageList::showResults(int serial, const QVector<TM::TrackId> &ids, qint64 elapsed_us)
+{
+    // typed on or cleared since the query was sent
+    if (serial != search_serial || search_text.isEmpty()) return;
+    search_model->setFilter(ids);
+    emit searchFinished(ids.size(), elapsed_us);
+}
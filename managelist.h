@@ -4,7 +4,23 @@
 #include <QObject>
 #include <QDir>
 #include <QSettings>
-#include <QListWidget>
+#include <QListView>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <memory>
+#include "trackmodel.h"
+#include "libraryscanner.h"
+#include "librarydatabase.h"
+#include "loudnessanalyzer.h"
+#include "tagscanner.h"
+#include "covercache.h"
+#include "searchindex.h"
+#include "searchproxymodel.h"
+#include "trackdelegate.h"
+#include "framemeter.h"
+#include "librarysorter.h"
+#include "librarywatcher.h"
 
 QT_BEGIN_NAMESPACE
 namespace ML { class ManageList;}
@@ -13,30 +29,132 @@ QT_END_NAMESPACE
 class ManageList : public QObject
 {
     Q_OBJECT
+    #define SAVE_DELAY 2000
+    #define LOAD_BATCH 20000
+    #define SEARCH_INDEX_BATCH 20000
 
 public:
-    explicit ManageList(QListWidget* init_list, QObject *parent = nullptr);
+    explicit ManageList(QListView* init_list, QObject *parent = nullptr);
     ~ManageList();
 
     // operations
-    void importToList(const QDir& dir, QString format);
+    bool importToList(const QDir& dir, const QStringList& extensions);
+    void cancelImport();
     void removeSelectedFromList();
     void clear();
-    int getRow(QListWidgetItem* item);
+    // rows of the track model, whatever the view shows
+    int getRow(const QModelIndex& index);
+    QList<TM::TrackId> selectedTracks() const;
 
     // ui update
-    void updateUIonItemChange(QListWidgetItem* cur_item, QListWidgetItem* new_item);
+    void updateUIonItemChange(TM::TrackId cur_id, TM::TrackId new_id);
+
+    // narrows the view down to the tracks matching text, an empty text shows all again
+    void search(const QString& text);
 
     // save/load
-    void saveList(QSettings& settings, QString list_name);
-    void loadList(QSettings& settings, QString list_name);
+    bool saveList();
+    // starts writing pending changes right away, without waiting for them
+    void flushList();
+    bool loadList();
+    void loadListAsync();
+    bool isLoading() const;
+    bool migrateList(QSettings& settings, QString list_name);
+
+    // loudness analysis of every track not measured yet, runs in the background
+    void analyzeLoudness();
+    void cancelAnalysis();
+    // tags and cover art of every track not read yet, also in the background
+    void readTags();
+    // the new order replaces the old one in a single layout change, see listSorted
+    bool sortList(TM::SortField field, bool descending = false);
+    // follows the imported folders on disk once the library has loaded, see librarySynced
+    void setWatching(bool enabled);
+    bool isWatching() const;
 
     // getters & setters
-    void setItem_list(QListWidget *newMusic_list);
-    QListWidget *getItem_list() const;
+    void setItem_list(QListView *newMusic_list);
+    QListView *getItem_list() const;
+    TrackModel *getTrack_model() const;
+    void setUse_fingerprint(bool newUse_fingerprint);
+    bool getUse_fingerprint() const;
+    LibraryScanner *getScanner() const;
+    LoudnessAnalyzer *getAnalyzer() const;
+    TagScanner *getTag_scanner() const;
+    CoverCache *getCover_cache() const;
+    // folders imported so far, with the extensions they were imported with
+    void setWatch_roots(const QStringList& newWatch_roots, const QStringList& newWatch_extensions);
+    QStringList getWatch_roots() const;
+
+signals:
+    // emitted once an asynchronous load has put every track into the model
+    void listLoaded(bool ok);
+    void searchFinished(int matches, qint64 elapsed_us);
+    void listSorted(int tracks, qint64 elapsed_ms);
+    // files were added, removed or moved in a watched folder and the list follows
+    void librarySynced(int added, int removed, int moved);
 
 private:
-    QListWidget* item_list;
+    QListView* item_list;
+    // outlives the model and the tag scanner, both hold on to it
+    std::unique_ptr<CoverCache> cover_cache;
+    std::unique_ptr<TrackModel> track_model;
+    // what the view shows, all of track_model or the search results
+    std::unique_ptr<SearchProxyModel> search_model;
+    // rows are painted by the delegate, the meter watches how fast with --trace-fps
+    std::unique_ptr<TrackDelegate> track_delegate;
+    std::unique_ptr<FrameMeter> frame_meter;
+    std::unique_ptr<LibraryScanner> scanner;
+    std::unique_ptr<LoudnessAnalyzer> analyzer;
+    std::unique_ptr<TagScanner> tag_scanner;
+    std::unique_ptr<LibrarySorter> sorter;
+    std::unique_ptr<LibraryWatcher> watcher;
+    QStringList watch_roots;
+    QStringList watch_extensions;
+    QString import_root;
+    bool watch_library;
+    // tracks were added while an analysis or tag scan was running, go again once it is done
+    bool analyze_again;
+    bool read_tags_again;
+
+    // the search index follows the model on its own thread
+    QThread search_thread;
+    std::unique_ptr<SearchIndex> search_index;
+    QString search_text;
+    int search_serial;
+    // index updates ask for the search to run again, at most once per event loop pass
+    QTimer refilter_timer;
+
+    // library file, changes are written in the background after SAVE_DELAY
+    LibraryDatabase library_db;
+    QTimer save_timer;
+    QThreadPool save_pool;
+    bool list_dirty;
+
+    // asynchronous load, the table is read on save_pool and handed
+    // to the model LOAD_BATCH rows at a time
+    TM::TrackTable pending_table;
+    int pending_row;
+    bool list_loading;
+    // the model holds the library file, nothing to compare the disk against before that
+    bool list_loaded;
+    QTimer fill_timer;
+
+    void markDirty();
+    void startFill(bool ok, const TM::TrackTable& table);
+    void fillNextBatch();
+    void saveInBackground();
+    void appendScanned(const QStringList& file_paths, const QVector<quint64>& fingerprints);
+    void analysisFinished(bool cancelled);
+    void tagScanFinished(bool cancelled);
+    void importFinished(bool cancelled);
+    void updateWatch();
+    void applyDelta(const LW::Delta& delta);
+    void setupView();
+    void applySort(const QVector<TM::TrackId>& ids, int field, qint64 elapsed_ms);
+    void indexRows(int first, int last, bool reset);
+    void unindexRows(int first, int last);
+    void showResults(int serial, const QVector<TM::TrackId>& ids, qint64 elapsed_us);
 
 };
 
@@ -1,35 +1,10 @@
-QT += core gui multimedia
+# the player is built from a static core library, shared by the app and the tests
+TEMPLATE = subdirs
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+SUBDIRS += \
+    core \
+    app \
+    tests
 
-CONFIG += c++17
-CONFIG -= debug_and_release debug_and_release_target
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    main.cpp \
-    mainwindow.cpp \
-    managelist.cpp \
-    playqueue.cpp
-
-HEADERS += \
-    mainwindow.h \
-    managelist.h \
-    playqueue.h
-
-FORMS += \
-    mainwindow.ui
-
-TARGET = myMusicPlayer
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
-
-RESOURCES += \
-    icons.qrc \
-    styles.qrc
+app.depends = core
+tests.depends = core
@@ -0,0 +1,137 @@
+#include "perfdialog.h"
+#include "perfprobe.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QDir>
+
+PerfDialog::PerfDialog(QWidget *parent)
+    : QDialog{parent}
+    , summary_label(new QLabel)
+    , probe_table(new QTableWidget(0, 7))
+    , reset_button(new QPushButton("Reset"))
+    , record_button(new QPushButton("Record Trace"))
+    , export_button(new QPushButton("Export Trace..."))
+{
+    setWindowTitle("Diagnostics");
+    resize(640, 420);
+    probe_table->setHorizontalHeaderLabels({"Probe", "Threads", "Count", "p50", "p99", "Max", "Total"});
+    probe_table->verticalHeader()->hide();
+    probe_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    probe_table->setSelectionMode(QAbstractItemView::NoSelection);
+    probe_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    record_button->setCheckable(true);
+    record_button->setChecked(PerfProbe::isRecording());
+
+    // the widgets are children of the dialog, deleting one first takes it off the dialog
+    auto* buttons = new QHBoxLayout;
+    buttons->addWidget(reset_button.get());
+    buttons->addStretch();
+    buttons->addWidget(record_button.get());
+    buttons->addWidget(export_button.get());
+    auto* layout = new QVBoxLayout(this);
+    layout->addWidget(summary_label.get());
+    layout->addWidget(probe_table.get());
+    layout->addLayout(buttons);
+
+    if (!PerfProbe::isCompiledIn())
+    {
+        summary_label->setText("Probes are compiled out of this build, "
+                               "build with CONFIG+=perf_probes or in debug mode to see them.");
+        reset_button->setEnabled(false);
+        record_button->setEnabled(false);
+        export_button->setEnabled(false);
+    }
+
+    refresh_timer.setInterval(PERF_DIALOG_REFRESH);
+    connect(&refresh_timer, &QTimer::timeout, this, &PerfDialog::refresh);
+    connect(reset_button.get(), &QPushButton::clicked, this, [this]() {
+        PerfProbe::reset();
+        refresh();
+    });
+    connect(record_button.get(), &QPushButton::toggled, this, &PerfDialog::toggleRecording);
+    connect(export_button.get(), &QPushButton::clicked, this, &PerfDialog::exportTrace);
+}
+
+PerfDialog::~PerfDialog()
+{
+
+}
+
+// protected
+
+void PerfDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+    if (!PerfProbe::isCompiledIn()) return;
+    refresh();
+    refresh_timer.start();
+}
+
+void PerfDialog::hideEvent(QHideEvent *event)
+{
+    QDialog::hideEvent(event);
+    refresh_timer.stop();
+}
+
+// private
+
+void PerfDialog::refresh()
+{
+    PP::Stats track_switch = PerfProbe::statsOf("track_switch");
+    PP::Stats stall = PerfProbe::statsOf("gui_stall");
+    summary_label->setText(QString("Track switch p50 %1, p99 %2 (%3 switches)    GUI stalls %4, longest %5")
+                           .arg(formatNs(track_switch.p50_ns), formatNs(track_switch.p99_ns))
+                           .arg(track_switch.count).arg(stall.count).arg(formatNs(stall.max_ns)));
+
+    QVector<PP::Stats> all = PerfProbe::stats();
+    probe_table->setRowCount(all.size());
+    for (int row = 0; row < all.size(); row++)
+    {
+        const PP::Stats& stats = all[row];
+        QStringList cells {stats.name, QString::number(stats.threads), QString::number(stats.count)};
+        if (stats.kind == PP::Counter)
+            cells << "" << "" << "" << QString::number(stats.total);
+        else
+            cells << formatNs(stats.p50_ns) << formatNs(stats.p99_ns) << formatNs(stats.max_ns)
+                  << formatNs(stats.total_ns);
+        for (int column = 0; column < cells.size(); column++)
+        {
+            QTableWidgetItem* item = probe_table->item(row, column);
+            if (!item)
+            {
+                item = new QTableWidgetItem;
+                if (column > 0) item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                probe_table->setItem(row, column, item);
+            }
+            item->setText(cells[column]);
+        }
+    }
+}
+
+void PerfDialog::toggleRecording(bool record)
+{
+    PerfProbe::setRecording(record);
+    record_button->setText(record ? "Stop Recording" : "Record Trace");
+}
+
+void PerfDialog::exportTrace()
+{ // the trace is only read once nothing writes to it any more
+    record_button->setChecked(false);
+    QString file_path = QFileDialog::getSaveFileName(this, "Export Chrome Trace",
+                                                     QDir::homePath() + "/myMusicPlayer-trace.json",
+                                                     "Chrome Trace (*.json)", nullptr,
+                                                     QFileDialog::DontUseNativeDialog);
+    if (file_path.isEmpty()) return;
+    if (!PerfProbe::exportTrace(file_path))
+        QMessageBox::warning(this, "Export Trace", "Could not write " + file_path);
+}
+
+QString PerfDialog::formatNs(qint64 ns)
+{
+    if (ns < 10000) return QString("%1 ns").arg(ns);
+    if (ns < 10000000) return QString("%1 us").arg(ns / 1000.0, 0, 'f', 1);
+    return QString("%1 ms").arg(ns / 1000000.0, 0, 'f', 1);
+}
@@ -0,0 +1,46 @@
+#ifndef PERFDIALOG_H
+#define PERFDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QTimer>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+namespace PD { class PerfDialog;}
+QT_END_NAMESPACE
+
+// diagnostics, opened with Ctrl+Shift+D and nowhere in the menus
+// every probe added up over its threads, track switch latency and gui stalls on top;
+// refreshed while shown, a Chrome trace can be recorded and saved from here
+class PerfDialog : public QDialog
+{
+    Q_OBJECT
+    #define PERF_DIALOG_REFRESH 500
+
+public:
+    explicit PerfDialog(QWidget *parent = nullptr);
+    ~PerfDialog();
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    std::unique_ptr<QLabel> summary_label;
+    std::unique_ptr<QTableWidget> probe_table;
+    std::unique_ptr<QPushButton> reset_button;
+    std::unique_ptr<QPushButton> record_button;
+    std::unique_ptr<QPushButton> export_button;
+    QTimer refresh_timer;
+
+    void refresh();
+    void toggleRecording(bool record);
+    void exportTrace();
+
+    static QString formatNs(qint64 ns);
+};
+
+#endif // PERFDIALOG_H
@@ -0,0 +1,371 @@
+#include "perfprobe.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QCoreApplication>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QtAlgorithms>
+#include <memory>
+#include <vector>
+#include <cmath>
+
+namespace
+{
+    // written by its own thread only, read by whoever asks for numbers
+    struct ThreadBlock
+    {
+        ThreadBlock()
+        {
+            clear();
+            trace = nullptr;
+            trace_head = 0;
+        }
+
+        void clear()
+        {
+            for (int probe = 0; probe < PP::MaxProbes; probe++)
+            {
+                for (int bucket = 0; bucket < PP::Buckets; bucket++)
+                    hist[probe][bucket].store(0, std::memory_order_relaxed);
+                counts[probe].store(0, std::memory_order_relaxed);
+                totals[probe].store(0, std::memory_order_relaxed);
+                max_ns[probe].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        int index = 0;
+        QString thread_name;
+        std::atomic<quint64> hist[PP::MaxProbes][PP::Buckets];
+        std::atomic<quint64> counts[PP::MaxProbes];
+        std::atomic<qint64> totals[PP::MaxProbes];
+        std::atomic<qint64> max_ns[PP::MaxProbes];
+        // allocated by the thread the first time it records while tracing
+        std::atomic<PP::TraceEvent*> trace;
+        std::atomic<quint64> trace_head;
+    };
+
+    struct Registry
+    {
+        Registry()
+            : probe_count(0)
+            , recording(false)
+            , epoch_ns(PerfProbe::now())
+        {
+            for (int probe = 0; probe < PP::MaxProbes; probe++) span_start[probe].store(0);
+        }
+
+        // taken to register probes and threads and to read, never to record
+        QMutex mutex;
+        QString names[PP::MaxProbes];
+        PP::Kind kinds[PP::MaxProbes];
+        std::atomic<int> probe_count;
+        // a block outlives its thread with its numbers, the next new thread takes it over,
+        // so pool threads expiring and coming back don't add blocks
+        std::vector<std::unique_ptr<ThreadBlock>> blocks;
+        std::vector<ThreadBlock*> free_blocks;
+        std::atomic<qint64> span_start[PP::MaxProbes];
+        std::atomic<bool> recording;
+        qint64 epoch_ns;
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    // gives the thread's block back when the thread exits
+    struct LocalBlock
+    {
+        ~LocalBlock()
+        {
+            if (!block) return;
+            Registry& reg = registry();
+            QMutexLocker locker(&reg.mutex);
+            reg.free_blocks.push_back(block);
+            block = nullptr;
+        }
+
+        ThreadBlock* block = nullptr;
+    };
+
+    thread_local LocalBlock local_block;
+
+    ThreadBlock* threadBlock()
+    {
+        if (local_block.block) return local_block.block;
+        Registry& reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        ThreadBlock* block = nullptr;
+        if (!reg.free_blocks.empty())
+        {
+            block = reg.free_blocks.back();
+            reg.free_blocks.pop_back();
+        }
+        else
+        {
+            block = new ThreadBlock;
+            block->index = int(reg.blocks.size());
+            reg.blocks.emplace_back(block);
+        }
+        QThread* thread = QThread::currentThread();
+        if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+            block->thread_name = "gui";
+        else if (thread && !thread->objectName().isEmpty())
+            block->thread_name = thread->objectName();
+        else
+            block->thread_name = QString("thread %1").arg(block->index);
+        local_block.block = block;
+        return block;
+    }
+
+    inline int bucketOf(qint64 ns)
+    {
+        if (ns < 4) return int(qMax<qint64>(ns, 0));
+        int msb = 63 - qCountLeadingZeroBits(quint64(ns));
+        return qMin(PP::Buckets - 1, msb * 4 + int((ns >> (msb - 2)) & 3));
+    }
+
+    // the most a bucket holds, what a percentile reports
+    inline qint64 bucketLimit(int bucket)
+    {
+        int msb = bucket / 4;
+        if (msb < 2) return bucket;
+        return qint64(5 + bucket % 4) << (msb - 2);
+    }
+
+    qint64 percentile(const quint64* hist, quint64 count, double share)
+    {
+        quint64 wanted = qMax<quint64>(1, quint64(std::ceil(count * share)));
+        quint64 seen = 0;
+        for (int bucket = 0; bucket < PP::Buckets; bucket++)
+        {
+            seen += hist[bucket];
+            if (seen >= wanted) return bucketLimit(bucket);
+        }
+        return bucketLimit(PP::Buckets - 1);
+    }
+}
+
+int PerfProbe::probeId(const char *name, PP::Kind kind)
+{
+    Registry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    QString probe_name = QString::fromLatin1(name);
+    int probes = reg.probe_count.load(std::memory_order_relaxed);
+    for (int probe = 0; probe < probes; probe++)
+        if (reg.names[probe] == probe_name) return probe;
+    if (probes == PP::MaxProbes) return -1;
+    reg.names[probes] = probe_name;
+    reg.kinds[probes] = kind;
+    reg.probe_count.store(probes + 1, std::memory_order_release);
+    return probes;
+}
+
+void PerfProbe::record(int probe, qint64 start_ns, qint64 dur_ns)
+{
+    if (probe < 0) return;
+    ThreadBlock* block = threadBlock();
+    block->hist[probe][bucketOf(dur_ns)].fetch_add(1, std::memory_order_relaxed);
+    block->counts[probe].fetch_add(1, std::memory_order_relaxed);
+    block->totals[probe].fetch_add(dur_ns, std::memory_order_relaxed);
+    if (dur_ns > block->max_ns[probe].load(std::memory_order_relaxed))
+        block->max_ns[probe].store(dur_ns, std::memory_order_relaxed);
+
+    if (!registry().recording.load(std::memory_order_relaxed)) return;
+    PP::TraceEvent* trace = block->trace.load(std::memory_order_relaxed);
+    if (!trace)
+    {
+        trace = new PP::TraceEvent[PP::TraceSize];
+        block->trace.store(trace, std::memory_order_release);
+    }
+    quint64 head = block->trace_head.load(std::memory_order_relaxed);
+    trace[head % PP::TraceSize] = {probe, start_ns, dur_ns};
+    block->trace_head.store(head + 1, std::memory_order_release);
+}
+
+void PerfProbe::count(int probe, qint64 amount)
+{
+    if (probe < 0) return;
+    ThreadBlock* block = threadBlock();
+    block->counts[probe].fetch_add(1, std::memory_order_relaxed);
+    block->totals[probe].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void PerfProbe::beginSpan(int probe)
+{
+    if (probe < 0) return;
+    registry().span_start[probe].store(now(), std::memory_order_relaxed);
+}
+
+void PerfProbe::endSpan(int probe)
+{ // cheap when nothing is open, the gui ends spans from frequent signals
+    if (probe < 0) return;
+    std::atomic<qint64>& start = registry().span_start[probe];
+    if (start.load(std::memory_order_relaxed) == 0) return;
+    qint64 start_ns = start.exchange(0, std::memory_order_relaxed);
+    if (start_ns) record(probe, start_ns, now() - start_ns);
+}
+
+bool PerfProbe::isCompiledIn()
+{
+#ifdef PERF_PROBES
+    return true;
+#else
+    return false;
+#endif
+}
+
+QVector<PP::Stats> PerfProbe::stats()
+{
+    Registry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    int probes = reg.probe_count.load(std::memory_order_acquire);
+    QVector<PP::Stats> all(probes);
+    quint64 hist[PP::Buckets];
+    for (int probe = 0; probe < probes; probe++)
+    {
+        PP::Stats& stats = all[probe];
+        stats.name = reg.names[probe];
+        stats.kind = reg.kinds[probe];
+        std::fill(hist, hist + PP::Buckets, 0);
+        for (const auto& block : reg.blocks)
+        {
+            quint64 count = block->counts[probe].load(std::memory_order_relaxed);
+            if (!count) continue;
+            stats.threads++;
+            stats.count += count;
+            if (stats.kind == PP::Counter)
+            {
+                stats.total += block->totals[probe].load(std::memory_order_relaxed);
+                continue;
+            }
+            stats.total_ns += block->totals[probe].load(std::memory_order_relaxed);
+            stats.max_ns = qMax(stats.max_ns, block->max_ns[probe].load(std::memory_order_relaxed));
+            for (int bucket = 0; bucket < PP::Buckets; bucket++)
+                hist[bucket] += block->hist[probe][bucket].load(std::memory_order_relaxed);
+        }
+        if (stats.kind != PP::Counter && stats.count)
+        {
+            stats.p50_ns = qMin(stats.max_ns, percentile(hist, stats.count, 0.50));
+            stats.p99_ns = qMin(stats.max_ns, percentile(hist, stats.count, 0.99));
+        }
+    }
+    return all;
+}
+
+PP::Stats PerfProbe::statsOf(const char *name)
+{
+    QString probe_name = QString::fromLatin1(name);
+    for (const PP::Stats& stats : PerfProbe::stats())
+        if (stats.name == probe_name) return stats;
+    PP::Stats none;
+    none.name = probe_name;
+    return none;
+}
+
+void PerfProbe::reset()
+{
+    Registry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    for (const auto& block : reg.blocks) block->clear();
+}
+
+void PerfProbe::setRecording(bool enable)
+{ // a new recording starts an empty trace
+    Registry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    if (enable && !reg.recording)
+        for (const auto& block : reg.blocks) block->trace_head.store(0, std::memory_order_relaxed);
+    reg.recording = enable;
+}
+
+bool PerfProbe::isRecording()
+{
+    return registry().recording;
+}
+
+bool PerfProbe::exportTrace(const QString &file_path)
+{ // events still being written while this reads may come out torn, stop recording first
+    Registry& reg = registry();
+    QJsonArray events;
+    {
+        QMutexLocker locker(&reg.mutex);
+        for (const auto& block : reg.blocks)
+        {
+            QJsonObject thread_name;
+            thread_name["name"] = "thread_name";
+            thread_name["ph"] = "M";
+            thread_name["pid"] = 1;
+            thread_name["tid"] = block->index;
+            thread_name["args"] = QJsonObject {{"name", block->thread_name}};
+            events.append(thread_name);
+
+            const PP::TraceEvent* trace = block->trace.load(std::memory_order_acquire);
+            quint64 head = block->trace_head.load(std::memory_order_acquire);
+            if (!trace) continue;
+            for (quint64 idx = head > quint64(PP::TraceSize) ? head - PP::TraceSize : 0; idx < head; idx++)
+            {
+                const PP::TraceEvent& event = trace[idx % PP::TraceSize];
+                QJsonObject entry;
+                entry["name"] = reg.names[event.probe];
+                entry["cat"] = reg.kinds[event.probe] == PP::Span ? "span" : "scope";
+                entry["ph"] = "X";
+                entry["ts"] = (event.start_ns - reg.epoch_ns) / 1000.0;
+                entry["dur"] = event.dur_ns / 1000.0;
+                entry["pid"] = 1;
+                entry["tid"] = block->index;
+                events.append(entry);
+            }
+        }
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+    QSaveFile trace_file(file_path);
+    if (!trace_file.open(QIODevice::WriteOnly)) return false;
+    trace_file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    return trace_file.commit();
+}
+
+// StallDetector
+
+StallDetector::StallDetector(QObject *parent)
+    : QObject{parent}
+    , probe(-1)
+{
+    tick_timer.setInterval(STALL_INTERVAL);
+    tick_timer.setTimerType(Qt::PreciseTimer);
+    connect(&tick_timer, &QTimer::timeout, this, &StallDetector::tick);
+}
+
+StallDetector::~StallDetector()
+{
+
+}
+
+void StallDetector::start()
+{
+    probe = PerfProbe::probeId("gui_stall", PP::Timer);
+    tick_clock.start();
+    tick_timer.start();
+}
+
+void StallDetector::stop()
+{
+    tick_timer.stop();
+}
+
+// private
+
+void StallDetector::tick()
+{ // late by more than the threshold, the loop was blocked for about that long
+    qint64 late_ms = tick_clock.restart() - STALL_INTERVAL;
+    if (late_ms <= STALL_THRESHOLD) return;
+    qint64 late_ns = late_ms * 1000000;
+    PerfProbe::record(probe, PerfProbe::now() - late_ns, late_ns);
+}
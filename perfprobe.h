@@ -0,0 +1,148 @@
+#ifndef PERFPROBE_H
+#define PERFPROBE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <atomic>
+#include <chrono>
+
+QT_BEGIN_NAMESPACE
+namespace PP { class PerfProbe;}
+QT_END_NAMESPACE
+
+namespace PP
+{
+    // timers record how long a scope took, spans the time between a begin and an end
+    // (on any thread), counters add up amounts
+    enum Kind {Timer, Span, Counter};
+
+    const int MaxProbes = 64;
+    // four buckets per power of two, from 1 ns up to about 4 s, longer goes in the last one
+    const int Buckets = 128;
+    // trace events kept per thread while recording, the oldest are overwritten
+    const int TraceSize = 16384;
+
+    struct Stats
+    {
+        QString name;
+        Kind kind = Timer;
+        int threads = 0;
+        quint64 count = 0;
+        // counters only
+        qint64 total = 0;
+        // timers and spans, in ns
+        qint64 total_ns = 0;
+        qint64 p50_ns = 0;
+        qint64 p99_ns = 0;
+        qint64 max_ns = 0;
+    };
+
+    struct TraceEvent
+    {
+        int probe;
+        qint64 start_ns;
+        qint64 dur_ns;
+    };
+}
+
+// scoped timers and counters for the paths a stutter can hide in, see PERF_SCOPE
+// every thread records into a block of its own with relaxed atomics, nothing is locked
+// after the first probe a thread hits; readers add the blocks up when they want numbers
+class PerfProbe
+{
+public:
+    // registers a probe the first time its name is seen, -1 once MaxProbes are taken
+    static int probeId(const char* name, PP::Kind kind);
+
+    static qint64 now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    static void record(int probe, qint64 start_ns, qint64 dur_ns);
+    static void count(int probe, qint64 amount);
+    // a later begin restarts the span, an end without a begin is ignored
+    static void beginSpan(int probe);
+    static void endSpan(int probe);
+
+    // false when the probes are compiled out, see PERF_PROBES in the .pro
+    static bool isCompiledIn();
+
+    // all threads added up, in the order the probes were registered
+    static QVector<PP::Stats> stats();
+    static PP::Stats statsOf(const char* name);
+    static void reset();
+
+    // Chrome trace (chrome://tracing, Perfetto) of the timers and spans recorded meanwhile
+    static void setRecording(bool enable);
+    static bool isRecording();
+    static bool exportTrace(const QString& file_path);
+};
+
+// timer for the enclosing scope
+class PerfScope
+{
+public:
+    explicit PerfScope(int init_probe)
+        : probe(init_probe)
+        , start_ns(PerfProbe::now())
+    {
+
+    }
+    ~PerfScope()
+    {
+        PerfProbe::record(probe, start_ns, PerfProbe::now() - start_ns);
+    }
+
+private:
+    int probe;
+    qint64 start_ns;
+};
+
+// gui thread stalls, a timer that fires late by more than STALL_THRESHOLD ms means the
+// event loop was busy for that long; the stall goes into the gui_stall probe
+class StallDetector : public QObject
+{
+    Q_OBJECT
+    #define STALL_INTERVAL 50
+    #define STALL_THRESHOLD 100
+
+public:
+    explicit StallDetector(QObject *parent = nullptr);
+    ~StallDetector();
+
+    void start();
+    void stop();
+
+private:
+    QTimer tick_timer;
+    QElapsedTimer tick_clock;
+    int probe;
+
+    void tick();
+};
+
+// probes cost nothing unless PERF_PROBES is defined, debug builds and CONFIG+=perf_probes do
+#ifdef PERF_PROBES
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_SCOPE(name) \
+    static const int PERF_CONCAT(perf_probe_, __LINE__) = PerfProbe::probeId(name, PP::Timer); \
+    PerfScope PERF_CONCAT(perf_scope_, __LINE__)(PERF_CONCAT(perf_probe_, __LINE__))
+#define PERF_COUNT(name, amount) \
+    do { static const int perf_probe = PerfProbe::probeId(name, PP::Counter); PerfProbe::count(perf_probe, amount); } while (0)
+#define PERF_BEGIN(name) \
+    do { static const int perf_probe = PerfProbe::probeId(name, PP::Span); PerfProbe::beginSpan(perf_probe); } while (0)
+#define PERF_END(name) \
+    do { static const int perf_probe = PerfProbe::probeId(name, PP::Span); PerfProbe::endSpan(perf_probe); } while (0)
+#else
+#define PERF_SCOPE(name) do {} while (0)
+#define PERF_COUNT(name, amount) do {} while (0)
+#define PERF_BEGIN(name) do {} while (0)
+#define PERF_END(name) do {} while (0)
+#endif
+
+#endif // PERFPROBE_H
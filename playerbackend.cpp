@@ -0,0 +1,166 @@
+#include "playerbackend.h"
+#include "dspkernels.h"
+
+PlayerBackend::PlayerBackend(QObject *parent)
+    : QObject{parent}
+{
+
+}
+
+PlayerBackend::~PlayerBackend()
+{
+
+}
+
+bool PlayerBackend::handlesTransitions() const
+{
+    return false;
+}
+
+void PlayerBackend::setNextSource(const QUrl &source)
+{
+    Q_UNUSED(source)
+}
+
+void PlayerBackend::setAudioTap(AudioRingBuffer *tap)
+{
+    Q_UNUSED(tap)
+}
+
+// MediaPlayerBackend
+
+MediaPlayerBackend::MediaPlayerBackend(QObject *parent)
+    : PlayerBackend{parent}
+    , media_player(new QMediaPlayer)
+    , audio_output(new QAudioOutput)
+    , audio_tap(nullptr)
+{
+    media_player->setAudioOutput(audio_output.get());
+    connect(media_player.get(), &QMediaPlayer::positionChanged, this, &PlayerBackend::positionChanged);
+    connect(media_player.get(), &QMediaPlayer::durationChanged, this, &PlayerBackend::durationChanged);
+    connect(media_player.get(), &QMediaPlayer::playbackStateChanged, this, &PlayerBackend::playbackStateChanged);
+    connect(media_player.get(), &QMediaPlayer::mediaStatusChanged, this, &PlayerBackend::mediaStatusChanged);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+    QAudioFormat format;
+    format.setSampleRate(48000);
+    format.setChannelCount(2);
+    format.setSampleFormat(QAudioFormat::Float);
+    buffer_output.reset(new QAudioBufferOutput(format));
+    connect(buffer_output.get(), &QAudioBufferOutput::audioBufferReceived, this, &MediaPlayerBackend::tapBuffer);
+#endif
+}
+
+MediaPlayerBackend::~MediaPlayerBackend()
+{
+
+}
+
+void MediaPlayerBackend::setSource(const QUrl &source)
+{
+    media_player->setSource(source);
+}
+
+QUrl MediaPlayerBackend::source() const
+{
+    return media_player->source();
+}
+
+void MediaPlayerBackend::play()
+{
+    media_player->play();
+}
+
+void MediaPlayerBackend::pause()
+{
+    media_player->pause();
+}
+
+void MediaPlayerBackend::stop()
+{
+    media_player->stop();
+}
+
+void MediaPlayerBackend::setPosition(qint64 position)
+{
+    media_player->setPosition(position);
+}
+
+qint64 MediaPlayerBackend::position() const
+{
+    return media_player->position();
+}
+
+qint64 MediaPlayerBackend::duration() const
+{
+    return media_player->duration();
+}
+
+QMediaPlayer::PlaybackState MediaPlayerBackend::playbackState() const
+{
+    return media_player->playbackState();
+}
+
+QMediaPlayer::MediaStatus MediaPlayerBackend::mediaStatus() const
+{
+    return media_player->mediaStatus();
+}
+
+QMediaMetaData MediaPlayerBackend::metaData() const
+{
+    return media_player->metaData();
+}
+
+void MediaPlayerBackend::setVolume(float volume)
+{
+    audio_output->setVolume(volume);
+}
+
+float MediaPlayerBackend::volume() const
+{
+    return audio_output->volume();
+}
+
+void MediaPlayerBackend::setAudioTap(AudioRingBuffer *tap)
+{ // without a buffer output (Qt before 6.8) there is nothing to copy, the tap stays empty
+    audio_tap = tap;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+    // the player only hands out buffers while an output is set
+    media_player->setAudioBufferOutput(tap ? buffer_output.get() : nullptr);
+#endif
+}
+
+// private
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+void MediaPlayerBackend::tapBuffer(const QAudioBuffer &buffer)
+{ // the format asked for is a wish, whatever comes is brought to float stereo
+    if (!audio_tap || !buffer.isValid()) return;
+    QAudioFormat format = buffer.format();
+    int channels = format.channelCount();
+    int frames = buffer.frameCount();
+    if (format.sampleRate() != 48000 || (channels != 1 && channels != 2) || frames <= 0) return;
+
+    const float* data = buffer.constData<float>();
+    if (format.sampleFormat() == QAudioFormat::Int16)
+    {
+        tap_samples.resize(frames * channels);
+        DspKernels::int16ToFloat(tap_samples.data(), buffer.constData<qint16>(), frames * channels);
+        data = tap_samples.constData();
+    }
+    else if (format.sampleFormat() == QAudioFormat::Int32)
+    {
+        tap_samples.resize(frames * channels);
+        DspKernels::int32ToFloat(tap_samples.data(), buffer.constData<qint32>(), frames * channels);
+        data = tap_samples.constData();
+    }
+    else if (format.sampleFormat() != QAudioFormat::Float)
+        return;
+    if (channels == 1)
+    {
+        tap_stereo.resize(frames * 2);
+        DspKernels::monoToStereo(tap_stereo.data(), data, frames);
+        data = tap_stereo.constData();
+    }
+    audio_tap->write(data, frames);
+}
+#endif
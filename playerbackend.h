@@ -0,0 +1,111 @@
+#ifndef PLAYERBACKEND_H
+#define PLAYERBACKEND_H
+
+#include <QObject>
+#include <QUrl>
+#include <QMediaPlayer>
+#include <QAudioOutput>
+#include <QMediaMetaData>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+#include <QAudioBuffer>
+#include <QAudioBufferOutput>
+#endif
+#include <memory>
+#include "audioringbuffer.h"
+
+QT_BEGIN_NAMESPACE
+namespace PB { class PlayerBackend;}
+QT_END_NAMESPACE
+
+namespace PB
+{
+    enum Engine {Multimedia, Pipeline};
+}
+
+// the part of QMediaPlayer the main window drives, so playback can go
+// through Qt Multimedia or through our own audio pipeline
+class PlayerBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PlayerBackend(QObject *parent = nullptr);
+    virtual ~PlayerBackend();
+
+    // transport
+    virtual void setSource(const QUrl& source) = 0;
+    virtual QUrl source() const = 0;
+    virtual void play() = 0;
+    virtual void pause() = 0;
+    virtual void stop() = 0;
+    virtual void setPosition(qint64 position) = 0;
+    virtual qint64 position() const = 0;
+    virtual qint64 duration() const = 0;
+    virtual QMediaPlayer::PlaybackState playbackState() const = 0;
+    virtual QMediaPlayer::MediaStatus mediaStatus() const = 0;
+    virtual QMediaMetaData metaData() const = 0;
+
+    // output
+    virtual void setVolume(float volume) = 0;
+    virtual float volume() const = 0;
+
+    // backends that move to the next track on their own ask for it through
+    // nextSourceNeeded() and report the switch through sourceAdvanced()
+    virtual bool handlesTransitions() const;
+    virtual void setNextSource(const QUrl& source);
+
+    // a copy of what is played, 48 kHz stereo float, goes into the tap; the audio
+    // side drops what does not fit and never waits, nullptr stops the copy
+    virtual void setAudioTap(AudioRingBuffer* tap);
+
+signals:
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
+    void playbackStateChanged(QMediaPlayer::PlaybackState state);
+    void mediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void nextSourceNeeded();
+    void sourceAdvanced(const QUrl& source);
+};
+
+// plain Qt Multimedia playback
+class MediaPlayerBackend : public PlayerBackend
+{
+    Q_OBJECT
+
+public:
+    explicit MediaPlayerBackend(QObject *parent = nullptr);
+    ~MediaPlayerBackend();
+
+    void setSource(const QUrl& source) override;
+    QUrl source() const override;
+    void play() override;
+    void pause() override;
+    void stop() override;
+    void setPosition(qint64 position) override;
+    qint64 position() const override;
+    qint64 duration() const override;
+    QMediaPlayer::PlaybackState playbackState() const override;
+    QMediaPlayer::MediaStatus mediaStatus() const override;
+    QMediaMetaData metaData() const override;
+
+    void setVolume(float volume) override;
+    float volume() const override;
+
+    void setAudioTap(AudioRingBuffer* tap) override;
+
+private:
+    std::unique_ptr<QMediaPlayer> media_player;
+    std::unique_ptr<QAudioOutput> audio_output;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+    std::unique_ptr<QAudioBufferOutput> buffer_output;
+    QVector<float> tap_samples;
+    QVector<float> tap_stereo;
+#endif
+    AudioRingBuffer* audio_tap;
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+    void tapBuffer(const QAudioBuffer& buffer);
+#endif
+};
+
+#endif // PLAYERBACKEND_H
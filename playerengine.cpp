@@ -0,0 +1,685 @@
+#include "playerengine.h"
+#include "perfprobe.h"
+#include <QCoreApplication>
+#include <QSettings>
+
+PlayerEngine::PlayerEngine(QListView *list_view, QObject *parent)
+    : QObject{parent}
+    , music_list(new ManageList(list_view))
+    , audio_tap(nullptr)
+    , import_extensions({"flac", "mp3", "wav"})
+    , restore_track_id(TM::InvalidId)
+    , restore_position(0)
+    , session_store(new SessionStore)
+    , restore_queue_pending(false)
+    , music_manually_stopped(false)
+    , volume(1.0f)
+    , muted(false)
+    , gapless_enabled(true)
+    , preloaded_track(TM::InvalidId)
+    , crossfade_ms(0)
+    , crossfade_curve(DK::EqualPower)
+    , audio_engine(PB::Multimedia)
+    , output_buffer_ms(PIPELINE_DEFAULT_BUFFER)
+    , output_period_ms(PIPELINE_DEFAULT_PERIOD)
+    , replay_gain_mode(TR::Off)
+    , analyze_loudness(true)
+    , watch_library(false)
+{
+    // settings first, they pick the player; the music list itself is loaded in start()
+    readSettings();
+    play_queue = std::unique_ptr<PlayQueue>(new PlayQueue(music_list->getTrack_model()));
+    setupPlayer();
+    music_list->setWatching(watch_library);
+    // the play mode is back right away, the queue once the library has loaded
+    play_queue->setPlayMode(restore_queue.play_mode);
+
+    // the library fills in after startup, pick the last track up as soon as it is there
+    connect(music_list.get(), &ManageList::listLoaded, this, &PlayerEngine::finishLoading);
+    connect(music_list->getTrack_model(), &QAbstractItemModel::modelReset, this, &PlayerEngine::restoreLastTrack);
+    connect(music_list->getTrack_model(), &QAbstractItemModel::rowsInserted, this, &PlayerEngine::restoreLastTrack);
+    // new tracks get their tags read and measured, imported or found in a watched folder
+    connect(music_list->getScanner(), &LibraryScanner::finished, this, [this](bool cancelled) {
+        if (!cancelled) refreshLibrary();
+    });
+    connect(music_list.get(), &ManageList::librarySynced, this, [this](int added) {
+        if (added > 0) refreshLibrary();
+    });
+
+    // the session is kept up to date while playing, not only at exit
+    session_timer.setInterval(SESSION_SAVE_INTERVAL);
+    connect(&session_timer, &QTimer::timeout, this, &PlayerEngine::saveSession);
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &PlayerEngine::saveSession);
+    session_timer.start();
+    session_flush.setSingleShot(true);
+    session_flush.setInterval(SESSION_FLUSH_DELAY);
+    connect(&session_flush, &QTimer::timeout, this, &PlayerEngine::saveSession);
+}
+
+PlayerEngine::~PlayerEngine()
+{
+
+}
+
+void PlayerEngine::start()
+{
+    music_list->loadListAsync();
+}
+
+// transport
+
+void PlayerEngine::play()
+{
+    music_manually_stopped = false;
+    audio_player->play();
+}
+
+void PlayerEngine::pause()
+{
+    music_manually_stopped = false;
+    audio_player->pause();
+}
+
+void PlayerEngine::togglePlay()
+{
+    if (audio_player->playbackState() == QMediaPlayer::PlayingState)
+        pause();
+    else
+        play();
+}
+
+void PlayerEngine::stop()
+{ // when the state changes to stopped <music_manually_stopped> is checked, set it before stop()
+    music_manually_stopped = true;
+    audio_player->stop();
+}
+
+void PlayerEngine::next()
+{
+    auto current_item = play_queue->current();
+    auto next_item = play_queue->next();
+    if (next_item == TM::InvalidId || current_item == TM::InvalidId) return;
+    playListItem(next_item);
+    music_list->updateUIonItemChange(current_item, next_item);
+}
+
+void PlayerEngine::previous()
+{
+    auto current_item = play_queue->current();
+    auto pre_item = play_queue->previous();
+    if (pre_item == TM::InvalidId || current_item == TM::InvalidId) return;
+    playListItem(pre_item);
+    music_list->updateUIonItemChange(current_item, pre_item);
+}
+
+void PlayerEngine::playRow(int row)
+{
+    if (row < 0 || row >= music_list->getTrack_model()->count()) return;
+    play_queue->updatePlayingQueue(row);
+    play_queue->setCurrent_item_row(row);
+
+    auto cur_play_mode = play_queue->getPlayMode();
+    play_queue->setPlayMode(PQ::PlayMode::Order);
+    next();
+    play_queue->setPlayMode(cur_play_mode);
+}
+
+void PlayerEngine::playFile(const QString &file_path)
+{
+    resetPreload();
+    PERF_BEGIN("track_switch");
+    startPlayingNew(QFileInfo(file_path));
+}
+
+void PlayerEngine::seek(qint64 position)
+{
+    audio_player->setPosition(qMax<qint64>(0, position));
+}
+
+void PlayerEngine::enqueue(const QList<TM::TrackId> &ids)
+{
+    play_queue->addToUserQueue(ids);
+    sessionChanged();
+}
+
+void PlayerEngine::setPlayMode(PQ::PlayMode mode)
+{
+    play_queue->setPlayMode(mode);
+    sessionChanged();
+    emit playModeChanged(mode);
+}
+
+PQ::PlayMode PlayerEngine::getPlay_mode() const
+{
+    return play_queue->getPlayMode();
+}
+
+// output
+
+void PlayerEngine::setVolume(float newVolume)
+{
+    volume = qBound(0.0f, newVolume, 1.0f);
+    applyVolume();
+    emit volumeChanged(volume, muted);
+}
+
+float PlayerEngine::getVolume() const
+{
+    return volume;
+}
+
+void PlayerEngine::setMuted(bool newMuted)
+{
+    muted = newMuted;
+    applyVolume();
+    emit volumeChanged(volume, muted);
+}
+
+bool PlayerEngine::isMuted() const
+{
+    return muted;
+}
+
+void PlayerEngine::setAudioTap(AudioRingBuffer *tap)
+{
+    audio_tap = tap;
+    if (audio_player) audio_player->setAudioTap(tap);
+}
+
+// playback settings
+
+void PlayerEngine::setGapless(bool enabled)
+{
+    gapless_enabled = enabled;
+    if (!gapless_enabled) resetPreload();
+}
+
+bool PlayerEngine::getGapless() const
+{
+    return gapless_enabled;
+}
+
+void PlayerEngine::setCrossfade(int fade_ms, DK::FadeCurve curve)
+{
+    crossfade_ms = qBound(0, fade_ms, PIPELINE_MAX_CROSSFADE);
+    crossfade_curve = curve;
+    // only the audio pipeline can mix two tracks
+    if (crossfade_ms > 0) audio_engine = PB::Pipeline;
+    setupPlayer();
+}
+
+int PlayerEngine::getCrossfade_ms() const
+{
+    return crossfade_ms;
+}
+
+DK::FadeCurve PlayerEngine::getCrossfade_curve() const
+{
+    return crossfade_curve;
+}
+
+void PlayerEngine::setAudioEngine(PB::Engine engine, int buffer_ms, int period_ms)
+{
+    audio_engine = engine;
+    if (audio_engine == PB::Pipeline)
+    {
+        output_buffer_ms = buffer_ms;
+        output_period_ms = period_ms;
+    }
+    else // Qt Multimedia can't crossfade
+        crossfade_ms = 0;
+    setupPlayer();
+}
+
+PB::Engine PlayerEngine::getAudio_engine() const
+{
+    return audio_engine;
+}
+
+int PlayerEngine::getOutput_buffer_ms() const
+{
+    return output_buffer_ms;
+}
+
+int PlayerEngine::getOutput_period_ms() const
+{
+    return output_period_ms;
+}
+
+void PlayerEngine::setReplayGain(TR::GainMode mode)
+{
+    replay_gain_mode = mode;
+    setupPlayer();
+}
+
+TR::GainMode PlayerEngine::getReplay_gain() const
+{
+    return replay_gain_mode;
+}
+
+void PlayerEngine::setAnalyzeLoudness(bool enabled)
+{
+    analyze_loudness = enabled;
+    if (analyze_loudness)
+        music_list->analyzeLoudness();
+    else
+        music_list->cancelAnalysis();
+}
+
+bool PlayerEngine::getAnalyze_loudness() const
+{
+    return analyze_loudness;
+}
+
+void PlayerEngine::setWatchLibrary(bool enabled)
+{ // starts once the library has loaded if it has not yet
+    watch_library = enabled;
+    music_list->setWatching(watch_library);
+}
+
+bool PlayerEngine::getWatch_library() const
+{
+    return watch_library;
+}
+
+QStringList PlayerEngine::getImport_extensions() const
+{
+    return import_extensions;
+}
+
+// state
+
+PE::Status PlayerEngine::status() const
+{
+    PE::Status status;
+    status.state = audio_player->playbackState();
+    status.track = currentTrack();
+    status.file_path = cur_file_info.filePath().isEmpty() ? QString() : cur_file_info.absoluteFilePath();
+    status.position = audio_player->position();
+    status.duration = audio_player->duration();
+    status.volume = volume;
+    status.muted = muted;
+    status.play_mode = play_queue->getPlayMode();
+    status.tracks = music_list->getTrack_model()->count();
+    return status;
+}
+
+QMediaPlayer::PlaybackState PlayerEngine::playbackState() const
+{
+    return audio_player->playbackState();
+}
+
+qint64 PlayerEngine::position() const
+{
+    return audio_player->position();
+}
+
+qint64 PlayerEngine::duration() const
+{
+    return audio_player->duration();
+}
+
+QMediaMetaData PlayerEngine::metaData() const
+{
+    return audio_player->metaData();
+}
+
+QFileInfo PlayerEngine::getCur_file_info() const
+{
+    return cur_file_info;
+}
+
+TM::TrackId PlayerEngine::currentTrack() const
+{ // a file opened from outside the library is no track of it
+    if (cur_file_info.filePath().isEmpty()) return TM::InvalidId;
+    return music_list->getTrack_model()->idOfPath(cur_file_info.absoluteFilePath());
+}
+
+PlayerBackend *PlayerEngine::getAudio_player() const
+{
+    return audio_player.get();
+}
+
+PlayQueue *PlayerEngine::getPlay_queue() const
+{
+    return play_queue.get();
+}
+
+ManageList *PlayerEngine::getMusic_list() const
+{
+    return music_list.get();
+}
+
+// save/load settings
+
+void PlayerEngine::writeSettings()
+{
+    QSettings settings;
+    settings.setValue("file/fingerprint_imports", music_list->getUse_fingerprint());
+    settings.setValue("file/analyze_loudness", analyze_loudness);
+    settings.setValue("file/watch_library", watch_library);
+    settings.setValue("file/watch_roots", music_list->getWatch_roots());
+
+    settings.setValue("play/volume", volume);
+    settings.setValue("play/gapless", gapless_enabled);
+    settings.setValue("play/crossfade_ms", crossfade_ms);
+    settings.setValue("play/crossfade_curve", static_cast<int>(crossfade_curve));
+    settings.setValue("play/engine", static_cast<int>(audio_engine));
+    settings.setValue("play/output_buffer_ms", output_buffer_ms);
+    settings.setValue("play/output_period_ms", output_period_ms);
+    settings.setValue("play/replay_gain_mode", static_cast<int>(replay_gain_mode));
+    // the last track is part of the session now
+    settings.remove("play/last_track");
+    settings.remove("play/last_position");
+    // the library file is written in the background, nobody waits for it
+    music_list->flushList();
+}
+
+void PlayerEngine::readSettings()
+{
+    QSettings settings;
+    music_list->setUse_fingerprint(settings.value("file/fingerprint_imports", false).toBool());
+    analyze_loudness = settings.value("file/analyze_loudness", true).toBool();
+    watch_library = settings.value("file/watch_library", false).toBool();
+    music_list->setWatch_roots(settings.value("file/watch_roots").toStringList(), import_extensions);
+    volume = settings.value("play/volume", 1.0f).toFloat();
+    gapless_enabled = settings.value("play/gapless", true).toBool();
+    crossfade_ms = settings.value("play/crossfade_ms", 0).toInt();
+    crossfade_curve = static_cast<DK::FadeCurve>(settings.value("play/crossfade_curve", DK::EqualPower).toInt());
+    // crossfades written before the engine could be picked imply the pipeline
+    audio_engine = static_cast<PB::Engine>(settings.value("play/engine",
+                        crossfade_ms > 0 ? PB::Pipeline : PB::Multimedia).toInt());
+    output_buffer_ms = settings.value("play/output_buffer_ms", PIPELINE_DEFAULT_BUFFER).toInt();
+    output_period_ms = settings.value("play/output_period_ms", PIPELINE_DEFAULT_PERIOD).toInt();
+    replay_gain_mode = static_cast<TR::GainMode>(settings.value("play/replay_gain_mode", TR::Off).toInt());
+    // playback session, older versions only kept the last track in the settings
+    SS::Session session;
+    if (session_store->read(session))
+    {
+        restore_queue = session.queue;
+        restore_queue_pending = true;
+        restore_track_id = session.queue.current;
+        restore_position = session.position_ms;
+    }
+    else
+    {
+        restore_track_id = settings.value("play/last_track", TM::InvalidId).toUInt();
+        restore_position = settings.value("play/last_position", 0).toLongLong();
+    }
+}
+
+void PlayerEngine::saveSession()
+{ // until the library is in, the session read at startup is still the one to keep
+    session_flush.stop();
+    if (restore_queue_pending) return;
+    SS::Session session;
+    session.queue = play_queue->saveState();
+    // remember the track only if it was played from the list
+    auto* track_model = music_list->getTrack_model();
+    if (track_model->filePath(track_model->rowOf(session.queue.current)) != cur_file_info.absoluteFilePath())
+        session.queue.current = TM::InvalidId;
+    // a restored position not applied yet is still the one to keep
+    if (session.queue.current != TM::InvalidId)
+        session.position_ms = restore_position > 0 ? restore_position : audio_player->position();
+    session_store->save(session);
+}
+
+// private
+
+void PlayerEngine::sessionChanged()
+{
+    if (!session_flush.isActive()) session_flush.start();
+}
+
+void PlayerEngine::setupPlayer()
+{ // the audio pipeline does crossfades and gapless joins by itself, Qt Multimedia
+    // gets a second player preloading the next track instead
+    bool use_pipeline = audio_engine == PB::Pipeline;
+    QUrl source;
+    bool was_playing = false;
+    if (!audio_player || audio_player->handlesTransitions() != use_pipeline)
+    {
+        // carry the current track over to the new player
+        if (audio_player)
+        {
+            source = audio_player->source();
+            restore_position = audio_player->position();
+            was_playing = audio_player->playbackState() == QMediaPlayer::PlayingState;
+            audio_player->disconnect(this);
+            audio_player->setAudioTap(nullptr);
+            audio_player->stop();
+        }
+        preloaded_track = TM::InvalidId;
+
+        if (use_pipeline)
+        {
+            auto* pipeline = new AudioPipeline(this);
+            connect(pipeline, &AudioPipeline::underrunDetected, this, &PlayerEngine::underrunDetected);
+            audio_player = std::unique_ptr<PlayerBackend>(pipeline);
+            preload_player.reset();
+        }
+        else
+        {
+            audio_player = std::unique_ptr<PlayerBackend>(new MediaPlayerBackend(this));
+            preload_player = std::unique_ptr<PlayerBackend>(new MediaPlayerBackend(this));
+        }
+        applyVolume();
+        connectPlayer(audio_player.get());
+    }
+
+    if (use_pipeline)
+    {
+        auto* pipeline = static_cast<AudioPipeline*>(audio_player.get());
+        pipeline->setCrossfade(crossfade_ms, crossfade_curve);
+        pipeline->setOutputTiming(output_buffer_ms, output_period_ms);
+        pipeline->setGainMode(replay_gain_mode);
+    }
+
+    if (!source.isEmpty())
+    {
+        audio_player->setSource(source);
+        if (was_playing) audio_player->play();
+    }
+}
+
+void PlayerEngine::connectPlayer(PlayerBackend *player)
+{ // only the audible player is followed and feeds the tap, see playPreloaded()
+    player->setAudioTap(audio_tap);
+    connect(player, &PlayerBackend::playbackStateChanged, this, &PlayerEngine::playerStateChanged);
+    connect(player, &PlayerBackend::positionChanged, this, &PlayerEngine::playerPositionChanged);
+    connect(player, &PlayerBackend::mediaStatusChanged, this, &PlayerEngine::mediaStatusChanged);
+    // backends that move on by themselves ask for the next track and tell when they switched
+    connect(player, &PlayerBackend::nextSourceNeeded, this, &PlayerEngine::queueNextSource);
+    connect(player, &PlayerBackend::sourceAdvanced, this, &PlayerEngine::trackAdvanced);
+}
+
+void PlayerEngine::applyVolume()
+{
+    if (audio_player) audio_player->setVolume(muted ? 0.0f : volume);
+}
+
+void PlayerEngine::finishLoading(bool ok)
+{
+    if (!ok)
+    {
+        QSettings settings;
+        music_list->migrateList(settings, "musicList");
+    }
+    restoreLastTrack();
+    if (restore_queue_pending)
+    { // a track or mode picked while the library loaded wins over the saved one
+        restore_queue_pending = false;
+        TM::TrackId playing = currentTrack();
+        if (playing != TM::InvalidId) restore_queue.current = playing;
+        restore_queue.play_mode = play_queue->getPlayMode();
+        play_queue->restoreState(restore_queue);
+        restore_queue = PQ::State();
+    }
+    // the track is gone from the list, start fresh
+    if (restore_track_id != TM::InvalidId)
+    {
+        restore_track_id = TM::InvalidId;
+        restore_position = 0;
+    }
+    refreshLibrary();
+    emit libraryLoaded(ok);
+}
+
+void PlayerEngine::restoreLastTrack()
+{ // select the last played track and load it paused, nothing else
+    if (restore_track_id == TM::InvalidId) return;
+    // something is already playing, leave it alone
+    if (!audio_player->source().isEmpty())
+    {
+        restore_track_id = TM::InvalidId;
+        restore_position = 0;
+        return;
+    }
+    auto* track_model = music_list->getTrack_model();
+    int row = track_model->rowOf(restore_track_id);
+    if (row < 0) return;
+
+    play_queue->setCurrent_item_row(row);
+    music_list->updateUIonItemChange(TM::InvalidId, restore_track_id);
+    cur_file_info = QFileInfo(track_model->filePath(row));
+    audio_player->setSource(QUrl::fromLocalFile(cur_file_info.absoluteFilePath()));
+    restore_track_id = TM::InvalidId;
+}
+
+void PlayerEngine::refreshLibrary()
+{
+    music_list->readTags();
+    if (analyze_loudness) music_list->analyzeLoudness();
+}
+
+// play control
+
+void PlayerEngine::startPlayingNew(const QFileInfo &file_info)
+{ // stop, load, play
+    PERF_SCOPE("startPlayingNew");
+    cur_file_info = file_info;
+    stop();
+    audio_player->setSource(QUrl::fromLocalFile(file_info.absoluteFilePath()));
+    play();
+}
+
+void PlayerEngine::playListItem(TM::TrackId id)
+{
+    auto* track_model = music_list->getTrack_model();
+    resetPreload();
+    PERF_BEGIN("track_switch");
+    startPlayingNew(QFileInfo(track_model->filePath(track_model->rowOf(id))));
+    sessionChanged();
+}
+
+void PlayerEngine::playerStateChanged(QMediaPlayer::PlaybackState state)
+{
+    // loudness analysis backs off while something is playing
+    music_list->getAnalyzer()->setThrottled(state == QMediaPlayer::PlayingState);
+    emit stateChanged(state);
+    // a track that ended by itself goes on with the next one
+    if (state == QMediaPlayer::StoppedState && !music_manually_stopped && !playPreloaded())
+        next();
+}
+
+void PlayerEngine::playerPositionChanged(qint64 position)
+{
+    // a switch is over once the new track is heard
+    if (position > 0) PERF_END("track_switch");
+    emit positionChanged(position);
+
+    // open the upcoming track shortly before this one ends
+    if (gapless_enabled && preload_player && preloaded_track == TM::InvalidId && audio_player->duration() > 0
+        && audio_player->duration() - position < PRELOAD_AHEAD)
+        preloadNext();
+}
+
+void PlayerEngine::mediaStatusChanged(QMediaPlayer::MediaStatus status)
+{ // after media fully loaded its metadata can be read
+    if (status == QMediaPlayer::LoadedMedia) trackChanged();
+}
+
+void PlayerEngine::trackChanged()
+{
+    if (restore_position > 0)
+    {
+        audio_player->setPosition(restore_position);
+        restore_position = 0;
+    }
+    emit trackLoaded(cur_file_info);
+}
+
+void PlayerEngine::preloadNext()
+{
+    auto* track_model = music_list->getTrack_model();
+    TM::TrackId next_track = play_queue->peekNext();
+    int row = track_model->rowOf(next_track);
+    if (row < 0) return;
+    preloaded_track = next_track;
+    preload_player->setSource(QUrl::fromLocalFile(track_model->filePath(row)));
+}
+
+bool PlayerEngine::playPreloaded()
+{ // switch to the player that already holds the next track instead of
+    // tearing the current one down and opening the next file from scratch
+    if (!gapless_enabled || !preload_player || preloaded_track == TM::InvalidId) return false;
+    if (play_queue->peekNext() != preloaded_track
+        || preload_player->mediaStatus() == QMediaPlayer::InvalidMedia)
+    {
+        resetPreload();
+        return false;
+    }
+
+    PERF_BEGIN("track_switch");
+    PERF_SCOPE("playPreloaded");
+    auto current_item = play_queue->current();
+    auto next_item = play_queue->next();
+
+    audio_player->disconnect(this);
+    audio_player->setAudioTap(nullptr);
+    std::swap(audio_player, preload_player);
+    applyVolume();
+    connectPlayer(audio_player.get());
+    audio_player->play();
+
+    cur_file_info = QFileInfo(audio_player->source().toLocalFile());
+    music_list->updateUIonItemChange(current_item, next_item);
+    resetPreload();
+    // the new player loaded its media while nobody was listening
+    trackChanged();
+    return true;
+}
+
+void PlayerEngine::resetPreload()
+{
+    preloaded_track = TM::InvalidId;
+    if (preload_player) preload_player->setSource(QUrl());
+}
+
+void PlayerEngine::queueNextSource()
+{ // hand the upcoming track to a backend that mixes it in by itself
+    auto* track_model = music_list->getTrack_model();
+    TM::TrackId next_track = play_queue->peekNext();
+    int row = track_model->rowOf(next_track);
+    if (row < 0) return;
+    preloaded_track = next_track;
+    audio_player->setNextSource(QUrl::fromLocalFile(track_model->filePath(row)));
+}
+
+void PlayerEngine::trackAdvanced(const QUrl &source)
+{ // the backend already plays the queued track, only the queue follows
+    auto current_item = play_queue->current();
+    auto next_item = play_queue->next();
+    // the queue changed after the track was handed over, follow what is audible
+    if (next_item != preloaded_track && preloaded_track != TM::InvalidId)
+    {
+        next_item = preloaded_track;
+        play_queue->setCurrent_item_row(music_list->getTrack_model()->rowOf(next_item));
+    }
+    preloaded_track = TM::InvalidId;
+
+    cur_file_info = QFileInfo(source.toLocalFile());
+    music_list->updateUIonItemChange(current_item, next_item);
+    trackChanged();
+    saveSession();
+}
@@ -0,0 +1,188 @@
+#ifndef PLAYERENGINE_H
+#define PLAYERENGINE_H
+
+#include <QObject>
+#include <QListView>
+#include <QFileInfo>
+#include <QTimer>
+#include <QUrl>
+#include <QMediaPlayer>
+#include <QMediaMetaData>
+#include <memory>
+#include "playqueue.h"
+#include "managelist.h"
+#include "playerbackend.h"
+#include "audiopipeline.h"
+#include "sessionstore.h"
+#include "audioringbuffer.h"
+
+QT_BEGIN_NAMESPACE
+namespace PE { class PlayerEngine;}
+QT_END_NAMESPACE
+
+namespace PE
+{
+    // what the player is doing, for the control socket and anything else that asks
+    struct Status
+    {
+        QMediaPlayer::PlaybackState state = QMediaPlayer::StoppedState;
+        TM::TrackId track = TM::InvalidId;
+        QString file_path;
+        qint64 position = 0;
+        qint64 duration = 0;
+        float volume = 0.0f;
+        bool muted = false;
+        PQ::PlayMode play_mode = PQ::Order;
+        int tracks = 0;
+    };
+}
+
+// playback core: the players, the play queue and the library, with their settings and session
+// it needs no window, the gui drives it like the control socket does and follows its signals;
+// the library view is optional, without one ManageList keeps the library alone
+class PlayerEngine : public QObject
+{
+    Q_OBJECT
+    #define PRELOAD_AHEAD 10000
+    #define SESSION_SAVE_INTERVAL 5000
+    #define SESSION_FLUSH_DELAY 500
+
+public:
+    explicit PlayerEngine(QListView* list_view = nullptr, QObject *parent = nullptr);
+    ~PlayerEngine();
+
+    // loads the library in the background, the session is picked up once it is in
+    void start();
+
+    // transport
+    void play();
+    void pause();
+    void togglePlay();
+    void stop();
+    void next();
+    void previous();
+    // the queue starts over from row, in list order for this one step
+    void playRow(int row);
+    // a file from outside the library
+    void playFile(const QString& file_path);
+    void seek(qint64 position);
+    void enqueue(const QList<TM::TrackId>& ids);
+    void setPlayMode(PQ::PlayMode mode);
+    PQ::PlayMode getPlay_mode() const;
+
+    // output, volume is linear 0..1
+    void setVolume(float newVolume);
+    float getVolume() const;
+    void setMuted(bool newMuted);
+    bool isMuted() const;
+    // the audible player copies its output here, see PlayerBackend::setAudioTap
+    void setAudioTap(AudioRingBuffer* tap);
+
+    // playback settings, a change rebuilds the player when it has to
+    void setGapless(bool enabled);
+    bool getGapless() const;
+    void setCrossfade(int fade_ms, DK::FadeCurve curve);
+    int getCrossfade_ms() const;
+    DK::FadeCurve getCrossfade_curve() const;
+    void setAudioEngine(PB::Engine engine, int buffer_ms, int period_ms);
+    PB::Engine getAudio_engine() const;
+    int getOutput_buffer_ms() const;
+    int getOutput_period_ms() const;
+    void setReplayGain(TR::GainMode mode);
+    TR::GainMode getReplay_gain() const;
+    // library upkeep
+    void setAnalyzeLoudness(bool enabled);
+    bool getAnalyze_loudness() const;
+    void setWatchLibrary(bool enabled);
+    bool getWatch_library() const;
+    QStringList getImport_extensions() const;
+
+    // state
+    PE::Status status() const;
+    QMediaPlayer::PlaybackState playbackState() const;
+    qint64 position() const;
+    qint64 duration() const;
+    QMediaMetaData metaData() const;
+    QFileInfo getCur_file_info() const;
+    TM::TrackId currentTrack() const;
+    PlayerBackend* getAudio_player() const;
+    PlayQueue* getPlay_queue() const;
+    ManageList* getMusic_list() const;
+
+    // save/load settings
+    void writeSettings();
+    void readSettings();
+    void saveSession();
+
+signals:
+    void stateChanged(QMediaPlayer::PlaybackState state);
+    void positionChanged(qint64 position);
+    // a new track is loaded and its metadata can be read
+    void trackLoaded(const QFileInfo& file_info);
+    void playModeChanged(PQ::PlayMode mode);
+    void volumeChanged(float volume, bool muted);
+    void underrunDetected(int underruns, qint64 latency_ms);
+    // the library has been read (or not) and the session restored
+    void libraryLoaded(bool ok);
+
+private:
+    std::unique_ptr<ManageList> music_list;
+    std::unique_ptr<PlayQueue> play_queue;
+    std::unique_ptr<PlayerBackend> audio_player;
+    // second player, opens the upcoming track ahead of time for gapless playback
+    // not needed when the backend handles transitions itself
+    std::unique_ptr<PlayerBackend> preload_player;
+    AudioRingBuffer* audio_tap;
+    QStringList import_extensions;
+    QFileInfo cur_file_info;
+
+    // track & position to bring back once the library has loaded it
+    TM::TrackId restore_track_id;
+    qint64 restore_position;
+    // queue & history from the last session, waiting for the library as well
+    std::unique_ptr<SessionStore> session_store;
+    QTimer session_timer;
+    // commands only mark the session changed, a burst of them is written once
+    QTimer session_flush;
+    PQ::State restore_queue;
+    bool restore_queue_pending;
+
+    // state
+    bool music_manually_stopped;
+    float volume;
+    bool muted;
+    bool gapless_enabled;
+    TM::TrackId preloaded_track;
+    int crossfade_ms;
+    DK::FadeCurve crossfade_curve;
+    PB::Engine audio_engine;
+    int output_buffer_ms;
+    int output_period_ms;
+    TR::GainMode replay_gain_mode;
+    bool analyze_loudness;
+    // imported folders are followed on disk
+    bool watch_library;
+
+    void setupPlayer();
+    void connectPlayer(PlayerBackend* player);
+    void applyVolume();
+    void finishLoading(bool ok);
+    void restoreLastTrack();
+    void refreshLibrary();
+    void sessionChanged();
+
+    // play control
+    void startPlayingNew(const QFileInfo& file_info);
+    void playListItem(TM::TrackId id);
+    void playerStateChanged(QMediaPlayer::PlaybackState state);
+    void playerPositionChanged(qint64 position);
+    void mediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void trackChanged();
+    void preloadNext();
+    bool playPreloaded();
+    void resetPreload();
+    void queueNextSource();
+    void trackAdvanced(const QUrl& source);
+};
+
+#endif // PLAYERENGINE_H
@@ -1,12 +1,23 @@
 #include "playqueue.h"
+#include "perfprobe.h"
+#include <algorithm>
+#include <limits>
 
-PlayQueue::PlayQueue(QListWidget* init_play_list, QObject *parent)
+PlayQueue::PlayQueue(TrackModel* init_play_list, QObject *parent)
     :
       QObject{parent}
+    ,shuffle_round(0)
+    ,shuffle_pos(0)
     ,current_item_row(0)
+    ,play_mode(PQ::PlayMode::Order)
     ,play_list(init_play_list)
+    ,layout_current(TM::InvalidId)
+    ,default_queue(PQ::QueueSize)
+    ,user_added_queue(PQ::QueueSize)
+    ,history_stack(PQ::HistorySize)
 {
-    generator = std::mt19937(rand_dev());
+    shuffle_order = ShuffleOrder(quint64(rand_dev()) << 32 | rand_dev());
+    connectPlayList();
 }
 
 PlayQueue::~PlayQueue()
@@ -16,23 +27,25 @@ PlayQueue::~PlayQueue()
 
 // public
 
-void PlayQueue::setPlayList(QListWidget* new_play_list)
+void PlayQueue::setPlayList(TrackModel* new_play_list)
 {
+    if (play_list) disconnect(play_list, nullptr, this, nullptr);
     play_list = new_play_list;
-    // other operations
+    clear();
+    connectPlayList();
 }
 
 
 void PlayQueue::updatePlayingQueue(int row)
 {
+    PERF_SCOPE("queue_update");
     if (play_list->count() == 0) return;
     default_queue.clear();
     user_added_queue.clear();
     for (int cnt = 0; cnt < AUTO_QUEUE_BATCH; cnt++)
     {
         if (row >= play_list->count()) row = 0;
-        if (default_queue.size() >= QUEUESIZE) default_queue.dequeue();
-        default_queue.enqueue(play_list->item(row++));
+        default_queue.push(play_list->idAt(row++));
     }
 }
 
@@ -45,21 +58,25 @@ void PlayQueue::setHistoryStack(int row)
     for (int cnt = 0; cnt < AUTO_STACK_BATCH; cnt++)
     {
         if (row >= play_list->count()) row = 0;
-        if (history_stack.size() >= HISTORYSIZE) history_stack.pop_front();
-        history_stack.push(play_list->item(row++));
+        history_stack.push(play_list->idAt(row++));
     }
 }
 
 void PlayQueue::clear()
 {
     current_item_row = 0;
+    shuffle_slots = PQ::ShuffleSlots();
+    shuffle_round = 0;
+    shuffle_pos = 0;
     default_queue.clear();
     user_added_queue.clear();
     history_stack.clear();
 }
 
 void PlayQueue::setPlayMode(PQ::PlayMode new_mode)
-{
+{ // going back to list order later continues after the track shuffle got to
+    if (new_mode == PQ::PlayMode::Shuffle && play_mode != PQ::PlayMode::Shuffle)
+        default_queue.clear();
     play_mode = new_mode;
 }
 
@@ -68,26 +85,27 @@ PQ::PlayMode PlayQueue::getPlayMode() const
     return play_mode;
 }
 
-void PlayQueue::addToUserQueue()
+void PlayQueue::addToUserQueue(const QList<TM::TrackId>& tracks)
 {
-    QList<QListWidgetItem*> selected_items = play_list->selectedItems();
-    for (auto item: selected_items)
+    PERF_SCOPE("queue_add");
+    for (auto id: tracks)
     {
-        if (user_added_queue.size() >= QUEUESIZE) break;
-        user_added_queue.enqueue(item);
+        if (user_added_queue.isFull()) break;
+        user_added_queue.push(id);
     }
 }
 
-QListWidgetItem *PlayQueue::current()
+TM::TrackId PlayQueue::current()
 { // return current item being selected
-    if (play_list->count() <= 0) return nullptr;
-    return play_list->item(current_item_row);
+    if (play_list->count() <= 0) return TM::InvalidId;
+    return play_list->idAt(current_item_row);
 }
 
-QListWidgetItem *PlayQueue::next()
+TM::TrackId PlayQueue::next()
 { // return next item in play queue and update current item to next item
     // and put current item into history stack
-    QListWidgetItem* next_item {nullptr};
+    PERF_SCOPE("queue_next");
+    TM::TrackId next_item {TM::InvalidId};
 
     if (play_list->count() <= 0) return next_item;
 
@@ -103,69 +121,269 @@ QListWidgetItem *PlayQueue::next()
         break;
     }
 
-    history_stack.push(play_list->item(current_item_row));
-    current_item_row = play_list->row(next_item);
+    history_stack.push(play_list->idAt(current_item_row));
+    current_item_row = play_list->rowOf(next_item);
 
     return next_item;
 }
 
-QListWidgetItem *PlayQueue::previous()
+TM::TrackId PlayQueue::previous()
 {
-    QListWidgetItem* pre_item {nullptr};
+    PERF_SCOPE("queue_previous");
+    TM::TrackId pre_item {TM::InvalidId};
 
     if (play_list->count() <= 0) return pre_item;
 
-    if (!history_stack.empty() && play_list->row(history_stack.top()) == current_item_row)
-        history_stack.pop();
+    if (!history_stack.isEmpty() && play_list->rowOf(history_stack.last()) == current_item_row)
+        history_stack.takeLast();
 
-    if (history_stack.empty())
-        setHistoryStack(current_item_row);
+    if (history_stack.isEmpty() && play_mode == PQ::PlayMode::Shuffle)
+        pre_item = previousRandom(); // back through the shuffle order, not the list
+    else
+    {
+        if (history_stack.isEmpty())
+            setHistoryStack(current_item_row);
 
-    if (!history_stack.empty())
-        pre_item = history_stack.pop();
+        pre_item = history_stack.takeLast();
+    }
 
     // maybe some other operations
-    if (pre_item)
-        current_item_row = play_list->row(pre_item);
+    if (pre_item != TM::InvalidId)
+        current_item_row = play_list->rowOf(pre_item);
 
     return pre_item;
 }
 
 
+TM::TrackId PlayQueue::peekNext() const
+{
+    PERF_SCOPE("queue_peek_next");
+    if (play_list->count() <= 0) return TM::InvalidId;
+
+    switch (play_mode) {
+    case PQ::PlayMode::Shuffle:
+    { // the same walk next() makes, on copies
+        ShuffleOrder order = shuffle_order;
+        PQ::ShuffleSlots slots = shuffle_slots;
+        quint32 round = shuffle_round;
+        quint64 pos = shuffle_pos;
+        alignShuffle(order, slots, round, pos);
+        return stepShuffle(order, slots, round, pos, 1);
+    }
+    case PQ::PlayMode::Single:
+        return play_list->idAt(current_item_row);
+    default:
+        if (!user_added_queue.isEmpty()) return user_added_queue.first();
+        if (!default_queue.isEmpty()) return default_queue.first();
+        return play_list->idAt((current_item_row + 1) % play_list->count());
+    }
+}
+
 void PlayQueue::setCurrent_item_row(int newCurrent_item_row)
 {
     current_item_row = newCurrent_item_row;
 }
 
-QListWidgetItem *PlayQueue::nextOrder()
+PQ::State PlayQueue::saveState() const
+{
+    PQ::State state;
+    state.play_mode = play_mode;
+    state.current = play_list->idAt(current_item_row);
+    state.shuffle_seed = shuffle_order.getSeed();
+    state.shuffle_round = shuffle_round;
+    state.shuffle_pos = shuffle_pos;
+    state.default_queue = default_queue.toVector();
+    state.user_added_queue = user_added_queue.toVector();
+    state.history = history_stack.toVector();
+    return state;
+}
+
+void PlayQueue::restoreState(const PQ::State &state)
+{
+    PERF_SCOPE("queue_restore");
+    clear();
+    play_mode = state.play_mode;
+    setShuffle_seed(state.shuffle_seed);
+    // a position from a differently sized order is realigned to the current track on use
+    shuffle_round = state.shuffle_round;
+    shuffle_pos = state.shuffle_pos < shuffle_order.domain() ? state.shuffle_pos : 0;
+    int row = play_list->rowOf(state.current);
+    if (row >= 0) current_item_row = row;
+
+    auto refill = [this](TrackRing& ring, const QVector<TM::TrackId>& ids) {
+        for (TM::TrackId id : ids)
+            if (play_list->rowOf(id) >= 0) ring.push(id);
+    };
+    refill(default_queue, state.default_queue);
+    refill(user_added_queue, state.user_added_queue);
+    refill(history_stack, state.history);
+}
+
+quint64 PlayQueue::getShuffle_seed() const
+{
+    return shuffle_order.getSeed();
+}
+
+void PlayQueue::setShuffle_seed(quint64 newShuffle_seed)
+{
+    shuffle_order = ShuffleOrder(newShuffle_seed, play_list->idLimit());
+    shuffle_slots = PQ::ShuffleSlots();
+    shuffle_round = 0;
+    shuffle_pos = 0;
+}
+
+void PlayQueue::connectPlayList()
+{
+    if (!play_list) return;
+    connect(play_list, &QAbstractItemModel::rowsRemoved, this,
+            [this](const QModelIndex&, int first, int last) { patchRemoved(first, last); });
+    connect(play_list, &QAbstractItemModel::layoutAboutToBeChanged, this, [this]() { followLayout(true); });
+    connect(play_list, &QAbstractItemModel::layoutChanged, this, [this]() { followLayout(false); });
+}
+
+void PlayQueue::followLayout(bool about_to_change)
+{ // the current row follows its track, the order queue was made for the old order
+    if (about_to_change)
+    {
+        layout_current = play_list->idAt(current_item_row);
+        return;
+    }
+    int row = play_list->rowOf(layout_current);
+    if (row >= 0) current_item_row = row;
+    layout_current = TM::InvalidId;
+    default_queue.clear();
+}
+
+void PlayQueue::patchRemoved(int first, int last)
+{ // the model has already forgotten the removed ids, the rest are found by id
+    auto removed = [this](TM::TrackId id) { return play_list->rowOf(id) < 0; };
+    default_queue.removeIf(removed);
+    user_added_queue.removeIf(removed);
+    history_stack.removeIf(removed);
+
+    // the current row moves up with the rows before it, a removed current track
+    // leaves its place to the track before it so order playback carries on after the gap
+    if (current_item_row > last)
+        current_item_row -= last - first + 1;
+    else if (current_item_row >= first)
+        current_item_row = qMax(first - 1, 0);
+}
+
+TM::TrackId PlayQueue::nextOrder()
 {
-    QListWidgetItem* next_item {nullptr};
+    TM::TrackId next_item {TM::InvalidId};
 
     // if (play_list->count() <= 0) return next_item;
-    if (!user_added_queue.empty())
+    if (!user_added_queue.isEmpty())
     {
-        next_item = user_added_queue.dequeue();
+        next_item = user_added_queue.takeFirst();
     }
     else
     {
-        if (default_queue.empty()) updatePlayingQueue(current_item_row+1);
-        next_item = default_queue.dequeue();
+        if (default_queue.isEmpty()) updatePlayingQueue(current_item_row+1);
+        next_item = default_queue.takeFirst();
     }
     return next_item;
 }
 
-QListWidgetItem *PlayQueue::nextRandom()
+TM::TrackId PlayQueue::nextRandom()
 {
-    default_queue.clear();
-    std::uniform_int_distribution<int> distr(0, play_list->count()-1);
-    int next_row = distr(generator);
-    return play_list->item(next_row);
+    alignShuffle(shuffle_order, shuffle_slots, shuffle_round, shuffle_pos);
+    return stepShuffle(shuffle_order, shuffle_slots, shuffle_round, shuffle_pos, 1);
 }
 
-QListWidgetItem *PlayQueue::nextSame()
+TM::TrackId PlayQueue::previousRandom()
 {
-    return play_list->item(current_item_row);
+    alignShuffle(shuffle_order, shuffle_slots, shuffle_round, shuffle_pos);
+    return stepShuffle(shuffle_order, shuffle_slots, shuffle_round, shuffle_pos, -1);
+}
+
+TM::TrackId PlayQueue::nextSame()
+{
+    return play_list->idAt(current_item_row);
+}
+
+void PlayQueue::alignShuffle(ShuffleOrder &order, PQ::ShuffleSlots &slots, quint32 &round, quint64 &pos) const
+{ // ids handed out since the order was made stay inside it until the domain is outgrown,
+    // then the order is made again for the larger list; once the tracks left fill less than
+    // a quarter of the slots, or the list was swapped under it, the slots are packed again
+    // so a step never has to skip more than a few dead values
+    TM::TrackId cur_id = play_list->idAt(current_item_row);
+    quint64 used = slotCount(slots);
+    if (used == 0 || quint64(play_list->count()) * 4 < used
+            || (cur_id != TM::InvalidId && slotOf(slots, cur_id) >= used))
+    {
+        packShuffle(slots);
+        order = ShuffleOrder(order.getSeed(), slots.ids.size());
+        pos = 0;
+    }
+    else if (!order.covers(used))
+    {
+        order = ShuffleOrder(order.getSeed(), used);
+        pos = 0;
+    }
+    // the current track may have been picked by hand, carry on from wherever it is
+    if (cur_id == TM::InvalidId) return;
+    quint64 cur_slot = slotOf(slots, cur_id);
+    if (order.at(round, pos) != cur_slot)
+        pos = order.positionOf(round, quint32(cur_slot));
+}
+
+TM::TrackId PlayQueue::stepShuffle(const ShuffleOrder &order, const PQ::ShuffleSlots &slots,
+                                   quint32 &round, quint64 &pos, int direction) const
+{ // values that are no track, removed or not handed out yet, are stepped over
+    for (quint64 steps = 0; steps < order.domain(); steps++)
+    {
+        if (direction > 0)
+        {
+            if (++pos == order.domain())
+            { // a new round, in a new order
+                pos = 0;
+                round++;
+            }
+        }
+        else
+        {
+            if (pos == 0)
+            {
+                pos = order.domain();
+                round--;
+            }
+            pos--;
+        }
+        TM::TrackId id = slotTrack(slots, order.at(round, pos));
+        if (play_list->rowOf(id) >= 0) return id;
+    }
+    return TM::InvalidId;
 }
 
+void PlayQueue::packShuffle(PQ::ShuffleSlots &slots) const
+{ // sorted, so the same tracks always give the same slots
+    slots.ids.resize(play_list->count());
+    for (int row = 0; row < play_list->count(); row++)
+        slots.ids[row] = play_list->idAt(row);
+    std::sort(slots.ids.begin(), slots.ids.end());
+    slots.base = play_list->idLimit();
+}
 
+quint64 PlayQueue::slotCount(const PQ::ShuffleSlots &slots) const
+{ // the list was reset to fewer ids than it had, nothing is valid
+    if (play_list->idLimit() < slots.base) return 0;
+    return quint64(slots.ids.size()) + (play_list->idLimit() - slots.base);
+}
 
+quint64 PlayQueue::slotOf(const PQ::ShuffleSlots &slots, TM::TrackId id) const
+{ // past slotCount() for an id the slots don't know
+    if (id >= slots.base) return quint64(slots.ids.size()) + (id - slots.base);
+    auto found = std::lower_bound(slots.ids.cbegin(), slots.ids.cend(), id);
+    if (found == slots.ids.cend() || *found != id) return std::numeric_limits<quint64>::max();
+    return quint64(found - slots.ids.cbegin());
+}
+
+TM::TrackId PlayQueue::slotTrack(const PQ::ShuffleSlots &slots, quint64 slot) const
+{
+    if (slot < quint64(slots.ids.size())) return slots.ids[slot];
+    quint64 handed_out = slot - slots.ids.size();
+    if (handed_out >= quint64(play_list->idLimit()) - slots.base) return TM::InvalidId;
+    return TM::TrackId(slots.base + handed_out);
+}
@@ -2,11 +2,10 @@
 #define PLAYQUEUE_H
 
 #include <QObject>
-#include <QQueue>
-#include <QStack>
-#include <QListWidget>
-#include <QListWidgetItem>
 #include <random>
+#include "trackmodel.h"
+#include "shuffleorder.h"
+#include "trackring.h"
 
 QT_BEGIN_NAMESPACE
 namespace PQ { class PlayQueue;}
@@ -15,54 +14,105 @@ QT_END_NAMESPACE
 namespace PQ
 {
     enum PlayMode {Order, Single, Shuffle};
+
+    // capacities of the rings, rounded up to a power of two
+    const int HistorySize = 256;
+    const int QueueSize = 256;
+
+    // everything needed to pick playback up where it was, ids oldest first
+    struct State
+    {
+        PlayMode play_mode = Order;
+        TM::TrackId current = TM::InvalidId;
+        quint64 shuffle_seed = 0;
+        quint32 shuffle_round = 0;
+        quint64 shuffle_pos = 0;
+        QVector<TM::TrackId> default_queue;
+        QVector<TM::TrackId> user_added_queue;
+        QVector<TM::TrackId> history;
+    };
+
+    // the values a ShuffleOrder permutes: below ids.size() a value stands for ids[value],
+    // sorted, above it for the ids handed out since, from base on; with no ids a value is the id
+    struct ShuffleSlots
+    {
+        QVector<TM::TrackId> ids;
+        TM::TrackId base = 0;
+    };
 }
 
 class PlayQueue : public QObject
 {
     Q_OBJECT
-    #define HISTORYSIZE 200
-    #define QUEUESIZE 200
     #define AUTO_QUEUE_BATCH 10
     #define AUTO_STACK_BATCH 10
 
 public:
-    explicit PlayQueue(QListWidget* init_play_list, QObject *parent = nullptr);
+    explicit PlayQueue(TrackModel* init_play_list, QObject *parent = nullptr);
     ~PlayQueue();
 
     // queue setttings
-    void setPlayList(QListWidget*);
+    void setPlayList(TrackModel*);
     void updatePlayingQueue(int row = 0);
     void setHistoryStack(int row = 0);
     void clear();
     void setPlayMode(PQ::PlayMode);
     PQ::PlayMode getPlayMode() const;
 
-    void addToUserQueue();
+    void addToUserQueue(const QList<TM::TrackId>& tracks);
 
-    QListWidgetItem* current();
-    QListWidgetItem* next();
-    QListWidgetItem* previous();
+    TM::TrackId current();
+    TM::TrackId next();
+    TM::TrackId previous();
+    // what next() is going to return, the queue itself is left as it is
+    TM::TrackId peekNext() const;
 
     void setCurrent_item_row(int newCurrent_item_row);
+    // ids missing from the list are left out on restore
+    PQ::State saveState() const;
+    void restoreState(const PQ::State& state);
+
+    // the same seed gives the same shuffle order
+    quint64 getShuffle_seed() const;
+    void setShuffle_seed(quint64 newShuffle_seed);
 
 private slots:
 
 private:
 
     std::random_device rand_dev;
-    std::mt19937 generator;
+    // shuffle walks the order one position at a time, a round covers every track once
+    ShuffleOrder shuffle_order;
+    PQ::ShuffleSlots shuffle_slots;
+    quint32 shuffle_round;
+    quint64 shuffle_pos;
 
     int current_item_row;
     PQ::PlayMode play_mode;
 
-    QListWidget* play_list;
-    QQueue<QListWidgetItem*> default_queue;
-    QQueue<QListWidgetItem*> user_added_queue;
-    QStack<QListWidgetItem*> history_stack;
-
-    QListWidgetItem* nextOrder();
-    QListWidgetItem* nextRandom();
-    QListWidgetItem* nextSame();
+    TrackModel* play_list;
+    // the current track while the list is being reordered
+    TM::TrackId layout_current;
+    // ids, not rows, so edits to the list only drop what was removed
+    TrackRing default_queue;
+    TrackRing user_added_queue;
+    TrackRing history_stack;
+
+    void connectPlayList();
+    void patchRemoved(int first, int last);
+    void followLayout(bool about_to_change);
+
+    TM::TrackId nextOrder();
+    TM::TrackId nextRandom();
+    TM::TrackId previousRandom();
+    TM::TrackId nextSame();
+    void alignShuffle(ShuffleOrder& order, PQ::ShuffleSlots& slots, quint32& round, quint64& pos) const;
+    TM::TrackId stepShuffle(const ShuffleOrder& order, const PQ::ShuffleSlots& slots,
+                            quint32& round, quint64& pos, int direction) const;
+    void packShuffle(PQ::ShuffleSlots& slots) const;
+    quint64 slotCount(const PQ::ShuffleSlots& slots) const;
+    quint64 slotOf(const PQ::ShuffleSlots& slots, TM::TrackId id) const;
+    TM::TrackId slotTrack(const PQ::ShuffleSlots& slots, quint64 slot) const;
 };
 
 #endif // PLAYQUEUE_H
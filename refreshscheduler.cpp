@@ -0,0 +1,93 @@
+#include "refreshscheduler.h"
+#include <QDebug>
+#include <QtMath>
+
+bool RefreshScheduler::tracing = false;
+
+RefreshScheduler::RefreshScheduler(QObject *parent)
+    : QObject{parent}
+    , pending(false)
+    , paused(false)
+    , requests(0)
+    , wakeups(0)
+{
+    setRefresh_rate(REFRESH_DEFAULT_HZ);
+    frame_timer.setSingleShot(true);
+    connect(&frame_timer, &QTimer::timeout, this, &RefreshScheduler::onFrame);
+    last_frame.start();
+
+    // the stats timer would be a wakeup of its own, only run it when asked
+    if (tracing)
+    {
+        stats_timer.setInterval(REFRESH_STATS_INTERVAL);
+        connect(&stats_timer, &QTimer::timeout, this, &RefreshScheduler::reportStats);
+        stats_timer.start();
+    }
+}
+
+RefreshScheduler::~RefreshScheduler()
+{
+
+}
+
+void RefreshScheduler::request()
+{
+    requests++;
+    pending = true;
+    if (!paused && !frame_timer.isActive()) startFrame();
+}
+
+void RefreshScheduler::setPaused(bool pause)
+{
+    if (paused == pause) return;
+    paused = pause;
+    if (paused)
+        frame_timer.stop();
+    else if (pending)
+        startFrame();
+}
+
+bool RefreshScheduler::isPaused() const
+{
+    return paused;
+}
+
+void RefreshScheduler::setRefresh_rate(qreal hz)
+{
+    if (hz <= 0) hz = REFRESH_DEFAULT_HZ;
+    frame_interval_ms = qMax(1, qRound(1000.0 / hz));
+}
+
+void RefreshScheduler::setTracing(bool enable)
+{
+    tracing = enable;
+}
+
+bool RefreshScheduler::isTracing()
+{
+    return tracing;
+}
+
+// private
+
+void RefreshScheduler::startFrame()
+{ // a request right after a frame waits for the next one, others go out at once
+    qint64 wait = frame_interval_ms - last_frame.elapsed();
+    frame_timer.start(int(qMax<qint64>(0, wait)));
+}
+
+void RefreshScheduler::onFrame()
+{
+    wakeups++;
+    pending = false;
+    last_frame.restart();
+    emit refresh();
+}
+
+void RefreshScheduler::reportStats()
+{
+    qInfo().noquote() << QString("ui: %1 refreshes/s from %2 requests/s%3")
+                         .arg(wakeups).arg(requests).arg(paused ? " (paused)" : "");
+    requests = 0;
+    wakeups = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE
+namespace RS { class RefreshScheduler;}
+QT_END_NAMESPACE
+
+// coalesces ui updates to at most one per display frame
+// while paused (window hidden or minimized) nothing runs at all, a pending
+// update goes out as soon as it is resumed
+class RefreshScheduler : public QObject
+{
+    Q_OBJECT
+    #define REFRESH_DEFAULT_HZ 60.0
+    #define REFRESH_STATS_INTERVAL 1000
+
+public:
+    explicit RefreshScheduler(QObject *parent = nullptr);
+    ~RefreshScheduler();
+
+    // something changed, refresh() follows within a frame
+    void request();
+    void setPaused(bool pause);
+    bool isPaused() const;
+    // the screen's refresh rate, the default is used when unknown
+    void setRefresh_rate(qreal hz);
+
+    // wakeups per second printed once a second, to check idle cost
+    static void setTracing(bool enable);
+    static bool isTracing();
+
+signals:
+    void refresh();
+
+private:
+    QTimer frame_timer;
+    QElapsedTimer last_frame;
+    int frame_interval_ms;
+    bool pending;
+    bool paused;
+
+    // instrumentation
+    static bool tracing;
+    QTimer stats_timer;
+    int requests;
+    int wakeups;
+
+    void startFrame();
+    void onFrame();
+    void reportStats();
+};
+
+#endif // REFRESHSCHEDULER_H
@@ -0,0 +1,204 @@
+#include "searchindex.h"
+#include <QSet>
+#include <QElapsedTimer>
+#include <algorithm>
+
+SearchIndex::SearchIndex(QObject *parent)
+    : QObject{parent}
+    , latest_serial(0)
+{
+
+}
+
+SearchIndex::~SearchIndex()
+{
+
+}
+
+void SearchIndex::reset(const QVector<TM::TrackId> &ids, const QStringList &texts)
+{
+    text_of_id.clear();
+    postings.clear();
+    insertTracks(ids, texts);
+}
+
+void SearchIndex::update(const QVector<TM::TrackId> &ids, const QStringList &texts)
+{
+    removeTracks(ids);
+    insertTracks(ids, texts);
+}
+
+void SearchIndex::remove(const QVector<TM::TrackId> &ids)
+{
+    removeTracks(ids);
+}
+
+void SearchIndex::search(int serial, const QString &query)
+{ // a newer query is already queued behind this one, don't bother
+    if (isStale(serial)) return;
+    QElapsedTimer clock;
+    clock.start();
+
+    QStringList words = normalize(query).split(' ', Qt::SkipEmptyParts);
+    QVector<TM::TrackId> matches;
+    auto containsAll = [&](TM::TrackId id) {
+        const QString& text = text_of_id[id];
+        if (text.isEmpty()) return false;
+        for (const QString& word : words)
+            if (!text.contains(word)) return false;
+        return true;
+    };
+
+    // posting lists of every trigram in the query, a trigram nobody has means no match
+    QVector<const QVector<TM::TrackId>*> lists;
+    bool exact = true; // a three letter word is matched by its trigram alone
+    bool missing = false;
+    for (const QString& word : words)
+    {
+        exact = exact && word.size() == 3;
+        for (quint64 gram : trigramsOf(word))
+        {
+            auto iter = postings.constFind(gram);
+            if (iter == postings.constEnd())
+            {
+                missing = true;
+                break;
+            }
+            lists.append(&iter.value());
+        }
+        if (missing) break;
+    }
+
+    if (words.isEmpty() || missing)
+    {
+        // nothing matches
+    }
+    else if (lists.isEmpty())
+    { // only one and two letter words, check every track
+        for (TM::TrackId id = TM::InvalidId + 1; id < TM::TrackId(text_of_id.size()); id++)
+        {
+            if (id % SEARCH_CANCEL_CHECK == 0 && isStale(serial)) return;
+            if (containsAll(id)) matches.append(id);
+        }
+    }
+    else
+    { // intersect starting from the shortest list, so the candidates only shrink
+        std::sort(lists.begin(), lists.end(), [](const QVector<TM::TrackId>* a, const QVector<TM::TrackId>* b) {
+            return a->size() < b->size();
+        });
+        QVector<TM::TrackId> candidates = *lists.first();
+        QVector<TM::TrackId> narrowed;
+        for (int idx = 1; idx < lists.size() && !candidates.isEmpty(); idx++)
+        {
+            if (isStale(serial)) return;
+            const QVector<TM::TrackId>& list = *lists[idx];
+            narrowed.clear();
+            if (candidates.size() * 16 < list.size())
+            { // far fewer candidates than entries, look each one up
+                for (TM::TrackId id : candidates)
+                    if (std::binary_search(list.cbegin(), list.cend(), id)) narrowed.append(id);
+            }
+            else
+            {
+                narrowed.resize(candidates.size());
+                auto end = std::set_intersection(candidates.cbegin(), candidates.cend(),
+                                                 list.cbegin(), list.cend(), narrowed.begin());
+                narrowed.resize(end - narrowed.begin());
+            }
+            candidates.swap(narrowed);
+        }
+
+        // trigrams say the letters are there, not that they are in one piece
+        if (exact)
+            matches = candidates;
+        else
+        {
+            for (int idx = 0; idx < candidates.size(); idx++)
+            {
+                if (idx % SEARCH_CANCEL_CHECK == 0 && isStale(serial)) return;
+                if (containsAll(candidates[idx])) matches.append(candidates[idx]);
+            }
+        }
+    }
+
+    emit resultsReady(serial, matches, clock.nsecsElapsed() / 1000);
+}
+
+void SearchIndex::setLatest_serial(int newLatest_serial)
+{
+    latest_serial = newLatest_serial;
+}
+
+QString SearchIndex::normalize(const QString &text)
+{
+    QString decomposed = text.normalized(QString::NormalizationForm_KD);
+    QString normalized;
+    normalized.reserve(decomposed.size());
+    for (QChar ch : decomposed)
+    {
+        if (ch.category() == QChar::Mark_NonSpacing) continue;
+        normalized.append(ch.isLetterOrNumber() ? ch.toCaseFolded() : QChar(' '));
+    }
+    return normalized;
+}
+
+// private
+
+void SearchIndex::insertTracks(const QVector<TM::TrackId> &ids, const QStringList &texts)
+{ // ids mostly arrive in increasing order, so lists grow at the back
+    for (int idx = 0; idx < ids.size() && idx < texts.size(); idx++)
+    {
+        TM::TrackId id = ids[idx];
+        if (id >= TM::TrackId(text_of_id.size())) text_of_id.resize(id + 1);
+        text_of_id[id] = normalize(texts[idx]);
+        for (quint64 gram : trigramsOf(text_of_id[id]))
+        {
+            QVector<TM::TrackId>& list = postings[gram];
+            if (list.isEmpty() || list.last() < id)
+                list.append(id);
+            else
+                list.insert(std::lower_bound(list.begin(), list.end(), id), id);
+        }
+    }
+}
+
+void SearchIndex::removeTracks(const QVector<TM::TrackId> &ids)
+{ // each affected list is filtered once, however many of its ids go
+    QSet<quint64> affected;
+    for (TM::TrackId id : ids)
+    {
+        if (id >= TM::TrackId(text_of_id.size()) || text_of_id[id].isEmpty()) continue;
+        for (quint64 gram : trigramsOf(text_of_id[id])) affected.insert(gram);
+        text_of_id[id].clear();
+    }
+    for (quint64 gram : affected)
+    {
+        auto iter = postings.find(gram);
+        if (iter == postings.end()) continue;
+        QVector<TM::TrackId>& list = iter.value();
+        list.erase(std::remove_if(list.begin(), list.end(), [this](TM::TrackId id) {
+            return text_of_id[id].isEmpty();
+        }), list.end());
+        if (list.isEmpty()) postings.erase(iter);
+    }
+}
+
+bool SearchIndex::isStale(int serial) const
+{
+    return serial != latest_serial.load(std::memory_order_relaxed);
+}
+
+QVector<quint64> SearchIndex::trigramsOf(const QString &text)
+{ // three utf-16 units packed into one key, none spanning a space
+    QVector<quint64> grams;
+    const QChar* data = text.constData();
+    for (int pos = 0; pos + 3 <= text.size(); pos++)
+    {
+        if (data[pos] == ' ' || data[pos + 1] == ' ' || data[pos + 2] == ' ') continue;
+        grams.append(quint64(data[pos].unicode()) << 32 | quint64(data[pos + 1].unicode()) << 16
+                     | data[pos + 2].unicode());
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
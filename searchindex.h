@@ -0,0 +1,56 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <atomic>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace SI { class SearchIndex;}
+QT_END_NAMESPACE
+
+// trigram index over the file name and tags of every track
+// lives on its own thread, updates and queries are queued to it in order
+class SearchIndex : public QObject
+{
+    Q_OBJECT
+    #define SEARCH_CANCEL_CHECK 4096
+
+public:
+    explicit SearchIndex(QObject *parent = nullptr);
+    ~SearchIndex();
+
+    // index thread only, call through QMetaObject::invokeMethod
+    void reset(const QVector<TM::TrackId>& ids, const QStringList& texts);
+    void update(const QVector<TM::TrackId>& ids, const QStringList& texts);
+    void remove(const QVector<TM::TrackId>& ids);
+    // every word of the query has to appear somewhere in the track's text
+    void search(int serial, const QString& query);
+
+    // any thread, a query older than this gives up as soon as it notices
+    void setLatest_serial(int newLatest_serial);
+
+    // case folded, accents stripped, anything but letters and digits turned into spaces
+    static QString normalize(const QString& text);
+
+signals:
+    // ids in no particular order
+    void resultsReady(int serial, const QVector<TM::TrackId>& ids, qint64 elapsed_us);
+
+private:
+    // normalized text, indexed by id, empty when the id is not in the index
+    QVector<QString> text_of_id;
+    // sorted ids of the tracks containing each trigram
+    QHash<quint64, QVector<TM::TrackId>> postings;
+    std::atomic<int> latest_serial;
+
+    void insertTracks(const QVector<TM::TrackId>& ids, const QStringList& texts);
+    void removeTracks(const QVector<TM::TrackId>& ids);
+    bool isStale(int serial) const;
+    static QVector<quint64> trigramsOf(const QString& text);
+};
+
+#endif // SEARCHINDEX_H
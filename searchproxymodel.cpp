@@ -0,0 +1,178 @@
+#include "searchproxymodel.h"
+#include <algorithm>
+
+SearchProxyModel::SearchProxyModel(TrackModel *init_track_model, QObject *parent)
+    : QAbstractProxyModel{parent}
+    , track_model(init_track_model)
+    , filtered(false)
+{
+    QAbstractProxyModel::setSourceModel(track_model);
+    connect(track_model, &QAbstractItemModel::rowsAboutToBeInserted, this,
+            [this](const QModelIndex&, int first, int last) { sourceAboutToChange(first, last, true); });
+    connect(track_model, &QAbstractItemModel::rowsInserted, this, [this]() { sourceChanged(true); });
+    connect(track_model, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+            [this](const QModelIndex&, int first, int last) { sourceAboutToChange(first, last, false); });
+    connect(track_model, &QAbstractItemModel::rowsRemoved, this, [this]() { sourceChanged(false); });
+    connect(track_model, &QAbstractItemModel::modelAboutToBeReset, this, &SearchProxyModel::sourceAboutToBeReset);
+    connect(track_model, &QAbstractItemModel::modelReset, this, &SearchProxyModel::sourceReset);
+    connect(track_model, &QAbstractItemModel::dataChanged, this, &SearchProxyModel::sourceDataChanged);
+    connect(track_model, &QAbstractItemModel::layoutAboutToBeChanged, this, &SearchProxyModel::sourceLayoutAboutToChange);
+    connect(track_model, &QAbstractItemModel::layoutChanged, this, &SearchProxyModel::sourceLayoutChanged);
+}
+
+SearchProxyModel::~SearchProxyModel()
+{
+
+}
+
+// filter control
+
+void SearchProxyModel::setFilter(const QVector<TM::TrackId> &ids)
+{
+    beginResetModel();
+    filtered = true;
+    filter_ids = ids;
+    remapRows();
+    endResetModel();
+}
+
+void SearchProxyModel::clearFilter()
+{
+    if (!filtered) return;
+    beginResetModel();
+    filtered = false;
+    filter_ids.clear();
+    source_rows.clear();
+    endResetModel();
+}
+
+bool SearchProxyModel::isFiltered() const
+{
+    return filtered;
+}
+
+// model interface
+
+QModelIndex SearchProxyModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column != 0 || row < 0 || row >= rowCount()) return QModelIndex();
+    return createIndex(row, column);
+}
+
+QModelIndex SearchProxyModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child);
+    return QModelIndex();
+}
+
+int SearchProxyModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return filtered ? source_rows.size() : track_model->rowCount();
+}
+
+int SearchProxyModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex SearchProxyModel::mapToSource(const QModelIndex &proxy_index) const
+{
+    if (!proxy_index.isValid()) return QModelIndex();
+    int row = proxy_index.row();
+    if (filtered) row = row < source_rows.size() ? source_rows[row] : -1;
+    return track_model->index(row);
+}
+
+QModelIndex SearchProxyModel::mapFromSource(const QModelIndex &source_index) const
+{
+    if (!source_index.isValid()) return QModelIndex();
+    if (!filtered) return index(source_index.row(), 0);
+    auto iter = std::lower_bound(source_rows.cbegin(), source_rows.cend(), source_index.row());
+    if (iter == source_rows.cend() || *iter != source_index.row()) return QModelIndex();
+    return index(iter - source_rows.cbegin(), 0);
+}
+
+// private
+
+void SearchProxyModel::remapRows()
+{ // ids survive inserts and removals, rows don't
+    source_rows.clear();
+    source_rows.reserve(filter_ids.size());
+    for (TM::TrackId id : filter_ids)
+    {
+        int row = track_model->rowOf(id);
+        if (row >= 0) source_rows.append(row);
+    }
+    std::sort(source_rows.begin(), source_rows.end());
+}
+
+void SearchProxyModel::sourceAboutToChange(int first, int last, bool insert)
+{ // the track model is a flat list, parent is always the root
+    if (filtered)
+        beginResetModel();
+    else if (insert)
+        beginInsertRows(QModelIndex(), first, last);
+    else
+        beginRemoveRows(QModelIndex(), first, last);
+}
+
+void SearchProxyModel::sourceChanged(bool insert)
+{
+    if (filtered)
+    {
+        remapRows();
+        endResetModel();
+    }
+    else if (insert)
+        endInsertRows();
+    else
+        endRemoveRows();
+}
+
+void SearchProxyModel::sourceAboutToBeReset()
+{
+    beginResetModel();
+}
+
+void SearchProxyModel::sourceReset()
+{
+    if (filtered) remapRows();
+    endResetModel();
+}
+
+void SearchProxyModel::sourceLayoutAboutToChange()
+{ // the rows move, the tracks behind the persistent indexes don't
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    layout_indexes = persistentIndexList();
+    layout_ids.clear();
+    layout_ids.reserve(layout_indexes.size());
+    for (const QModelIndex& index : layout_indexes)
+        layout_ids.append(track_model->idAt(mapToSource(index).row()));
+}
+
+void SearchProxyModel::sourceLayoutChanged()
+{
+    if (filtered) remapRows();
+    QModelIndexList new_indexes;
+    new_indexes.reserve(layout_ids.size());
+    for (TM::TrackId id : layout_ids)
+        new_indexes.append(mapFromSource(track_model->index(track_model->rowOf(id))));
+    changePersistentIndexList(layout_indexes, new_indexes);
+    layout_indexes.clear();
+    layout_ids.clear();
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+void SearchProxyModel::sourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right, const QList<int> &roles)
+{
+    if (!filtered)
+    {
+        emit dataChanged(index(top_left.row(), 0), index(bottom_right.row(), 0), roles);
+        return;
+    }
+    auto first = std::lower_bound(source_rows.cbegin(), source_rows.cend(), top_left.row());
+    auto last = std::upper_bound(source_rows.cbegin(), source_rows.cend(), bottom_right.row());
+    if (first == last) return;
+    emit dataChanged(index(first - source_rows.cbegin(), 0), index(last - source_rows.cbegin() - 1, 0), roles);
+}
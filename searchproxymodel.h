@@ -0,0 +1,56 @@
+#ifndef SEARCHPROXYMODEL_H
+#define SEARCHPROXYMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QVector>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace SP { class SearchProxyModel;}
+QT_END_NAMESPACE
+
+// shows every track, or only the tracks a search matched, in list order
+// unlike QSortFilterProxyModel nothing is evaluated per row, the rows are handed in
+class SearchProxyModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit SearchProxyModel(TrackModel* init_track_model, QObject *parent = nullptr);
+    ~SearchProxyModel();
+
+    // filter control, ids in any order
+    void setFilter(const QVector<TM::TrackId>& ids);
+    void clearFilter();
+    bool isFiltered() const;
+
+    // model interface
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxy_index) const override;
+    QModelIndex mapFromSource(const QModelIndex &source_index) const override;
+
+private:
+    TrackModel* track_model;
+    bool filtered;
+    QVector<TM::TrackId> filter_ids;
+    // rows of track_model that are shown, ascending
+    QVector<int> source_rows;
+    // persistent indexes across a source layout change, by track
+    QModelIndexList layout_indexes;
+    QVector<TM::TrackId> layout_ids;
+
+    void remapRows();
+    // source changes, forwarded as they are when not filtered, as a reset otherwise
+    void sourceAboutToChange(int first, int last, bool insert);
+    void sourceChanged(bool insert);
+    void sourceAboutToBeReset();
+    void sourceReset();
+    void sourceLayoutAboutToChange();
+    void sourceLayoutChanged();
+    void sourceDataChanged(const QModelIndex& top_left, const QModelIndex& bottom_right, const QList<int>& roles);
+};
+
+#endif // SEARCHPROXYMODEL_H
@@ -0,0 +1,108 @@
+#include "sessionstore.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QDebug>
+#include <cstring>
+
+namespace
+{
+    void appendIds(QByteArray& data, const QVector<TM::TrackId>& ids)
+    {
+        data.append(reinterpret_cast<const char*>(ids.constData()), ids.size() * sizeof(TM::TrackId));
+    }
+
+    bool readIds(const QByteArray& data, qsizetype& offset, quint32 count, QVector<TM::TrackId>& ids)
+    {
+        qsizetype length = qsizetype(count) * sizeof(TM::TrackId);
+        if (data.size() - offset < length) return false;
+        ids.resize(count);
+        std::memcpy(ids.data(), data.constData() + offset, length);
+        offset += length;
+        return true;
+    }
+}
+
+SessionStore::SessionStore(const QString &init_file_path)
+    : file_path(init_file_path)
+{
+    write_pool.setMaxThreadCount(1);
+}
+
+SessionStore::~SessionStore()
+{
+    write_pool.waitForDone();
+}
+
+bool SessionStore::read(SS::Session &session) const
+{
+    QFile session_file(file_path);
+    if (!session_file.open(QIODevice::ReadOnly)) return false;
+    QByteArray data = session_file.readAll();
+    if (data.size() < qsizetype(sizeof(SS::Header))) return false;
+
+    SS::Header header;
+    std::memcpy(&header, data.constData(), sizeof(header));
+    if (header.magic != SS::Magic || header.version != SS::Version) return false;
+    if (header.play_mode > PQ::PlayMode::Shuffle) return false;
+
+    SS::Session read_session;
+    qsizetype offset = sizeof(header);
+    if (!readIds(data, offset, header.queue_count, read_session.queue.default_queue)
+        || !readIds(data, offset, header.user_queue_count, read_session.queue.user_added_queue)
+        || !readIds(data, offset, header.history_count, read_session.queue.history))
+        return false;
+    read_session.queue.play_mode = static_cast<PQ::PlayMode>(header.play_mode);
+    read_session.queue.current = header.current_track;
+    read_session.queue.shuffle_seed = header.shuffle_seed;
+    read_session.queue.shuffle_round = header.shuffle_round;
+    read_session.queue.shuffle_pos = header.shuffle_pos;
+    read_session.position_ms = header.position_ms;
+    session = read_session;
+    return true;
+}
+
+void SessionStore::save(const SS::Session &session)
+{
+    SS::Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = SS::Magic;
+    header.version = SS::Version;
+    header.play_mode = session.queue.play_mode;
+    header.current_track = session.queue.current;
+    header.position_ms = session.position_ms;
+    header.shuffle_seed = session.queue.shuffle_seed;
+    header.shuffle_pos = session.queue.shuffle_pos;
+    header.shuffle_round = session.queue.shuffle_round;
+    header.queue_count = session.queue.default_queue.size();
+    header.user_queue_count = session.queue.user_added_queue.size();
+    header.history_count = session.queue.history.size();
+
+    QByteArray data(reinterpret_cast<const char*>(&header), sizeof(header));
+    appendIds(data, session.queue.default_queue);
+    appendIds(data, session.queue.user_added_queue);
+    appendIds(data, session.queue.history);
+    if (data == last_written) return;
+    last_written = data;
+
+    QString path = file_path;
+    write_pool.start([path, data]() {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile session_file(path);
+        if (!session_file.open(QIODevice::WriteOnly) || session_file.write(data) != data.size()
+            || !session_file.commit())
+            qWarning() << "failed to write session file" << path;
+    });
+}
+
+const QString &SessionStore::getFile_path() const
+{
+    return file_path;
+}
+
+QString SessionStore::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/session.bin";
+}
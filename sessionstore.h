@@ -0,0 +1,64 @@
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QThreadPool>
+#include "playqueue.h"
+
+QT_BEGIN_NAMESPACE
+namespace SS { class SessionStore;}
+QT_END_NAMESPACE
+
+namespace SS
+{
+    const quint32 Magic = 0x53504D4D; // "MMPS"
+    const quint32 Version = 1;
+
+    // on-disk layout, native byte order:
+    // [Header][TrackId * queue_count][TrackId * user_queue_count][TrackId * history_count]
+    struct Header
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 play_mode;
+        quint32 current_track;
+        qint64 position_ms;
+        quint64 shuffle_seed;
+        quint64 shuffle_pos;
+        quint32 shuffle_round;
+        quint32 queue_count;
+        quint32 user_queue_count;
+        quint32 history_count;
+    };
+
+    struct Session
+    {
+        PQ::State queue;
+        qint64 position_ms = 0;
+    };
+}
+
+// where playback was, a few hundred bytes written next to the library file
+// writes go through QSaveFile on a background thread, a crash leaves the previous one
+class SessionStore
+{
+public:
+    explicit SessionStore(const QString& init_file_path = defaultPath());
+    ~SessionStore();
+
+    // blocking, small enough to read at startup
+    bool read(SS::Session& session) const;
+    // returns at once, unchanged sessions are not written again
+    void save(const SS::Session& session);
+
+    const QString& getFile_path() const;
+    static QString defaultPath();
+
+private:
+    QString file_path;
+    QByteArray last_written;
+    QThreadPool write_pool;
+};
+
+#endif // SESSIONSTORE_H
@@ -0,0 +1,70 @@
+#include "shuffleorder.h"
+
+namespace
+{
+    // splitmix64 finalizer, cheap and well mixed
+    quint64 mix(quint64 x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+}
+
+ShuffleOrder::ShuffleOrder(quint64 init_seed, quint32 limit)
+    : seed(init_seed)
+    , half_bits(SHUFFLE_MIN_BITS / 2)
+{ // at most 16 bits a half, TrackId is 32 bits wide
+    while (half_bits < 16 && (quint64(1) << (2 * half_bits)) < 2 * quint64(limit)) half_bits++;
+    half_mask = quint32((quint64(1) << half_bits) - 1);
+}
+
+quint32 ShuffleOrder::at(quint32 round, quint64 position) const
+{
+    quint32 left = quint32(position >> half_bits) & half_mask;
+    quint32 right = quint32(position) & half_mask;
+    for (int step = 0; step < SHUFFLE_FEISTEL_ROUNDS; step++)
+    {
+        quint32 next_right = left ^ scramble(right, round, step);
+        left = right;
+        right = next_right;
+    }
+    return left << half_bits | right;
+}
+
+quint64 ShuffleOrder::positionOf(quint32 round, quint32 value) const
+{ // the same steps backwards
+    quint32 left = (value >> half_bits) & half_mask;
+    quint32 right = value & half_mask;
+    for (int step = SHUFFLE_FEISTEL_ROUNDS - 1; step >= 0; step--)
+    {
+        quint32 prev_left = right ^ scramble(left, round, step);
+        right = left;
+        left = prev_left;
+    }
+    return quint64(left) << half_bits | right;
+}
+
+bool ShuffleOrder::covers(quint32 limit) const
+{
+    return limit <= domain();
+}
+
+quint64 ShuffleOrder::domain() const
+{
+    return quint64(1) << (2 * half_bits);
+}
+
+quint64 ShuffleOrder::getSeed() const
+{
+    return seed;
+}
+
+// private
+
+quint32 ShuffleOrder::scramble(quint32 half, quint32 round, int step) const
+{
+    quint64 key = mix(seed ^ (quint64(round) * SHUFFLE_FEISTEL_ROUNDS + step));
+    return quint32(mix(key ^ half)) & half_mask;
+}
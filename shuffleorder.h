@@ -0,0 +1,39 @@
+#ifndef SHUFFLEORDER_H
+#define SHUFFLEORDER_H
+
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+namespace SO { class ShuffleOrder;}
+QT_END_NAMESPACE
+
+// seeded random permutation of [0, domain()), one per round, computed on the fly
+// a balanced Feistel network, so it is a bijection whatever the round function does
+// and every value comes up exactly once a round without keeping an O(n) table
+class ShuffleOrder
+{
+    #define SHUFFLE_FEISTEL_ROUNDS 4
+    #define SHUFFLE_MIN_BITS 8
+
+public:
+    // the domain is a power of four of at least twice the limit, room for the list to grow
+    ShuffleOrder(quint64 init_seed = 0, quint32 limit = 0);
+
+    // value at position in the given round, and back
+    quint32 at(quint32 round, quint64 position) const;
+    quint64 positionOf(quint32 round, quint32 value) const;
+
+    // whether values up to limit are still inside the domain
+    bool covers(quint32 limit) const;
+    quint64 domain() const;
+    quint64 getSeed() const;
+
+private:
+    quint64 seed;
+    int half_bits;
+    quint32 half_mask;
+
+    quint32 scramble(quint32 half, quint32 round, int step) const;
+};
+
+#endif // SHUFFLEORDER_H
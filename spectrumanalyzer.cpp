@@ -0,0 +1,163 @@
+#include "spectrumanalyzer.h"
+#include "loudnessanalyzer.h"
+#include <QtMath>
+#include <QDebug>
+
+namespace
+{
+    // a power ratio in dB, floored
+    inline float toDb(float power)
+    {
+        if (power <= 0.0f) return SA::FloorDb;
+        return qMax(SA::FloorDb, 10.0f * std::log10(power));
+    }
+}
+
+bool SpectrumAnalyzer::tracing = false;
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent)
+    : QObject{parent}
+    , tap(SPECTRUM_RING_MS * SA::SampleRate / 1000, SA::Channels)
+    , pass_timer(new QTimer)
+    , fft(SPECTRUM_FFT_SIZE)
+    , history_pos(0)
+    , busy_nsecs(0)
+    , passes(0)
+{
+    int size = fft.getSize();
+    window.resize(size);
+    for (int idx = 0; idx < size; idx++)
+        window[idx] = static_cast<float>(0.5 - 0.5 * qCos(2.0 * M_PI * idx / size));
+    history.fill(0.0f, size);
+    chunk.resize(1024 * SA::Channels);
+    fft_re.resize(size);
+    fft_im.resize(size);
+    fft_power.resize(size / 2);
+
+    // bands are spaced evenly on a log scale, the low ones get at least a bin each
+    band_edges.resize(SPECTRUM_BANDS + 1);
+    for (int band = 0; band <= SPECTRUM_BANDS; band++)
+    {
+        double hz = SPECTRUM_LOW_HZ * qPow(SPECTRUM_HIGH_HZ / SPECTRUM_LOW_HZ, double(band) / SPECTRUM_BANDS);
+        int bin = qRound(hz * size / SA::SampleRate);
+        if (band > 0) bin = qMax(bin, band_edges[band - 1] + 1);
+        band_edges[band] = qMin(bin, size / 2);
+    }
+
+    // the timer fires on the analysis thread, so do the passes
+    pass_timer->setInterval(SPECTRUM_INTERVAL);
+    connect(pass_timer, &QTimer::timeout, pass_timer, [this]() { runPass(); });
+    pass_timer->moveToThread(&analyze_thread);
+    connect(&analyze_thread, &QThread::finished, pass_timer, &QObject::deleteLater);
+    analyze_thread.start(QThread::LowPriority);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    analyze_thread.quit();
+    analyze_thread.wait();
+}
+
+AudioRingBuffer *SpectrumAnalyzer::getTap()
+{
+    return &tap;
+}
+
+void SpectrumAnalyzer::setActive(bool active)
+{ // the timer belongs to the analysis thread, it is started and stopped there
+    QTimer* timer = pass_timer;
+    AudioRingBuffer* ring = &tap;
+    QMetaObject::invokeMethod(timer, [this, timer, ring, active]() {
+        if (active == timer->isActive()) return;
+        if (active)
+        { // what piled up while stopped is old, start from now
+            ring->discardUntil(ring->writeIndex());
+            stats_clock.start();
+            busy_nsecs = 0;
+            passes = 0;
+            timer->start();
+        }
+        else
+            timer->stop();
+    }, Qt::QueuedConnection);
+}
+
+void SpectrumAnalyzer::setTracing(bool enable)
+{
+    tracing = enable;
+}
+
+bool SpectrumAnalyzer::isTracing()
+{
+    return tracing;
+}
+
+// private
+
+void SpectrumAnalyzer::runPass()
+{ // analysis thread, everything played since the last pass goes into the levels,
+    // the newest SPECTRUM_FFT_SIZE frames into the spectrum
+    qint64 cpu_start = LoudnessAnalyzer::threadCpuNsecs();
+    int size = fft.getSize();
+    double sum[SA::Channels] = {};
+    float peak[SA::Channels] = {};
+    int frames = 0;
+    int got = 0;
+    while ((got = tap.read(chunk.data(), chunk.size() / SA::Channels)) > 0)
+    {
+        for (int frame = 0; frame < got; frame++)
+        {
+            const float* in = chunk.constData() + frame * SA::Channels;
+            for (int channel = 0; channel < SA::Channels; channel++)
+            {
+                sum[channel] += in[channel] * in[channel];
+                peak[channel] = qMax(peak[channel], qAbs(in[channel]));
+            }
+            history[history_pos] = 0.5f * (in[0] + in[1]);
+            history_pos = (history_pos + 1) & (size - 1);
+        }
+        frames += got;
+    }
+
+    if (frames > 0)
+    {
+        for (int idx = 0; idx < size; idx++)
+        {
+            fft_re[idx] = history[(history_pos + idx) & (size - 1)] * window[idx];
+            fft_im[idx] = 0.0f;
+        }
+        fft.forward(fft_re.data(), fft_im.data());
+        FftPlan::power(fft_power.data(), fft_re.constData(), fft_im.constData(), size / 2);
+
+        // a full scale sine through the Hann window peaks at (size / 4)^2
+        const float full_scale = float(size) * size / 16.0f;
+        QVector<float> bands(SPECTRUM_BANDS);
+        for (int band = 0; band < SPECTRUM_BANDS; band++)
+        {
+            float strongest = 0.0f;
+            for (int bin = band_edges[band]; bin < band_edges[band + 1]; bin++)
+                strongest = qMax(strongest, fft_power[bin]);
+            bands[band] = toDb(strongest / full_scale);
+        }
+        QVector<float> levels(2 * SA::Channels);
+        for (int channel = 0; channel < SA::Channels; channel++)
+        {
+            levels[channel] = toDb(static_cast<float>(sum[channel] / frames));
+            levels[SA::Channels + channel] = toDb(peak[channel] * peak[channel]);
+        }
+        emit spectrumReady(bands, levels);
+    }
+
+    busy_nsecs += LoudnessAnalyzer::threadCpuNsecs() - cpu_start;
+    passes++;
+    if (tracing && stats_clock.elapsed() >= SPECTRUM_STATS_INTERVAL) reportStats();
+}
+
+void SpectrumAnalyzer::reportStats()
+{
+    qint64 elapsed = qMax<qint64>(stats_clock.restart(), 1);
+    qInfo().noquote() << QString("spectrum: %1% of one core, %2 passes/s")
+                         .arg(busy_nsecs / (elapsed * 1e4), 0, 'f', 3).arg(passes * 1000 / elapsed);
+    busy_nsecs = 0;
+    passes = 0;
+}
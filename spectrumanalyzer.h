@@ -0,0 +1,85 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include "audioringbuffer.h"
+#include "fftplan.h"
+
+QT_BEGIN_NAMESPACE
+namespace SA { class SpectrumAnalyzer;}
+QT_END_NAMESPACE
+
+namespace SA
+{
+    // what the tap carries, the pipeline's output format
+    const int SampleRate = 48000;
+    const int Channels = 2;
+    // anything quieter is drawn as silence
+    const float FloorDb = -90.0f;
+}
+
+// spectrum and VU levels of what is playing, for the view next to the cover
+// the player copies its output into the tap ring and never waits on it; a pass on the
+// analysis thread reads the ring SPECTRUM_INTERVAL ms apart, so the view gets at most
+// that many updates however small the audio periods are
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+    #define SPECTRUM_FFT_SIZE 2048
+    #define SPECTRUM_BANDS 24
+    #define SPECTRUM_INTERVAL 33
+    #define SPECTRUM_RING_MS 500
+    #define SPECTRUM_LOW_HZ 40.0
+    #define SPECTRUM_HIGH_HZ 16000.0
+    #define SPECTRUM_STATS_INTERVAL 1000
+
+public:
+    explicit SpectrumAnalyzer(QObject *parent = nullptr);
+    ~SpectrumAnalyzer();
+
+    // audio side, single producer: the backend that is playing writes, nobody else
+    AudioRingBuffer* getTap();
+
+    // gui side, passes only run while playing and shown
+    void setActive(bool active);
+
+    // analysis cost printed once a second, as a share of one core
+    static void setTracing(bool enable);
+    static bool isTracing();
+
+signals:
+    // band levels low to high, then rms and peak of left and right, all in dB FS
+    void spectrumReady(const QVector<float>& bands, const QVector<float>& levels);
+
+private:
+    AudioRingBuffer tap;
+    QThread analyze_thread;
+    // lives on analyze_thread, deleted when it finishes
+    QTimer* pass_timer;
+
+    // analysis thread only
+    FftPlan fft;
+    QVector<float> window;
+    QVector<float> history; // mono, the newest SPECTRUM_FFT_SIZE frames, circular
+    int history_pos;
+    QVector<float> chunk;
+    QVector<float> fft_re;
+    QVector<float> fft_im;
+    QVector<float> fft_power;
+    QVector<int> band_edges; // first bin of every band, one more for the end
+
+    // instrumentation
+    static bool tracing;
+    QElapsedTimer stats_clock;
+    qint64 busy_nsecs;
+    int passes;
+
+    void runPass();
+    void reportStats();
+};
+
+#endif // SPECTRUMANALYZER_H
@@ -0,0 +1,74 @@
+#include "spectrumview.h"
+#include <QPainter>
+
+SpectrumView::SpectrumView(QWidget *parent)
+    : QWidget{parent}
+{
+
+}
+
+SpectrumView::~SpectrumView()
+{
+
+}
+
+void SpectrumView::setSpectrum(const QVector<float> &newBands, const QVector<float> &newLevels)
+{ // every pass may lower a bar by SPECTRUM_FALL_DB at most
+    if (bands.size() != newBands.size())
+        bands = newBands;
+    else
+        for (int band = 0; band < bands.size(); band++)
+            bands[band] = qMax(newBands[band], bands[band] - SPECTRUM_FALL_DB);
+    if (levels.size() != newLevels.size())
+        levels = newLevels;
+    else
+        for (int level = 0; level < levels.size(); level++)
+            levels[level] = qMax(newLevels[level], levels[level] - SPECTRUM_FALL_DB);
+    update();
+}
+
+void SpectrumView::clear()
+{
+    if (bands.isEmpty() && levels.isEmpty()) return;
+    bands.clear();
+    levels.clear();
+    update();
+}
+
+// protected
+
+void SpectrumView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    if (bands.isEmpty()) return;
+    QPainter painter(this);
+    QColor bar_color = palette().color(QPalette::Highlight);
+    QColor peak_color = bar_color.lighter(140);
+    int h = height();
+
+    // two meters of a bar's width at the right, rms filled, peak as a line
+    int meters = levels.size() / 2;
+    int slots = bands.size() + meters + 1;
+    double slot = double(width()) / slots;
+    double gap = qMax(1.0, slot / 4);
+    for (int band = 0; band < bands.size(); band++)
+    {
+        double top = h * (1.0f - heightOf(bands[band]));
+        painter.fillRect(QRectF(band * slot, top, slot - gap, h - top), bar_color);
+    }
+    for (int meter = 0; meter < meters; meter++)
+    {
+        double left = (bands.size() + 1 + meter) * slot;
+        double rms_top = h * (1.0f - heightOf(levels[meter]));
+        double peak_top = h * (1.0f - heightOf(levels[meters + meter]));
+        painter.fillRect(QRectF(left, rms_top, slot - gap, h - rms_top), bar_color);
+        painter.fillRect(QRectF(left, peak_top, slot - gap, 2), peak_color);
+    }
+}
+
+// private
+
+float SpectrumView::heightOf(float db)
+{
+    return qBound(0.0f, 1.0f + db / SPECTRUM_RANGE_DB, 1.0f);
+}
@@ -0,0 +1,37 @@
+#ifndef SPECTRUMVIEW_H
+#define SPECTRUMVIEW_H
+
+#include <QWidget>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+namespace SV { class SpectrumView;}
+QT_END_NAMESPACE
+
+// spectrum bars with a VU meter per channel at the right, in the highlight colour
+// bars jump up at once and fall back slowly, so short peaks stay readable
+class SpectrumView : public QWidget
+{
+    Q_OBJECT
+    #define SPECTRUM_RANGE_DB 60.0f
+    #define SPECTRUM_FALL_DB 1.5f
+
+public:
+    explicit SpectrumView(QWidget *parent = nullptr);
+    ~SpectrumView();
+
+    void setSpectrum(const QVector<float>& newBands, const QVector<float>& newLevels);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QVector<float> bands;
+    QVector<float> levels;
+
+    // a level in dB as a share of the full height
+    static float heightOf(float db);
+};
+
+#endif // SPECTRUMVIEW_H
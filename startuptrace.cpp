@@ -0,0 +1,58 @@
+#include "startuptrace.h"
+#include <QDebug>
+
+QElapsedTimer StartupTrace::clock;
+bool StartupTrace::enabled = false;
+qint64 StartupTrace::stage_time[ST::LibraryLoaded + 1] = {-1, -1, -1};
+
+void StartupTrace::start()
+{
+    clock.start();
+}
+
+void StartupTrace::setEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+bool StartupTrace::isEnabled()
+{
+    return enabled;
+}
+
+void StartupTrace::mark(ST::Stage stage)
+{
+    if (!clock.isValid() || stage_time[stage] >= 0) return;
+    stage_time[stage] = clock.elapsed();
+    // the library is the last thing to arrive, print everything then
+    if (enabled && stage == ST::LibraryLoaded) report();
+}
+
+qint64 StartupTrace::elapsed(ST::Stage stage)
+{
+    return stage_time[stage];
+}
+
+void StartupTrace::report()
+{
+    for (int stage = ST::FirstPaint; stage <= ST::LibraryLoaded; stage++)
+    {
+        qInfo().noquote() << QString("startup: %1 %2 ms")
+                             .arg(QString::fromLatin1(stageName(static_cast<ST::Stage>(stage))), -16)
+                             .arg(stage_time[stage]);
+    }
+}
+
+const char *StartupTrace::stageName(ST::Stage stage)
+{
+    switch (stage) {
+    case ST::FirstPaint:
+        return "first paint";
+    case ST::Interactive:
+        return "interactive";
+    case ST::LibraryLoaded:
+        return "full library";
+    default:
+        return "unknown";
+    }
+}
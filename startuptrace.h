@@ -0,0 +1,37 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+namespace ST { class StartupTrace;}
+QT_END_NAMESPACE
+
+namespace ST
+{
+    enum Stage {FirstPaint, Interactive, LibraryLoaded};
+}
+
+class StartupTrace
+{
+public:
+    // start the clock as early in main() as possible
+    static void start();
+    static void setEnabled(bool enable);
+    static bool isEnabled();
+
+    // record the time a stage was reached, later calls for the same stage are ignored
+    static void mark(ST::Stage stage);
+    static qint64 elapsed(ST::Stage stage);
+    static void report();
+
+private:
+    static QElapsedTimer clock;
+    static bool enabled;
+    static qint64 stage_time[ST::LibraryLoaded + 1];
+
+    static const char* stageName(ST::Stage stage);
+};
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,450 @@
+#include "tagreader.h"
+#include <QtEndian>
+#include <QtMath>
+#include <QStringDecoder>
+
+namespace
+{
+    quint32 syncsafe(const char* data)
+    {
+        const uchar* bytes = reinterpret_cast<const uchar*>(data);
+        return (quint32(bytes[0] & 0x7f) << 21) | (quint32(bytes[1] & 0x7f) << 14)
+                | (quint32(bytes[2] & 0x7f) << 7) | quint32(bytes[3] & 0x7f);
+    }
+
+    quint32 bigEndian(const char* data, int bytes)
+    {
+        quint32 value = 0;
+        for (int idx = 0; idx < bytes; idx++)
+            value = (value << 8) | uchar(data[idx]);
+        return value;
+    }
+
+    // undo id3v2 unsynchronisation, 0xFF 0x00 -> 0xFF
+    QByteArray resync(const QByteArray& data)
+    {
+        QByteArray out;
+        out.reserve(data.size());
+        for (int idx = 0; idx < data.size(); idx++)
+        {
+            out.append(data[idx]);
+            if (uchar(data[idx]) == 0xff && idx + 1 < data.size() && data[idx + 1] == 0) idx++;
+        }
+        return out;
+    }
+
+    float parseNumber(QString value, bool* ok)
+    {
+        value = value.trimmed();
+        if (value.endsWith("dB", Qt::CaseInsensitive)) value.chop(2);
+        return value.trimmed().toFloat(ok);
+    }
+}
+
+TR::Tags TagReader::read(const QString &file_path, bool read_cover)
+{
+    TR::Tags tags;
+    QFile file(file_path);
+    if (!file.open(QIODevice::ReadOnly)) return tags;
+
+    QByteArray magic = file.peek(4);
+    if (magic.startsWith("ID3"))
+    {
+        readId3v2(file, tags, read_cover);
+        readMpeg(file, tags);
+    }
+    else if (magic == "fLaC")
+        readFlac(file, tags, read_cover);
+    else if (magic == "RIFF")
+        readRiff(file, tags, read_cover);
+    else if (magic.size() == 4 && uchar(magic[0]) == 0xff && (uchar(magic[1]) & 0xe0) == 0xe0)
+        readMpeg(file, tags); // mp3 without a tag
+    return tags;
+}
+
+float TagReader::gainFor(const TR::Tags &tags, TR::GainMode mode)
+{
+    if (mode == TR::Off) return 1.0f;
+    float gain_db = 0.0f;
+    if (mode == TR::Album && tags.has_album_gain)
+        gain_db = tags.album_gain;
+    else if (tags.has_track_gain)
+        gain_db = tags.track_gain;
+    else if (tags.has_album_gain)
+        gain_db = tags.album_gain;
+    return static_cast<float>(qPow(10.0, gain_db / 20.0));
+}
+
+// private
+
+void TagReader::readId3v2(QFile &file, TR::Tags &tags, bool read_cover)
+{ // leaves the file at the first byte after the tag
+    QByteArray header = file.read(10);
+    if (header.size() < 10) return;
+    quint32 size = syncsafe(header.constData() + 6);
+    if (size > TAG_MAX_SIZE) return;
+    parseId3v2(header + file.read(size), tags, read_cover);
+    if (uchar(header[5]) & 0x10) file.seek(file.pos() + 10); // footer
+}
+
+void TagReader::readMpeg(QFile &file, TR::Tags &tags)
+{ // duration from the xing/info or vbri header of the first frame, else from the bitrate
+    static const int bitrates[2][16] = {
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}};
+    static const int sample_rates[3] = {44100, 48000, 32000};
+
+    qint64 start = file.pos();
+    QByteArray head = file.read(TAG_SYNC_SEARCH);
+    const uchar* bytes = reinterpret_cast<const uchar*>(head.constData());
+    for (int pos = 0; pos + 4 <= head.size(); pos++)
+    {
+        if (bytes[pos] != 0xff || (bytes[pos + 1] & 0xe0) != 0xe0) continue;
+        // version 3 = mpeg 1, 2 = mpeg 2, 0 = mpeg 2.5; layer 1 = layer III
+        int version = (bytes[pos + 1] >> 3) & 3;
+        int layer = (bytes[pos + 1] >> 1) & 3;
+        int bitrate_index = bytes[pos + 2] >> 4;
+        int rate_index = (bytes[pos + 2] >> 2) & 3;
+        if (version == 1 || layer != 1 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3)
+            continue;
+
+        bool mpeg1 = version == 3;
+        int sample_rate = sample_rates[rate_index] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+        int bitrate = bitrates[mpeg1 ? 0 : 1][bitrate_index];
+        int frame_length = (mpeg1 ? 144 : 72) * bitrate * 1000 / sample_rate + ((bytes[pos + 2] >> 1) & 1);
+        // a stray sync word in the data is not followed by another frame
+        int next = pos + frame_length;
+        if (next + 2 <= head.size() && (bytes[next] != 0xff || (bytes[next + 1] & 0xe0) != 0xe0))
+            continue;
+
+        bool mono = (bytes[pos + 3] >> 6) == 3;
+        int xing = pos + 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+        int vbri = pos + 36;
+        qint64 frames = 0;
+        if (xing + 12 <= head.size() && (head.mid(xing, 4) == "Xing" || head.mid(xing, 4) == "Info"))
+        {
+            if (bigEndian(head.constData() + xing + 4, 4) & 1)
+                frames = bigEndian(head.constData() + xing + 8, 4);
+        }
+        else if (vbri + 18 <= head.size() && head.mid(vbri, 4) == "VBRI")
+            frames = bigEndian(head.constData() + vbri + 14, 4);
+
+        if (frames > 0)
+            tags.duration_ms = frames * (mpeg1 ? 1152 : 576) * 1000 / sample_rate;
+        else
+            tags.duration_ms = (file.size() - start - pos) * 8 / bitrate;
+        return;
+    }
+}
+
+void TagReader::readFlac(QFile &file, TR::Tags &tags, bool read_cover)
+{
+    file.seek(4);
+    bool last = false;
+    while (!last)
+    {
+        QByteArray header = file.read(4);
+        if (header.size() < 4) return;
+        last = uchar(header[0]) & 0x80;
+        int type = uchar(header[0]) & 0x7f;
+        quint32 length = bigEndian(header.constData() + 1, 3);
+        // 0 = stream info, 4 = vorbis comment, 6 = picture
+        bool wanted = type == 0 || type == 4 || (type == 6 && read_cover);
+        if (!wanted || length > TAG_MAX_SIZE)
+        {
+            if (!file.seek(file.pos() + length)) return;
+            continue;
+        }
+
+        QByteArray block = file.read(length);
+        if (block.size() < int(length)) return;
+        const char* data = block.constData();
+        if (type == 0 && length >= 18)
+        { // 20 bit sample rate, then channels and depth, then 36 bit sample count
+            const uchar* info = reinterpret_cast<const uchar*>(data);
+            quint32 sample_rate = bigEndian(data + 10, 3) >> 4;
+            quint64 samples = (quint64(info[13] & 0x0f) << 32) | bigEndian(data + 14, 4);
+            if (sample_rate > 0) tags.duration_ms = samples * 1000 / sample_rate;
+        }
+        else if (type == 6)
+        { // picture type, mime, description, geometry, image, lengths big endian
+            qint64 pos = 4;
+            if (pos + 4 > block.size()) continue;
+            pos += 4 + bigEndian(data + pos, 4);
+            if (pos + 4 > block.size()) continue;
+            pos += 4 + bigEndian(data + pos, 4) + 16;
+            if (pos + 4 > block.size()) continue;
+            quint32 image_length = bigEndian(data + pos, 4);
+            pos += 4;
+            if (pos + image_length > block.size()) continue;
+            setCover(block.mid(pos, image_length), bigEndian(data, 4) == 3, tags);
+        }
+        else if (type == 4)
+        { // vorbis comment block, little endian lengths, "KEY=value" entries
+            qint64 pos = 0;
+            auto readLength = [&](quint32& value) {
+                if (pos + 4 > block.size()) return false;
+                value = qFromLittleEndian<quint32>(data + pos);
+                pos += 4;
+                return true;
+            };
+            quint32 vendor_length, count;
+            if (!readLength(vendor_length)) continue;
+            pos += vendor_length;
+            if (!readLength(count)) continue;
+            for (quint32 idx = 0; idx < count; idx++)
+            {
+                quint32 entry_length;
+                if (!readLength(entry_length) || pos + entry_length > block.size()) break;
+                QString entry = QString::fromUtf8(data + pos, entry_length);
+                pos += entry_length;
+                int split = entry.indexOf('=');
+                if (split > 0) setField(entry.left(split), entry.mid(split + 1), tags);
+            }
+        }
+    }
+}
+
+void TagReader::readRiff(QFile &file, TR::Tags &tags, bool read_cover)
+{ // wav keeps its id3v2 tag in an "id3 " chunk and plain text in LIST/INFO
+    file.seek(12);
+    quint32 byte_rate = 0;
+    qint64 data_size = -1;
+    while (true)
+    {
+        QByteArray header = file.read(8);
+        if (header.size() < 8) break;
+        QByteArray id = header.left(4);
+        quint32 length = qFromLittleEndian<quint32>(header.constData() + 4);
+        qint64 next = file.pos() + length + (length & 1);
+
+        if (id == "fmt " && length >= 16)
+            byte_rate = qFromLittleEndian<quint32>(file.read(16).constData() + 8);
+        else if (id == "data")
+        { // streamed files leave the length at its maximum
+            data_size = qMin<qint64>(length, file.size() - file.pos());
+        }
+        else if (id.toLower() == "id3 " && length <= TAG_MAX_SIZE)
+        {
+            QByteArray chunk = file.read(length);
+            if (chunk.startsWith("ID3")) parseId3v2(chunk, tags, read_cover);
+        }
+        else if (id == "LIST" && length >= 4 && length <= TAG_MAX_SIZE)
+        {
+            QByteArray list = file.read(length);
+            qint64 pos = 4;
+            while (list.startsWith("INFO") && pos + 8 <= list.size())
+            { // an id3 tag, wherever it is in the file, takes precedence
+                QByteArray key = list.mid(pos, 4);
+                quint32 size = qFromLittleEndian<quint32>(list.constData() + pos + 4);
+                pos += 8;
+                if (pos + size > list.size()) break;
+                QString value = decodeText(list.mid(pos, size), 3);
+                pos += size + (size & 1);
+                if (key == "INAM" && tags.title.isEmpty()) tags.title = value;
+                else if (key == "IART" && tags.artist.isEmpty()) tags.artist = value;
+                else if (key == "IPRD" && tags.album.isEmpty()) tags.album = value;
+            }
+        }
+        if (!file.seek(next)) break;
+    }
+    if (byte_rate > 0 && data_size >= 0) tags.duration_ms = data_size * 1000 / byte_rate;
+}
+
+void TagReader::parseId3v2(const QByteArray &raw_tag, TR::Tags &tags, bool read_cover)
+{
+    if (raw_tag.size() < 10) return;
+    int major = raw_tag[3];
+    int flags = uchar(raw_tag[5]);
+    if (major < 2 || major > 4) return;
+    // v2.2 and v2.3 unsynchronise the whole tag, v2.4 does it per frame
+    QByteArray tag = (flags & 0x80) && major < 4 ? resync(raw_tag) : raw_tag;
+
+    int pos = 10;
+    if ((flags & 0x40) && major >= 3)
+    { // skip the extended header
+        if (pos + 4 > tag.size()) return;
+        pos += major == 3 ? 4 + bigEndian(tag.constData() + pos, 4) : syncsafe(tag.constData() + pos);
+    }
+
+    const int id_length = major == 2 ? 3 : 4;
+    const int header_length = major == 2 ? 6 : 10;
+    const QByteArray user_text = major == 2 ? "TXX" : "TXXX";
+    const QByteArray title_text = major == 2 ? "TT2" : "TIT2";
+    const QByteArray artist_text = major == 2 ? "TP1" : "TPE1";
+    const QByteArray album_text = major == 2 ? "TAL" : "TALB";
+    const QByteArray picture = major == 2 ? "PIC" : "APIC";
+    while (pos + header_length <= tag.size())
+    {
+        const char* frame = tag.constData() + pos;
+        if (frame[0] == 0) break; // padding
+        QByteArray id(frame, id_length);
+        quint32 size = major == 2 ? bigEndian(frame + 3, 3)
+                                  : major == 3 ? bigEndian(frame + 4, 4) : syncsafe(frame + 4);
+        pos += header_length;
+        if (size > quint32(tag.size() - pos)) break;
+        int data_pos = pos;
+        pos += size;
+
+        // only copy the frames we read, pictures can be large
+        bool is_text = id == title_text || id == artist_text || id == album_text;
+        bool is_picture = read_cover && id == picture;
+        if ((id != user_text && !is_text && !is_picture) || size == 0) continue;
+        QByteArray data = tag.mid(data_pos, size);
+        if (major == 4)
+        {
+            int frame_flags = uchar(frame[9]);
+            if (frame_flags & 0x0c) continue; // compressed or encrypted
+            if (frame_flags & 0x02) data = resync(data);
+            if (frame_flags & 0x01) data = data.mid(4); // data length indicator
+            if (data.isEmpty()) continue;
+        }
+        if (is_picture)
+        {
+            parsePicture(data, major, tags);
+            continue;
+        }
+
+        // encoding byte, then the text; v2.4 separates several values with zeros
+        int encoding = data[0];
+        if (is_text)
+        {
+            QString value = decodeText(data.mid(1), encoding).section(QChar(0), 0, 0);
+            if (id == title_text) tags.title = value;
+            else if (id == artist_text) tags.artist = value;
+            else tags.album = value;
+            continue;
+        }
+
+        // user text: encoding byte, description, terminator, value
+        bool wide = encoding == 1 || encoding == 2;
+        int split = -1;
+        for (int idx = 1; idx + (wide ? 1 : 0) < data.size(); idx += wide ? 2 : 1)
+        {
+            if (data[idx] == 0 && (!wide || data[idx + 1] == 0))
+            {
+                split = idx;
+                break;
+            }
+        }
+        if (split < 0) continue;
+        QString key = decodeText(data.mid(1, split - 1), encoding);
+        QString value = decodeText(data.mid(split + (wide ? 2 : 1)), encoding);
+        setField(key, value, tags);
+    }
+}
+
+void TagReader::parsePicture(const QByteArray &data, int major, TR::Tags &tags)
+{ // encoding, mime type (v2.2: 3 letter format), picture type, description, image
+    int encoding = data[0];
+    bool wide = encoding == 1 || encoding == 2;
+    int pos = 1;
+    if (major == 2)
+        pos += 3;
+    else
+    {
+        int end = data.indexOf('\0', pos);
+        if (end < 0) return;
+        pos = end + 1;
+    }
+    if (pos >= data.size()) return;
+    bool front = data[pos] == 3;
+    pos++;
+    while (pos + (wide ? 1 : 0) < data.size() && !(data[pos] == 0 && (!wide || data[pos + 1] == 0)))
+        pos += wide ? 2 : 1;
+    pos += wide ? 2 : 1;
+    if (pos < data.size()) setCover(data.mid(pos), front, tags);
+}
+
+void TagReader::setCover(const QByteArray &image, bool front, TR::Tags &tags)
+{ // the first picture, unless a front cover turns up later
+    if (image.isEmpty() || tags.cover_is_front || (!tags.cover.isEmpty() && !front)) return;
+    tags.cover = image;
+    tags.cover_is_front = front;
+}
+
+void TagReader::setField(const QString &key, const QString &value, TR::Tags &tags)
+{
+    QString name = key.trimmed().toUpper();
+    bool ok = false;
+    if (name == "TITLE")
+        tags.title = value;
+    else if (name == "ARTIST")
+        tags.artist = tags.artist.isEmpty() ? value : tags.artist + ", " + value;
+    else if (name == "ALBUM")
+        tags.album = value;
+    else if (name == "REPLAYGAIN_TRACK_GAIN")
+    {
+        float gain = parseNumber(value, &ok);
+        if (ok)
+        {
+            tags.track_gain = gain;
+            tags.has_track_gain = true;
+        }
+    }
+    else if (name == "REPLAYGAIN_ALBUM_GAIN")
+    {
+        float gain = parseNumber(value, &ok);
+        if (ok)
+        {
+            tags.album_gain = gain;
+            tags.has_album_gain = true;
+        }
+    }
+    else if (name == "REPLAYGAIN_TRACK_PEAK")
+    {
+        float peak = parseNumber(value, &ok);
+        if (ok) tags.track_peak = peak;
+    }
+    else if (name == "REPLAYGAIN_ALBUM_PEAK")
+    {
+        float peak = parseNumber(value, &ok);
+        if (ok) tags.album_peak = peak;
+    }
+    // r128 gains are Q7.8 against -23 LUFS, replay gain is against -18 LUFS
+    else if (name == "R128_TRACK_GAIN" && !tags.has_track_gain)
+    {
+        int gain = value.trimmed().toInt(&ok);
+        if (ok)
+        {
+            tags.track_gain = gain / 256.0f + 5.0f;
+            tags.has_track_gain = true;
+        }
+    }
+    else if (name == "R128_ALBUM_GAIN" && !tags.has_album_gain)
+    {
+        int gain = value.trimmed().toInt(&ok);
+        if (ok)
+        {
+            tags.album_gain = gain / 256.0f + 5.0f;
+            tags.has_album_gain = true;
+        }
+    }
+}
+
+QString TagReader::decodeText(const QByteArray &data, int encoding)
+{
+    QString text;
+    switch (encoding) {
+    case 1:
+    {
+        QStringDecoder decoder(QStringDecoder::Utf16);
+        text = decoder(data);
+        break;
+    }
+    case 2:
+    {
+        QStringDecoder decoder(QStringDecoder::Utf16BE);
+        text = decoder(data);
+        break;
+    }
+    case 3:
+        text = QString::fromUtf8(data);
+        break;
+    default:
+        text = QString::fromLatin1(data);
+        break;
+    }
+    while (text.endsWith(QChar(0))) text.chop(1);
+    return text;
+}
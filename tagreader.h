@@ -0,0 +1,62 @@
+#ifndef TAGREADER_H
+#define TAGREADER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+
+QT_BEGIN_NAMESPACE
+namespace TR { class TagReader;}
+QT_END_NAMESPACE
+
+namespace TR
+{
+    enum GainMode {Off, Track, Album};
+
+    struct Tags
+    {
+        // replay gain in dB against the -18 LUFS reference, peaks as linear amplitude
+        bool has_track_gain = false;
+        bool has_album_gain = false;
+        float track_gain = 0.0f;
+        float album_gain = 0.0f;
+        float track_peak = 0.0f;
+        float album_peak = 0.0f;
+
+        // track info, empty when the file has none
+        QString title;
+        QString artist;
+        QString album;
+        qint64 duration_ms = 0;
+        // embedded cover art as stored in the file, only read when asked for
+        QByteArray cover;
+        bool cover_is_front = false;
+    };
+}
+
+// reads the few tags the player needs straight from ID3v2 (mp3, wav),
+// vorbis comments (flac) and RIFF INFO (wav), without pulling in a tagging library
+// durations come from the stream headers, nothing is decoded
+class TagReader
+{
+    #define TAG_MAX_SIZE (16 * 1024 * 1024)
+    #define TAG_SYNC_SEARCH (64 * 1024)
+
+public:
+    static TR::Tags read(const QString& file_path, bool read_cover = false);
+    // linear gain for mode, falls back from album to track, 1 when there is nothing
+    static float gainFor(const TR::Tags& tags, TR::GainMode mode);
+
+private:
+    static void readId3v2(QFile& file, TR::Tags& tags, bool read_cover);
+    static void readMpeg(QFile& file, TR::Tags& tags);
+    static void readFlac(QFile& file, TR::Tags& tags, bool read_cover);
+    static void readRiff(QFile& file, TR::Tags& tags, bool read_cover);
+    static void parseId3v2(const QByteArray& tag, TR::Tags& tags, bool read_cover);
+    static void parsePicture(const QByteArray& data, int major, TR::Tags& tags);
+    static void setCover(const QByteArray& image, bool front, TR::Tags& tags);
+    static void setField(const QString& key, const QString& value, TR::Tags& tags);
+    static QString decodeText(const QByteArray& data, int encoding);
+};
+
+#endif // TAGREADER_H
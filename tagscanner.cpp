@@ -0,0 +1,104 @@
+#include "tagscanner.h"
+#include "tagreader.h"
+#include <QFileInfo>
+#include <QDateTime>
+
+TagScanner::TagScanner(const CoverCache *init_cover_cache, QObject *parent)
+    : QObject{parent}
+    , cover_cache(init_cover_cache)
+    , running(false)
+    , cancelled(false)
+    , pending_batches(0)
+    , tracks_read(0)
+{
+    tag_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+TagScanner::~TagScanner()
+{
+    cancel();
+    tag_pool.waitForDone();
+}
+
+// scan control
+
+bool TagScanner::scan(const QVector<TS::Job> &new_jobs)
+{
+    if (running || new_jobs.isEmpty()) return false;
+
+    running = true;
+    jobs = new_jobs;
+    cancelled = false;
+    tracks_read = 0;
+    pending_batches = (jobs.size() + TAG_SCAN_BATCH - 1) / TAG_SCAN_BATCH;
+    scan_clock.start();
+
+    // jobs is left alone until the last batch is done, the tasks only read it
+    for (int first = 0; first < jobs.size(); first += TAG_SCAN_BATCH)
+    {
+        int count = qMin(TAG_SCAN_BATCH, jobs.size() - first);
+        tag_pool.start([this, first, count]() { scanBatch(first, count); });
+    }
+    return true;
+}
+
+void TagScanner::cancel()
+{
+    cancelled = true;
+}
+
+bool TagScanner::isRunning() const
+{
+    return running;
+}
+
+TM::TrackInfo TagScanner::readInfo(const QString &file_path, const CoverCache *cover_cache)
+{
+    TM::TrackInfo info;
+    QFileInfo file(file_path);
+    if (!file.exists()) return info;
+    TR::Tags tags = TagReader::read(file_path, cover_cache != nullptr);
+    info.file_size = file.size();
+    info.mtime = file.lastModified().toMSecsSinceEpoch();
+    info.title = tags.title.trimmed();
+    info.artist = tags.artist.trimmed();
+    info.album = tags.album.trimmed();
+    info.duration_ms = tags.duration_ms;
+    if (cover_cache) info.cover_key = cover_cache->store(tags.cover);
+    return info;
+}
+
+// private
+
+void TagScanner::scanBatch(int first, int count)
+{ // runs on a pool thread
+    QVector<TM::TrackId> ids;
+    QVector<TM::TrackInfo> infos;
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+    for (int index = first; index < first + count && !cancelled; index++)
+    {
+        const TS::Job& job = jobs.at(index);
+        QFileInfo file(job.file_path);
+        // a file that has not changed since it was last read is done already
+        if (!file.exists() || job.cached.matches(file.size(), file.lastModified().toMSecsSinceEpoch()))
+            continue;
+        ids.append(job.id);
+        infos.append(readInfo(job.file_path, cover_cache));
+    }
+    if (!ids.isEmpty() && !cancelled)
+    {
+        tracks_read += ids.size();
+        emit tagsRead(ids, infos);
+    }
+
+    // the last task to finish reports back to the owner thread
+    if (pending_batches.fetch_sub(1) == 1)
+        QMetaObject::invokeMethod(this, &TagScanner::onScanDone, Qt::QueuedConnection);
+}
+
+void TagScanner::onScanDone()
+{
+    running = false;
+    jobs.clear();
+    emit finished(cancelled, tracks_read, scan_clock.elapsed());
+}
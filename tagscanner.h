@@ -0,0 +1,67 @@
+#ifndef TAGSCANNER_H
+#define TAGSCANNER_H
+
+#include <QObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QVector>
+#include <atomic>
+#include "trackmodel.h"
+#include "covercache.h"
+
+QT_BEGIN_NAMESPACE
+namespace TS { class TagScanner;}
+QT_END_NAMESPACE
+
+namespace TS
+{
+    struct Job
+    {
+        TM::TrackId id;
+        QString file_path;
+        // what the library already knows, the file is skipped if it still matches
+        TM::TrackInfo cached;
+    };
+}
+
+// reads title, artist, album, duration and cover art of many tracks on a pool,
+// covers go into the cover cache and only their key comes back
+class TagScanner : public QObject
+{
+    Q_OBJECT
+    #define TAG_SCAN_BATCH 64
+
+public:
+    TagScanner(const CoverCache* init_cover_cache, QObject *parent = nullptr);
+    ~TagScanner();
+
+    // scan control
+    bool scan(const QVector<TS::Job>& new_jobs);
+    void cancel();
+    bool isRunning() const;
+
+    // reads one file, safe to call from any thread
+    static TM::TrackInfo readInfo(const QString& file_path, const CoverCache* cover_cache);
+
+signals:
+    // one signal per batch of TAG_SCAN_BATCH jobs, unchanged files left out
+    void tagsRead(const QVector<TM::TrackId>& ids, const QVector<TM::TrackInfo>& infos);
+    void finished(bool cancelled, int tracks_read, qint64 elapsed_ms);
+
+private:
+    const CoverCache* cover_cache;
+    QThreadPool tag_pool;
+    QElapsedTimer scan_clock;
+    QVector<TS::Job> jobs;
+    bool running;
+
+    std::atomic<bool> cancelled;
+    std::atomic<int> pending_batches;
+    std::atomic<int> tracks_read;
+
+    void scanBatch(int first, int count);
+    void onScanDone();
+};
+
+#endif // TAGSCANNER_H
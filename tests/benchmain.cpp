@@ -0,0 +1,143 @@
+#include "benchmain.h"
+#include <QTemporaryDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QSysInfo>
+#include <QThread>
+#include <QStandardPaths>
+#include <QSettings>
+
+void BenchMain::prepare()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::setApplicationName("myMusicPlayer-tests");
+    QCoreApplication::setOrganizationName("CrystallisR");
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+}
+
+int BenchMain::exec(QObject *test, int argc, char **argv)
+{
+    QStringList json_paths;
+    QStringList arguments;
+    bool has_output = false;
+    for (int arg = 0; arg < argc; arg++)
+    {
+        QString argument = QString::fromLocal8Bit(argv[arg]);
+        if (argument == "-o" && arg + 1 < argc)
+        {
+            QString output = QString::fromLocal8Bit(argv[++arg]);
+            if (output.endsWith(",json"))
+            {
+                json_paths.append(output.chopped(5));
+                continue;
+            }
+            // a plain "-o file" can't be mixed with "-o file,format"
+            if (!output.contains(',')) output += ",txt";
+            arguments << argument << output;
+            has_output = true;
+            continue;
+        }
+        arguments.append(argument);
+    }
+    if (json_paths.isEmpty()) return QTest::qExec(test, arguments);
+
+    QTemporaryDir csv_dir;
+    if (!csv_dir.isValid())
+    {
+        qWarning().noquote() << "no temporary folder for the benchmark results";
+        return 1;
+    }
+    QString csv_path = csv_dir.filePath("results.csv");
+    arguments << "-o" << csv_path + ",csv";
+    // the console log stays unless another output was asked for
+    if (!has_output) arguments << "-o" << "-,txt";
+    int failures = QTest::qExec(test, arguments);
+
+    QString test_name = QString::fromLatin1(test->metaObject()->className());
+    for (const QString& json_path : json_paths)
+    {
+        if (writeJson(test_name, csv_path, json_path)) continue;
+        qWarning().noquote() << QString("cannot write %1").arg(json_path);
+        if (!failures) failures = 1;
+    }
+    return failures;
+}
+
+// private
+
+bool BenchMain::writeJson(const QString &test_name, const QString &csv_path, const QString &json_path)
+{ // one csv line per result: "function","[global tag:]tag","metric",per iteration,total,iterations
+    QJsonArray results;
+    QFile csv_file(csv_path);
+    if (csv_file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QTextStream in(&csv_file);
+        while (!in.atEnd())
+        {
+            QStringList fields = splitCsv(in.readLine());
+            if (fields.size() < 6) continue;
+            bool ok = false;
+            double value = fields[3].toDouble(&ok);
+            if (!ok) continue;
+            QJsonObject result;
+            result["function"] = fields[0];
+            result["tag"] = fields[1];
+            result["metric"] = fields[2];
+            result["value"] = value;
+            result["total"] = fields[4].toDouble();
+            result["iterations"] = fields[5].toInt();
+            results.append(result);
+        }
+    }
+
+    QJsonObject report;
+    report["version"] = BM::ReportVersion;
+    report["test"] = test_name;
+    report["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["qt"] = qVersion();
+    report["os"] = QSysInfo::prettyProductName();
+    report["cpu"] = QSysInfo::currentCpuArchitecture();
+    report["threads"] = QThread::idealThreadCount();
+    report["results"] = results;
+
+    QSaveFile json_file(json_path);
+    if (!json_file.open(QIODevice::WriteOnly)) return false;
+    json_file.write(QJsonDocument(report).toJson());
+    return json_file.commit();
+}
+
+QStringList BenchMain::splitCsv(const QString &line)
+{ // quoted fields may hold commas and doubled quotes
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (int idx = 0; idx < line.size(); idx++)
+    {
+        QChar ch = line[idx];
+        if (quoted)
+        {
+            if (ch != '"')
+                field += ch;
+            else if (idx + 1 < line.size() && line[idx + 1] == '"')
+                field += line[++idx];
+            else
+                quoted = false;
+        }
+        else if (ch == '"')
+            quoted = true;
+        else if (ch == ',')
+        {
+            fields.append(field);
+            field.clear();
+        }
+        else
+            field += ch;
+    }
+    fields.append(field);
+    return fields;
+}
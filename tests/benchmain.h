@@ -0,0 +1,57 @@
+#ifndef BENCHMAIN_H
+#define BENCHMAIN_H
+
+#include <QObject>
+#include <QString>
+#include <QApplication>
+#include <QtTest>
+
+QT_BEGIN_NAMESPACE
+namespace BM { class BenchMain;}
+QT_END_NAMESPACE
+
+namespace BM
+{
+    // bumped whenever the report layout changes, reports of another version
+    // should not be compared with each other
+    const int ReportVersion = 2;
+}
+
+// QtTest has no JSON logger, "-o file,json" is taken off the command line here,
+// the run is logged as csv instead and the benchmark results are written to file as JSON
+// with the machine they ran on, so releases can be compared; every other option goes to QTest
+// settings and data folders are the test ones, the user's library is never touched
+class BenchMain
+{
+public:
+    // before the test object is made, so it already sees the test folders
+    static void prepare();
+    static int exec(QObject* test, int argc, char** argv);
+
+private:
+    static bool writeJson(const QString& test_name, const QString& csv_path, const QString& json_path);
+    static QStringList splitCsv(const QString& line);
+};
+
+// QTEST_MAIN and QTEST_GUILESS_MAIN with the JSON output
+#define BENCH_MAIN(TestObject) \
+int main(int argc, char *argv[]) \
+{ \
+    QApplication app(argc, argv); \
+    QTEST_SET_MAIN_SOURCE_PATH \
+    BenchMain::prepare(); \
+    TestObject test; \
+    return BenchMain::exec(&test, argc, argv); \
+}
+
+#define BENCH_GUILESS_MAIN(TestObject) \
+int main(int argc, char *argv[]) \
+{ \
+    QCoreApplication app(argc, argv); \
+    QTEST_SET_MAIN_SOURCE_PATH \
+    BenchMain::prepare(); \
+    TestObject test; \
+    return BenchMain::exec(&test, argc, argv); \
+}
+
+#endif // BENCHMAIN_H
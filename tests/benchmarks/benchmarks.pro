@@ -0,0 +1,6 @@
+TARGET = tst_benchmarks
+
+include(../tests.pri)
+
+SOURCES += \
+    tst_benchmarks.cpp
@@ -0,0 +1,238 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QEventLoop>
+#include <QSignalSpy>
+#include <QDir>
+#include <QUrl>
+#include "benchmain.h"
+#include "testlibrary.h"
+#include "trackmodel.h"
+#include "managelist.h"
+#include "playqueue.h"
+#include "playerengine.h"
+
+Q_DECLARE_METATYPE(PQ::PlayMode)
+Q_DECLARE_METATYPE(PB::Engine)
+
+// library and playback timings on synthetic libraries, everything in a temporary folder
+// the components are the ones ManageList and PlayerEngine use, driven the way they drive them
+class TestBenchmarks : public QObject
+{
+    Q_OBJECT
+    #define BENCH_MAX_FILES 20000
+    #define BENCH_DIR_FILES 500
+    #define BENCH_SWITCH_FILES 10
+    #define BENCH_WAV_MS 2000
+    #define BENCH_TIMEOUT 10000
+    #define BENCH_LOAD_TIMEOUT 60000
+
+private slots:
+    void initTestCase();
+
+    // a ManageList without a view, importing generated files and saving and loading its library
+    // file; tests run with the test data folder, see BenchMain::prepare
+    void import_data();
+    void import();
+    void save_data();
+    void save();
+    void load_data();
+    void load();
+    // every step is followed by what PlayerEngine does with its answer, the row becomes current
+    void queueNext_data();
+    void queueNext();
+    void queuePrevious_data();
+    void queuePrevious();
+    // PlayerEngine::startPlayingNew (stop, set source, play) until the new track is heard
+    void switchTrack_data();
+    void switchTrack();
+
+private:
+    QTemporaryDir work_dir;
+
+    QDir importDir(int files);
+    static void addQueueRows();
+};
+
+void TestBenchmarks::initTestCase()
+{
+    QVERIFY(work_dir.isValid());
+}
+
+void TestBenchmarks::import_data()
+{ // a million files would not fit the temporary folder
+    TestLibrary::addSizes({1000, 10000, BENCH_MAX_FILES});
+}
+
+void TestBenchmarks::import()
+{
+    QFETCH(int, tracks);
+    QDir import_dir = importDir(tracks);
+    QVERIFY(import_dir.exists());
+
+    ManageList list(nullptr);
+    int imported = 0;
+    QBENCHMARK {
+        list.clear();
+        QEventLoop loop;
+        connect(list.getScanner(), &LibraryScanner::finished, &loop, &QEventLoop::quit);
+        QVERIFY(list.importToList(import_dir, {"wav"}));
+        loop.exec();
+        imported = list.getTrack_model()->count();
+    }
+    QCOMPARE(imported, tracks);
+}
+
+void TestBenchmarks::save_data()
+{
+    TestLibrary::addSizes();
+}
+
+void TestBenchmarks::save()
+{ // every run adds a track first, the way an import leaves the list to be saved
+    QFETCH(int, tracks);
+    ManageList list(nullptr);
+    TrackModel* model = list.getTrack_model();
+    TestLibrary::fill(*model, tracks);
+
+    QBENCHMARK {
+        model->appendTrack(TestLibrary::paths(1, model->count()).first());
+        QVERIFY(list.saveList());
+    }
+}
+
+void TestBenchmarks::load_data()
+{
+    TestLibrary::addSizes();
+}
+
+void TestBenchmarks::load()
+{ // read on the save pool, then handed to the model LOAD_BATCH rows per event loop pass
+    QFETCH(int, tracks);
+    {
+        ManageList list(nullptr);
+        TestLibrary::fill(*list.getTrack_model(), tracks);
+        QVERIFY(list.saveList());
+    }
+
+    ManageList list(nullptr);
+    int loaded_tracks = 0;
+    QBENCHMARK {
+        QSignalSpy loaded(&list, &ManageList::listLoaded);
+        list.loadListAsync();
+        QVERIFY(loaded.wait(BENCH_LOAD_TIMEOUT));
+        QVERIFY(loaded.first().first().toBool());
+        loaded_tracks = list.getTrack_model()->count();
+    }
+    QCOMPARE(loaded_tracks, tracks);
+}
+
+void TestBenchmarks::queueNext_data()
+{
+    addQueueRows();
+}
+
+void TestBenchmarks::queueNext()
+{
+    QFETCH(PQ::PlayMode, mode);
+    QFETCH(int, tracks);
+    TrackModel model;
+    TestLibrary::fill(model, tracks);
+    PlayQueue queue(&model);
+    queue.setPlayMode(mode);
+    queue.updatePlayingQueue(0);
+    queue.setCurrent_item_row(0);
+
+    QBENCHMARK {
+        queue.setCurrent_item_row(model.rowOf(queue.next()));
+    }
+    QVERIFY(queue.current() != TM::InvalidId);
+}
+
+void TestBenchmarks::queuePrevious_data()
+{
+    addQueueRows();
+}
+
+void TestBenchmarks::queuePrevious()
+{ // the history is filled the way playing through the list fills it
+    QFETCH(PQ::PlayMode, mode);
+    QFETCH(int, tracks);
+    TrackModel model;
+    TestLibrary::fill(model, tracks);
+    PlayQueue queue(&model);
+    queue.setPlayMode(mode);
+    queue.updatePlayingQueue(0);
+    queue.setCurrent_item_row(0);
+    for (int step = 0; step < PQ::HistorySize; step++)
+        queue.setCurrent_item_row(model.rowOf(queue.next()));
+
+    QBENCHMARK {
+        queue.setCurrent_item_row(model.rowOf(queue.previous()));
+    }
+    QVERIFY(queue.current() != TM::InvalidId);
+}
+
+void TestBenchmarks::switchTrack_data()
+{
+    QTest::addColumn<PB::Engine>("audio_engine");
+    QTest::newRow("multimedia") << PB::Multimedia;
+    QTest::newRow("pipeline") << PB::Pipeline;
+}
+
+void TestBenchmarks::switchTrack()
+{
+    QFETCH(PB::Engine, audio_engine);
+    QStringList files;
+    for (int file = 0; file < BENCH_SWITCH_FILES; file++)
+    {
+        QString file_path = work_dir.filePath(QString("switch_%1.wav").arg(file));
+        if (!QFile::exists(file_path))
+            QVERIFY(TestLibrary::writeWav(file_path, BENCH_WAV_MS, 220.0 * (file + 1)));
+        files.append(file_path);
+    }
+
+    PlayerEngine engine;
+    engine.setAudioEngine(audio_engine, engine.getOutput_buffer_ms(), engine.getOutput_period_ms());
+    // the switch is timed, not heard
+    engine.setMuted(true);
+    engine.playFile(files.first());
+    if (!QTest::qWaitFor([&engine]() { return engine.position() > 0; }, BENCH_TIMEOUT))
+        QSKIP("nothing played, is there an audio device?");
+
+    int next_file = 1;
+    QBENCHMARK {
+        engine.playFile(files[next_file++ % files.size()]);
+        QTRY_VERIFY_WITH_TIMEOUT(engine.position() > 0, BENCH_TIMEOUT);
+    }
+    engine.stop();
+}
+
+// private
+
+QDir TestBenchmarks::importDir(int files)
+{ // made once per size, later runs find the files in the disk cache
+    QDir import_dir(work_dir.filePath(QString("import_%1").arg(files)));
+    if (import_dir.exists()) return import_dir;
+    for (int file = 0; file < files; file++)
+    {
+        QString sub_dir = QString("dir_%1").arg(file / BENCH_DIR_FILES);
+        if (file % BENCH_DIR_FILES == 0) import_dir.mkpath(sub_dir);
+        if (!TestLibrary::writeWav(import_dir.filePath(QString("%1/track_%2.wav").arg(sub_dir).arg(file)), 0, 0.0))
+            return QDir(work_dir.filePath("missing"));
+    }
+    return import_dir;
+}
+
+void TestBenchmarks::addQueueRows()
+{
+    QTest::addColumn<PQ::PlayMode>("mode");
+    QTest::addColumn<int>("tracks");
+    const QList<QPair<const char*, PQ::PlayMode>> modes {
+        {"order", PQ::PlayMode::Order}, {"single", PQ::PlayMode::Single}, {"shuffle", PQ::PlayMode::Shuffle}};
+    for (const auto& mode : modes)
+        for (int tracks : TestLibrary::defaultSizes())
+            QTest::addRow("%s %s", mode.first, qPrintable(TestLibrary::sizeTag(tracks))) << mode.second << tracks;
+}
+
+BENCH_GUILESS_MAIN(TestBenchmarks)
+#include "tst_benchmarks.moc"
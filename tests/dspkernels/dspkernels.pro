@@ -0,0 +1,6 @@
+TARGET = tst_dspkernels
+
+include(../tests.pri)
+
+SOURCES += \
+    tst_dspkernels.cpp
@@ -0,0 +1,263 @@
+#include <QtTest>
+#include <QVector>
+#include <QRandomGenerator>
+#include <cstring>
+#include "benchmain.h"
+#include "testlibrary.h"
+#include "dspkernels.h"
+
+Q_DECLARE_METATYPE(DK::FadeCurve)
+
+// the sample kernels, results checked against plain loops and their rates measured
+// sizes are interleaved stereo frames, the layout AudioPipeline renders
+class TestDspKernels : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // every 16 bit value comes back unchanged
+    void int16Unity();
+    // the vector body and the scalar tail clamp and round alike
+    void floatToInt16Rounding();
+    void floatToInt16Rate_data();
+    void floatToInt16Rate();
+    void int16ToFloatRate_data();
+    void int16ToFloatRate();
+    // replay gain and volume with the true-peak limiter
+    // unity gain below the ceiling is bit-exact, above it no sample passes the ceiling
+    void gainLimitUnity();
+    void gainLimitCeiling();
+    void gainLimitRate_data();
+    void gainLimitRate();
+    // the crossfade mix, per output frame
+    void mixRampRate_data();
+    void mixRampRate();
+    void crossfadeRate_data();
+    void crossfadeRate();
+    // the waveform peak reduction, checked against a plain loop at every length and offset
+    void minMax();
+    void minMaxRate_data();
+    void minMaxRate();
+
+private:
+    static void addFrames();
+    static QVector<float> noise(int samples, quint32 seed);
+};
+
+void TestDspKernels::int16Unity()
+{
+    QVector<qint16> in(65536);
+    for (int idx = 0; idx < in.size(); idx++)
+        in[idx] = static_cast<qint16>(idx - 32768);
+    QVector<float> samples(in.size());
+    QVector<qint16> out(in.size());
+    DspKernels::int16ToFloat(samples.data(), in.constData(), in.size());
+    DspKernels::floatToInt16(out.data(), samples.constData(), samples.size());
+    QCOMPARE(out, in);
+}
+
+void TestDspKernels::floatToInt16Rounding()
+{ // halfway values, full scale and beyond, at every offset so each lands in both paths
+    QVector<float> in;
+    for (int half = -8; half < 8; half++)
+        in.append((half + 0.5f) / DK::Int16Scale);
+    in << 1.0f << -1.0f << 2.0f << -2.0f << 1e30f << -1e30f << 0.99999f << -0.99999f << 0.0f;
+
+    QVector<qint16> expected(in.size());
+    for (int idx = 0; idx < in.size(); idx++)
+        DspKernels::floatToInt16(expected.data() + idx, in.constData() + idx, 1);
+    QCOMPARE(expected[0], qint16(-8));
+    QCOMPARE(expected[1], qint16(-6));
+    QCOMPARE(expected[16], qint16(32767));
+    QCOMPARE(expected[17], qint16(-32768));
+    QCOMPARE(expected[20], qint16(32767));
+    QCOMPARE(expected[21], qint16(-32768));
+
+    for (int offset = 0; offset < 8; offset++)
+    {
+        QVector<qint16> out(in.size() - offset);
+        DspKernels::floatToInt16(out.data(), in.constData() + offset, out.size());
+        QCOMPARE(out, expected.mid(offset));
+    }
+}
+
+void TestDspKernels::floatToInt16Rate_data()
+{
+    addFrames();
+}
+
+void TestDspKernels::floatToInt16Rate()
+{
+    QFETCH(int, frames);
+    QVector<float> in = noise(frames * 2, 1);
+    QVector<qint16> out(in.size());
+    TestLibrary::measureRate(frames, [&]() { DspKernels::floatToInt16(out.data(), in.constData(), in.size()); });
+}
+
+void TestDspKernels::int16ToFloatRate_data()
+{
+    addFrames();
+}
+
+void TestDspKernels::int16ToFloatRate()
+{
+    QFETCH(int, frames);
+    QVector<qint16> in(frames * 2);
+    DspKernels::floatToInt16(in.data(), noise(in.size(), 2).constData(), in.size());
+    QVector<float> out(in.size());
+    TestLibrary::measureRate(frames, [&]() { DspKernels::int16ToFloat(out.data(), in.constData(), in.size()); });
+}
+
+void TestDspKernels::gainLimitUnity()
+{ // odd block lengths so the history carries over mid-block, mono and stereo
+    for (int channels : {1, 2})
+    {
+        QVector<float> in = noise(10007 * channels, 9);
+        for (float& sample : in)
+            sample *= 0.5f;
+        QVector<float> out = in;
+        DK::LimiterState state;
+        for (int done = 0, block = 1; done < 10007; done += block, block = block * 3 % 97 + 1)
+        {
+            block = qMin(block, 10007 - done);
+            DspKernels::gainLimit(out.data() + done * channels, block, channels, 1.0f, 0.99f, state);
+        }
+        QCOMPARE(state.reduction, 1.0f);
+        QVERIFY(std::memcmp(out.constData(), in.constData(), sizeof(float) * in.size()) == 0);
+    }
+}
+
+void TestDspKernels::gainLimitCeiling()
+{
+    QVector<float> buf = noise(4096 * 2, 10);
+    DK::LimiterState state;
+    DspKernels::gainLimit(buf.data(), 4096, 2, 4.0f, 0.9f, state);
+    QVERIFY(state.reduction < 1.0f);
+    for (float sample : buf)
+        QVERIFY(qAbs(sample) <= 0.9f * 1.0001f);
+}
+
+void TestDspKernels::gainLimitRate_data()
+{
+    QTest::addColumn<bool>("limiting");
+    QTest::addColumn<int>("frames");
+    for (bool limiting : {false, true})
+        for (int frames : {480, 4096, 1048576})
+            QTest::addRow("%s %d", limiting ? "limiting" : "unity", frames) << limiting << frames;
+}
+
+void TestDspKernels::gainLimitRate()
+{ // the limiting rows copy the input back every run, or the buffer would fade towards nothing
+    QFETCH(bool, limiting);
+    QFETCH(int, frames);
+    QVector<float> in = noise(frames * 2, 11);
+    for (float& sample : in)
+        sample *= 0.5f;
+    QVector<float> buf = in;
+    DK::LimiterState state;
+    const float gain = limiting ? 2.0f : 1.0f;
+    TestLibrary::measureRate(frames, [&]() {
+        if (limiting) std::memcpy(buf.data(), in.constData(), sizeof(float) * in.size());
+        DspKernels::gainLimit(buf.data(), frames, 2, gain, 0.9f, state);
+    });
+    QCOMPARE(state.reduction < 1.0f, limiting);
+}
+
+void TestDspKernels::mixRampRate_data()
+{
+    addFrames();
+}
+
+void TestDspKernels::mixRampRate()
+{
+    QFETCH(int, frames);
+    QVector<float> from = noise(frames * 2, 3);
+    QVector<float> to = noise(frames * 2, 4);
+    QVector<float> out(from.size());
+    const float step = 1.0f / frames;
+    TestLibrary::measureRate(frames, [&]() {
+        DspKernels::mixRamp(out.data(), from.constData(), to.constData(), frames, 2, 1.0f, -step, 0.0f, step);
+    });
+}
+
+void TestDspKernels::crossfadeRate_data()
+{
+    QTest::addColumn<DK::FadeCurve>("curve");
+    QTest::addColumn<int>("frames");
+    const QList<QPair<const char*, DK::FadeCurve>> curves {{"linear", DK::Linear}, {"equal power", DK::EqualPower}};
+    for (const auto& curve : curves)
+        for (int frames : {480, 4096, 1048576})
+            QTest::addRow("%s %d", curve.first, frames) << curve.second << frames;
+}
+
+void TestDspKernels::crossfadeRate()
+{ // the whole fade in one call, as many curve segments as it takes
+    QFETCH(DK::FadeCurve, curve);
+    QFETCH(int, frames);
+    QVector<float> from = noise(frames * 2, 5);
+    QVector<float> to = noise(frames * 2, 6);
+    QVector<float> out(from.size());
+    TestLibrary::measureRate(frames, [&]() {
+        DspKernels::crossfade(out.data(), from.constData(), to.constData(), frames, 2, 0, frames, curve, 0.9f, 1.1f);
+    });
+}
+
+void TestDspKernels::minMax()
+{
+    QVector<float> in = noise(100, 7);
+    for (int first = 0; first < 4; first++)
+    {
+        for (int samples = 0; first + samples <= in.size(); samples++)
+        {
+            float lo = 0.5f;
+            float hi = -0.5f;
+            DspKernels::minMax(in.constData() + first, samples, lo, hi);
+            float expected_lo = 0.5f;
+            float expected_hi = -0.5f;
+            for (int idx = first; idx < first + samples; idx++)
+            {
+                expected_lo = qMin(expected_lo, in[idx]);
+                expected_hi = qMax(expected_hi, in[idx]);
+            }
+            QCOMPARE(lo, expected_lo);
+            QCOMPARE(hi, expected_hi);
+        }
+    }
+}
+
+void TestDspKernels::minMaxRate_data()
+{
+    addFrames();
+}
+
+void TestDspKernels::minMaxRate()
+{
+    QFETCH(int, frames);
+    QVector<float> in = noise(frames * 2, 8);
+    float lo = 0.0f;
+    float hi = 0.0f;
+    TestLibrary::measureRate(frames, [&]() { DspKernels::minMax(in.constData(), in.size(), lo, hi); });
+    QVERIFY(lo < hi);
+}
+
+// private
+
+void TestDspKernels::addFrames()
+{ // an output period, a decoded buffer and more than the caches hold
+    QTest::addColumn<int>("frames");
+    QTest::newRow("480") << 480;
+    QTest::newRow("4096") << 4096;
+    QTest::newRow("1M") << 1048576;
+}
+
+QVector<float> TestDspKernels::noise(int samples, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QVector<float> out(samples);
+    for (float& sample : out)
+        sample = static_cast<float>(random.bounded(2.0) - 1.0);
+    return out;
+}
+
+BENCH_GUILESS_MAIN(TestDspKernels)
+#include "tst_dspkernels.moc"
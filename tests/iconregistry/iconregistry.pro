@@ -0,0 +1,9 @@
+TARGET = tst_iconregistry
+
+include(../tests.pri)
+
+SOURCES += \
+    tst_iconregistry.cpp
+
+RESOURCES += \
+    ../../icons.qrc
@@ -0,0 +1,106 @@
+#include <QtTest>
+#include <QListWidget>
+#include <QToolButton>
+#include <QAction>
+#include <QLabel>
+#include <memory>
+#include "benchmain.h"
+#include "testlibrary.h"
+#include "iconregistry.h"
+
+// icons taken from the registry against icons made from their resource path every time,
+// the way the list and the window used to
+class TestIconRegistry : public QObject
+{
+    Q_OBJECT
+    #define ICON_ITEMS 100000
+    #define ICON_SIZE 24
+
+private slots:
+    void initTestCase();
+
+    // what a track change puts on screen: the play button, the play action and the cover
+    void trackChange_data();
+    void trackChange();
+    // heap held by ICON_ITEMS list items with their icon
+    void itemMemory_data();
+    void itemMemory();
+
+private:
+    static void addSourceRows();
+};
+
+void TestIconRegistry::initTestCase()
+{
+    IconRegistry::preload();
+    QVERIFY(!IconRegistry::icon(IR::TrackIcon).isNull());
+    QVERIFY(!IconRegistry::pixmap(IR::MusicNote).isNull());
+}
+
+void TestIconRegistry::trackChange_data()
+{
+    addSourceRows();
+}
+
+void TestIconRegistry::trackChange()
+{ // the icons are drawn at button size, as painting the button would
+    QFETCH(bool, registry);
+    QToolButton play_button;
+    QAction play_action;
+    QLabel cover;
+    bool playing = false;
+    QBENCHMARK {
+        playing = !playing;
+        if (registry)
+        {
+            play_button.setIcon(IconRegistry::icon(playing ? IR::PauseButton : IR::PlayButton));
+            play_action.setIcon(IconRegistry::icon(playing ? IR::Pause : IR::Play));
+            cover.setPixmap(IconRegistry::pixmap(IR::MusicNote));
+        }
+        else
+        {
+            play_button.setIcon(QIcon(playing ? ":/icons/res/pause_w.png" : ":/icons/res/play_w.png"));
+            play_action.setIcon(QIcon(playing ? ":icons/res/pause.png" : ":icons/res/play.png"));
+            cover.setPixmap(QPixmap(":icons/res/musical_notec.png"));
+        }
+        QVERIFY(!play_button.icon().pixmap(ICON_SIZE).isNull());
+        QVERIFY(!play_action.icon().pixmap(ICON_SIZE).isNull());
+    }
+}
+
+void TestIconRegistry::itemMemory_data()
+{
+    addSourceRows();
+}
+
+void TestIconRegistry::itemMemory()
+{
+    QFETCH(bool, registry);
+    if (TestLibrary::heapBytes() < 0) QSKIP("the allocator can't be asked on this platform");
+    const QStringList file_paths = TestLibrary::paths(ICON_ITEMS);
+
+    qint64 before = TestLibrary::heapBytes();
+    std::unique_ptr<QListWidget> list(new QListWidget);
+    for (const QString& file_path : file_paths)
+    {
+        QListWidgetItem* item = new QListWidgetItem;
+        item->setIcon(registry ? IconRegistry::icon(IR::TrackIcon) : QIcon(":/icons/res/music_notec2.png"));
+        item->setText(file_path.mid(file_path.lastIndexOf('/') + 1));
+        item->setData(Qt::UserRole, file_path);
+        list->addItem(item);
+    }
+    QCOMPARE(list->count(), ICON_ITEMS);
+    QTest::setBenchmarkResult(TestLibrary::heapBytes() - before, QTest::BytesAllocated);
+}
+
+// private
+
+void TestIconRegistry::addSourceRows()
+{
+    QTest::addColumn<bool>("registry");
+    QTest::newRow("from path") << false;
+    QTest::newRow("registry") << true;
+}
+
+BENCH_MAIN(TestIconRegistry)
+#include "tst_iconregistry.moc"
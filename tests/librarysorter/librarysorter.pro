@@ -0,0 +1,6 @@
+TARGET = tst_librarysorter
+
+include(../tests.pri)
+
+SOURCES += \
+    tst_librarysorter.cpp
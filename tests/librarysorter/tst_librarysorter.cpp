@@ -0,0 +1,117 @@
+#include <QtTest>
+#include <QSignalSpy>
+#include <memory>
+#include "benchmain.h"
+#include "testlibrary.h"
+#include "trackmodel.h"
+#include "librarysorter.h"
+
+Q_DECLARE_METATYPE(TM::SortField)
+
+// sorting the library by every field, from the snapshot ManageList hands over to the new order
+// the first sort makes the collation keys, later ones find them cached
+class TestLibrarySorter : public QObject
+{
+    Q_OBJECT
+    #define SORT_TIMEOUT 60000
+
+private slots:
+    void initTestCase();
+
+    void firstSort_data();
+    void firstSort();
+    void cachedSort_data();
+    void cachedSort();
+
+private:
+    // one library per size, filled once
+    QHash<int, std::shared_ptr<TrackModel>> models;
+
+    static void addSortRows();
+    TM::TrackTable library(int tracks);
+    // runs a sort and waits for its result, the ids in the new order
+    static QVector<TM::TrackId> sortWith(LibrarySorter& sorter, const TM::TrackTable& table, TM::SortField field);
+};
+
+void TestLibrarySorter::initTestCase()
+{
+    qRegisterMetaType<QVector<TM::TrackId>>();
+}
+
+void TestLibrarySorter::firstSort_data()
+{
+    addSortRows();
+}
+
+void TestLibrarySorter::firstSort()
+{
+    QFETCH(TM::SortField, field);
+    QFETCH(int, tracks);
+    TM::TrackTable table = library(tracks);
+    QVector<TM::TrackId> ids;
+    QBENCHMARK_ONCE {
+        LibrarySorter sorter;
+        ids = sortWith(sorter, table, field);
+    }
+    QCOMPARE(ids.size(), tracks);
+}
+
+void TestLibrarySorter::cachedSort_data()
+{
+    addSortRows();
+}
+
+void TestLibrarySorter::cachedSort()
+{
+    QFETCH(TM::SortField, field);
+    QFETCH(int, tracks);
+    TM::TrackTable table = library(tracks);
+    LibrarySorter sorter;
+    QCOMPARE(sortWith(sorter, table, field).size(), tracks);
+
+    QVector<TM::TrackId> ids;
+    QBENCHMARK {
+        ids = sortWith(sorter, table, field);
+    }
+    QCOMPARE(ids.size(), tracks);
+    if (field != TM::SortByDuration) return;
+    // the one order that is easy to check from here
+    TrackModel& model = *models[tracks];
+    for (int idx = 1; idx < ids.size(); idx++)
+        QVERIFY(model.trackInfo(model.rowOf(ids[idx - 1])).duration_ms <= model.trackInfo(model.rowOf(ids[idx])).duration_ms);
+}
+
+// private
+
+void TestLibrarySorter::addSortRows()
+{
+    QTest::addColumn<TM::SortField>("field");
+    QTest::addColumn<int>("tracks");
+    const QList<QPair<const char*, TM::SortField>> fields {
+        {"title", TM::SortByTitle}, {"artist", TM::SortByArtist}, {"album", TM::SortByAlbum},
+        {"path", TM::SortByPath}, {"duration", TM::SortByDuration}, {"date added", TM::SortByDateAdded}};
+    for (const auto& field : fields)
+        for (int tracks : {100000, 1000000})
+            QTest::addRow("%s %s", field.first, qPrintable(TestLibrary::sizeTag(tracks))) << field.second << tracks;
+}
+
+TM::TrackTable TestLibrarySorter::library(int tracks)
+{
+    auto found = models.constFind(tracks);
+    if (found != models.constEnd()) return found.value()->snapshot();
+    std::shared_ptr<TrackModel> model(new TrackModel);
+    TestLibrary::fill(*model, tracks);
+    models.insert(tracks, model);
+    return model->snapshot();
+}
+
+QVector<TM::TrackId> TestLibrarySorter::sortWith(LibrarySorter &sorter, const TM::TrackTable &table, TM::SortField field)
+{
+    QSignalSpy spy(&sorter, &LibrarySorter::sorted);
+    sorter.sort(table, field, false);
+    if (!spy.wait(SORT_TIMEOUT)) return {};
+    return spy.first().first().value<QVector<TM::TrackId>>();
+}
+
+BENCH_GUILESS_MAIN(TestLibrarySorter)
+#include "tst_librarysorter.moc"
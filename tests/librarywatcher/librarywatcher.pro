@@ -0,0 +1,6 @@
+TARGET = tst_librarywatcher
+
+include(../tests.pri)
+
+SOURCES += \
+    tst_librarywatcher.cpp
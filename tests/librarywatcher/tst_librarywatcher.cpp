@@ -0,0 +1,188 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <memory>
+#include "benchmain.h"
+#include "testlibrary.h"
+#include "trackmodel.h"
+#include "librarywatcher.h"
+
+// files changed on disk under a watched root, the deltas applied the way ManageList::applyDelta does
+class TestLibraryWatcher : public QObject
+{
+    Q_OBJECT
+    #define WATCH_TIMEOUT 5000
+    #define WATCH_SETTLE (3 * WATCH_DEBOUNCE)
+
+private slots:
+    void init();
+    void cleanup();
+
+    // a rename in place keeps the track
+    void rename();
+    // so does a move into another directory, both are listed in one batch
+    void moveAcrossDirectories();
+    // a new file that got a removed track's inode but not its size is a new track
+    void inodeReuse();
+    // a root that disappears is taken for an unmounted drive, its tracks stay
+    void missingRoot();
+
+private:
+    std::unique_ptr<QTemporaryDir> work_dir;
+    std::unique_ptr<TrackModel> model;
+    std::unique_ptr<LibraryWatcher> watcher;
+    QString root;
+    int batches;
+
+    void startWatching(const QStringList& roots);
+    void apply(const LW::Delta& delta);
+    QString addFile(const QString& name, int ms = 100);
+    TM::TrackId idOf(const QString& name) const;
+};
+
+void TestLibraryWatcher::init()
+{
+    work_dir.reset(new QTemporaryDir);
+    QVERIFY(work_dir->isValid());
+    // the watcher works on canonical paths
+    root = QFileInfo(work_dir->path()).canonicalFilePath();
+    model.reset(new TrackModel);
+    watcher.reset(new LibraryWatcher(model.get()));
+    connect(watcher.get(), &LibraryWatcher::changed, this, &TestLibraryWatcher::apply);
+    batches = 0;
+}
+
+void TestLibraryWatcher::cleanup()
+{
+    watcher.reset();
+    model.reset();
+    work_dir.reset();
+}
+
+void TestLibraryWatcher::rename()
+{
+    addFile("a/one.wav");
+    addFile("a/two.wav");
+    startWatching({root});
+    TM::TrackId id = idOf("a/one.wav");
+    QVERIFY(id != TM::InvalidId);
+
+    int seen = batches;
+    QVERIFY(QFile::rename(root + "/a/one.wav", root + "/a/uno.wav"));
+    QTRY_VERIFY_WITH_TIMEOUT(batches > seen, WATCH_TIMEOUT);
+    QCOMPARE(model->count(), 2);
+    QCOMPARE(idOf("a/uno.wav"), id);
+    QCOMPARE(idOf("a/one.wav"), TM::InvalidId);
+}
+
+void TestLibraryWatcher::moveAcrossDirectories()
+{
+    addFile("a/one.wav");
+    addFile("b/two.wav");
+    startWatching({root});
+    TM::TrackId id = idOf("a/one.wav");
+    QVERIFY(id != TM::InvalidId);
+
+    int seen = batches;
+    QVERIFY(QFile::rename(root + "/a/one.wav", root + "/b/one.wav"));
+    QTRY_VERIFY_WITH_TIMEOUT(batches > seen && model->rowOf(id) >= 0 && idOf("b/one.wav") == id, WATCH_TIMEOUT);
+    QCOMPARE(model->count(), 2);
+    QCOMPARE(idOf("a/one.wav"), TM::InvalidId);
+}
+
+void TestLibraryWatcher::inodeReuse()
+{
+    if (!LibraryWatcher::fileInode(addFile("a/probe.wav"))) QSKIP("no inodes on this platform");
+    QString old_path = addFile("a/old.wav", 100);
+    startWatching({root});
+    TM::TrackId old_id = idOf("a/old.wav");
+    QVERIFY(old_id != TM::InvalidId);
+    // the tags were read, so the watcher knows the old file's size
+    TM::TrackInfo info;
+    info.file_size = QFileInfo(old_path).size();
+    model->setTrackInfo({old_id}, {info});
+
+    // the file system handing the freed number out again can't be forced, so the new file's
+    // inode is recorded for the old track, before the batch is started
+    int seen = batches;
+    QVERIFY(QFile::remove(old_path));
+    QString new_path = addFile("a/new.wav", 300);
+    QVERIFY(QFileInfo(new_path).size() != info.file_size);
+    watcher->recordInode(old_id, LibraryWatcher::fileInode(new_path));
+
+    QTRY_VERIFY_WITH_TIMEOUT(batches > seen && idOf("a/new.wav") != TM::InvalidId, WATCH_TIMEOUT);
+    QCOMPARE(model->rowOf(old_id), -1);
+    QVERIFY(idOf("a/new.wav") != old_id);
+}
+
+void TestLibraryWatcher::missingRoot()
+{
+    QString drive = root + "/drive";
+    QString local = root + "/local";
+    addFile("drive/one.wav");
+    addFile("drive/sub/two.wav");
+    addFile("local/three.wav");
+    // a root that is not there to begin with is left alone
+    startWatching({drive, local, root + "/not_mounted"});
+    QCOMPARE(model->count(), 3);
+
+    QVERIFY(QDir(drive).removeRecursively());
+    QTest::qWait(WATCH_SETTLE);
+    QCOMPARE(model->count(), 3);
+    QVERIFY(idOf("drive/sub/two.wav") != TM::InvalidId);
+
+    // the other root is still followed
+    int seen = batches;
+    QVERIFY(QFile::remove(root + "/local/three.wav"));
+    QTRY_VERIFY_WITH_TIMEOUT(batches > seen, WATCH_TIMEOUT);
+    QCOMPARE(model->count(), 2);
+    QCOMPARE(idOf("local/three.wav"), TM::InvalidId);
+}
+
+// private
+
+void TestLibraryWatcher::startWatching(const QStringList &roots)
+{ // the first batch lists the roots in full and imports what is there
+    int files = 0;
+    for (const QString& watched : roots)
+    {
+        QDirIterator iter(watched, {"*.wav"}, QDir::Files, QDirIterator::Subdirectories);
+        while (iter.hasNext())
+        {
+            iter.next();
+            files++;
+        }
+    }
+    watcher->watch(roots, {"wav"});
+    QTRY_COMPARE_WITH_TIMEOUT(model->count(), files, WATCH_TIMEOUT);
+    // the directories are watched once the batch is done, let it settle
+    QTest::qWait(WATCH_SETTLE);
+}
+
+void TestLibraryWatcher::apply(const LW::Delta &delta)
+{
+    model->removeTracks(delta.removed_ids);
+    model->moveTracks(delta.moved_ids, delta.moved_paths);
+    model->appendNewTracks(delta.added_paths, delta.added_fingerprints);
+    for (int idx = 0; idx < delta.added_paths.size(); idx++)
+        if (delta.added_inodes[idx]) watcher->recordInode(model->idOfPath(delta.added_paths[idx]), delta.added_inodes[idx]);
+    batches++;
+}
+
+QString TestLibraryWatcher::addFile(const QString &name, int ms)
+{
+    QString file_path = root + "/" + name;
+    QDir().mkpath(QFileInfo(file_path).absolutePath());
+    if (!TestLibrary::writeWav(file_path, ms, 440.0)) return QString();
+    return file_path;
+}
+
+TM::TrackId TestLibraryWatcher::idOf(const QString &name) const
+{
+    return model->idOfPath(root + "/" + name);
+}
+
+BENCH_GUILESS_MAIN(TestLibraryWatcher)
+#include "tst_librarywatcher.moc"
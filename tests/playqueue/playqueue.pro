@@ -0,0 +1,6 @@
+TARGET = tst_playqueue
+
+include(../tests.pri)
+
+SOURCES += \
+    tst_playqueue.cpp
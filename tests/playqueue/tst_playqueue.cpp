@@ -0,0 +1,225 @@
+#include <QtTest>
+#include <QMap>
+#include <algorithm>
+#include <memory>
+#include "benchmain.h"
+#include "testlibrary.h"
+#include "trackmodel.h"
+#include "playqueue.h"
+
+Q_DECLARE_METATYPE(PQ::PlayMode)
+
+// shuffle is walked through whole rounds on lists with and without removals behind them
+class TestPlayQueue : public QObject
+{
+    Q_OBJECT
+    #define SHUFFLE_SEEDS 4000
+    #define SHUFFLE_TRACKS 16
+    // chi-square for p = 0.001 at SHUFFLE_TRACKS - 1 degrees of freedom
+    #define SHUFFLE_CHI_SQUARE 37.7
+    #define QUEUE_TRACKS 1000000
+
+private slots:
+    // every track comes up exactly once in each round
+    void shuffleRounds_data();
+    void shuffleRounds();
+    // over many seeds a round starts on every track about as often
+    void shuffleFirstTrack();
+    // removing tracks drops them from the queues, everything else stays queued
+    void removalPatchesQueue();
+    // a step on a 1M track list, O(1) whatever the mode
+    void nextStep_data();
+    void nextStep();
+    void previousStep_data();
+    void previousStep();
+
+private:
+    std::unique_ptr<TrackModel> big_model;
+
+    static void addStepRows();
+    TrackModel& bigModel();
+    // the queue the way PlayerEngine leaves it after playing through history_steps tracks
+    static void startQueue(PlayQueue& queue, PQ::PlayMode mode, bool user_queue, int history_steps);
+    // tracks imported, all but kept removed, spread over the list
+    static void churn(TrackModel& model, int tracks, int kept);
+    static QVector<TM::TrackId> liveIds(const TrackModel& model);
+};
+
+void TestPlayQueue::shuffleRounds_data()
+{
+    QTest::addColumn<int>("tracks");
+    QTest::addColumn<int>("kept");
+    QTest::addColumn<int>("added");
+    QTest::newRow("fresh") << 300 << 300 << 0;
+    QTest::newRow("few removed") << 300 << 250 << 0;
+    QTest::newRow("most removed") << 2000 << 60 << 0;
+    QTest::newRow("most removed, then imported") << 2000 << 60 << 40;
+}
+
+void TestPlayQueue::shuffleRounds()
+{
+    QFETCH(int, tracks);
+    QFETCH(int, kept);
+    QFETCH(int, added);
+    TrackModel model;
+    churn(model, tracks, kept);
+    PlayQueue queue(&model);
+    queue.setShuffle_seed(7);
+    queue.setPlayMode(PQ::Shuffle);
+    queue.setCurrent_item_row(0);
+    QVERIFY(queue.next() != TM::InvalidId);
+    // imported after the shuffle has settled on its slots
+    model.appendTracks(TestLibrary::paths(added, tracks));
+    const QVector<TM::TrackId> live = liveIds(model);
+
+    QMap<quint32, QVector<TM::TrackId>> rounds;
+    for (int step = 0; step < 3 * live.size(); step++)
+    {
+        TM::TrackId id = queue.next();
+        QVERIFY(model.rowOf(id) >= 0);
+        rounds[queue.saveState().shuffle_round].append(id);
+    }
+    // the first round started part way through, the last one is not over
+    QVERIFY(rounds.size() >= 3);
+    for (auto round = std::next(rounds.begin()); round != std::prev(rounds.end()); ++round)
+    {
+        QVector<TM::TrackId> played = round.value();
+        std::sort(played.begin(), played.end());
+        QCOMPARE(played, live);
+    }
+}
+
+void TestPlayQueue::shuffleFirstTrack()
+{
+    TrackModel model;
+    churn(model, SHUFFLE_TRACKS * 4, SHUFFLE_TRACKS);
+    PlayQueue queue(&model);
+    queue.setPlayMode(PQ::Shuffle);
+
+    QVector<int> first(SHUFFLE_TRACKS, 0);
+    for (int seed = 0; seed < SHUFFLE_SEEDS; seed++)
+    {
+        queue.setShuffle_seed(seed);
+        queue.setCurrent_item_row(0);
+        TM::TrackId id = TM::InvalidId;
+        do {
+            id = queue.next();
+        } while (queue.saveState().shuffle_round == 0);
+        QVERIFY(model.rowOf(id) >= 0);
+        first[model.rowOf(id)]++;
+    }
+
+    const double expected = double(SHUFFLE_SEEDS) / SHUFFLE_TRACKS;
+    double chi_square = 0.0;
+    for (int count : first)
+        chi_square += (count - expected) * (count - expected) / expected;
+    if (chi_square >= SHUFFLE_CHI_SQUARE) qWarning() << "first tracks" << first;
+    QVERIFY2(chi_square < SHUFFLE_CHI_SQUARE, qPrintable(QString("chi-square %1").arg(chi_square)));
+}
+
+void TestPlayQueue::removalPatchesQueue()
+{
+    TrackModel model;
+    model.appendTracks(TestLibrary::paths(100));
+    PlayQueue queue(&model);
+    queue.setCurrent_item_row(10);
+    queue.addToUserQueue({model.idAt(50), model.idAt(60), model.idAt(70)});
+    TM::TrackId current = queue.current();
+
+    model.removeTracks({model.idAt(5), model.idAt(60)});
+    QCOMPARE(queue.current(), current);
+    QCOMPARE(queue.next(), model.idAt(49));
+    QCOMPARE(queue.next(), model.idAt(68));
+    QCOMPARE(queue.previous(), model.idAt(49));
+}
+
+void TestPlayQueue::nextStep_data()
+{
+    addStepRows();
+}
+
+void TestPlayQueue::nextStep()
+{
+    QFETCH(PQ::PlayMode, mode);
+    QFETCH(bool, user_queue);
+    PlayQueue queue(&bigModel());
+    startQueue(queue, mode, user_queue, 0);
+    QBENCHMARK {
+        TM::TrackId id = queue.next();
+        QVERIFY(id != TM::InvalidId);
+        // kept full, so every step is taken from it
+        if (user_queue) queue.addToUserQueue({id});
+    }
+}
+
+void TestPlayQueue::previousStep_data()
+{
+    addStepRows();
+}
+
+void TestPlayQueue::previousStep()
+{ // through the history first, then back past it
+    QFETCH(PQ::PlayMode, mode);
+    QFETCH(bool, user_queue);
+    PlayQueue queue(&bigModel());
+    startQueue(queue, mode, user_queue, PQ::HistorySize);
+    QBENCHMARK {
+        QVERIFY(queue.previous() != TM::InvalidId);
+    }
+}
+
+// private
+
+void TestPlayQueue::addStepRows()
+{
+    QTest::addColumn<PQ::PlayMode>("mode");
+    QTest::addColumn<bool>("user_queue");
+    QTest::newRow("order") << PQ::Order << false;
+    QTest::newRow("order, user queue") << PQ::Order << true;
+    QTest::newRow("single") << PQ::Single << false;
+    QTest::newRow("shuffle") << PQ::Shuffle << false;
+}
+
+TrackModel &TestPlayQueue::bigModel()
+{ // made once, every step benchmark walks the same list
+    if (!big_model)
+    {
+        big_model = std::unique_ptr<TrackModel>(new TrackModel);
+        big_model->appendTracks(TestLibrary::paths(QUEUE_TRACKS));
+    }
+    return *big_model;
+}
+
+void TestPlayQueue::startQueue(PlayQueue &queue, PQ::PlayMode mode, bool user_queue, int history_steps)
+{
+    queue.setShuffle_seed(11);
+    queue.setPlayMode(mode);
+    queue.setCurrent_item_row(QUEUE_TRACKS / 2);
+    queue.updatePlayingQueue(QUEUE_TRACKS / 2 + 1);
+    for (int step = 0; step < history_steps; step++) queue.next();
+    if (!user_queue) return;
+    QList<TM::TrackId> ids;
+    for (int row = 0; row < PQ::QueueSize; row++) ids.append(queue.current() + row + 1);
+    queue.addToUserQueue(ids);
+}
+
+void TestPlayQueue::churn(TrackModel &model, int tracks, int kept)
+{
+    model.appendTracks(TestLibrary::paths(tracks));
+    QList<TM::TrackId> removed;
+    for (int row = 0; row < tracks; row++)
+        if (qint64(row) * kept / tracks == qint64(row + 1) * kept / tracks) removed.append(model.idAt(row));
+    model.removeTracks(removed);
+}
+
+QVector<TM::TrackId> TestPlayQueue::liveIds(const TrackModel &model)
+{
+    QVector<TM::TrackId> ids(model.count());
+    for (int row = 0; row < model.count(); row++)
+        ids[row] = model.idAt(row);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+BENCH_GUILESS_MAIN(TestPlayQueue)
+#include "tst_playqueue.moc"
@@ -0,0 +1,6 @@
+TARGET = tst_searchindex
+
+include(../tests.pri)
+
+SOURCES += \
+    tst_searchindex.cpp
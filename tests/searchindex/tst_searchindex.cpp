@@ -0,0 +1,198 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <limits>
+#include "benchmain.h"
+#include "testlibrary.h"
+#include "managelist.h"
+#include "searchindex.h"
+
+// the index of a 500k track library, queried the way the search box does, one query per keystroke
+// the index is driven on the test thread, the order of calls is what the index thread would see
+// names are made of random syllables, a synthetic library where every track has the same words
+// would make every query hit every track
+class TestSearchIndex : public QObject
+{
+    Q_OBJECT
+    #define SEARCH_TRACKS 500000
+    #define SEARCH_BUDGET_US 5000
+    #define SEARCH_RUNS 5
+
+private slots:
+    void initTestCase();
+
+    // imported, retagged and removed tracks are found, or not, right away
+    void incrementalUpdate();
+    void keystroke_data();
+    void keystroke();
+    // every keystroke that the trigrams can narrow down is answered within the budget,
+    // one and two letter queries go through every track and are only measured
+    void typingBudget();
+    // a ManageList::indexRows batch of new tracks going in and out again
+    void importBatch_data();
+    void importBatch();
+
+private:
+    SearchIndex index;
+    QStringList texts;
+    int serial;
+    QVector<TM::TrackId> last_results;
+    qint64 last_elapsed_us;
+
+    // what ManageList::indexRows hands over for a track
+    static QString trackText(QRandomGenerator& random, int track);
+    static QString name(QRandomGenerator& random, int syllables);
+    // every keystroke of the artist and title of one track
+    QStringList typing() const;
+    QVector<TM::TrackId> search(const QString& query);
+};
+
+void TestSearchIndex::initTestCase()
+{
+    serial = 0;
+    last_elapsed_us = 0;
+    connect(&index, &SearchIndex::resultsReady, this, [this](int, const QVector<TM::TrackId>& ids, qint64 elapsed_us) {
+        last_results = ids;
+        last_elapsed_us = elapsed_us;
+    });
+
+    QRandomGenerator random(42);
+    QVector<TM::TrackId> ids(SEARCH_TRACKS);
+    texts.reserve(SEARCH_TRACKS);
+    for (int track = 0; track < SEARCH_TRACKS; track++)
+    {
+        ids[track] = TM::TrackId(track + 1);
+        texts.append(trackText(random, track));
+    }
+    index.reset(ids, texts);
+}
+
+void TestSearchIndex::incrementalUpdate()
+{
+    const TM::TrackId id = SEARCH_TRACKS + 1;
+    QVERIFY(search("zyxwvu").isEmpty());
+    index.update({id}, {"01 - zyxwvu.flac Zyxwvu Qwerty Asdfgh"});
+    QCOMPARE(search("zyxwvu"), QVector<TM::TrackId>({id}));
+    QCOMPARE(search("qwerty zyx"), QVector<TM::TrackId>({id}));
+
+    // retagged, the old words are gone
+    index.update({id}, {"01 - zyxwvu.flac Zyxwvu Poiuyt Asdfgh"});
+    QVERIFY(search("qwerty").isEmpty());
+    QCOMPARE(search("poiuyt"), QVector<TM::TrackId>({id}));
+
+    index.remove({id});
+    QVERIFY(search("zyxwvu").isEmpty());
+    QVERIFY(search("poiuyt").isEmpty());
+}
+
+void TestSearchIndex::keystroke_data()
+{
+    QTest::addColumn<QString>("query");
+    for (const QString& query : typing())
+        QTest::newRow(qPrintable(query)) << query;
+}
+
+void TestSearchIndex::keystroke()
+{
+    QFETCH(QString, query);
+    QBENCHMARK {
+        search(query);
+    }
+    QVERIFY(!last_results.isEmpty());
+}
+
+void TestSearchIndex::typingBudget()
+{
+    qint64 worst_us = 0;
+    for (const QString& query : typing())
+    {
+        qint64 best_us = std::numeric_limits<qint64>::max();
+        for (int run = 0; run < SEARCH_RUNS; run++)
+        {
+            search(query);
+            best_us = qMin(best_us, last_elapsed_us);
+        }
+        const QStringList words = SearchIndex::normalize(query).split(' ', Qt::SkipEmptyParts);
+        bool indexed = std::any_of(words.cbegin(), words.cend(), [](const QString& word) { return word.size() >= 3; });
+        if (!indexed) continue;
+        worst_us = qMax(worst_us, best_us);
+#ifdef QT_NO_DEBUG
+        // debug builds are too slow to hold to it
+        QVERIFY2(best_us <= SEARCH_BUDGET_US, qPrintable(QString("\"%1\" took %2 us").arg(query).arg(best_us)));
+#endif
+    }
+    QTest::setBenchmarkResult(worst_us / 1000.0, QTest::WalltimeMilliseconds);
+}
+
+void TestSearchIndex::importBatch_data()
+{
+    QTest::addColumn<int>("tracks");
+    QTest::newRow("1") << 1;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("20000") << SEARCH_INDEX_BATCH;
+}
+
+void TestSearchIndex::importBatch()
+{
+    QFETCH(int, tracks);
+    QRandomGenerator random(7);
+    QVector<TM::TrackId> ids(tracks);
+    QStringList batch;
+    for (int track = 0; track < tracks; track++)
+    {
+        ids[track] = TM::TrackId(SEARCH_TRACKS + 10 + track);
+        batch.append(trackText(random, SEARCH_TRACKS + track));
+    }
+    QBENCHMARK {
+        index.update(ids, batch);
+        index.remove(ids);
+    }
+}
+
+// private
+
+QString TestSearchIndex::trackText(QRandomGenerator &random, int track)
+{
+    QString title = name(random, 2) + ' ' + name(random, 3);
+    QString artist = name(random, 2) + ' ' + name(random, 2);
+    QString album = name(random, 3);
+    return QString("%1 - %2.flac").arg(track % 20 + 1, 2, 10, QChar('0')).arg(title)
+            + ' ' + title + ' ' + artist + ' ' + album;
+}
+
+QString TestSearchIndex::name(QRandomGenerator &random, int syllables)
+{
+    static const char* const parts[] = {"ka", "lo", "mi", "ren", "sa", "to", "vel", "dor", "an", "bri",
+                                        "cu", "fen", "gar", "hol", "is", "jun", "mor", "na", "pel", "quo",
+                                        "ri", "sun", "tar", "ul", "vi", "wen", "xa", "yor", "ze", "ost"};
+    const int part_count = sizeof(parts) / sizeof(parts[0]);
+    QString word;
+    for (int syllable = 0; syllable < syllables; syllable++)
+        word += QLatin1String(parts[random.bounded(part_count)]);
+    word[0] = word[0].toUpper();
+    return word;
+}
+
+QStringList TestSearchIndex::typing() const
+{ // the artist and the first word of the title of a track in the middle of the library
+    const QStringList words = texts[SEARCH_TRACKS / 2].split(' ');
+    // "NN", "-", the title in the file name, the title, the artist (two words each), the album
+    QString typed = words[6] + ' ' + words[7] + ' ' + words[4];
+    QStringList queries;
+    for (int length = 1; length <= typed.size(); length++)
+        if (typed[length - 1] != ' ') queries.append(typed.left(length));
+    return queries;
+}
+
+QVector<TM::TrackId> TestSearchIndex::search(const QString &query)
+{
+    serial++;
+    index.setLatest_serial(serial);
+    last_results.clear();
+    index.search(serial, query);
+    std::sort(last_results.begin(), last_results.end());
+    return last_results;
+}
+
+BENCH_GUILESS_MAIN(TestSearchIndex)
+#include "tst_searchindex.moc"
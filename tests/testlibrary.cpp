@@ -0,0 +1,117 @@
+#include "testlibrary.h"
+#include <QtTest>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QtMath>
+#include <QElapsedTimer>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+void TestLibrary::addSizes(const QList<int> &sizes)
+{
+    QTest::addColumn<int>("tracks");
+    for (int tracks : sizes)
+        QTest::newRow(qPrintable(sizeTag(tracks))) << tracks;
+}
+
+QList<int> TestLibrary::defaultSizes()
+{
+    return {1000, 10000, 100000, 1000000};
+}
+
+QString TestLibrary::sizeTag(int tracks)
+{
+    if (tracks >= 1000000 && tracks % 1000000 == 0) return QString("%1M").arg(tracks / 1000000);
+    if (tracks >= 1000 && tracks % 1000 == 0) return QString("%1k").arg(tracks / 1000);
+    return QString::number(tracks);
+}
+
+void TestLibrary::fill(TrackModel &model, int tracks)
+{
+    model.appendTracks(paths(tracks));
+
+    QVector<TM::TrackId> ids(tracks);
+    QVector<TM::TrackInfo> infos(tracks);
+    for (int row = 0; row < tracks; row++)
+    {
+        ids[row] = model.idAt(row);
+        TM::TrackInfo& info = infos[row];
+        info.file_size = 20000000 + row;
+        info.mtime = 1600000000000 + row;
+        info.title = QString("Track %1").arg(row);
+        info.artist = QString("Artist %1").arg(row / 1000);
+        info.album = QString("Album %1").arg(row / 10);
+        info.duration_ms = 180000 + row % 120000;
+        TM::Loudness loudness;
+        loudness.file_size = info.file_size;
+        loudness.mtime = info.mtime;
+        loudness.integrated = -14.0f - row % 10;
+        loudness.true_peak = -1.0f;
+        model.setLoudness(ids[row], loudness);
+    }
+    model.setTrackInfo(ids, infos);
+}
+
+QStringList TestLibrary::paths(int tracks, int first)
+{
+    QStringList file_paths;
+    file_paths.reserve(tracks);
+    for (int track = first; track < first + tracks; track++)
+        file_paths.append(QString("/music/artist_%1/album_%2/%3 - track %4.flac")
+                          .arg(track / 1000).arg(track / 10).arg(track % 10 + 1, 2, 10, QChar('0')).arg(track));
+    return file_paths;
+}
+
+bool TestLibrary::writeWav(const QString &file_path, int ms, double hz)
+{
+    const int sample_rate = 48000;
+    const int channels = 2;
+    quint32 frames = quint32(qint64(ms) * sample_rate / 1000);
+    quint32 data_size = frames * channels * sizeof(qint16);
+
+    QSaveFile wav_file(file_path);
+    if (!wav_file.open(QIODevice::WriteOnly)) return false;
+    QDataStream out(&wav_file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("RIFF", 4);
+    out << quint32(36 + data_size);
+    out.writeRawData("WAVEfmt ", 8);
+    out << quint32(16) << quint16(1) << quint16(channels) << quint32(sample_rate)
+        << quint32(sample_rate * channels * sizeof(qint16)) << quint16(channels * sizeof(qint16)) << quint16(16);
+    out.writeRawData("data", 4);
+    out << data_size;
+    for (quint32 frame = 0; frame < frames; frame++)
+    {
+        qint16 sample = static_cast<qint16>(8000 * qSin(2.0 * M_PI * hz * frame / sample_rate));
+        for (int channel = 0; channel < channels; channel++) out << sample;
+    }
+    return wav_file.commit();
+}
+
+void TestLibrary::measureRate(qint64 units, const std::function<void()> &run, QTest::QBenchmarkMetric metric)
+{ // one untimed run first, so caches and page faults are out of the way
+    run();
+    qint64 runs = 0;
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        run();
+        runs++;
+    } while (timer.elapsed() < TL::RateMs);
+    qint64 nsecs = qMax<qint64>(1, timer.nsecsElapsed());
+    QTest::setBenchmarkResult(double(units) * runs * 1e9 / nsecs, metric);
+}
+
+qint64 TestLibrary::heapBytes()
+{ // small blocks from the arenas plus the large ones mapped on their own
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+    return qint64(info.uordblks) + qint64(info.hblkhd);
+#elif defined(__GLIBC__)
+    struct mallinfo info = mallinfo();
+    return qint64(quint32(info.uordblks)) + qint64(quint32(info.hblkhd));
+#else
+    return -1;
+#endif
+}
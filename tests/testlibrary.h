@@ -0,0 +1,43 @@
+#ifndef TESTLIBRARY_H
+#define TESTLIBRARY_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QTest>
+#include <functional>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace TL { class TestLibrary;}
+QT_END_NAMESPACE
+
+namespace TL
+{
+    const int RateMs = 200;
+}
+
+// synthetic libraries and audio files the tests and benchmarks run on
+class TestLibrary
+{
+public:
+    // rows for an int "tracks" column, tagged 1k, 10k, ... 1M
+    static void addSizes(const QList<int>& sizes = defaultSizes());
+    static QList<int> defaultSizes();
+    static QString sizeTag(int tracks);
+
+    // paths, tags and loudness shaped like an imported library, the files do not exist
+    static void fill(TrackModel& model, int tracks);
+    static QStringList paths(int tracks, int first = 0);
+    // 16 bit stereo PCM at 48 kHz, a sine of hz, silence for hz 0
+    static bool writeWav(const QString& file_path, int ms, double hz);
+
+    // repeats run for at least RateMs and reports units per second as the benchmark result,
+    // for kernels whose cost is better read as a rate than as time per call
+    static void measureRate(qint64 units, const std::function<void()>& run,
+                            QTest::QBenchmarkMetric metric = QTest::FramesPerSecond);
+    // bytes the allocator has handed out and not got back, -1 where it can't tell
+    static qint64 heapBytes();
+};
+
+#endif // TESTLIBRARY_H
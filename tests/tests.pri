@@ -0,0 +1,17 @@
+# included by every test, tests/<name>/<name>.pro builds tst_<name>.cpp against the core library
+QT += testlib
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+include(../common.pri)
+include(../core/core.pri)
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/benchmain.cpp \
+    $$PWD/testlibrary.cpp
+
+HEADERS += \
+    $$PWD/benchmain.h \
+    $$PWD/testlibrary.h
@@ -0,0 +1,12 @@
+# one QtTest executable per component, "make check" runs them all
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    benchmarks \
+    dspkernels \
+    iconregistry \
+    librarysorter \
+    librarywatcher \
+    playqueue \
+    searchindex \
+    trackmodel
@@ -0,0 +1,10 @@
+TARGET = tst_trackmodel
+
+include(../tests.pri)
+
+SOURCES += \
+    tst_trackmodel.cpp
+
+# the list widget rows load the track icon the way the old list did
+RESOURCES += \
+    ../../icons.qrc
@@ -0,0 +1,211 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QListView>
+#include <QListWidget>
+#include <QIcon>
+#include <QElapsedTimer>
+#include <memory>
+#include "benchmain.h"
+#include "testlibrary.h"
+#include "trackmodel.h"
+#include "managelist.h"
+#include "librarydatabase.h"
+#include "libraryscanner.h"
+
+// the library as it is held now, a TrackModel read from the library file behind a QListView,
+// against the QListWidget the list used to be, one item per track with its icon, name and path
+// both hold paths only, all the old list knew about a track
+class TestTrackModel : public QObject
+{
+    Q_OBJECT
+    #define OLD_TRACK_ICON ":/icons/res/music_notec2.png"
+
+private slots:
+    void initTestCase();
+
+    void loadTime_data();
+    void loadTime();
+    void memory_data();
+    void memory();
+    // time per imported file through TrackModel::appendNewTracks, what ManageList::appendScanned
+    // calls per scanner batch, the same whatever the size of the library or the import
+    void importScaling_data();
+    void importScaling();
+    // two rows with the same file under different paths, removing one keeps the other findable
+    void sharedFingerprint();
+
+private:
+    QTemporaryDir work_dir;
+
+    static void addLayoutRows();
+    // a library file with tracks paths in it, written once per size
+    QString databaseFor(int tracks);
+    static void loadModel(TrackModel& model, QListView& view, const QString& db_path);
+    static void loadWidget(QListWidget& list, const QStringList& file_paths);
+};
+
+void TestTrackModel::initTestCase()
+{
+    QVERIFY(work_dir.isValid());
+}
+
+void TestTrackModel::loadTime_data()
+{
+    addLayoutRows();
+}
+
+void TestTrackModel::loadTime()
+{ // the old list was read from the settings file, here it gets its paths for free
+    QFETCH(bool, list_widget);
+    QFETCH(int, tracks);
+    if (list_widget)
+    {
+        const QStringList file_paths = TestLibrary::paths(tracks);
+        QBENCHMARK {
+            QListWidget list;
+            loadWidget(list, file_paths);
+        }
+        return;
+    }
+    QString db_path = databaseFor(tracks);
+    QBENCHMARK {
+        TrackModel model;
+        QListView view;
+        loadModel(model, view, db_path);
+        QCOMPARE(model.count(), tracks);
+    }
+}
+
+void TestTrackModel::memory_data()
+{
+    addLayoutRows();
+}
+
+void TestTrackModel::memory()
+{ // what the allocator holds for the loaded list, paths and file given to the loaders not counted
+    QFETCH(bool, list_widget);
+    QFETCH(int, tracks);
+    if (TestLibrary::heapBytes() < 0) QSKIP("the allocator can't be asked on this platform");
+
+    QStringList file_paths;
+    QString db_path;
+    if (list_widget)
+        file_paths = TestLibrary::paths(tracks);
+    else
+        db_path = databaseFor(tracks);
+
+    qint64 before = TestLibrary::heapBytes();
+    std::unique_ptr<QListWidget> list;
+    std::unique_ptr<TrackModel> model;
+    std::unique_ptr<QListView> view;
+    if (list_widget)
+    {
+        list = std::unique_ptr<QListWidget>(new QListWidget);
+        loadWidget(*list, file_paths);
+        QCOMPARE(list->count(), tracks);
+    }
+    else
+    {
+        model = std::unique_ptr<TrackModel>(new TrackModel);
+        view = std::unique_ptr<QListView>(new QListView);
+        loadModel(*model, *view, db_path);
+        QCOMPARE(model->count(), tracks);
+    }
+    QTest::setBenchmarkResult(TestLibrary::heapBytes() - before, QTest::BytesAllocated);
+}
+
+void TestTrackModel::importScaling_data()
+{
+    QTest::addColumn<int>("library");
+    QTest::addColumn<int>("imported");
+    for (int imported : {12500, 25000, 50000})
+        QTest::addRow("%d into 100k", imported) << 100000 << imported;
+    QTest::newRow("50000 into 10k") << 10000 << 50000;
+    QTest::newRow("50000 into 1M") << 1000000 << 50000;
+}
+
+void TestTrackModel::importScaling()
+{ // half of the import is in the library already, it comes in scanner batches
+    QFETCH(int, library);
+    QFETCH(int, imported);
+    TrackModel model;
+    model.appendTracks(TestLibrary::paths(library));
+    const QStringList file_paths = TestLibrary::paths(imported, library - imported / 2);
+    // the index is built once when the library is loaded, not per import
+    QCOMPARE(model.idOfPath(file_paths.first()), model.idAt(library - imported / 2));
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int first = 0; first < file_paths.size(); first += SCAN_BATCH_SIZE)
+        model.appendNewTracks(file_paths.mid(first, SCAN_BATCH_SIZE));
+    qint64 nsecs = timer.nsecsElapsed();
+    QCOMPARE(model.count(), library + imported - imported / 2);
+    QTest::setBenchmarkResult(double(nsecs) / imported, QTest::WalltimeNanoseconds);
+}
+
+void TestTrackModel::sharedFingerprint()
+{
+    TrackModel model;
+    const QStringList file_paths = TestLibrary::paths(2);
+    model.appendTracks(file_paths, {42, 42});
+    TM::TrackId kept = model.idOfFingerprint(42);
+    QVERIFY(kept != TM::InvalidId);
+    TM::TrackId other = model.idAt(0) == kept ? model.idAt(1) : model.idAt(0);
+
+    model.removeTracks({other});
+    QCOMPARE(model.idOfFingerprint(42), kept);
+    QCOMPARE(model.appendNewTracks(file_paths, {42, 42}), 0);
+    model.removeTracks({kept});
+    QCOMPARE(model.idOfFingerprint(42), TM::InvalidId);
+}
+
+// private
+
+void TestTrackModel::addLayoutRows()
+{
+    QTest::addColumn<bool>("list_widget");
+    QTest::addColumn<int>("tracks");
+    for (int tracks : {10000, 100000, 1000000})
+    {
+        QString size = TestLibrary::sizeTag(tracks);
+        QTest::addRow("list widget %s", qPrintable(size)) << true << tracks;
+        QTest::addRow("track model %s", qPrintable(size)) << false << tracks;
+    }
+}
+
+QString TestTrackModel::databaseFor(int tracks)
+{
+    QString db_path = work_dir.filePath(QString("library_%1.db").arg(tracks));
+    if (QFile::exists(db_path)) return db_path;
+    TrackModel model;
+    model.appendTracks(TestLibrary::paths(tracks));
+    if (!LibraryDatabase(db_path).write(model.snapshot())) return QString();
+    return db_path;
+}
+
+void TestTrackModel::loadModel(TrackModel &model, QListView &view, const QString &db_path)
+{ // what ManageList::loadListAsync and startFill do, in one go
+    TM::TrackTable table;
+    if (!LibraryDatabase(db_path).read(table)) return;
+    int row = qMin(LOAD_BATCH, table.size());
+    model.setTable(table.mid(0, row));
+    for (; row < table.size(); row += LOAD_BATCH)
+        model.appendSlice(table.mid(row, qMin(LOAD_BATCH, table.size() - row)));
+    view.setUniformItemSizes(true);
+    view.setModel(&model);
+}
+
+void TestTrackModel::loadWidget(QListWidget &list, const QStringList &file_paths)
+{ // ManageList::loadList before the model
+    for (const QString& file_path : file_paths)
+    {
+        QListWidgetItem* item = new QListWidgetItem;
+        item->setIcon(QIcon(OLD_TRACK_ICON));
+        item->setText(file_path.mid(file_path.lastIndexOf('/') + 1));
+        item->setData(Qt::UserRole, file_path);
+        list.addItem(item);
+    }
+}
+
+BENCH_MAIN(TestTrackModel)
+#include "tst_trackmodel.moc"
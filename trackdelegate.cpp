@@ -0,0 +1,130 @@
+#include "trackdelegate.h"
+#include "covercache.h"
+#include <QPainter>
+#include <QPixmap>
+#include <QIcon>
+
+TrackDelegate::TrackDelegate(QObject *parent)
+    : QStyledItemDelegate{parent}
+    , now_playing(TM::InvalidId)
+    , border_color(184, 175, 247)
+    , base_color(255, 255, 255)
+    , highlight_color(184, 175, 247)
+    , text_color(0, 0, 0)
+    , highlight_text_color(255, 240, 79)
+    , secondary_text_color(110, 110, 110)
+{
+
+}
+
+TrackDelegate::~TrackDelegate()
+{
+
+}
+
+void TrackDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    painter->save();
+    bool highlighted = option.state & (QStyle::State_Selected | QStyle::State_MouseOver);
+    QRect rect = option.rect.adjusted(1, 1, -1, -1);
+    painter->setPen(border_color);
+    painter->setBrush(highlighted ? highlight_color : base_color);
+    painter->drawRoundedRect(rect, TRACK_ROW_RADIUS, TRACK_ROW_RADIUS);
+    // first row of a group in the sorted list, a heavier line on top
+    QString group = index.data(TM::GroupRole).toString();
+    if (index.row() > 0
+        && group.compare(index.siblingAtRow(index.row() - 1).data(TM::GroupRole).toString(), Qt::CaseInsensitive))
+        painter->fillRect(QRect(option.rect.left(), option.rect.top(), option.rect.width(), TRACK_GROUP_LINE), border_color);
+    rect.adjust(TRACK_ROW_PADDING, TRACK_ROW_PADDING, -TRACK_ROW_PADDING, -TRACK_ROW_PADDING);
+
+    // cover from the cache, or the shared track icon
+    QRect icon_rect(rect.left(), rect.top() + (rect.height() - COVER_ICON_SIZE) / 2, COVER_ICON_SIZE, COVER_ICON_SIZE);
+    QVariant decoration = index.data(Qt::DecorationRole);
+    if (decoration.typeId() == QMetaType::QPixmap)
+    {
+        QPixmap cover = qvariant_cast<QPixmap>(decoration);
+        QSize size = cover.size().scaled(icon_rect.size(), Qt::KeepAspectRatio);
+        painter->drawPixmap(QRect(icon_rect.topLeft() + QPoint((icon_rect.width() - size.width()) / 2,
+                                                               (icon_rect.height() - size.height()) / 2), size), cover);
+    }
+    else
+        qvariant_cast<QIcon>(decoration).paint(painter, icon_rect);
+    rect.setLeft(icon_rect.right() + 1 + TRACK_ROW_PADDING * 2);
+
+    // duration on the right, when the tags had one
+    const QFontMetrics& metrics = option.fontMetrics;
+    qint64 duration_ms = index.data(TM::DurationRole).toLongLong();
+    painter->setPen(highlighted ? highlight_text_color : secondary_text_color);
+    if (duration_ms > 0)
+    {
+        QString duration = formatDuration(duration_ms);
+        painter->drawText(rect, Qt::AlignRight | Qt::AlignVCenter, duration);
+        rect.setRight(rect.right() - metrics.horizontalAdvance(duration) - TRACK_ROW_PADDING * 2);
+    }
+
+    // playing now, a small triangle in front of a bold title
+    bool playing = now_playing != TM::InvalidId && index.data(TM::IdRole).toUInt() == now_playing;
+    if (playing)
+    {
+        int top = rect.top() + (rect.height() - TRACK_MARKER_SIZE) / 2;
+        QPolygon marker({QPoint(rect.left(), top), QPoint(rect.left(), top + TRACK_MARKER_SIZE),
+                         QPoint(rect.left() + TRACK_MARKER_SIZE - 1, top + TRACK_MARKER_SIZE / 2)});
+        painter->setBrush(highlighted ? highlight_text_color : border_color);
+        painter->setPen(Qt::NoPen);
+        painter->drawPolygon(marker);
+        rect.setLeft(rect.left() + TRACK_MARKER_SIZE + TRACK_ROW_PADDING);
+    }
+
+    // title over artist, the file name alone until the tags are read
+    QString title = index.data(TM::TitleRole).toString();
+    QString artist = index.data(TM::ArtistRole).toString();
+    if (title.isEmpty()) title = index.data(Qt::DisplayRole).toString();
+    QFont title_font = option.font;
+    title_font.setBold(playing);
+    painter->setFont(title_font);
+    painter->setPen(highlighted ? highlight_text_color : text_color);
+    QRect title_rect = rect;
+    if (!artist.isEmpty())
+    {
+        title_rect.setBottom(rect.top() + rect.height() / 2 - 1);
+        QRect artist_rect = rect;
+        artist_rect.setTop(title_rect.bottom() + 1);
+        painter->setFont(option.font);
+        painter->setPen(highlighted ? highlight_text_color : secondary_text_color);
+        painter->drawText(artist_rect, Qt::AlignLeft | Qt::AlignVCenter,
+                          metrics.elidedText(artist, Qt::ElideRight, artist_rect.width()));
+        painter->setFont(title_font);
+        painter->setPen(highlighted ? highlight_text_color : text_color);
+    }
+    painter->drawText(title_rect, Qt::AlignLeft | Qt::AlignVCenter,
+                      QFontMetrics(title_font).elidedText(title, Qt::ElideRight, title_rect.width()));
+    painter->restore();
+}
+
+QSize TrackDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{ // the same for every row, the view asks once with uniformItemSizes
+    Q_UNUSED(index);
+    int height = qMax(COVER_ICON_SIZE, option.fontMetrics.height() * 2) + TRACK_ROW_PADDING * 2 + 2;
+    return QSize(COVER_ICON_SIZE + TRACK_ROW_PADDING * 2, height);
+}
+
+void TrackDelegate::setNow_playing(TM::TrackId newNow_playing)
+{
+    now_playing = newNow_playing;
+}
+
+TM::TrackId TrackDelegate::getNow_playing() const
+{
+    return now_playing;
+}
+
+// private
+
+QString TrackDelegate::formatDuration(qint64 duration_ms)
+{
+    qint64 seconds = duration_ms / 1000;
+    if (seconds >= 3600)
+        return QString("%1:%2:%3").arg(seconds / 3600).arg(seconds / 60 % 60, 2, 10, QChar('0'))
+                                  .arg(seconds % 60, 2, 10, QChar('0'));
+    return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+}
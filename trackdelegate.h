@@ -0,0 +1,47 @@
+#ifndef TRACKDELEGATE_H
+#define TRACKDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QColor>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace TD { class TrackDelegate;}
+QT_END_NAMESPACE
+
+// paints a music list row straight from the model roles: cover, title, artist,
+// duration, a marker for the track playing now and a line where a sorted group starts
+// no style sheet or style calls per row, every row has the same height
+class TrackDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+    #define TRACK_ROW_PADDING 4
+    #define TRACK_ROW_RADIUS 3
+    #define TRACK_MARKER_SIZE 8
+    #define TRACK_GROUP_LINE 3
+
+public:
+    explicit TrackDelegate(QObject *parent = nullptr);
+    ~TrackDelegate();
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    // the view has to be repainted after a change
+    void setNow_playing(TM::TrackId newNow_playing);
+    TM::TrackId getNow_playing() const;
+
+private:
+    TM::TrackId now_playing;
+    // the colors of the theme
+    QColor border_color;
+    QColor base_color;
+    QColor highlight_color;
+    QColor text_color;
+    QColor highlight_text_color;
+    QColor secondary_text_color;
+
+    static QString formatDuration(qint64 duration_ms);
+};
+
+#endif // TRACKDELEGATE_H
@@ -0,0 +1,520 @@
+#include "trackmodel.h"
+#include "iconregistry.h"
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <QtNumeric>
+#include <QSet>
+
+TrackModel::TrackModel(QObject *parent)
+    : QAbstractListModel{parent}
+    , pool_garbage(0)
+    , lookup_index_valid(true)
+    , cover_cache(nullptr)
+    , group_field(TM::SortByDateAdded)
+{
+    row_of_id.append(-1); // slot of TM::InvalidId
+}
+
+TrackModel::~TrackModel()
+{
+
+}
+
+int TrackModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return table.size();
+}
+
+QVariant TrackModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= table.size()) return QVariant();
+    int row = index.row();
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return displayName(row);
+    case Qt::DecorationRole:
+    { // cover art from memory only, rows without one share the same implicitly shared icon
+        // asked for by views only, a model without a gui never loads it
+        quint64 cover_key = table.info[row].cover_key;
+        QPixmap cover = cover_key && cover_cache ? cover_cache->icon(cover_key) : QPixmap();
+        if (!cover.isNull()) return cover;
+        return IconRegistry::icon(IR::TrackIcon);
+    }
+    case Qt::ToolTipRole:
+    case Qt::UserRole:
+        return filePath(row);
+    case TM::IdRole:
+        return table.ids[row];
+    case TM::LoudnessRole:
+        if (!table.loudness[row].isValid() || qIsNaN(table.loudness[row].integrated)) return QVariant();
+        return table.loudness[row].integrated;
+    case TM::TitleRole:
+        return table.info[row].title;
+    case TM::ArtistRole:
+        return table.info[row].artist;
+    case TM::AlbumRole:
+        return table.info[row].album;
+    case TM::DurationRole:
+        return table.info[row].duration_ms;
+    case TM::GroupRole:
+        switch (group_field) {
+        case TM::SortByTitle:
+            return displayName(row).left(1).toUpper();
+        case TM::SortByArtist:
+            return table.info[row].artist;
+        case TM::SortByAlbum:
+            return table.info[row].album;
+        case TM::SortByPath:
+            return table.dir_table[table.dir_index[row]];
+        default:
+            return QVariant();
+        }
+    default:
+        return QVariant();
+    }
+}
+
+// operations
+
+TM::TrackId TrackModel::appendTrack(const QString &file_path, quint64 fingerprint)
+{
+    int row = table.size();
+    beginInsertRows(QModelIndex(), row, row);
+    insertTrack(file_path, fingerprint);
+    endInsertRows();
+    return table.ids.last();
+}
+
+void TrackModel::appendTracks(const QStringList &file_paths, const QVector<quint64> &fingerprints)
+{
+    if (file_paths.isEmpty()) return;
+    int first = table.size();
+    reserve(first + file_paths.size());
+    beginInsertRows(QModelIndex(), first, first + file_paths.size() - 1);
+    for (int idx = 0; idx < file_paths.size(); idx++)
+        insertTrack(file_paths[idx], idx < fingerprints.size() ? fingerprints[idx] : 0);
+    endInsertRows();
+}
+
+int TrackModel::appendNewTracks(const QStringList &file_paths, const QVector<quint64> &fingerprints)
+{
+    QStringList new_paths;
+    QVector<quint64> new_fingerprints;
+    QSet<QString> new_path_set;
+    QSet<quint64> new_fingerprint_set;
+    for (int idx = 0; idx < file_paths.size(); idx++)
+    {
+        const QString& file_path = file_paths[idx];
+        quint64 fingerprint = idx < fingerprints.size() ? fingerprints[idx] : 0;
+        if (idOfPath(file_path) != TM::InvalidId) continue;
+        if (idOfFingerprint(fingerprint) != TM::InvalidId) continue;
+        if (new_path_set.contains(file_path) || (fingerprint && new_fingerprint_set.contains(fingerprint)))
+            continue;
+
+        new_path_set.insert(file_path);
+        if (fingerprint) new_fingerprint_set.insert(fingerprint);
+        new_paths.append(file_path);
+        new_fingerprints.append(fingerprint);
+    }
+    appendTracks(new_paths, new_fingerprints);
+    return new_paths.size();
+}
+
+void TrackModel::removeTracks(const QList<TM::TrackId> &ids)
+{
+    QVector<int> rows;
+    rows.reserve(ids.size());
+    for (auto id : ids)
+    {
+        int row = rowOf(id);
+        if (row >= 0) rows.append(row);
+    }
+    if (rows.isEmpty()) return;
+
+    // remove contiguous runs from the back so earlier rows stay valid
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    int idx = 0;
+    while (idx < rows.size())
+    {
+        int last = rows[idx];
+        int first = last;
+        while (idx + 1 < rows.size() && rows[idx + 1] == first - 1)
+            first = rows[++idx];
+        idx++;
+
+        beginRemoveRows(QModelIndex(), first, last);
+        int span = last - first + 1;
+        QVector<TM::TrackId> removed_ids = table.ids.mid(first, span);
+        for (int row = first; row <= last; row++)
+        {
+            if (lookup_index_valid)
+            {
+                path_index.remove(qHash(filePath(row)), table.ids[row]);
+                // another copy of the file may own the fingerprint, leave its entry alone
+                quint64 fingerprint = table.fingerprints[row];
+                if (fingerprint && fingerprint_index.value(fingerprint) == table.ids[row])
+                    fingerprint_index.remove(fingerprint);
+            }
+            pool_garbage += table.name_length[row];
+        }
+        table.ids.remove(first, span);
+        table.dir_index.remove(first, span);
+        table.name_offset.remove(first, span);
+        table.name_length.remove(first, span);
+        table.fingerprints.remove(first, span);
+        table.loudness.remove(first, span);
+        table.info.remove(first, span);
+        // listeners look rows up as soon as the run is gone, keep the index current
+        for (int row = first; row <= last; row++) row_of_id[removed_ids[row - first]] = -1;
+        for (int row = first; row < table.size(); row++) row_of_id[table.ids[row]] = row;
+        endRemoveRows();
+    }
+
+    if (pool_garbage > table.name_pool.size() / 2) compactPool();
+}
+
+void TrackModel::clear()
+{
+    beginResetModel();
+    // ids are not reused, keep counting from where we are
+    TM::TrackId next_id = table.next_id;
+    table = TM::TrackTable();
+    table.next_id = next_id;
+    dir_lookup.clear();
+    path_index.clear();
+    fingerprint_index.clear();
+    lookup_index_valid = true;
+    pool_garbage = 0;
+    rebuildRowIndex();
+    endResetModel();
+}
+
+void TrackModel::reserve(int size)
+{
+    table.ids.reserve(size);
+    table.dir_index.reserve(size);
+    table.name_offset.reserve(size);
+    table.name_length.reserve(size);
+    table.fingerprints.reserve(size);
+    table.loudness.reserve(size);
+    table.info.reserve(size);
+}
+
+void TrackModel::setLoudness(TM::TrackId id, const TM::Loudness &loudness)
+{
+    int row = rowOf(id);
+    if (row < 0) return;
+    table.loudness[row] = loudness;
+    QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, {TM::LoudnessRole});
+}
+
+void TrackModel::setTrackInfo(const QVector<TM::TrackId> &ids, const QVector<TM::TrackInfo> &infos)
+{ // one change notification for the whole batch
+    int first = table.size();
+    int last = -1;
+    for (int idx = 0; idx < ids.size() && idx < infos.size(); idx++)
+    {
+        int row = rowOf(ids[idx]);
+        if (row < 0) continue;
+        table.info[row] = infos[idx];
+        first = qMin(first, row);
+        last = qMax(last, row);
+    }
+    if (last >= first) emit dataChanged(index(first), index(last));
+}
+
+void TrackModel::moveTracks(const QVector<TM::TrackId> &ids, const QStringList &file_paths)
+{ // the new name goes to the end of the pool, the old one is garbage until the next compaction
+    int first = table.size();
+    int last = -1;
+    for (int idx = 0; idx < ids.size() && idx < file_paths.size(); idx++)
+    {
+        int row = rowOf(ids[idx]);
+        if (row < 0) continue;
+        const QString& file_path = file_paths[idx];
+        if (lookup_index_valid) path_index.remove(qHash(filePath(row)), ids[idx]);
+
+        int split = file_path.lastIndexOf('/');
+        QString name = file_path.mid(split + 1);
+        int length = qMin(name.size(), 0xFFFF);
+        pool_garbage += table.name_length[row];
+        table.dir_index[row] = internDir(split > 0 ? file_path.left(split) : QString());
+        table.name_offset[row] = table.name_pool.size();
+        table.name_length[row] = static_cast<quint16>(length);
+        table.name_pool.append(name.constData(), length);
+
+        if (lookup_index_valid) path_index.insert(qHash(filePath(row)), ids[idx]);
+        first = qMin(first, row);
+        last = qMax(last, row);
+    }
+    if (last >= first)
+        emit dataChanged(index(first), index(last), {Qt::DisplayRole, Qt::ToolTipRole, Qt::UserRole, TM::GroupRole});
+    if (pool_garbage > table.name_pool.size() / 2) compactPool();
+}
+
+void TrackModel::reorder(const QVector<TM::TrackId> &ids)
+{
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    // selection and current index follow their tracks
+    const QModelIndexList old_persistent = persistentIndexList();
+    QVector<TM::TrackId> persistent_ids;
+    persistent_ids.reserve(old_persistent.size());
+    for (const QModelIndex& index : old_persistent) persistent_ids.append(idAt(index.row()));
+
+    QVector<int> order;
+    order.reserve(table.size());
+    QVector<bool> placed(table.size(), false);
+    for (TM::TrackId id : ids)
+    {
+        int row = rowOf(id);
+        if (row < 0 || placed[row]) continue;
+        placed[row] = true;
+        order.append(row);
+    }
+    for (int row = 0; row < table.size(); row++)
+        if (!placed[row]) order.append(row);
+
+    // every column is gathered into the new order, the pools stay as they are
+    auto gather = [&order](auto& column) {
+        std::remove_reference_t<decltype(column)> sorted;
+        sorted.reserve(column.size());
+        for (int row : order) sorted.append(column[row]);
+        column.swap(sorted);
+    };
+    gather(table.ids);
+    gather(table.dir_index);
+    gather(table.name_offset);
+    gather(table.name_length);
+    gather(table.fingerprints);
+    gather(table.loudness);
+    gather(table.info);
+    rebuildRowIndex();
+
+    QModelIndexList new_persistent;
+    new_persistent.reserve(persistent_ids.size());
+    for (TM::TrackId id : persistent_ids) new_persistent.append(index(rowOf(id)));
+    changePersistentIndexList(old_persistent, new_persistent);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+void TrackModel::setTable(const TM::TrackTable &new_table)
+{
+    beginResetModel();
+    table = new_table;
+    dir_lookup.clear();
+    for (int index = 0; index < table.dir_table.size(); index++)
+        dir_lookup.insert(table.dir_table[index], index);
+    pool_garbage = 0;
+    // duplicate lookups are only needed on import, build them then
+    path_index.clear();
+    fingerprint_index.clear();
+    lookup_index_valid = false;
+    rebuildRowIndex();
+    endResetModel();
+}
+
+void TrackModel::appendSlice(const TM::TrackTable &slice)
+{ // slice must come from the table last given to setTable, so its directory
+    // and name offsets are still valid here (both only ever grow)
+    if (slice.size() == 0) return;
+    int first = table.size();
+    beginInsertRows(QModelIndex(), first, first + slice.size() - 1);
+    table.ids.append(slice.ids);
+    table.dir_index.append(slice.dir_index);
+    table.name_offset.append(slice.name_offset);
+    table.name_length.append(slice.name_length);
+    table.fingerprints.append(slice.fingerprints);
+    table.loudness.append(slice.loudness);
+    table.info.append(slice.info);
+    table.next_id = qMax(table.next_id, slice.next_id);
+    row_of_id.resize(table.next_id, -1);
+    for (int row = first; row < table.size(); row++)
+        row_of_id[table.ids[row]] = row;
+    lookup_index_valid = false;
+    endInsertRows();
+}
+
+TM::TrackTable TrackModel::snapshot()
+{
+    if (pool_garbage > 0) compactPool();
+    return table;
+}
+
+// lookups
+
+int TrackModel::count() const
+{
+    return table.size();
+}
+
+TM::TrackId TrackModel::idAt(int row) const
+{
+    if (row < 0 || row >= table.size()) return TM::InvalidId;
+    return table.ids[row];
+}
+
+int TrackModel::rowOf(TM::TrackId id) const
+{
+    if (id >= static_cast<TM::TrackId>(row_of_id.size())) return -1;
+    return row_of_id[id];
+}
+
+TM::TrackId TrackModel::idLimit() const
+{
+    return table.next_id;
+}
+
+TM::TrackId TrackModel::idOfPath(const QString &file_path) const
+{ // hash collisions are resolved by comparing the stored path
+    if (!lookup_index_valid) buildLookupIndex();
+    auto range = path_index.equal_range(qHash(file_path));
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+        if (filePath(rowOf(iter.value())) == file_path) return iter.value();
+    }
+    return TM::InvalidId;
+}
+
+TM::TrackId TrackModel::idOfFingerprint(quint64 fingerprint) const
+{
+    if (!fingerprint) return TM::InvalidId;
+    if (!lookup_index_valid) buildLookupIndex();
+    return fingerprint_index.value(fingerprint, TM::InvalidId);
+}
+
+quint64 TrackModel::fingerprint(int row) const
+{
+    if (row < 0 || row >= table.size()) return 0;
+    return table.fingerprints[row];
+}
+
+TM::Loudness TrackModel::loudness(int row) const
+{
+    if (row < 0 || row >= table.size()) return TM::Loudness();
+    return table.loudness[row];
+}
+
+TM::TrackInfo TrackModel::trackInfo(int row) const
+{
+    if (row < 0 || row >= table.size()) return TM::TrackInfo();
+    return table.info[row];
+}
+
+QString TrackModel::fileName(int row) const
+{
+    if (row < 0 || row >= table.size()) return QString();
+    return table.name_pool.mid(table.name_offset[row], table.name_length[row]);
+}
+
+QString TrackModel::filePath(int row) const
+{
+    if (row < 0 || row >= table.size()) return QString();
+    return table.dir_table[table.dir_index[row]] + '/' + fileName(row);
+}
+
+QString TrackModel::displayName(int row) const
+{
+    if (row < 0 || row >= table.size()) return QString();
+    const TM::TrackInfo& info = table.info[row];
+    if (info.title.isEmpty()) return fileName(row);
+    if (info.artist.isEmpty()) return info.title;
+    return info.artist + " - " + info.title;
+}
+
+// getters & setters
+
+void TrackModel::setGroup_field(TM::SortField newGroup_field)
+{
+    if (group_field == newGroup_field) return;
+    group_field = newGroup_field;
+    if (table.size()) emit dataChanged(index(0), index(table.size() - 1), {TM::GroupRole});
+}
+
+void TrackModel::setCover_cache(CoverCache *newCover_cache)
+{
+    if (cover_cache) cover_cache->disconnect(this);
+    cover_cache = newCover_cache;
+    if (cover_cache) connect(cover_cache, &CoverCache::coverLoaded, this, &TrackModel::coverLoaded);
+}
+
+// private
+
+void TrackModel::insertTrack(const QString &file_path, quint64 fingerprint)
+{
+    int split = file_path.lastIndexOf('/');
+    QString name = file_path.mid(split + 1);
+    int length = qMin(name.size(), 0xFFFF);
+
+    TM::TrackId id = table.next_id++;
+    table.ids.append(id);
+    table.dir_index.append(internDir(split > 0 ? file_path.left(split) : QString()));
+    table.name_offset.append(table.name_pool.size());
+    table.name_length.append(static_cast<quint16>(length));
+    table.name_pool.append(name.constData(), length);
+    table.fingerprints.append(fingerprint);
+    table.loudness.append(TM::Loudness());
+    table.info.append(TM::TrackInfo());
+
+    row_of_id.append(table.size() - 1);
+    if (lookup_index_valid)
+    {
+        path_index.insert(qHash(filePath(table.size() - 1)), id);
+        if (fingerprint) fingerprint_index.insert(fingerprint, id);
+    }
+}
+
+quint32 TrackModel::internDir(const QString &dir)
+{
+    auto iter = dir_lookup.constFind(dir);
+    if (iter != dir_lookup.constEnd()) return iter.value();
+    quint32 index = table.dir_table.size();
+    table.dir_table.append(dir);
+    dir_lookup.insert(dir, index);
+    return index;
+}
+
+void TrackModel::rebuildRowIndex()
+{
+    row_of_id.fill(-1, table.next_id);
+    for (int row = 0; row < table.size(); row++)
+        row_of_id[table.ids[row]] = row;
+}
+
+void TrackModel::buildLookupIndex() const
+{
+    path_index.clear();
+    fingerprint_index.clear();
+    path_index.reserve(table.size());
+    for (int row = 0; row < table.size(); row++)
+    {
+        path_index.insert(qHash(filePath(row)), table.ids[row]);
+        if (table.fingerprints[row]) fingerprint_index.insert(table.fingerprints[row], table.ids[row]);
+    }
+    lookup_index_valid = true;
+}
+
+void TrackModel::compactPool()
+{
+    QString new_pool;
+    new_pool.reserve(table.name_pool.size() - pool_garbage);
+    for (int row = 0; row < table.size(); row++)
+    {
+        quint32 offset = new_pool.size();
+        new_pool.append(table.name_pool.constData() + table.name_offset[row], table.name_length[row]);
+        table.name_offset[row] = offset;
+    }
+    table.name_pool = new_pool;
+    pool_garbage = 0;
+}
+
+void TrackModel::coverLoaded()
+{ // rows with the cover are not tracked, the view only repaints what is visible
+    if (table.size() > 0) emit dataChanged(index(0), index(table.size() - 1), {Qt::DecorationRole});
+}
@@ -0,0 +1,172 @@
+#ifndef TRACKMODEL_H
+#define TRACKMODEL_H
+
+#include <QAbstractListModel>
+#include <QIcon>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include "covercache.h"
+
+QT_BEGIN_NAMESPACE
+namespace TM { class TrackModel;}
+QT_END_NAMESPACE
+
+namespace TM
+{
+    // stable id of a track, never reused while the program runs
+    using TrackId = quint32;
+    const TrackId InvalidId = 0;
+
+    enum Role {IdRole = Qt::UserRole + 1, LoudnessRole, TitleRole, ArtistRole, AlbumRole, DurationRole, GroupRole};
+    // date added is the id order, ids are handed out as tracks are imported
+    enum SortField {SortByTitle, SortByArtist, SortByAlbum, SortByPath, SortByDuration, SortByDateAdded};
+
+    // result of the loudness analysis, kept for as long as the file keeps
+    // the size and modification time it had when it was measured
+    struct Loudness
+    {
+        qint64 file_size = -1; // -1 = not analyzed
+        qint64 mtime = 0;
+        // LUFS and dBTP, NaN when the file could not be decoded
+        float integrated = 0.0f;
+        float true_peak = 0.0f;
+
+        bool isValid() const { return file_size >= 0; }
+        bool matches(qint64 size, qint64 modified) const { return file_size == size && mtime == modified; }
+    };
+
+    // tags read in the background, kept the same way as Loudness
+    struct TrackInfo
+    {
+        qint64 file_size = -1; // -1 = not read
+        qint64 mtime = 0;
+        QString title;
+        QString artist;
+        QString album;
+        qint64 duration_ms = 0;
+        quint64 cover_key = 0; // 0 = no cover, see CoverCache
+
+        bool isValid() const { return file_size >= 0; }
+        bool matches(qint64 size, qint64 modified) const { return file_size == size && mtime == modified; }
+    };
+
+    // track table, kept as parallel arrays indexed by row
+    // directories are interned, file names live in one shared pool
+    struct TrackTable
+    {
+        QVector<TrackId> ids;
+        QVector<quint32> dir_index;
+        QVector<quint32> name_offset;
+        QVector<quint16> name_length;
+        QVector<quint64> fingerprints; // 0 = not computed
+        QVector<Loudness> loudness;
+        QVector<TrackInfo> info;
+
+        QStringList dir_table;
+        QString name_pool;
+        TrackId next_id = InvalidId + 1;
+
+        int size() const { return ids.size(); }
+
+        // rows [first, first + count), sharing the directory table and name pool
+        TrackTable mid(int first, int count) const
+        {
+            TrackTable part;
+            part.ids = ids.mid(first, count);
+            part.dir_index = dir_index.mid(first, count);
+            part.name_offset = name_offset.mid(first, count);
+            part.name_length = name_length.mid(first, count);
+            part.fingerprints = fingerprints.mid(first, count);
+            part.loudness = loudness.mid(first, count);
+            part.info = info.mid(first, count);
+            part.dir_table = dir_table;
+            part.name_pool = name_pool;
+            part.next_id = next_id;
+            return part;
+        }
+    };
+}
+
+class TrackModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit TrackModel(QObject *parent = nullptr);
+    ~TrackModel();
+
+    // model interface
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // operations
+    TM::TrackId appendTrack(const QString& file_path, quint64 fingerprint = 0);
+    void appendTracks(const QStringList& file_paths, const QVector<quint64>& fingerprints = {});
+    // appends only the files not in the model yet, by path or fingerprint, nor twice in file_paths
+    // returns how many were appended
+    int appendNewTracks(const QStringList& file_paths, const QVector<quint64>& fingerprints = {});
+    void removeTracks(const QList<TM::TrackId>& ids);
+    void clear();
+    void reserve(int size);
+    void setLoudness(TM::TrackId id, const TM::Loudness& loudness);
+    void setTrackInfo(const QVector<TM::TrackId>& ids, const QVector<TM::TrackInfo>& infos);
+    // files that were renamed or moved on disk, the tracks keep their id, tags and loudness
+    void moveTracks(const QVector<TM::TrackId>& ids, const QStringList& file_paths);
+    // puts the rows in the order of ids in one layout change, rows not among them
+    // (imported since the order was made) keep their order at the end
+    void reorder(const QVector<TM::TrackId>& ids);
+
+    // bulk access, the table is implicitly shared so snapshots are cheap
+    void setTable(const TM::TrackTable& new_table);
+    void appendSlice(const TM::TrackTable& slice);
+    TM::TrackTable snapshot();
+
+    // lookups
+    int count() const;
+    TM::TrackId idAt(int row) const;
+    int rowOf(TM::TrackId id) const;
+    // every id handed out so far is below this
+    TM::TrackId idLimit() const;
+    TM::TrackId idOfPath(const QString& file_path) const;
+    TM::TrackId idOfFingerprint(quint64 fingerprint) const;
+    quint64 fingerprint(int row) const;
+    TM::Loudness loudness(int row) const;
+    TM::TrackInfo trackInfo(int row) const;
+    QString fileName(int row) const;
+    QString filePath(int row) const;
+    // title and artist from the tags, the file name until they are read
+    QString displayName(int row) const;
+
+    // getters & setters
+    void setCover_cache(CoverCache *newCover_cache);
+    // what GroupRole returns, the list draws a line where it changes
+    void setGroup_field(TM::SortField newGroup_field);
+
+private:
+    TM::TrackTable table;
+    QHash<QString, quint32> dir_lookup;
+    int pool_garbage;
+
+    // id -> row, indexed by id directly (ids are handed out densely)
+    QVector<int> row_of_id;
+
+    // duplicate detection, keyed by the hash of the absolute path
+    // and by the content fingerprint, built on first use
+    mutable QMultiHash<size_t, TM::TrackId> path_index;
+    mutable QHash<quint64, TM::TrackId> fingerprint_index;
+    mutable bool lookup_index_valid;
+
+    CoverCache* cover_cache;
+    TM::SortField group_field;
+
+    void coverLoaded();
+
+    void insertTrack(const QString& file_path, quint64 fingerprint);
+    quint32 internDir(const QString& dir);
+    void rebuildRowIndex();
+    void buildLookupIndex() const;
+    void compactPool();
+};
+
+#endif // TRACKMODEL_H
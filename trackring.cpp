@@ -0,0 +1,80 @@
+#include "trackring.h"
+
+TrackRing::TrackRing(int min_capacity)
+    : head(0)
+    , count(0)
+{ // a power of two, so wrapping is a mask
+    int capacity = 1;
+    while (capacity < min_capacity) capacity <<= 1;
+    slots.resize(capacity);
+    mask = capacity - 1;
+}
+
+void TrackRing::push(TM::TrackId id)
+{
+    if (isFull())
+    {
+        head = (head + 1) & mask;
+        count--;
+    }
+    slots[(head + count++) & mask] = id;
+}
+
+TM::TrackId TrackRing::first() const
+{
+    return count ? slots[head] : TM::InvalidId;
+}
+
+TM::TrackId TrackRing::last() const
+{
+    return count ? slots[(head + count - 1) & mask] : TM::InvalidId;
+}
+
+TM::TrackId TrackRing::takeFirst()
+{
+    if (!count) return TM::InvalidId;
+    TM::TrackId id = slots[head];
+    head = (head + 1) & mask;
+    count--;
+    return id;
+}
+
+TM::TrackId TrackRing::takeLast()
+{
+    if (!count) return TM::InvalidId;
+    return slots[(head + --count) & mask];
+}
+
+void TrackRing::clear()
+{
+    head = 0;
+    count = 0;
+}
+
+bool TrackRing::isEmpty() const
+{
+    return count == 0;
+}
+
+bool TrackRing::isFull() const
+{
+    return count == slots.size();
+}
+
+int TrackRing::size() const
+{
+    return count;
+}
+
+int TrackRing::getCapacity() const
+{
+    return slots.size();
+}
+
+QVector<TM::TrackId> TrackRing::toVector() const
+{
+    QVector<TM::TrackId> ids;
+    ids.reserve(count);
+    for (int idx = 0; idx < count; idx++) ids.append(slots[(head + idx) & mask]);
+    return ids;
+}
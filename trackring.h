@@ -0,0 +1,55 @@
+#ifndef TRACKRING_H
+#define TRACKRING_H
+
+#include <QVector>
+#include "trackmodel.h"
+
+QT_BEGIN_NAMESPACE
+namespace RG { class TrackRing;}
+QT_END_NAMESPACE
+
+// fixed size ring of track ids, usable as a queue from the front and a stack from the back
+// pushing onto a full ring drops the oldest id
+class TrackRing
+{
+public:
+    explicit TrackRing(int min_capacity);
+
+    void push(TM::TrackId id);
+    TM::TrackId first() const;
+    TM::TrackId last() const;
+    // InvalidId when empty
+    TM::TrackId takeFirst();
+    TM::TrackId takeLast();
+    void clear();
+
+    bool isEmpty() const;
+    bool isFull() const;
+    int size() const;
+    int getCapacity() const;
+    // oldest first
+    QVector<TM::TrackId> toVector() const;
+
+    // drops every id pred is true for, the rest keep their order
+    template <class Pred>
+    int removeIf(Pred pred)
+    {
+        int kept = 0;
+        for (int idx = 0; idx < count; idx++)
+        {
+            TM::TrackId id = slots[(head + idx) & mask];
+            if (!pred(id)) slots[(head + kept++) & mask] = id;
+        }
+        int removed = count - kept;
+        count = kept;
+        return removed;
+    }
+
+private:
+    QVector<TM::TrackId> slots;
+    int mask;
+    int head; // slot of the oldest id
+    int count;
+};
+
+#endif // TRACKRING_H
@@ -0,0 +1,288 @@
+#include "waveformcache.h"
+#include "dspkernels.h"
+#include <QAudioDecoder>
+#include <QAudioBuffer>
+#include <QEventLoop>
+#include <QThread>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QUrl>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <cstring>
+
+namespace
+{
+    inline qint8 quantize(float sample)
+    {
+        return static_cast<qint8>(qRound(qBound(-1.0f, sample, 1.0f) * 127.0f));
+    }
+}
+
+// pyramid
+
+void WC::Pyramid::append(const Peak *bins, int count)
+{
+    if (count <= 0) return;
+    if (levels.isEmpty()) levels.resize(1);
+    levels[0].append(bins, count);
+    for (int level = 1; levels[level - 1].size() > 1; level++)
+    {
+        if (level == levels.size()) levels.resize(level + 1);
+        const QVector<Peak>& below = levels[level - 1];
+        QVector<Peak>& above = levels[level];
+        // the last bin above may have been made from half a pair, it is made again
+        int first = qMax(0, int(above.size()) - 1);
+        above.resize((below.size() + 1) / 2);
+        for (int bin = first; bin < above.size(); bin++)
+        {
+            Peak peak = below[bin * 2];
+            if (bin * 2 + 1 < below.size())
+            {
+                peak.lo = qMin(peak.lo, below[bin * 2 + 1].lo);
+                peak.hi = qMax(peak.hi, below[bin * 2 + 1].hi);
+            }
+            above[bin] = peak;
+        }
+    }
+}
+
+double WC::Pyramid::binMs(int level) const
+{
+    if (sample_rate <= 0) return 0.0;
+    return double(WC::BinFrames << level) * 1000.0 / sample_rate;
+}
+
+int WC::Pyramid::levelFor(double ms) const
+{
+    int level = 0;
+    while (level + 1 < levels.size() && binMs(level + 1) <= ms) level++;
+    return level;
+}
+
+int WC::Pyramid::fullBins(int level) const
+{
+    if (level >= levels.size()) return 0;
+    if (complete) return levels[level].size();
+    return levels[0].size() >> level;
+}
+
+int WC::Pyramid::bytes() const
+{
+    int total = 0;
+    for (const QVector<Peak>& level : levels) total += level.size() * sizeof(Peak);
+    return total;
+}
+
+// cache
+
+WaveformCache::WaveformCache(const QString &init_dir, QObject *parent)
+    : QObject{parent}
+    , dir(init_dir)
+    , pyramids(WAVE_MEMORY)
+    , serial(0)
+{ // one decode at a time, the track on screen is the only one that matters
+    QDir().mkpath(dir);
+    build_pool.setMaxThreadCount(1);
+}
+
+WaveformCache::~WaveformCache()
+{
+    serial++;
+    build_pool.waitForDone();
+}
+
+void WaveformCache::request(const QString &file_path)
+{
+    // asked again for the track already shown or being decoded
+    if (!file_path.isEmpty() && file_path == pyramid.file_path)
+    {
+        emit peaksChanged(pyramid);
+        return;
+    }
+    int request_serial = ++serial;
+    pyramid = WC::Pyramid();
+    pyramid.file_path = file_path;
+    if (WC::Pyramid* cached = pyramids.object(file_path))
+    {
+        pyramid = *cached;
+        emit peaksChanged(pyramid);
+        return;
+    }
+    emit peaksChanged(pyramid);
+    QString cache_path = pathOf(file_path);
+    build_pool.start([this, request_serial, file_path, cache_path]() {
+        buildPeaks(request_serial, file_path, cache_path);
+    });
+}
+
+void WaveformCache::cancel()
+{
+    serial++;
+    pyramid = WC::Pyramid();
+}
+
+const WC::Pyramid &WaveformCache::current() const
+{
+    return pyramid;
+}
+
+QString WaveformCache::defaultDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/waveforms";
+}
+
+// private
+
+QString WaveformCache::pathOf(const QString &file_path) const
+{ // named after the path, the header says which version of the file it describes
+    quint64 key {0};
+    memcpy(&key, QCryptographicHash::hash(file_path.toUtf8(), QCryptographicHash::Sha1).constData(), sizeof(key));
+    return dir + '/' + QString::number(key, 16).rightJustified(16, '0') + ".peaks";
+}
+
+void WaveformCache::buildPeaks(int request_serial, const QString &file_path, const QString &cache_path)
+{ // runs on build_pool, the decoder gets a local event loop like the loudness analyzer's
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+    auto stale = [this, request_serial]() { return serial.load(std::memory_order_relaxed) != request_serial; };
+    if (stale()) return;
+    QFileInfo file(file_path);
+    qint64 file_size = file.size();
+    qint64 mtime = file.lastModified().toMSecsSinceEpoch();
+
+    QVector<WC::Peak> bins;
+    int sample_rate = 0;
+    if (readCached(cache_path, file_size, mtime, bins, sample_rate))
+    {
+        QMetaObject::invokeMethod(this, [this, request_serial, bins, sample_rate]() {
+            binsReady(request_serial, bins, sample_rate, true);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    QAudioDecoder decoder;
+    QEventLoop loop;
+    QVector<float> samples;
+    // the bin being filled, carried across buffers
+    float lo = 1.0f;
+    float hi = -1.0f;
+    int bin_samples = 0;
+    int sent = 0;
+    bool ok = true;
+    auto send = [&](bool complete) {
+        QVector<WC::Peak> part = bins.mid(sent);
+        sent = bins.size();
+        int rate = sample_rate;
+        QMetaObject::invokeMethod(this, [this, request_serial, part, rate, complete]() {
+            binsReady(request_serial, part, rate, complete);
+        }, Qt::QueuedConnection);
+    };
+
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&]() {
+        QAudioBuffer buffer = decoder.read();
+        if (!buffer.isValid()) return;
+        if (stale())
+        {
+            ok = false;
+            loop.quit();
+            return;
+        }
+        QAudioFormat format = buffer.format();
+        int channels = format.channelCount();
+        int count = buffer.frameCount() * channels;
+        if (channels <= 0 || count <= 0) return;
+        if (!sample_rate) sample_rate = format.sampleRate();
+
+        const float* data = buffer.constData<float>();
+        if (format.sampleFormat() != QAudioFormat::Float)
+        {
+            samples.resize(count);
+            const char* in = buffer.constData<char>();
+            if (format.sampleFormat() == QAudioFormat::Int16)
+                DspKernels::int16ToFloat(samples.data(), reinterpret_cast<const qint16*>(in), count);
+            else if (format.sampleFormat() == QAudioFormat::Int32)
+                DspKernels::int32ToFloat(samples.data(), reinterpret_cast<const qint32*>(in), count);
+            else
+                for (int sample = 0; sample < count; sample++)
+                    samples[sample] = format.normalizedSampleValue(in + sample * format.bytesPerSample());
+            data = samples.constData();
+        }
+
+        // a bin is BinFrames frames of every channel, buffers end wherever they like
+        int bin_size = WC::BinFrames * channels;
+        for (int done = 0; done < count;)
+        {
+            int take = qMin(bin_size - bin_samples, count - done);
+            DspKernels::minMax(data + done, take, lo, hi);
+            done += take;
+            bin_samples += take;
+            if (bin_samples < bin_size) break;
+            bins.append({quantize(lo), quantize(hi)});
+            lo = 1.0f;
+            hi = -1.0f;
+            bin_samples = 0;
+        }
+        if (bins.size() - sent >= WAVE_EMIT_BINS) send(false);
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), &loop,
+                     [&](QAudioDecoder::Error) {
+        ok = false;
+        loop.quit();
+    });
+
+    decoder.setSource(QUrl::fromLocalFile(file_path));
+    decoder.start();
+    if (ok) loop.exec();
+    decoder.stop();
+    if (!ok || stale() || !sample_rate) return;
+
+    if (bin_samples > 0) bins.append({quantize(lo), quantize(hi)});
+    send(true);
+
+    // next time the track is shown it is read back instead of decoded
+    WC::Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = WC::Magic;
+    header.version = WC::Version;
+    header.sample_rate = sample_rate;
+    header.bin_count = bins.size();
+    header.file_size = file_size;
+    header.mtime = mtime;
+    QSaveFile cache_file(cache_path);
+    if (!cache_file.open(QIODevice::WriteOnly)) return;
+    cache_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    cache_file.write(reinterpret_cast<const char*>(bins.constData()), bins.size() * sizeof(WC::Peak));
+    cache_file.commit();
+}
+
+void WaveformCache::binsReady(int request_serial, const QVector<WC::Peak> &bins, int sample_rate, bool complete)
+{
+    if (request_serial != serial) return;
+    pyramid.sample_rate = sample_rate;
+    pyramid.append(bins.constData(), bins.size());
+    pyramid.complete = complete;
+    if (complete && !pyramid.isEmpty())
+        pyramids.insert(pyramid.file_path, new WC::Pyramid(pyramid), pyramid.bytes() / 1024 + 1);
+    emit peaksChanged(pyramid);
+}
+
+bool WaveformCache::readCached(const QString &cache_path, qint64 file_size, qint64 mtime,
+                               QVector<WC::Peak> &bins, int &sample_rate)
+{ // a file changed since its peaks were taken is decoded again
+    QFile cache_file(cache_path);
+    if (!cache_file.open(QIODevice::ReadOnly)) return false;
+    WC::Header header;
+    if (cache_file.read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header))) return false;
+    if (header.magic != WC::Magic || header.version != WC::Version || header.sample_rate == 0
+        || header.file_size != file_size || header.mtime != mtime)
+        return false;
+    bins.resize(header.bin_count);
+    qint64 length = qint64(header.bin_count) * sizeof(WC::Peak);
+    if (cache_file.read(reinterpret_cast<char*>(bins.data()), length) != length) return false;
+    sample_rate = header.sample_rate;
+    return true;
+}
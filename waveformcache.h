@@ -0,0 +1,102 @@
+#ifndef WAVEFORMCACHE_H
+#define WAVEFORMCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QVector>
+#include <QThreadPool>
+#include <atomic>
+
+QT_BEGIN_NAMESPACE
+namespace WC { class WaveformCache;}
+QT_END_NAMESPACE
+
+namespace WC
+{
+    const quint32 Magic = 0x4B50574D; // "MWPK"
+    const quint32 Version = 1;
+    // frames per bin of the finest level
+    const int BinFrames = 256;
+
+    // smallest and largest sample of a bin over all channels, scaled to -127..127
+    struct Peak
+    {
+        qint8 lo;
+        qint8 hi;
+    };
+
+    // on-disk layout, native byte order: [Header][Peak * bin_count]
+    // only the finest level is kept, the ones above take no time to rebuild
+    struct Header
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 sample_rate;
+        quint32 bin_count;
+        qint64 file_size;
+        qint64 mtime;
+    };
+
+    // min/max pyramid, each level halves the one below until a single bin is left
+    struct Pyramid
+    {
+        QString file_path;
+        int sample_rate = 0;
+        // false while the file is still being decoded
+        bool complete = false;
+        QVector<QVector<Peak>> levels;
+
+        bool isEmpty() const { return levels.isEmpty() || levels.first().isEmpty(); }
+        // bins go onto the finest level, the levels above are patched from where it grew
+        void append(const Peak* bins, int count);
+        // audio one bin of level covers
+        double binMs(int level) const;
+        // the coarsest level whose bins are no longer than ms
+        int levelFor(double ms) const;
+        // bins of level whose whole span has been decoded
+        int fullBins(int level) const;
+        int bytes() const;
+    };
+}
+
+// waveform overviews, built by decoding the file on a background thread and kept on
+// disk per file, so a track that was shown once comes back without decoding
+// only the newest request is worked on, a track being skipped stops its decode
+class WaveformCache : public QObject
+{
+    Q_OBJECT
+    #define WAVE_MEMORY (2 * 1024) // KB
+    #define WAVE_EMIT_BINS 2048
+
+public:
+    explicit WaveformCache(const QString& init_dir = defaultDir(), QObject *parent = nullptr);
+    ~WaveformCache();
+
+    // gui thread: the peaks come through peaksChanged, at once when they are known,
+    // a piece at a time while they are decoded
+    void request(const QString& file_path);
+    void cancel();
+    const WC::Pyramid& current() const;
+
+    static QString defaultDir();
+
+signals:
+    void peaksChanged(const WC::Pyramid& peaks);
+
+private:
+    QString dir;
+    QCache<QString, WC::Pyramid> pyramids;
+    // peaks of the newest request, growing while it decodes
+    WC::Pyramid pyramid;
+    QThreadPool build_pool;
+    // tasks older than the newest request give up
+    std::atomic<int> serial;
+
+    QString pathOf(const QString& file_path) const;
+    void buildPeaks(int request_serial, const QString& file_path, const QString& cache_path);
+    void binsReady(int request_serial, const QVector<WC::Peak>& bins, int sample_rate, bool complete);
+    static bool readCached(const QString& cache_path, qint64 file_size, qint64 mtime,
+                           QVector<WC::Peak>& bins, int& sample_rate);
+};
+
+#endif // WAVEFORMCACHE_H
@@ -0,0 +1,161 @@
+#include "waveformslider.h"
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionSlider>
+#include <QEvent>
+#include <cmath>
+
+WaveformSlider::WaveformSlider(QWidget *parent)
+    : QSlider{Qt::Horizontal, parent}
+    , drawn_columns(0)
+{
+
+}
+
+WaveformSlider::~WaveformSlider()
+{
+
+}
+
+void WaveformSlider::setPeaks(const WC::Pyramid &newPeaks)
+{ // the same track growing keeps what is drawn, anything else starts over
+    bool same_track = newPeaks.file_path == peaks.file_path && newPeaks.sample_rate == peaks.sample_rate
+            && !newPeaks.isEmpty() && !peaks.isEmpty() && newPeaks.levels[0].size() >= peaks.levels[0].size();
+    peaks = newPeaks;
+    if (!same_track) resetWave();
+    drawColumns();
+    update();
+}
+
+void WaveformSlider::clearPeaks()
+{
+    peaks = WC::Pyramid();
+    resetWave();
+    update();
+}
+
+// protected
+
+void WaveformSlider::paintEvent(QPaintEvent *event)
+{
+    if (peaks.isEmpty() || played_wave.isNull())
+    {
+        QSlider::paintEvent(event);
+        return;
+    }
+    QPainter painter(this);
+    QRect wave = waveRect();
+    qreal ratio = played_wave.devicePixelRatio();
+    int split = QStyle::sliderPositionFromValue(minimum(), maximum(), value(), wave.width());
+    painter.drawPixmap(QRectF(wave.left(), wave.top(), split, wave.height()),
+                       played_wave, QRectF(0, 0, split * ratio, wave.height() * ratio));
+    painter.drawPixmap(QRectF(wave.left() + split, wave.top(), wave.width() - split, wave.height()),
+                       rest_wave, QRectF(split * ratio, 0, (wave.width() - split) * ratio, wave.height() * ratio));
+
+    // the handle as the style draws it, without the groove
+    QStyleOptionSlider option;
+    initStyleOption(&option);
+    option.subControls = QStyle::SC_SliderHandle;
+    style()->drawComplexControl(QStyle::CC_Slider, &option, &painter, this);
+}
+
+void WaveformSlider::resizeEvent(QResizeEvent *event)
+{
+    QSlider::resizeEvent(event);
+    resetWave();
+    drawColumns();
+}
+
+void WaveformSlider::changeEvent(QEvent *event)
+{ // colours come from the palette, the column width from the style
+    QSlider::changeEvent(event);
+    if (event->type() != QEvent::PaletteChange && event->type() != QEvent::StyleChange) return;
+    resetWave();
+    drawColumns();
+}
+
+void WaveformSlider::sliderChange(QAbstractSlider::SliderChange change)
+{ // a new duration spreads the same peaks over the width differently
+    if (change == QAbstractSlider::SliderRangeChange)
+    {
+        resetWave();
+        drawColumns();
+    }
+    QSlider::sliderChange(change);
+}
+
+// private
+
+QRect WaveformSlider::waveRect() const
+{ // the handle's centre travels between these, the waveform lines up with it
+    QStyleOptionSlider option;
+    initStyleOption(&option);
+    QRect groove = style()->subControlRect(QStyle::CC_Slider, &option, QStyle::SC_SliderGroove, this);
+    QRect handle = style()->subControlRect(QStyle::CC_Slider, &option, QStyle::SC_SliderHandle, this);
+    return QRect(groove.left() + handle.width() / 2, 0, qMax(0, groove.width() - handle.width()), height());
+}
+
+void WaveformSlider::resetWave()
+{
+    played_wave = QPixmap();
+    rest_wave = QPixmap();
+    drawn_columns = 0;
+}
+
+void WaveformSlider::drawColumns()
+{ // a column is drawn once every bin it spans has been decoded, later ones wait
+    QRect wave = waveRect();
+    if (peaks.isEmpty() || peaks.sample_rate <= 0 || maximum() <= minimum() || wave.isEmpty()) return;
+    if (played_wave.isNull())
+    {
+        qreal ratio = devicePixelRatioF();
+        played_wave = QPixmap(wave.size() * ratio);
+        played_wave.setDevicePixelRatio(ratio);
+        played_wave.fill(Qt::transparent);
+        rest_wave = played_wave;
+        drawn_columns = 0;
+    }
+    if (drawn_columns >= wave.width()) return;
+
+    // the coarsest level that still has a bin per column, each column folds a few of them
+    double column_ms = double(maximum() - minimum()) / wave.width();
+    int level = peaks.levelFor(column_ms);
+    double bin_ms = peaks.binMs(level);
+    const QVector<WC::Peak>& bins = peaks.levels[level];
+    int full_bins = peaks.fullBins(level);
+    int middle = wave.height() / 2;
+    float scale = qMax(1, middle - 1) / 127.0f;
+
+    QPainter played_painter(&played_wave);
+    QPainter rest_painter(&rest_wave);
+    played_painter.setPen(palette().color(QPalette::Highlight));
+    rest_painter.setPen(palette().color(QPalette::Mid));
+    int column = drawn_columns;
+    for (; column < wave.width(); column++)
+    {
+        int first = int(column * column_ms / bin_ms);
+        int last = qMax(first + 1, int(std::ceil((column + 1) * column_ms / bin_ms)));
+        if (last > full_bins)
+        {
+            if (!peaks.complete) break;
+            // the duration runs a little past the decoded audio, nothing more to draw
+            last = full_bins;
+            if (first >= last)
+            {
+                column = wave.width();
+                break;
+            }
+        }
+        qint8 lo = bins[first].lo;
+        qint8 hi = bins[first].hi;
+        for (int bin = first + 1; bin < last; bin++)
+        {
+            lo = qMin(lo, bins[bin].lo);
+            hi = qMax(hi, bins[bin].hi);
+        }
+        QLineF line(column + 0.5, middle - hi * scale, column + 0.5, middle - lo * scale);
+        played_painter.drawLine(line);
+        rest_painter.drawLine(line);
+    }
+    drawn_columns = column;
+}
@@ -0,0 +1,45 @@
+#ifndef WAVEFORMSLIDER_H
+#define WAVEFORMSLIDER_H
+
+#include <QSlider>
+#include <QPixmap>
+#include "waveformcache.h"
+
+QT_BEGIN_NAMESPACE
+namespace WS { class WaveformSlider;}
+QT_END_NAMESPACE
+
+// seek bar that draws the track's waveform instead of a groove, the played part
+// in the highlight colour; a plain slider until peaks are set
+// the waveform is drawn once into two pixmaps, columns as their peaks arrive,
+// a repaint only copies them, split at the handle
+class WaveformSlider : public QSlider
+{
+    Q_OBJECT
+
+public:
+    explicit WaveformSlider(QWidget *parent = nullptr);
+    ~WaveformSlider();
+
+    void setPeaks(const WC::Pyramid& newPeaks);
+    void clearPeaks();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void sliderChange(QAbstractSlider::SliderChange change) override;
+
+private:
+    WC::Pyramid peaks;
+    QPixmap played_wave;
+    QPixmap rest_wave;
+    // columns of the pixmaps drawn so far, left to right
+    int drawn_columns;
+
+    QRect waveRect() const;
+    void resetWave();
+    void drawColumns();
+};
+
+#endif // WAVEFORMSLIDER_H